@@ -0,0 +1,158 @@
+// Edge filters on a 3x3 neighbourhood, shared by edge_detection.frag and lighting/fused_lighting.comp.
+// The callers only differ in where the neighbours come from (texture taps vs. a shared memory tile).
+// Neighbourhood arrays are row-major from the bottom-left, see edgeTap(): 0 1 2 is y-1, 3 4 5 is y, 6 7 8 is y+1.
+
+uniform float depthThreshold;
+uniform float normalThreshold;
+uniform float sobelThreshold;
+uniform float colorThreshold;
+uniform vec3 edgeColor;
+
+uniform float depthExponent;
+uniform float normalSplit;
+uniform float sobelScale;
+uniform float smoothWidth;
+uniform float laplacianThreshold;
+uniform float laplacianScale;
+
+// EdgeDetectionType bits. Which filters run is the EDGE_FILTERS mask, a permutation define set by
+// Renderer::selectShaderVariants() (every filter when compiled without it), so disabled ones compile out.
+#define DEPTH_BASED 1
+#define NORMAL_BASED 2
+#define SOBEL 4
+#define COLOR_BASED 8
+#define LAPLACIAN 16
+
+#ifndef EDGE_FILTERS
+#define EDGE_FILTERS 31
+#endif
+
+// magic numbers to tune how much each channel impactgs color difference 
+const vec3 EDGE_LUMINANCE_WEIGHTS = vec3(0.299, 0.587, 0.114);
+
+int edgeTap(int x, int y)
+{
+    return (y + 1) * 3 + (x + 1);
+}
+
+// Which neighbourhoods the enabled filters read.
+bool edgesNeedDepth()     { return (EDGE_FILTERS & (DEPTH_BASED | LAPLACIAN)) != 0; }
+bool edgesNeedNormals()   { return (EDGE_FILTERS & (NORMAL_BASED | SOBEL)) != 0; }
+bool edgesNeedLuminance() { return (EDGE_FILTERS & COLOR_BASED) != 0; }
+
+// Linearize depth
+float getLinearDepth(float d)
+{
+    return pow(d, depthExponent);
+}
+
+// TODO: here i'm using a single function to avoid spamming code but I have a feeling some edges are weak because of this.
+float getEdgeIntensity(float val, float threshold)
+{
+    // we have an edge when when val > threshold
+    float edgeW = smoothWidth * 0.01;
+    // using smoothstep seems better than step as it produces slightly less jagged lines
+    //return step(threshold - edgeW, threshold + edgeW, val);
+    return smoothstep(threshold - edgeW, threshold + edgeW, val);
+}
+
+float depthEdgeDetection(float depth[9])
+{
+    float depthGradX = abs(depth[5] - depth[3]);
+    float depthGradY = abs(depth[7] - depth[1]);
+    float depthGrad = sqrt(depthGradX * depthGradX + depthGradY * depthGradY);
+    
+    return getEdgeIntensity(depthGrad, depthThreshold);
+}
+
+float normalEdgeDetection(vec3 normal[9])
+{
+    vec3 center = normal[4];
+    float dotN = dot(center, normal[7]);
+    float dotS = dot(center, normal[1]);
+    float dotE = dot(center, normal[5]);
+    float dotW = dot(center, normal[3]);
+    float minDot = min(min(dotN, dotS), min(dotE, dotW));
+    // Was more precise but also too conservative. For now let's keep it as is
+    //float maxDot = max(max(dotN, dotS), max(dotE, dotW));
+    //float diffDot = abs(maxDot - minDot);
+    float diffDot = 1.0 - minDot;
+    
+    return getEdgeIntensity(diffDot, normalThreshold);
+}
+
+// Sobel computation
+float computeSobel(float tl, float tm, float tr, float ml, float mr, float bl, float bm, float br) 
+{
+    float gx = tl * -1.0 + tr * 1.0 + ml * -2.0 + mr * 2.0 + bl * -1.0 + br * 1.0;
+    float gy = tl * -1.0 + tm * -2.0 + tr * -1.0 + bl * 1.0 + bm * 2.0 + br * 1.0;
+    return sqrt(gx * gx + gy * gy);
+}
+
+float computeSobel(float v[9])
+{
+    return computeSobel(v[6], v[7], v[8], v[3], v[5], v[0], v[1], v[2]);
+}
+
+// Compute Sobel for per-axis Normals
+float normalSobelDetection(vec3 normal[9]) 
+{
+    float nx[9], ny[9], nz[9];
+    for (int i = 0; i < 9; ++i) {
+        nx[i] = normal[i].x;
+        ny[i] = normal[i].y;
+        nz[i] = normal[i].z;
+    }
+    
+    float totalSobel = (computeSobel(nx) + computeSobel(ny) + computeSobel(nz)) * sobelScale; 
+    
+    return getEdgeIntensity(totalSobel, sobelThreshold);
+}
+
+//This computes Sobel for colors
+float colorEdgeDetection(float luminance[9])
+{
+    float edgeStr = computeSobel(luminance) * sobelScale;
+    
+    return getEdgeIntensity(edgeStr, colorThreshold);
+}
+
+// 3 by 3 Laplacian with 8 Neighbor kernel
+float laplacianEdgeDetection(float depth[9]) 
+{
+    float laplacian = -9.0 * depth[4];
+    for (int i = 0; i < 9; ++i) {
+        laplacian += depth[i];
+    }
+    
+    // laplacian measures the intensity of change so we multiply by the slider value and check if it meets the threashold
+    return getEdgeIntensity(abs(laplacian) * laplacianScale, laplacianThreshold);
+}
+
+// Strongest response of the enabled filters. Neighbourhoods a filter doesn't need may be left unset.
+float evaluateEdges(float depth[9], vec3 normal[9], float luminance[9])
+{
+    float edge = 0.0;
+    
+#if (EDGE_FILTERS & DEPTH_BASED) != 0
+    edge = max(edge, depthEdgeDetection(depth));
+#endif
+    
+#if (EDGE_FILTERS & NORMAL_BASED) != 0
+    edge = max(edge, normalEdgeDetection(normal));
+#endif
+    
+#if (EDGE_FILTERS & SOBEL) != 0
+    edge = max(edge, normalSobelDetection(normal));
+#endif
+    
+#if (EDGE_FILTERS & COLOR_BASED) != 0
+    edge = max(edge, colorEdgeDetection(luminance));
+#endif
+    
+#if (EDGE_FILTERS & LAPLACIAN) != 0
+    edge = max(edge, laplacianEdgeDetection(depth));
+#endif
+    
+    return edge;
+}
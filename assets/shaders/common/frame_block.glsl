@@ -0,0 +1,19 @@
+// Per-frame camera and shadow settings, shared by every program.
+// Mirrored on the C++ side by FrameBlockData (src/renderer/UniformBlocks.h).
+layout (std140, binding = 0) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 inverseViewProjection; // For rebuilding world positions from depth (compact G-Buffer)
+
+    vec3 viewPos;
+    float shadowBias;
+
+    float shadowNormalBias;
+    int shadowPCFSamples;
+    float shadowIntensity;
+    bool enablePCF;
+
+    float shadowFarPlane;
+    int renderWidth;   // Pixels drawn this frame. With dynamic resolution that's only
+    int renderHeight;  // the bottom-left part of the G-Buffer and the other screen targets
+};
@@ -0,0 +1,57 @@
+// G-Buffer reads for the passes after the geometry pass. Hides which layout is in use (see gbuffer_encoding.glsl).
+// Needs common/frame_block.glsl included first (position reconstruction uses inverseViewProjection).
+#include "gbuffer_encoding.glsl"
+
+uniform sampler2D gBaseColor;
+uniform sampler2D gNormal;
+uniform sampler2D gPosition;     // Standard layout only
+uniform sampler2D gQuantization;
+uniform sampler2D gDepth;
+
+// Pixels rendered this frame. The targets are allocated at the window size and dynamic resolution only draws
+// the bottom-left renderWidth x renderHeight of them, so texture coordinates below are in G-Buffer texture space.
+ivec2 getRenderSize()
+{
+    return ivec2(renderWidth, renderHeight);
+}
+
+vec2 getGBufferTexelSize()
+{
+    return 1.0 / vec2(textureSize(gNormal, 0));
+}
+
+// Fullscreen [0,1] coordinates to the rendered part of the G-Buffer.
+vec2 toGBufferCoords(vec2 screenCoords)
+{
+    return screenCoords * vec2(getRenderSize()) * getGBufferTexelSize();
+}
+
+// Keeps neighbour taps inside the rendered part (whatever is past it is stale from a larger scale).
+vec2 clampToRenderedRegion(vec2 texCoords)
+{
+    vec2 texelSize = getGBufferTexelSize();
+    return clamp(texCoords, texelSize * 0.5, (vec2(getRenderSize()) - 0.5) * texelSize);
+}
+
+// World position from the depth buffer and the inverse view-projection.
+vec3 reconstructWorldPosition(vec2 texCoords, float depth)
+{
+    vec2 screenCoords = texCoords / (vec2(getRenderSize()) * getGBufferTexelSize());
+    vec4 clip = vec4(vec3(screenCoords, depth) * 2.0 - 1.0, 1.0);
+    vec4 world = inverseViewProjection * clip;
+    return world.xyz / world.w;
+}
+
+// Raw world normal, zero on background pixels (length < 0.1), same as the standard layout's clear value.
+vec3 sampleGBufferNormal(vec2 texCoords)
+{
+    if (!compactGBuffer) return texture(gNormal, texCoords).rgb;
+    if (texture(gDepth, texCoords).r >= 1.0) return vec3(0.0);
+    return decodeOctahedral(texture(gNormal, texCoords).rg);
+}
+
+vec3 sampleGBufferPosition(vec2 texCoords)
+{
+    if (!compactGBuffer) return texture(gPosition, texCoords).rgb;
+    return reconstructWorldPosition(texCoords, texture(gDepth, texCoords).r);
+}
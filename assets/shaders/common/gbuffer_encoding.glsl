@@ -0,0 +1,11 @@
+// Packing shared by the geometry pass (writes) and common/gbuffer.glsl (reads).
+// Two layouts, picked at startup (GBufferLayout in src/renderer/GBuffer.h):
+//   standard: 4 x RGBA16F (base color + type, normal + roughness, position + shininess, params + AO + edge weight)
+//   compact:  RGBA8 base color + material id, RG16_SNORM octahedral normal, RGBA8 roughness / AO / edge weight.
+//             Position comes from the depth buffer, the material parameters from materials[].
+uniform bool compactGBuffer;
+
+// Material ids go into 8 bits of the base color target.
+const float GBUFFER_MATERIAL_ID_SCALE = 255.0;
+
+#include "octahedral.glsl"
@@ -0,0 +1,39 @@
+// Light struct. type can either be 0, 1 or 2 (dir / point / spot)
+// Members are ordered so each vec3 is packed with a scalar (std430), see GPULight in src/renderer/UniformBlocks.h.
+struct Light {
+    vec3 position;
+    int type;
+    vec3 direction;
+    float intensity;
+    vec3 color;
+    float constant;
+    float linear;
+    float quadratic;
+    float cutOff;
+    float outerCutOff;
+    bool castShadows;   // Only true when the light has a shadow slot this frame
+    int shadowTier;     // Resolution tier of the slot
+    int shadowLayer;    // Point lights: cube index in shadowCubeArrays[shadowTier], dir lights: cascade slot
+    float range;        // Point/spot lights: no contribution past this distance (see light_culling.comp)
+    vec4 shadowRect;    // Spot lights: tile in shadowAtlas, xy = offset, zw = scale
+    mat4 lightSpaceMatrix; // Spot lights: world to shadowAtlas tile
+};
+
+// Mirrors LIGHT_BUFFER_MAX_LIGHTS.
+const int MAX_LIGHTS = 512;
+
+// Mirror SHADOW_CASCADE_COUNT / SHADOW_CASCADED_LIGHTS.
+const int MAX_CASCADES = 4;
+const int MAX_CASCADED_LIGHTS = 2;
+
+// Every light, only the ones that changed are re-uploaded.
+layout (std430, binding = 5) readonly buffer LightBuffer {
+    Light lights[];
+};
+
+// Uploaded only when the light count or the cascades change.
+layout (std140, binding = 1) uniform LightBlock {
+    mat4 cascadeMatrices[MAX_CASCADED_LIGHTS * MAX_CASCADES]; // Layer in shadowCascades: shadowLayer * MAX_CASCADES + cascade
+    int numLights;
+    int cascadeCount;
+};
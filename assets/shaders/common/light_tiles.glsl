@@ -0,0 +1,9 @@
+// Per-tile light lists, written by lighting/light_culling.comp and read by the lighting pass.
+// LIGHT_TILE_SIZE^2 pixels per tile, row-major. A tile's mask is LIGHT_TILE_WORDS uints, bit i of word w is
+// lights[w * 32 + i]. Mirrors LIGHT_TILE_SIZE / LIGHT_TILE_WORDS in UniformBlocks.h.
+const int LIGHT_TILE_SIZE = 16;
+const int LIGHT_TILE_WORDS = 16;
+
+layout (std430, binding = 3) buffer LightTileBuffer {
+    uint lightTileMasks[];
+};
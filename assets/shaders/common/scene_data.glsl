@@ -0,0 +1,83 @@
+// Per-instance and per-material data of the flattened scene.
+// Mirrored on the C++ side by GPUInstance/GPUModel/GPUMaterial (src/renderer/UniformBlocks.h).
+
+struct InstanceData {
+    mat4 model;
+    uint materialId;
+    uint modelId;
+};
+
+layout (std430, binding = 0) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+};
+
+// Instances that survived culling for the current pass, compacted by the renderer.
+// Draws address this list, not instances[] directly. The GPU culling passes write it (see occlusion_cull.comp).
+#ifndef VISIBLE_INSTANCE_ACCESS
+#define VISIBLE_INSTANCE_ACCESS readonly
+#endif
+layout (std430, binding = 2) VISIBLE_INSTANCE_ACCESS buffer VisibleInstanceBuffer {
+    uint visibleInstances[];
+};
+
+// Layered passes (point shadow cube faces) store the target layer in the top bits of each entry.
+const uint VISIBLE_INSTANCE_LAYER_SHIFT = 29u;
+const uint VISIBLE_INSTANCE_INDEX_MASK = (1u << VISIBLE_INSTANCE_LAYER_SHIFT) - 1u;
+
+// Call from the vertex shader with gl_BaseInstance + gl_InstanceID,
+// so both instanced and multi-draw-indirect submissions work.
+InstanceData fetchInstance(int drawInstance)
+{
+    return instances[visibleInstances[drawInstance] & VISIBLE_INSTANCE_INDEX_MASK];
+}
+
+// Vertex positions are unorm16 inside the bounding box of their model (see MeshBuilder).
+// diffuseTexture is a bindless handle (see geometry.frag), zero when untextured or without bindless textures.
+struct ModelData {
+    vec4 positionMin;
+    vec4 positionExtent;
+    uvec2 diffuseTexture;
+};
+
+layout (std430, binding = 4) readonly buffer ModelBuffer {
+    ModelData models[];
+};
+
+vec3 decodePosition(InstanceData instance, vec3 quantized)
+{
+    ModelData modelData = models[instance.modelId];
+    return modelData.positionMin.xyz + quantized * modelData.positionExtent.xyz;
+}
+
+// Layer this draw instance targets, 0 outside layered passes.
+int fetchLayer(int drawInstance)
+{
+    return int(visibleInstances[drawInstance] >> VISIBLE_INSTANCE_LAYER_SHIFT);
+}
+
+struct MaterialData {
+    vec3 albedo;
+    float roughness;
+    float specularShininess;
+    int materialType;
+    float minnaertK;
+    float orenNayarRoughness;
+    float ashikhminShirleyNu;
+    float ashikhminShirleyNv;
+    float cookTorranceRoughness;
+    float cookTorranceF0;
+    float intensityCorrection;
+    float ambientOcclusion;
+};
+
+layout (std430, binding = 1) readonly buffer MaterialBuffer {
+    MaterialData materials[];
+};
+
+// The two parameters of the material's illumination model, as the lighting pass expects them.
+vec2 getIlluminationParams(MaterialData material)
+{
+    if (material.materialType == 3) return vec2(material.ashikhminShirleyNu, material.ashikhminShirleyNv);
+    if (material.materialType == 4) return vec2(material.cookTorranceRoughness, material.cookTorranceF0);
+    return vec2(material.minnaertK, material.orenNayarRoughness);
+}
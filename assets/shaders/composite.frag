@@ -5,21 +5,34 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D lightingTexture;
-uniform sampler2D edgeTexture;
+uniform sampler2D edgeTexture;   // Edge strength in alpha
 
 uniform bool enableOutlining;
+uniform vec3 edgeColor;
+
+// Dynamic resolution: the inputs only cover the rendered part of their textures and are upsampled here.
+uniform vec2 uvScale;        // Rendered size / texture size
+uniform vec2 uvMax;          // Center of the last rendered texel, bilinear taps never reach past it
+uniform float upscaleRatio;  // Screen pixels per rendered pixel, 1 at full resolution
+uniform bool sharpenEdges;   // Edge-aware upsample: steepen the bilinear edge ramp back to about one screen pixel
 
 void main()
 {
-    vec3 lighting = texture(lightingTexture, TexCoords).rgb;
-    vec4 edge = texture(edgeTexture, TexCoords);
+    vec2 uv = min(TexCoords * uvScale, uvMax);
+    vec3 lighting = texture(lightingTexture, uv).rgb;
+    float edge = texture(edgeTexture, uv).a;
+    
+    // Bilinear filtering spreads a one texel outline over upscaleRatio screen pixels, this pulls it back together.
+    if (sharpenEdges && upscaleRatio > 1.0) {
+        edge = clamp((edge - 0.5) * upscaleRatio + 0.5, 0.0, 1.0);
+    }
     
     vec3 finalColor = lighting;
     
     if (enableOutlining) {
         // Blend lighting with edges
-        finalColor = mix(lighting, edge.rgb, edge.a);
+        finalColor = mix(lighting, edgeColor * edge, edge);
     }
     
     FragColor = vec4(finalColor, 1.0);
-}
\ No newline at end of file
+}
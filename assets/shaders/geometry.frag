@@ -1,5 +1,13 @@
 #version 460 core
 
+// BINDLESS_TEXTURES: the diffuse texture comes from the model buffer, see Renderer::usesBindlessTextures().
+// ARB_bindless_texture alone wants a dynamically uniform handle, and ModelId is a flat input that can change
+// within one multi-draw; GL_NV_gpu_shader5 lifts that restriction, so the renderer only enables both together.
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#extension GL_NV_gpu_shader5 : require
+#endif
+
 // G-Buffer
 layout (location = 0) out vec4 gBaseColor;      // RGB: Base color, A: Material type
 layout (location = 1) out vec4 gNormal;         // RGB: World normal, A: Roughness
@@ -24,33 +32,36 @@ uniform bool hasRoughnessMap;
 uniform bool hasMetallicMap;
 uniform bool hasAOMap;
 
-// Material parameters
-uniform vec3 albedo;
-uniform float roughness;
-uniform float specularShininess;
-uniform int materialType;        
-uniform float minnaertK;         
-uniform float orenNayarRoughness; 
-uniform float ashikhminShirleyNu; 
-uniform float ashikhminShirleyNv; 
-uniform float cookTorranceRoughness; 
-uniform float cookTorranceF0;        
-uniform float intensityCorrection;
-uniform float ambientOcclusion;
+// Material parameters, indexed by the per-instance material id.
+flat in uint MaterialId;
+flat in uint ModelId;
+
+#include "common/scene_data.glsl"
+#include "common/gbuffer_encoding.glsl"
 
 void main()
 {
+    MaterialData material = materials[MaterialId];
+
     // Sample base color from texture
     vec3 baseColor;
+#ifdef BINDLESS_TEXTURES
+    // One multi-draw covers every model, so the handle isn't dynamically uniform (fine with NV_gpu_shader5).
+    uvec2 diffuseHandle = models[ModelId].diffuseTexture;
+    if (any(notEqual(diffuseHandle, uvec2(0u)))) {
+        baseColor = texture(sampler2D(diffuseHandle), TexCoords).rgb * material.intensityCorrection;
+    } else {
+#else
     if (hasTexture) {
-        baseColor = texture(texture_diffuse1, TexCoords).rgb * intensityCorrection;
+        baseColor = texture(texture_diffuse1, TexCoords).rgb * material.intensityCorrection;
     } else {
-        baseColor = albedo * intensityCorrection;
+#endif
+        baseColor = material.albedo * material.intensityCorrection;
     }
     
-    float materialRoughness = hasRoughnessMap ? texture(texture_roughness1, TexCoords).r : roughness;
+    float materialRoughness = hasRoughnessMap ? texture(texture_roughness1, TexCoords).r : material.roughness;
     // float materialMetallic = hasMetallicMap ? texture(texture_metallic1, TexCoords).r : metallic; // logic unused now
-    float materialAO = hasAOMap ? texture(texture_ao1, TexCoords).r : ambientOcclusion;
+    float materialAO = hasAOMap ? texture(texture_ao1, TexCoords).r : material.ambientOcclusion;
 
     
     // Normal mapping
@@ -62,28 +73,27 @@ void main()
         worldNormal = normalize(Normal);
     }
     
+    // Compact layout: material id instead of its parameters, octahedral normal, no position (rebuilt from depth).
+    // Nothing is attached to location 2 there.
+    if (compactGBuffer) {
+        gBaseColor = vec4(baseColor, float(MaterialId) / GBUFFER_MATERIAL_ID_SCALE);
+        gNormal = vec4(encodeOctahedral(worldNormal), 0.0, 0.0);
+        gQuantization = vec4(materialRoughness, materialAO, 1.0, 0.0);
+        return;
+    }
+    
     // Fill G-Buffer
-    gBaseColor = vec4(baseColor, float(materialType));
+    gBaseColor = vec4(baseColor, float(material.materialType));
     gNormal = vec4(worldNormal, materialRoughness);
 
-    gPosition = vec4(FragPos, specularShininess);
-    float param1 = minnaertK;
-    float param2 = orenNayarRoughness;
+    gPosition = vec4(FragPos, material.specularShininess);
     
     // Set correct parameters based on the active illum model
-    if (materialType == 3) {
-        param1 = ashikhminShirleyNu;
-        param2 = ashikhminShirleyNv;
-    }
-    
-    if (materialType == 4) {
-        param1 = cookTorranceRoughness;
-        param2 = cookTorranceF0;
-    }
+    vec2 params = getIlluminationParams(material);
 
     gQuantization = vec4(
-        param1,
-        param2,
+        params.x,
+        params.y,
         materialAO,
         1.0  // Edge detection weight
     );
@@ -1,23 +1,31 @@
 #version 460 core
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 0) in vec3 aPos;      // Quantized, see decodePosition()
+layout (location = 1) in vec2 aNormal;   // Octahedral
 layout (location = 2) in vec2 aTexCoords;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+flat out uint MaterialId;
+flat out uint ModelId;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/frame_block.glsl"
+#include "common/scene_data.glsl"
+#include "common/octahedral.glsl"
 
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    // Per-instance data from the scene instance buffer.
+    InstanceData instance = fetchInstance(gl_BaseInstance + gl_InstanceID);
+    mat4 model = instance.model;
+
+    vec4 worldPos = model * vec4(decodePosition(instance, aPos), 1.0);
     FragPos = worldPos.xyz;
-    Normal = transpose(inverse(mat3(model))) * aNormal;
+    Normal = transpose(inverse(mat3(model))) * decodeOctahedral(aNormal);
     TexCoords = aTexCoords;
+    MaterialId = instance.materialId;
+    ModelId = instance.modelId;
     
     gl_Position = projection * view * worldPos;
 }
\ No newline at end of file
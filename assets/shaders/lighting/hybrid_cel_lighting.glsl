@@ -0,0 +1,690 @@
+// Deferred cel lighting of a G-Buffer pixel, shared by the fullscreen pass (hybrid_cel_lighting.frag)
+// and the fused compute path (fused_lighting.comp). Entry point is shadeGBufferPixel().
+
+// Permutation, defined by Renderer::selectShaderVariants() (everything on when compiled without it):
+// MATERIAL_TYPES        bit per IlluminationModel present in the scene, absent models compile out
+// SINGLE_MATERIAL_TYPE  set when only one model is present, the per-pixel type is then a constant
+// QUANTIZATION          1 = cel shading, 0 = the "photorealistic" path
+// SHADOW_PCF            1 = filtered shadows (shadowPCFSamples still picks the kernel radius), 0 = one tap
+// SHADOW_POISSON        1 = rotated Poisson disk kernel, 0 = grid kernel (ShadowFilter in Renderer.h)
+// SHADOW_POISSON_TAPS   taps of the Poisson disk: 8, 16 or 32
+#ifndef MATERIAL_TYPES
+#define MATERIAL_TYPES 31
+#endif
+#ifndef QUANTIZATION
+#define QUANTIZATION 1
+#endif
+#ifndef SHADOW_PCF
+#define SHADOW_PCF 1
+#endif
+#ifndef SHADOW_POISSON
+#define SHADOW_POISSON 1
+#endif
+#ifndef SHADOW_POISSON_TAPS
+#define SHADOW_POISSON_TAPS 16
+#endif
+
+// Shadow maps.
+// Every spot light has a tile in the atlas, every point light a cube in one of the per-tier cube arrays,
+// every directional light a set of cascades (see Light.shadowRect / shadowTier / shadowLayer).
+// The sampler count no longer grows with the lights.
+// All of them compare in the texture unit (GL_TEXTURE_COMPARE_MODE): a lookup returns the lit fraction, and with
+// PCF enabled the maps are linearly filtered so each lookup is already a bilinear 2x2 PCF.
+uniform sampler2DShadow shadowAtlas;
+uniform samplerCubeArrayShadow shadowCubeArrays[3];
+uniform sampler2DArrayShadow shadowCascades;
+
+// Camera data and shadow parameters (view, projection, viewPos, shadowBias, ...)
+#include "../common/frame_block.glsl"
+
+// G-Buffer textures and decode helpers (either layout), materials[] for the compact one
+#include "../common/gbuffer.glsl"
+#include "../common/scene_data.glsl"
+
+// Light data (lights[], numLights, cascade matrices)
+// For now this shader only really behaves well with dir + point lights.
+// Spot lights technically work but aren't tuned.
+#include "../common/light_block.glsl"
+
+// Lights reaching each screen tile (lightTileMasks[]), see light_culling.comp.
+// When the culling pass is off, every light is shaded.
+#include "../common/light_tiles.glsl"
+uniform bool useLightTiles;
+
+// Words of the light masks in use, 32 lights each.
+int getLightWordCount()
+{
+    return min((numLights + 31) / 32, LIGHT_TILE_WORDS);
+}
+
+// Bitmask of the lights lights[word * 32 ...] to shade for this pixel.
+uint getPixelLightMask(ivec2 pixel, int word)
+{
+    int remaining = numLights - word * 32;
+    uint allLights = remaining >= 32 ? 0xFFFFFFFFu : (1u << uint(max(remaining, 0))) - 1u;
+    if (!useLightTiles) return allLights;
+
+    ivec2 tile = pixel / LIGHT_TILE_SIZE;
+    int tilesX = (getRenderSize().x + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+    return lightTileMasks[(tile.y * tilesX + tile.x) * LIGHT_TILE_WORDS + word] & allLights;
+}
+
+// Cel shading parameters
+uniform int diffuseQuantizationBands;
+uniform float specularThreshold1;
+uniform float specularThreshold2;
+
+// PCF kernel of the point lights in grid mode: directions spread over a sphere
+const vec3 sampleOffsetDirections[20] = vec3[]
+(
+   vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
+   vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
+   vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
+   vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
+   vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
+);
+
+// Unit disk, best-candidate ordered: the first 8 and 16 points are evenly spread on their own.
+const vec2 POISSON_DISK[32] = vec2[]
+(
+    vec2( 0.3500,  0.2000), vec2(-0.7524, -0.5535), vec2(-0.7077,  0.6530), vec2( 0.3186, -0.8679),
+    vec2( 0.0128,  0.9500), vec2( 0.8403, -0.3523), vec2(-0.3313,  0.0364), vec2(-0.9700,  0.0697),
+    vec2(-0.2788, -0.9353), vec2( 0.5922,  0.7621), vec2( 0.9021,  0.2923), vec2( 0.0151, -0.4184),
+    vec2(-0.2190,  0.5207), vec2( 0.3852, -0.2324), vec2( 0.2098,  0.5895), vec2(-0.4023, -0.3433),
+    vec2( 0.6728, -0.6966), vec2( 0.0654, -0.0528), vec2(-0.3999,  0.9106), vec2(-0.6466,  0.2708),
+    vec2( 0.7174, -0.0112), vec2(-0.6583, -0.0878), vec2(-0.4433, -0.6604), vec2( 0.3200, -0.5465),
+    vec2(-0.9509, -0.2651), vec2( 0.0187,  0.2841), vec2( 0.6043,  0.3958), vec2( 0.0214, -0.7359),
+    vec2( 0.3204,  0.8927), vec2( 0.9876, -0.1027), vec2( 0.5853, -0.4381), vec2(-0.9194,  0.3438)
+);
+
+// Per-pixel rotation of the Poisson disk, set by shadeGBufferPixel(). Turns the banding of a small kernel into noise.
+mat2 shadowKernelRotation = mat2(1.0);
+
+// Taps of the 2D PCF kernel and the offset (in texels) of tap i.
+// Grid: (n + 1)^2 taps two texels apart, each bilinear tap covers the 2x2 texels the old one-texel grid read one by one.
+// Poisson: the disk scaled to the same footprint, n + 0.5 texels.
+int getShadowKernelTaps()
+{
+#if SHADOW_POISSON
+    return SHADOW_POISSON_TAPS;
+#else
+    return (shadowPCFSamples + 1) * (shadowPCFSamples + 1);
+#endif
+}
+
+vec2 getShadowKernelOffset(int tap)
+{
+#if SHADOW_POISSON
+    return shadowKernelRotation * POISSON_DISK[tap] * (float(shadowPCFSamples) + 0.5);
+#else
+    int side = shadowPCFSamples + 1;
+    return vec2(tap % side, tap / side) * 2.0 - float(shadowPCFSamples);
+#endif
+}
+
+// Calculate shadow for spot lights
+float calculateDirectionalSpotShadow(int lightIndex, vec3 fragPos, vec3 normal, vec3 lightDir)
+{
+    // First we need to transform to light space, then perspective divide and finally normalize to 0,1
+    vec4 fragPosLightSpace = lights[lightIndex].lightSpaceMatrix * vec4(fragPos, 1.0);
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    
+    // If outside shadow map then there is no shadow
+    if(projCoords.z > 1.0 || projCoords.x < 0.0 || projCoords.x > 1.0 || 
+       projCoords.y < 0.0 || projCoords.y > 1.0){
+        //return 0;
+        return 1.0;
+       }
+    
+    // Get depth from light's perspective
+    float currentDepth = projCoords.z;
+    
+    // Move into the light's atlas tile. Lookups are clamped half a texel inside it so PCF never reads a neighbour.
+    vec4 tile = lights[lightIndex].shadowRect;
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec2 tileMin = tile.xy + texelSize * 0.5;
+    vec2 tileMax = tile.xy + tile.zw - texelSize * 0.5;
+    vec2 atlasCoords = tile.xy + projCoords.xy * tile.zw;
+    
+    // Calculate bias
+    float bias = max(shadowBias * (1.0 - dot(normal, lightDir)), shadowBias * 0.1);
+    
+    // Fake the position to be further along its normal to reduce shadow acne
+    vec3 offsetPos = fragPos + normal * shadowNormalBias;
+    vec4 offsetPosLightSpace = lights[lightIndex].lightSpaceMatrix * vec4(offsetPos, 1.0);
+    vec3 offsetProjCoords = offsetPosLightSpace.xyz / offsetPosLightSpace.w;
+    offsetProjCoords = offsetProjCoords * 0.5 + 0.5;
+    currentDepth = offsetProjCoords.z;
+    float compareDepth = currentDepth - bias;
+    
+    float shadow = 0.0;
+    
+    // Check if PCF is enabled and if so do the computations
+#if SHADOW_PCF
+    if (enablePCF && shadowPCFSamples > 0) {
+        int taps = getShadowKernelTaps();
+        float lit = 0.0;
+        for (int i = 0; i < taps; ++i) {
+            vec2 sampleCoords = clamp(atlasCoords + getShadowKernelOffset(i) * texelSize, tileMin, tileMax);
+            lit += texture(shadowAtlas, vec3(sampleCoords, compareDepth));
+        }
+        shadow = 1.0 - lit / float(taps);
+    } else
+#endif
+    {
+        shadow = 1.0 - texture(shadowAtlas, vec3(clamp(atlasCoords, tileMin, tileMax), compareDepth));
+    }
+    
+    // Once we're done with computing shadow we have to weight it
+    shadow = mix(1.0, 1.0 - shadow, 1.0 - shadowIntensity);
+    
+    return shadow;
+}
+
+// Calculate shadow for directional lights from their cascades.
+// The cascade is the first (sharpest) one whose box contains the fragment. Going by the box instead of the view depth
+// stays correct when a cascade refit was postponed and the cascades lag behind the camera for a frame or two.
+float calculateCascadedShadow(int lightIndex, vec3 fragPos, vec3 normal, vec3 lightDir)
+{
+    // Fake the position to be further along its normal to reduce shadow acne
+    vec3 offsetPos = fragPos + normal * shadowNormalBias;
+    
+    int cascade = -1;
+    vec3 projCoords;
+    int firstMatrix = lights[lightIndex].shadowLayer * MAX_CASCADES;
+    for (int c = 0; c < cascadeCount; ++c) {
+        vec4 posLightSpace = cascadeMatrices[firstMatrix + c] * vec4(offsetPos, 1.0);
+        projCoords = posLightSpace.xyz / posLightSpace.w * 0.5 + 0.5;
+        if (all(greaterThanEqual(projCoords, vec3(0.0))) && all(lessThanEqual(projCoords, vec3(1.0)))) {
+            cascade = c;
+            break;
+        }
+    }
+    
+    // Past the last cascade there is no shadow
+    if (cascade < 0) return 1.0;
+    
+    float layer = float(firstMatrix + cascade);
+    float currentDepth = projCoords.z;
+    float bias = max(shadowBias * (1.0 - dot(normal, lightDir)), shadowBias * 0.1);
+    float compareDepth = currentDepth - bias;
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowCascades, 0).xy);
+    
+    float shadow = 0.0;
+    
+#if SHADOW_PCF
+    if (enablePCF && shadowPCFSamples > 0) {
+        int taps = getShadowKernelTaps();
+        float lit = 0.0;
+        for (int i = 0; i < taps; ++i) {
+            lit += texture(shadowCascades, vec4(projCoords.xy + getShadowKernelOffset(i) * texelSize, layer, compareDepth));
+        }
+        shadow = 1.0 - lit / float(taps);
+    } else
+#endif
+    {
+        shadow = 1.0 - texture(shadowCascades, vec4(projCoords.xy, layer, compareDepth));
+    }
+    
+    shadow = mix(1.0, 1.0 - shadow, 1.0 - shadowIntensity);
+    
+    return shadow;
+}
+
+// Lit fraction at distance depth from the light, in a direction of its cube (which stores distance / farPlane).
+// Explicit branches keep the sampler index a constant.
+float sampleShadowCube(int lightIndex, vec3 direction, float depth)
+{
+    vec4 coords = vec4(direction, float(lights[lightIndex].shadowLayer));
+    float compareDepth = depth / shadowFarPlane;
+    int tier = lights[lightIndex].shadowTier;
+    if (tier == 0) return texture(shadowCubeArrays[0], coords, compareDepth);
+    if (tier == 1) return texture(shadowCubeArrays[1], coords, compareDepth);
+    return texture(shadowCubeArrays[2], coords, compareDepth);
+}
+
+// Calculate shadow using damned cube maps
+float calculatePointShadow(int lightIndex, vec3 fragPos, vec3 lightPos)
+{
+    // Get distance from light to fragment
+    vec3 fragToLight = fragPos - lightPos;
+    float currentDepth = length(fragToLight);
+    
+    // Since point lights are giving a ton of acne we gonna increase it
+    float bias = shadowBias * 2.5;
+    float compareDepth = currentDepth - bias;
+    
+    float shadow = 0.0;
+    
+    // Check if PCF is enabled and if so do the computations
+#if SHADOW_PCF
+    if (enablePCF && shadowPCFSamples > 0) {
+        // Offsets in world units on fragToLight, 0.1 for the default kernel like the old 4x4x4 grid.
+        float diskRadius = 0.05 * float(shadowPCFSamples);
+        float lit = 0.0;
+#if SHADOW_POISSON
+        // The disk lies across the direction to the light.
+        vec3 axis = normalize(fragToLight);
+        vec3 tangent = normalize(cross(axis, abs(axis.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+        vec3 bitangent = cross(axis, tangent);
+        for (int i = 0; i < SHADOW_POISSON_TAPS; ++i) {
+            vec2 offset = shadowKernelRotation * POISSON_DISK[i] * diskRadius;
+            lit += sampleShadowCube(lightIndex, fragToLight + tangent * offset.x + bitangent * offset.y, compareDepth);
+        }
+        shadow = 1.0 - lit / float(SHADOW_POISSON_TAPS);
+#else
+        for (int i = 0; i < 20; ++i) {
+            lit += sampleShadowCube(lightIndex, fragToLight + sampleOffsetDirections[i] * diskRadius, compareDepth);
+        }
+        shadow = 1.0 - lit / 20.0;
+#endif
+    } else
+#endif
+    {
+        // Hard shadows
+        shadow = 1.0 - sampleShadowCube(lightIndex, fragToLight, compareDepth);
+    }
+    
+    shadow = mix(1.0, 1.0 - shadow, 1.0 - shadowIntensity);
+    
+    return shadow;
+}
+
+// Simple quantization for lighti intensity and specular highlights
+float quantizeDiffuseIntensity(float intensity, int bands) {
+    if (bands <= 1) return intensity;
+    
+    float bandsFloat = float(bands);
+    intensity = clamp(intensity, 0.0, 1.0);
+    return floor(intensity * bandsFloat + 0.5) / bandsFloat;
+}
+
+float quantizeSpecularIntensity(float intensity, float threshold1, float threshold2) {
+    intensity = clamp(intensity, 0.0, 1.0);
+    threshold1 = clamp(threshold1, 0.0, 1.0);
+    threshold2 = clamp(threshold2, threshold1 + 0.01, 1.0);
+    
+    if (intensity < threshold1) {
+        return 0.0;
+    } else if (intensity < threshold2) {
+        return 0.8;
+    } else {
+        return 0.95;
+    }
+}
+
+vec3 hybridCelShading(vec3 baseColor, float diffuseIntensity, float specularIntensity, int diffuseBands, float specThreshold1, float specThreshold2, float shadowFactor) {
+    
+    // Turns out that if we apply shadow BEFORE quantization we obtain better cel shading
+    diffuseIntensity *= shadowFactor;
+    
+    // Quantize diffuse intensity
+    float quantizedDiffuse = quantizeDiffuseIntensity(diffuseIntensity, diffuseBands);
+    
+    // Apply quantized diffuse to base color
+    vec3 diffuseColor = baseColor * quantizedDiffuse;
+    
+    // no specular in shadowed areas
+    specularIntensity *= shadowFactor;
+    
+    // Quantize specular highlights
+    float quantizedSpecular = quantizeSpecularIntensity(specularIntensity, specThreshold1, specThreshold2);
+    
+    // Add quantized specular
+    vec3 specularColor = vec3(quantizedSpecular * 0.6);
+    vec3 finalColor = diffuseColor + specularColor;
+    
+    // Gamma correction
+    //finalColor = pow(finalColor, vec3(0.9));
+    finalColor = pow(finalColor, vec3(1));
+    
+    return finalColor;
+}
+
+// Blinn-Phong specular calculation
+float calculateSpecularIntensity(vec3 lightDir, vec3 viewDir, vec3 normal, float shininess) {
+    float NdotL = max(dot(normal, lightDir), 0.0);
+    if (NdotL <= 0.0) return 0.0;
+    
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float NdotH = max(dot(normal, halfwayDir), 0.0);
+    
+    float specular = pow(NdotH, shininess);
+    return specular * NdotL;
+}
+
+// G-buffer data structure
+struct GBufferData {
+    vec3 baseColor;
+    float materialType;
+    vec3 worldNormal;
+    float roughness;
+    vec3 worldPosition;
+    float specularShininess;
+    float ambientOcclusion;
+    float edgeWeight;
+    vec2 modelParams;      // Parameters of the illumination model, see getIlluminationParams()
+};
+
+GBufferData sampleGBuffer(vec2 texCoords) {
+    GBufferData data;
+    
+    vec4 baseColorData = texture(gBaseColor, texCoords);
+    vec4 quantizationData = texture(gQuantization, texCoords);
+    
+    // Compact layout: material id instead of the per-pixel copies, position from depth.
+    if (compactGBuffer) {
+        MaterialData material = materials[uint(round(baseColorData.a * GBUFFER_MATERIAL_ID_SCALE))];
+        data.baseColor = baseColorData.rgb;
+        data.materialType = float(material.materialType);
+        data.worldNormal = sampleGBufferNormal(texCoords);
+        data.roughness = quantizationData.r;
+        data.worldPosition = sampleGBufferPosition(texCoords);
+        data.specularShininess = material.specularShininess;
+        data.ambientOcclusion = quantizationData.g;
+        data.edgeWeight = quantizationData.b;
+        data.modelParams = getIlluminationParams(material);
+        return data;
+    }
+    
+    vec4 normalData = texture(gNormal, texCoords);
+    vec4 positionData = texture(gPosition, texCoords);
+    
+    data.baseColor = baseColorData.rgb;
+    data.materialType = baseColorData.a;
+    data.worldNormal = normalize(normalData.rgb);
+    data.roughness = normalData.a;
+    data.worldPosition = positionData.rgb;
+    data.specularShininess = positionData.a;
+    data.ambientOcclusion = quantizationData.b;
+    data.edgeWeight = quantizationData.a;
+    data.modelParams = quantizationData.rg;
+    
+    return data;
+}
+
+// Minnaert illumination model
+vec3 calculateMinnaert(vec3 normal, vec3 lightDir, vec3 viewDir, float k) {
+    float NdotL = max(dot(normal, lightDir), 0.0);
+    float NdotV = max(dot(normal, viewDir), 0.0);
+    return vec3(pow(max(NdotL * NdotV, 0.001), k));
+}
+
+// Oren-Nayar illumination model
+vec3 calculateOrenNayar(vec3 normal, vec3 lightDir, vec3 viewDir, float roughness, vec3 albedo) {
+    float sigma2 = roughness * roughness;
+    float A = 1.0 - (sigma2 / (2.0 * (sigma2 + 0.33)));
+    float B = 0.45 * sigma2 / (sigma2 + 0.09);
+    
+    float NdotL = max(dot(normal, lightDir), 0.0);
+    float NdotV = max(dot(normal, viewDir), 0.0);
+    
+    vec3 lightProj = lightDir - normal * NdotL;
+    vec3 viewProj = viewDir - normal * NdotV;
+    
+    if (length(lightProj) > 0.001) lightProj = normalize(lightProj);
+    if (length(viewProj) > 0.001) viewProj = normalize(viewProj);
+    
+    float deltaAlpha = max(0.0, dot(lightProj, viewProj));
+    float sinAlpha, tanBeta;
+    if (NdotL < NdotV) {
+        sinAlpha = sqrt(max(0.0, 1.0 - NdotL*NdotL));
+        tanBeta = sqrt(max(0.0, 1.0 - NdotV*NdotV)) / max(NdotV, 0.001);
+    } else {
+        sinAlpha = sqrt(max(0.0, 1.0 - NdotV*NdotV));
+        tanBeta = sqrt(max(0.0, 1.0 - NdotL*NdotL)) / max(NdotL, 0.001);
+    }
+    
+    return albedo * NdotL * (A + B * deltaAlpha * sinAlpha * tanBeta);
+}
+
+// Ashikhmin-Shirley model
+void determineTangentFrame(vec3 N, out vec3 T, out vec3 B) {
+    vec3 up = abs(N.y) < 0.999999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    T = normalize(cross(up, N));
+    B = cross(N, T);
+}
+
+vec3 calculateAshikhminShirley(vec3 N, vec3 L, vec3 V, float nu, float nv, vec3 albedo) {
+    vec3 H = normalize(L + V);
+    vec3 T, B;
+    determineTangentFrame(N, T, B);
+    
+    float NdotL = max(dot(N, L), 0.0);
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotH = max(dot(N, H), 0.0);
+    float HdotV = max(dot(H, V), 0.0);
+    
+    if (NdotL == 0.0 || NdotV == 0.0) return vec3(0.0);
+    
+    // Diffuse term
+    float Rd = (28.0 * (1.0 - max(dot(N, L), 0.0) / 2.0) * (1.0 - max(dot(N, V), 0.0) / 2.0)) / (23.0 * 3.14159);
+    vec3 diffuse = albedo * Rd * (1.0 - pow(1.0 - NdotL / 2.0, 5.0)) * (1.0 - pow(1.0 - NdotV / 2.0, 5.0));
+    
+    // Specular term
+    float HdotT = dot(H, T);
+    float HdotB = dot(H, B);
+    
+    float exponent = (nu * HdotT * HdotT + nv * HdotB * HdotB) / (1.0 - NdotH * NdotH);
+    float numerator = sqrt((nu + 1.0) * (nv + 1.0)) * pow(NdotH, exponent);
+    float denominator = 8.0 * 3.14159 * HdotV * max(NdotL, NdotV);
+    
+    // Fresnel term (Schlick approximation with magic numbers)
+    vec3 F0 = vec3(0.04);
+    vec3 F = F0 + (1.0 - F0) * pow(1.0 - HdotV, 5.0);
+    
+    vec3 specular = (numerator / denominator) * F;
+    
+    return diffuse + specular; 
+}
+
+// Cook-Torrance lighting
+vec3 calculateCookTorrance(vec3 N, vec3 L, vec3 V, float roughness, float F0_val, vec3 albedo) {
+    vec3 H = normalize(L + V);
+    
+    float NdotL = max(dot(N, L), 0.0);
+    float NdotV = max(dot(N, V), 0.0);
+    
+    if (NdotL == 0.0) return vec3(0.0);
+    
+    // Normal Distribution Function (Beckmann)
+    float NdotH = max(dot(N, H), 0.001);
+    float NdotH2 = NdotH * NdotH;
+    float m2 = roughness * roughness;
+    float r1 = 1.0 / (4.0 * m2 * pow(NdotH, 4.0));
+    float r2 = (NdotH2 - 1.0) / (m2 * NdotH2);
+    float D = r1 * exp(r2);
+    
+    // Geometric Attenuation (Cook-Torrance)
+    float HdotV = max(dot(H, V), 0.0);
+    float NdotH_x2 = 2.0 * NdotH;
+    float G1 = (NdotH_x2 * NdotV) / HdotV;
+    float G2 = (NdotH_x2 * NdotL) / HdotV;
+    float G = min(1.0, min(G1, G2));
+    
+    // Fresnel again for kS
+    vec3 F0 = vec3(F0_val);
+    vec3 F = F0 + (1.0 - F0) * pow(1.0 - HdotV, 5.0);
+    
+    // Specular component
+    vec3 numerator = D * F * G;
+    float denominator = 4.0 * NdotV * NdotL + 0.001; 
+    vec3 kS = numerator / denominator;
+    
+    // Theory note: energy conservation implies we subtract specular but, for simple integration, we don't and instead we compute how much light is not reflected and modulate intensity
+    // TODO: should probably look into it since I always have to increase intensity multiplier when using this model otherwise it's too dark
+    // Diffuse component (energy conservation)
+    vec3 kD = vec3(1.0) - F; // F represents the ratio of light that gets reflected
+    
+    // Final color
+    return (kD * albedo / 3.14159 + kS) * NdotL; 
+}
+
+uniform int globalMaterialType;
+
+// Lights lights[firstLight + bit] for every bit of lightMask.
+vec3 calculateHybridCelShading(GBufferData gData, vec3 viewDir, uint lightMask, int firstLight) {
+    vec3 totalLighting = vec3(0.0);
+    
+#ifdef SINGLE_MATERIAL_TYPE
+    const int materialType = SINGLE_MATERIAL_TYPE;
+#else
+    int materialType = int(round(gData.materialType));
+#endif
+    
+    // Iterate through the lights that reach this tile
+    while (lightMask != 0u) {
+        int i = firstLight + findLSB(lightMask);
+        lightMask &= lightMask - 1u;
+        Light light = lights[i];
+        
+        if (light.intensity <= 0.0) continue;
+        
+        vec3 lightContrib = vec3(0.0);
+        vec3 lightDir;
+        float attenuation = 1.0;
+        float shadowFactor = 1.0;
+        
+        bool shouldCastShadows = light.castShadows;
+        
+        // Calculate light direction, attenuation, and shadows based on light type
+        if (light.type == 0) { // Directional light
+            lightDir = normalize(-light.direction);
+            if (shouldCastShadows)
+                shadowFactor = calculateCascadedShadow(i, gData.worldPosition, gData.worldNormal, lightDir);
+        } else if (light.type == 1) { // Point light
+            vec3 lightVec = light.position - gData.worldPosition;
+            lightDir = normalize(lightVec);
+            float distance = length(lightVec);
+            attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * distance * distance);
+            if (shouldCastShadows)
+                shadowFactor = calculatePointShadow(i, gData.worldPosition, light.position);
+        } else if (light.type == 2) { // Spot light
+            vec3 lightVec = light.position - gData.worldPosition;
+            lightDir = normalize(lightVec);
+            float distance = length(lightVec);
+            attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * distance * distance);
+            float theta = dot(lightDir, normalize(-light.direction));
+            float epsilon = light.cutOff - light.outerCutOff;
+            float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+            attenuation *= intensity;
+            if (shouldCastShadows)
+                shadowFactor = calculateDirectionalSpotShadow(i, gData.worldPosition, gData.worldNormal, lightDir);
+        }
+        
+        // don't mind magic numbers. they work.
+        if (attenuation <= 0.001) continue;
+        
+        float diffuseIntensity = 0.0;
+        vec3 diffuseColor = vec3(0.0);
+        float specularIntensity = 0.0;
+        
+        // Calculate diffuse based on material type
+#if (MATERIAL_TYPES & 1) != 0
+        if (materialType == 0) { // Lambertian
+            float NdotL = max(dot(gData.worldNormal, lightDir), 0.0);
+            diffuseIntensity = NdotL;
+            diffuseColor = gData.baseColor * diffuseIntensity;
+        }
+#endif
+#if (MATERIAL_TYPES & 2) != 0
+        if (materialType == 1) { // Minnaert
+            vec2 extraParams = gData.modelParams;
+            float k = extraParams.r;
+            vec3 minnaert = calculateMinnaert(gData.worldNormal, lightDir, viewDir, k);
+            diffuseIntensity = minnaert.r; 
+            diffuseColor = gData.baseColor * minnaert;
+        }
+#endif
+#if (MATERIAL_TYPES & 4) != 0
+        if (materialType == 2) { // Oren-Nayar
+            vec2 extraParams = gData.modelParams;
+            float roughness = extraParams.g;
+            vec3 orenNayar = calculateOrenNayar(gData.worldNormal, lightDir, viewDir, roughness, gData.baseColor);
+            diffuseIntensity = length(orenNayar) / length(gData.baseColor + 0.001); 
+            diffuseColor = orenNayar;
+        }
+#endif
+#if (MATERIAL_TYPES & 8) != 0
+        if (materialType == 3) { // Ashikhmin-Shirley
+            // NOTE: Ashikhmin-Shirley and Cook-Torrance already include specular so we skip its calculation. This won't look very cartoonish but seems a good way to showcase this type of anisotropy
+            vec2 extraParams = gData.modelParams;
+            float nu = extraParams.r;
+            float nv = extraParams.g;
+            vec3 ashikhmin = calculateAshikhminShirley(gData.worldNormal, lightDir, viewDir, nu, nv, gData.baseColor);
+            diffuseIntensity = length(ashikhmin) / length(gData.baseColor + 0.001);
+            diffuseColor = ashikhmin;
+            specularIntensity = 0.0;
+        }
+#endif
+#if (MATERIAL_TYPES & 16) != 0
+        if (materialType == 4) { // Cook-Torrance
+            vec2 extraParams = gData.modelParams;
+            float roughness = extraParams.r;
+            float F0 = extraParams.g;
+            vec3 cookTorrance = calculateCookTorrance(gData.worldNormal, lightDir, viewDir, roughness, F0, gData.baseColor);
+            
+            diffuseIntensity = length(cookTorrance) / length(gData.baseColor + 0.001);
+            diffuseColor = cookTorrance;
+            specularIntensity = 0.0; // Included
+        }
+#endif
+
+        diffuseIntensity *= light.intensity * attenuation;
+        diffuseColor *= light.intensity * attenuation;
+        
+        if (materialType != 3 && materialType != 4) {
+            specularIntensity = calculateSpecularIntensity(lightDir, viewDir, gData.worldNormal, gData.specularShininess) * light.intensity * attenuation * 0.3;
+        }
+
+#if QUANTIZATION
+        // cel shading
+        vec3 celColor = hybridCelShading(gData.baseColor, diffuseIntensity, specularIntensity,
+                                       diffuseQuantizationBands, specularThreshold1, specularThreshold2, shadowFactor);
+        lightContrib = celColor * light.color;
+#else
+        // "photorealistic" rendering
+        vec3 finalDiffuse = diffuseColor * shadowFactor;
+        vec3 finalSpecular = vec3(specularIntensity * shadowFactor);
+        lightContrib = (finalDiffuse + finalSpecular) * light.color;
+#endif
+        
+        totalLighting += lightContrib;
+    }
+    
+    return totalLighting;
+}
+
+const vec3 BACKGROUND_COLOR = vec3(0.05, 0.05, 0.1);
+
+// Lit color of one pixel. pixel picks the light tile, texCoords the G-Buffer texel.
+vec3 shadeGBufferPixel(vec2 texCoords, ivec2 pixel)
+{
+    GBufferData gData = sampleGBuffer(texCoords);
+    
+    // Early exit for background pixels
+    if (length(gData.worldNormal) < 0.1) {
+        return BACKGROUND_COLOR;
+    }
+    
+    vec3 viewDir = normalize(viewPos - gData.worldPosition);
+    
+#if SHADOW_PCF && SHADOW_POISSON
+    // Interleaved gradient noise (Jimenez 2014): a different disk rotation for each pixel of a 4x4-ish neighbourhood.
+    float kernelAngle = 6.2831853 * fract(52.9829189 * fract(dot(vec2(pixel), vec2(0.06711056, 0.00583715))));
+    shadowKernelRotation = mat2(cos(kernelAngle), sin(kernelAngle), -sin(kernelAngle), cos(kernelAngle));
+#endif
+    
+    // 32 lights per mask word; most words of most tiles are empty.
+    vec3 totalLighting = vec3(0.0);
+    int wordCount = getLightWordCount();
+    for (int word = 0; word < wordCount; ++word) {
+        uint lightMask = getPixelLightMask(pixel, word);
+        if (lightMask != 0u) totalLighting += calculateHybridCelShading(gData, viewDir, lightMask, word * 32);
+    }
+    
+    // Add ambient lighting on top of everything else
+    totalLighting += gData.baseColor * 0.1 * gData.ambientOcclusion;
+    return totalLighting;
+}
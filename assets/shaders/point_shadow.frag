@@ -3,15 +3,17 @@
 in vec4 FragPos;
 
 uniform vec3 lightPos;
-uniform float farPlane;
+
+// shadowFarPlane
+#include "common/frame_block.glsl"
 
 void main()
 {
     // Calculate distance from light to fragment
     float lightDistance = length(FragPos.xyz - lightPos);
     
-    // Map to [0,1] range by dividing by farPlane
-    lightDistance = lightDistance / farPlane;
+    // Map to [0,1] range by dividing by the far plane
+    lightDistance = lightDistance / shadowFarPlane;
     
     // Write as depth value
     gl_FragDepth = lightDistance;
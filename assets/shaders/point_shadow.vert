@@ -2,9 +2,10 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
+#include "common/scene_data.glsl"
 
 void main()
 {
-    gl_Position = model * vec4(aPos, 1.0);
+    InstanceData instance = fetchInstance(gl_BaseInstance + gl_InstanceID);
+    gl_Position = instance.model * vec4(decodePosition(instance, aPos), 1.0);
 }
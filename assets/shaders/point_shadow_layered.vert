@@ -0,0 +1,27 @@
+#version 460 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+
+// Single-pass alternative to point_shadow.vert + point_shadow.geom.
+// The renderer culls every instance against each cube face and lists it once per face it touches,
+// with the face packed into the visible instance entry. No geometry shader amplification needed.
+
+layout (location = 0) in vec3 aPos;
+
+#include "common/scene_data.glsl"
+
+uniform mat4 shadowMatrices[6];
+uniform int layerBase; // First layer-face of this light's cube in the cube map array (cube index * 6)
+
+out vec4 FragPos;
+
+void main()
+{
+    int drawInstance = gl_BaseInstance + gl_InstanceID;
+    InstanceData instance = fetchInstance(drawInstance);
+    int face = fetchLayer(drawInstance);
+
+    FragPos = instance.model * vec4(decodePosition(instance, aPos), 1.0);
+    gl_Position = shadowMatrices[face] * FragPos;
+    gl_Layer = layerBase + face; // Set the face we're rendering to
+}
@@ -2,10 +2,12 @@
 
 layout (location = 0) in vec3 aPos;
 
+#include "common/scene_data.glsl"
+
 uniform mat4 lightSpaceMatrix;
-uniform mat4 model;
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    InstanceData instance = fetchInstance(gl_BaseInstance + gl_InstanceID);
+    gl_Position = lightSpaceMatrix * instance.model * vec4(decodePosition(instance, aPos), 1.0);
 }
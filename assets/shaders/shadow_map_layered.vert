@@ -0,0 +1,23 @@
+#version 460 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+
+// All cascades of a directional light in one pass, same scheme as point_shadow_layered.vert:
+// instances are listed once per cascade they touch, with the cascade packed into the visible instance entry.
+
+layout (location = 0) in vec3 aPos;
+
+#include "common/scene_data.glsl"
+
+uniform mat4 cascadeMatrices[4];
+uniform int layerBase; // First layer of this light's cascades in the cascade array (slot * cascade count)
+
+void main()
+{
+    int drawInstance = gl_BaseInstance + gl_InstanceID;
+    InstanceData instance = fetchInstance(drawInstance);
+    int cascade = fetchLayer(drawInstance);
+
+    gl_Position = cascadeMatrices[cascade] * instance.model * vec4(decodePosition(instance, aPos), 1.0);
+    gl_Layer = layerBase + cascade;
+}
@@ -0,0 +1,313 @@
+#include "Benchmark.h"
+#include "../camera/Camera.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+    {
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) +
+                       (-p0 + p2) * t +
+                       (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                       (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+    }
+
+    // Frame time at the given percentile (0..1) of an ascending list.
+    float percentile(const std::vector<float>& sorted, double p)
+    {
+        if (sorted.empty()) return 0.0f;
+        size_t index = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+        index = std::min(std::max<size_t>(index, 1), sorted.size()) - 1;
+        return sorted[index];
+    }
+
+    float toFps(float milliseconds)
+    {
+        return milliseconds > 0.0f ? 1000.0f / milliseconds : 0.0f;
+    }
+
+    double toMB(size_t bytes)
+    {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+
+    bool endsWith(const std::string& value, const std::string& suffix)
+    {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // Strings are always quoted (GL_RENDERER strings contain commas), numbers and bools are written as in JSON.
+    std::string csvField(const nlohmann::json& value)
+    {
+        if (!value.is_string()) return value.dump();
+        std::string field = "\"";
+        for (char c : value.get<std::string>()) {
+            if (c == '"') field += '"';
+            field += c;
+        }
+        return field + "\"";
+    }
+}
+
+BenchmarkCameraPath::BenchmarkCameraPath()
+{
+    // Courtyard is the stone floor inside the walls at +-10, the torches stand along them.
+    // The lap walks the inside at eye height, climbs over the centre and circles the whole dungeon from above.
+    keys = {
+        { glm::vec3(  0.0f,  0.8f,   7.0f), glm::vec3( 0.0f, 0.5f,  0.0f) },
+        { glm::vec3(  6.0f,  1.0f,   6.0f), glm::vec3( 0.0f, 0.5f, -2.0f) },
+        { glm::vec3(  7.0f,  1.2f,  -2.0f), glm::vec3(-2.0f, 0.5f, -6.0f) },
+        { glm::vec3(  3.0f,  1.0f,  -7.0f), glm::vec3(-6.0f, 0.8f, -4.0f) },
+        { glm::vec3( -5.0f,  1.2f,  -6.0f), glm::vec3(-6.0f, 1.0f,  4.0f) },
+        { glm::vec3( -7.0f,  1.5f,   2.0f), glm::vec3( 0.0f, 0.5f,  6.0f) },
+        { glm::vec3( -2.0f,  6.0f,   4.0f), glm::vec3( 0.0f, 0.0f,  0.0f) },
+        { glm::vec3(-16.0f, 10.0f,  16.0f), glm::vec3( 0.0f, 0.0f,  0.0f) },
+        { glm::vec3( 16.0f, 10.0f,  16.0f), glm::vec3( 0.0f, 0.0f,  0.0f) },
+        { glm::vec3( 16.0f, 10.0f, -16.0f), glm::vec3( 0.0f, 0.0f,  0.0f) },
+        { glm::vec3(  0.0f,  4.0f,   9.0f), glm::vec3( 0.0f, 0.5f,  0.0f) },
+    };
+}
+
+void BenchmarkCameraPath::apply(float t, Camera& camera) const
+{
+    int count = static_cast<int>(keys.size());
+    float position = (t - std::floor(t)) * static_cast<float>(count);
+    int segment = std::min(static_cast<int>(position), count - 1);
+    float local = position - static_cast<float>(segment);
+
+    const Key& k0 = keys[(segment + count - 1) % count];
+    const Key& k1 = keys[segment];
+    const Key& k2 = keys[(segment + 1) % count];
+    const Key& k3 = keys[(segment + 2) % count];
+
+    camera.Position = catmullRom(k0.position, k1.position, k2.position, k3.position, local);
+    camera.lookAt(catmullRom(k0.target, k1.target, k2.target, k3.target, local));
+}
+
+BenchmarkRun::BenchmarkRun(const BenchmarkSettings& settings)
+    : settings(settings), frameIndex(0), simulationTime(0.0f), lastResolvedFrame(0), peakMemoryBytes(0)
+{
+    if (settings.fixedDelta > 0.0f) {
+        frameTimes.reserve(static_cast<size_t>(settings.duration / settings.fixedDelta) + 1);
+    }
+}
+
+bool BenchmarkRun::advance(float realDelta, Camera& camera, float& frameDelta)
+{
+    ++frameIndex;
+    frameDelta = settings.fixedDelta > 0.0f ? settings.fixedDelta : realDelta;
+
+    // Warm-up frames hold the first key so the recorded lap starts on a settled pipeline.
+    if (isWarmingUp()) {
+        path.apply(0.0f, camera);
+        return true;
+    }
+
+    if (simulationTime >= settings.duration) return false;
+    path.apply(simulationTime / settings.duration, camera);
+    simulationTime += frameDelta;
+    return true;
+}
+
+void BenchmarkRun::recordFrame(float frameMs, const Profiler& profiler)
+{
+    if (isWarmingUp()) {
+        lastResolvedFrame = profiler.getResolvedFrames();
+        return;
+    }
+    frameTimes.push_back(frameMs);
+
+    // The profiler reads frames back a few frames late and may drop some, only count each resolved frame once.
+    if (profiler.getResolvedFrames() == lastResolvedFrame) return;
+    lastResolvedFrame = profiler.getResolvedFrames();
+
+    for (const auto& scope : profiler.getLastFrame()) {
+        auto inserted = passIndices.emplace(scope.path, passes.size());
+        if (inserted.second) {
+            PassSamples samples;
+            samples.path = scope.path;
+            samples.depth = scope.depth;
+            passes.push_back(samples);
+        }
+        PassSamples& samples = passes[inserted.first->second];
+        samples.gpuSum += scope.gpuMs;
+        samples.cpuSum += scope.cpuMs;
+        samples.gpuMax = std::max(samples.gpuMax, scope.gpuMs);
+        ++samples.count;
+    }
+}
+
+void BenchmarkRun::recordMemory(const GpuMemoryReport& report)
+{
+    if (isWarmingUp()) return;
+    lastMemory = report;
+    peakMemoryBytes = std::max(peakMemoryBytes, report.getTotalBytes());
+}
+
+BenchmarkRun::Summary BenchmarkRun::summarize() const
+{
+    Summary summary;
+    summary.frames = frameTimes.size();
+    if (frameTimes.empty()) return summary;
+
+    std::vector<float> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+
+    double totalMs = 0.0;
+    for (float ms : frameTimes) totalMs += ms;
+
+    summary.seconds = totalMs / 1000.0;
+    summary.averageMs = static_cast<float>(totalMs / static_cast<double>(frameTimes.size()));
+    summary.p99Ms = percentile(sorted, 0.99);
+    summary.p999Ms = percentile(sorted, 0.999);
+    summary.maxMs = sorted.back();
+
+    // Average FPS is frames over time, not the mean of per-frame FPS, which would overweight the fast frames.
+    summary.averageFps = toFps(summary.averageMs);
+    summary.minFps = toFps(sorted.back());
+    summary.maxFps = toFps(sorted.front());
+    summary.low1Fps = toFps(summary.p99Ms);
+    summary.low01Fps = toFps(summary.p999Ms);
+    return summary;
+}
+
+bool BenchmarkRun::writeResults(const nlohmann::json& config) const
+{
+    Summary summary = summarize();
+    if (summary.frames == 0) {
+        std::cerr << "Benchmark: no frames recorded" << std::endl;
+        return false;
+    }
+
+    std::cout << "Benchmark: " << summary.frames << " frames in " << summary.seconds << " s" << std::endl;
+    std::cout << "  FPS avg " << summary.averageFps << ", min " << summary.minFps << ", max " << summary.maxFps
+              << ", 1% low " << summary.low1Fps << ", 0.1% low " << summary.low01Fps << std::endl;
+    for (const auto& pass : passes) {
+        if (pass.count == 0) continue;
+        std::cout << "  " << std::string(pass.depth * 2, ' ') << pass.path << ": "
+                  << pass.gpuSum / pass.count << " ms GPU, " << pass.cpuSum / pass.count << " ms CPU" << std::endl;
+    }
+    std::cout << "  Video memory " << toMB(lastMemory.getTotalBytes()) << " MB (peak " << toMB(peakMemoryBytes) << " MB):";
+    for (size_t i = 0; i < GpuMemoryReport::CATEGORY_COUNT; ++i) {
+        auto category = static_cast<GpuMemoryCategory>(i);
+        std::cout << (i ? ", " : " ") << GpuMemoryReport::getCategoryName(category) << " " << toMB(lastMemory[category]);
+    }
+    std::cout << std::endl;
+    if (lastMemory.hasDriverInfo()) {
+        std::cout << "  Driver (" << lastMemory.driverSource << "): " << toMB(lastMemory.driverAvailableBytes) << " MB free" << std::endl;
+    }
+
+    bool written = endsWith(settings.outputPath, ".csv") ? writeCsv(config, summary) : writeJson(config, summary);
+    if (written) {
+        std::cout << "Benchmark results written to " << settings.outputPath << std::endl;
+    }
+    return written;
+}
+
+bool BenchmarkRun::writeJson(const nlohmann::json& config, const Summary& summary) const
+{
+    nlohmann::json j;
+    j["config"] = config;
+    j["frames"] = summary.frames;
+    j["seconds"] = summary.seconds;
+    j["fps"] = {
+        {"average", summary.averageFps},
+        {"min", summary.minFps},
+        {"max", summary.maxFps},
+        {"low1", summary.low1Fps},
+        {"low01", summary.low01Fps}
+    };
+    j["frameTimeMs"] = {
+        {"average", summary.averageMs},
+        {"p99", summary.p99Ms},
+        {"p999", summary.p999Ms},
+        {"max", summary.maxMs}
+    };
+
+    j["passes"] = nlohmann::json::array();
+    for (const auto& pass : passes) {
+        if (pass.count == 0) continue;
+        j["passes"].push_back({
+            {"name", pass.path},
+            {"depth", pass.depth},
+            {"gpuMs", pass.gpuSum / pass.count},
+            {"gpuMaxMs", pass.gpuMax},
+            {"cpuMs", pass.cpuSum / pass.count},
+            {"samples", pass.count}
+        });
+    }
+
+    nlohmann::json memory;
+    for (size_t i = 0; i < GpuMemoryReport::CATEGORY_COUNT; ++i) {
+        auto category = static_cast<GpuMemoryCategory>(i);
+        memory["categories"][GpuMemoryReport::getCategoryName(category)] = toMB(lastMemory[category]);
+    }
+    memory["total"] = toMB(lastMemory.getTotalBytes());
+    memory["peakTotal"] = toMB(peakMemoryBytes);
+    if (lastMemory.hasDriverInfo()) {
+        memory["driverSource"] = lastMemory.driverSource;
+        memory["driverAvailable"] = toMB(lastMemory.driverAvailableBytes);
+        if (lastMemory.driverDedicatedBytes > 0) memory["driverDedicated"] = toMB(lastMemory.driverDedicatedBytes);
+    }
+    j["videoMemoryMB"] = memory;
+    j["frameTimesMs"] = frameTimes;
+
+    std::ofstream file(settings.outputPath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write benchmark results: " << settings.outputPath << std::endl;
+        return false;
+    }
+    file << j.dump(4);
+    return true;
+}
+
+bool BenchmarkRun::writeCsv(const nlohmann::json& config, const Summary& summary) const
+{
+    // One header line and one row, so runs can be appended into a spreadsheet.
+    std::vector<std::pair<std::string, nlohmann::json>> columns;
+    for (auto it = config.begin(); it != config.end(); ++it) {
+        columns.emplace_back(it.key(), it.value());
+    }
+    columns.emplace_back("frames", summary.frames);
+    columns.emplace_back("seconds", summary.seconds);
+    columns.emplace_back("fps_avg", summary.averageFps);
+    columns.emplace_back("fps_min", summary.minFps);
+    columns.emplace_back("fps_max", summary.maxFps);
+    columns.emplace_back("fps_low1", summary.low1Fps);
+    columns.emplace_back("fps_low01", summary.low01Fps);
+    columns.emplace_back("frame_ms_avg", summary.averageMs);
+    columns.emplace_back("frame_ms_p99", summary.p99Ms);
+    columns.emplace_back("frame_ms_p999", summary.p999Ms);
+    columns.emplace_back("frame_ms_max", summary.maxMs);
+    for (const auto& pass : passes) {
+        if (pass.count == 0) continue;
+        columns.emplace_back("gpu_ms:" + pass.path, pass.gpuSum / pass.count);
+        columns.emplace_back("cpu_ms:" + pass.path, pass.cpuSum / pass.count);
+    }
+    for (size_t i = 0; i < GpuMemoryReport::CATEGORY_COUNT; ++i) {
+        auto category = static_cast<GpuMemoryCategory>(i);
+        columns.emplace_back(std::string("memory_mb:") + GpuMemoryReport::getCategoryName(category), toMB(lastMemory[category]));
+    }
+    columns.emplace_back("memory_mb_total", toMB(lastMemory.getTotalBytes()));
+    columns.emplace_back("memory_mb_peak", toMB(peakMemoryBytes));
+    columns.emplace_back("memory_mb_driver_available", toMB(lastMemory.driverAvailableBytes));
+
+    std::ofstream file(settings.outputPath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write benchmark results: " << settings.outputPath << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < columns.size(); ++i) {
+        file << (i ? "," : "") << csvField(columns[i].first);
+    }
+    file << "\n";
+    for (size_t i = 0; i < columns.size(); ++i) {
+        file << (i ? "," : "") << csvField(columns[i].second);
+    }
+    file << "\n";
+    return true;
+}
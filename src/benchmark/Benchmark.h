@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../renderer/GpuMemory.h"
+#include "../renderer/Profiler.h"
+
+class Camera;
+
+// Settings of a scripted benchmark run, filled from the command line (see main.cpp).
+struct BenchmarkSettings {
+    int preset = 0;
+    float duration = 30.0f;     // Simulated seconds for one lap of the camera path
+    float fixedDelta = 0.0f;    // > 0: every frame advances exactly this much, so the same frames are rendered every run
+    int warmupFrames = 120;     // Rendered at the start of the path but not recorded (shader compiles, driver warm-up)
+    bool crazyMode = false;
+    std::string outputPath = "benchmark.json"; // ".csv" writes CSV, anything else JSON
+};
+
+// Closed Catmull-Rom loop through the courtyard and over the walls.
+// Every key has its own look-at target, which is splined the same way as the position.
+class BenchmarkCameraPath
+{
+public:
+    BenchmarkCameraPath();
+
+    // t in [0, 1) is one lap, values outside wrap around.
+    void apply(float t, Camera& camera) const;
+
+private:
+    struct Key {
+        glm::vec3 position;
+        glm::vec3 target;
+    };
+    std::vector<Key> keys;
+};
+
+// Drives the camera and collects frame times and per-pass profiler samples.
+class BenchmarkRun
+{
+public:
+    explicit BenchmarkRun(const BenchmarkSettings& settings);
+
+    // Places the camera for the next frame and returns the delta the scene should be updated with.
+    // Returns false once the lap is complete.
+    bool advance(float realDelta, Camera& camera, float& frameDelta);
+
+    // Called after the swap of every frame; frameMs is the wall time since the previous swap.
+    void recordFrame(float frameMs, const Profiler& profiler);
+    // Renderer::getMemoryReport() of the same frame: the output has the last report and the peak total.
+    void recordMemory(const GpuMemoryReport& report);
+
+    bool isWarmingUp() const { return frameIndex <= settings.warmupFrames; }
+
+    // Writes the summary to settings.outputPath and prints it. config is copied into the output as-is.
+    bool writeResults(const nlohmann::json& config) const;
+
+private:
+    struct PassSamples {
+        std::string path;
+        int depth = 0;
+        double gpuSum = 0.0, cpuSum = 0.0;
+        float gpuMax = 0.0f;
+        unsigned int count = 0;
+    };
+
+    struct Summary {
+        size_t frames = 0;
+        double seconds = 0.0;
+        float averageFps = 0.0f, minFps = 0.0f, maxFps = 0.0f;
+        float low1Fps = 0.0f, low01Fps = 0.0f;   // FPS at the 99th / 99.9th percentile frame time
+        float averageMs = 0.0f, p99Ms = 0.0f, p999Ms = 0.0f, maxMs = 0.0f;
+    };
+
+    BenchmarkSettings settings;
+    BenchmarkCameraPath path;
+
+    int frameIndex;
+    float simulationTime;
+    std::vector<float> frameTimes;
+
+    std::vector<PassSamples> passes;             // First-seen order, which is the frame order
+    std::unordered_map<std::string, size_t> passIndices;
+    unsigned int lastResolvedFrame;
+
+    GpuMemoryReport lastMemory;
+    size_t peakMemoryBytes;
+
+    Summary summarize() const;
+    bool writeJson(const nlohmann::json& config, const Summary& summary) const;
+    bool writeCsv(const nlohmann::json& config, const Summary& summary) const;
+};
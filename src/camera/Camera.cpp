@@ -29,7 +29,7 @@ glm::mat4 Camera::getViewMatrix() const
 // Perspective projection matrix
 glm::mat4 Camera::getProjectionMatrix(float aspect_ratio) const
 {
-    return glm::perspective(glm::radians(Zoom), aspect_ratio, 0.1f, 100.0f);
+    return glm::perspective(glm::radians(Zoom), aspect_ratio, NEAR_PLANE, FAR_PLANE);
 }
 
 // Keyboard movement (free-fly mode)
@@ -77,6 +77,18 @@ void Camera::processMouseScroll(float yoffset)
         Zoom = 45.0f;
 }
 
+void Camera::lookAt(const glm::vec3& target)
+{
+    glm::vec3 direction = target - Position;
+    if (glm::dot(direction, direction) < 1e-8f) return;
+    direction = glm::normalize(direction);
+
+    // Inverse of the spherical mapping in updateCameraVectors, clamped like the mouse look.
+    Yaw = glm::degrees(atan2(direction.z, direction.x));
+    Pitch = glm::clamp(glm::degrees(asin(direction.y)), -89.0f, 89.0f);
+    updateCameraVectors();
+}
+
 // Recalculates the Front, Right, and Up vectors from the updated Euler angles.
 void Camera::updateCameraVectors()
 {
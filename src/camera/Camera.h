@@ -18,6 +18,8 @@ const float PITCH = 0.0f;
 const float SPEED = 5.0f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
 
 class Camera
 {
@@ -61,6 +63,9 @@ public:
     // Processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void processMouseScroll(float yoffset);
 
+    // Turns the camera towards a world-space point (used by scripted camera paths).
+    void lookAt(const glm::vec3& target);
+
 private:
     // Calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors();
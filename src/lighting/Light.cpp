@@ -1 +1,22 @@
-#include "Light.h"
\ No newline at end of file
+#include "Light.h"
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+// Solves constant + linear * d + quadratic * d^2 = 1 / attenuation for d.
+float Light::getRange(float attenuation) const
+{
+    if (type == LightType::DIRECTIONAL || attenuation <= 0.0f) return FLT_MAX;
+
+    float target = 1.0f / attenuation;
+    if (quadratic > 0.0f) {
+        float c = constant - target;
+        float discriminant = linear * linear - 4.0f * quadratic * c;
+        if (discriminant < 0.0f) return 0.0f;
+        return std::max(0.0f, (-linear + std::sqrt(discriminant)) / (2.0f * quadratic));
+    }
+    if (linear > 0.0f) {
+        return std::max(0.0f, (target - constant) / linear);
+    }
+    return FLT_MAX;
+}
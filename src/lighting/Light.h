@@ -50,6 +50,9 @@ struct Light {
     float baseIntensity;   
     glm::vec3 baseColor;   
     
+    // Distance at which the attenuation drops to the given value. FLT_MAX for directional or unattenuated lights.
+    float getRange(float attenuation) const;
+    
     // Method for creating a directional light source.
     static Light createDirectionalLight(const glm::vec3& direction, const glm::vec3& color, float intensity = 1.0f) {
         Light light;
@@ -1,7 +1,9 @@
 #include "LightManager.h"
 #include <algorithm>
+#include <cmath>
 
 LightManager::LightManager()
+    : revision(0)
 {
     // Default directional light (sun)
     addLight(Light::createDirectionalLight(glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f), 5.0f));
@@ -16,31 +18,213 @@ LightManager::~LightManager()
 {
 }
 
+void LightManager::markDirty(size_t index, uint8_t bits)
+{
+    dirty[index] |= bits;
+    if (bits & DIRTY_TRANSFORM) ++transformRevisions[index];
+    ++revision;
+}
+
 void LightManager::addLight(const Light& light)
 {
-    // DO NOT TOUCH or it crashes
-    if (lights.size() < MAX_LIGHTS) {
-        lights.push_back(light);
-    }
+    if (types.size() >= MAX_LIGHTS) return;
+
+    types.push_back(light.type);
+    positions.push_back(light.position);
+    directions.push_back(light.direction);
+    colors.push_back(light.color);
+    intensities.push_back(light.intensity);
+    constants.push_back(light.constant);
+    linears.push_back(light.linear);
+    quadratics.push_back(light.quadratic);
+    cutOffs.push_back(light.cutOff);
+    outerCutOffs.push_back(light.outerCutOff);
+    flags.push_back(static_cast<uint8_t>((light.castShadows ? CAST_SHADOWS : 0) | (light.isStatic ? STATIC : 0) |
+                                         (light.flicker ? FLICKER : 0)));
+    baseIntensities.push_back(light.baseIntensity);
+    baseColors.push_back(light.baseColor);
+    dirty.push_back(0);
+    transformRevisions.push_back(0);
+    markDirty(types.size() - 1, DIRTY_SHADING | DIRTY_TRANSFORM);
 }
 
 void LightManager::removeLight(size_t index)
 {
-    // Delete the corresponding light and moves others
-    if (index < lights.size()) {
-        lights.erase(lights.begin() + index);
+    if (index >= types.size()) return;
+
+    auto erase = [index](auto& values) { values.erase(values.begin() + index); };
+    erase(types);
+    erase(positions);
+    erase(directions);
+    erase(colors);
+    erase(intensities);
+    erase(constants);
+    erase(linears);
+    erase(quadratics);
+    erase(cutOffs);
+    erase(outerCutOffs);
+    erase(flags);
+    erase(baseIntensities);
+    erase(baseColors);
+    erase(dirty);
+    erase(transformRevisions);
+
+    // Every later light now sits at a new index.
+    for (size_t i = index; i < types.size(); ++i) {
+        markDirty(i, DIRTY_SHADING | DIRTY_TRANSFORM);
     }
+    ++revision;
 }
 
 void LightManager::updateLight(size_t index, const Light& light)
 {
-    if (index < lights.size()) {
-        lights[index] = light;
-    }
+    if (index >= types.size()) return;
+
+    Light current = getLight(index);
+    bool transformChanged = current.type != light.type || current.position != light.position ||
+                            current.direction != light.direction || current.cutOff != light.cutOff ||
+                            current.outerCutOff != light.outerCutOff;
+
+    types[index] = light.type;
+    positions[index] = light.position;
+    directions[index] = light.direction;
+    colors[index] = light.color;
+    intensities[index] = light.intensity;
+    constants[index] = light.constant;
+    linears[index] = light.linear;
+    quadratics[index] = light.quadratic;
+    cutOffs[index] = light.cutOff;
+    outerCutOffs[index] = light.outerCutOff;
+    flags[index] = static_cast<uint8_t>((light.castShadows ? CAST_SHADOWS : 0) | (light.isStatic ? STATIC : 0) |
+                                        (light.flicker ? FLICKER : 0));
+    baseIntensities[index] = light.baseIntensity;
+    baseColors[index] = light.baseColor;
+    markDirty(index, static_cast<uint8_t>(DIRTY_SHADING | (transformChanged ? DIRTY_TRANSFORM : 0)));
 }
 
 void LightManager::clearLights()
 {
-    lights.clear();
+    types.clear();
+    positions.clear();
+    directions.clear();
+    colors.clear();
+    intensities.clear();
+    constants.clear();
+    linears.clear();
+    quadratics.clear();
+    cutOffs.clear();
+    outerCutOffs.clear();
+    flags.clear();
+    baseIntensities.clear();
+    baseColors.clear();
+    dirty.clear();
+    transformRevisions.clear();
+    ++revision;
+}
+
+Light LightManager::getLight(size_t index) const
+{
+    Light light;
+    light.type = types[index];
+    light.position = positions[index];
+    light.direction = directions[index];
+    light.color = colors[index];
+    light.intensity = intensities[index];
+    light.constant = constants[index];
+    light.linear = linears[index];
+    light.quadratic = quadratics[index];
+    light.cutOff = cutOffs[index];
+    light.outerCutOff = outerCutOffs[index];
+    light.castShadows = (flags[index] & CAST_SHADOWS) != 0;
+    light.isStatic = (flags[index] & STATIC) != 0;
+    light.flicker = (flags[index] & FLICKER) != 0;
+    light.baseIntensity = baseIntensities[index];
+    light.baseColor = baseColors[index];
+    return light;
+}
+
+void LightManager::setPosition(size_t index, const glm::vec3& position)
+{
+    if (positions[index] == position) return;
+    positions[index] = position;
+    markDirty(index, DIRTY_TRANSFORM);
+}
+
+void LightManager::setDirection(size_t index, const glm::vec3& direction)
+{
+    if (directions[index] == direction) return;
+    directions[index] = direction;
+    markDirty(index, DIRTY_TRANSFORM);
+}
+
+void LightManager::setColor(size_t index, const glm::vec3& color)
+{
+    if (colors[index] == color) return;
+    colors[index] = color;
+    markDirty(index, DIRTY_SHADING);
+}
+
+void LightManager::setIntensity(size_t index, float intensity)
+{
+    if (intensities[index] == intensity) return;
+    intensities[index] = intensity;
+    markDirty(index, DIRTY_SHADING);
 }
 
+void LightManager::setFlag(size_t index, uint8_t flag, bool value, uint8_t dirtyBits)
+{
+    uint8_t updated = static_cast<uint8_t>(value ? (flags[index] | flag) : (flags[index] & ~flag));
+    if (updated == flags[index]) return;
+    flags[index] = updated;
+    markDirty(index, dirtyBits);
+}
+
+void LightManager::setCastShadows(size_t index, bool castShadows) { setFlag(index, CAST_SHADOWS, castShadows, DIRTY_SHADING); }
+// Static only changes how shadow maps are cached, not what the GPU sees.
+void LightManager::setStatic(size_t index, bool isStatic) { setFlag(index, STATIC, isStatic, 0); }
+void LightManager::setFlicker(size_t index, bool flicker) { setFlag(index, FLICKER, flicker, 0); }
+
+// Touches only the flickering lights, and moves the revision once for the whole update.
+void LightManager::updateFlicker(float time)
+{
+    size_t count = types.size();
+    bool changed = false;
+    for (size_t i = 0; i < count; ++i) {
+        if (!(flags[i] & FLICKER)) continue;
+
+        // Unique offset based on position to de-sync lights
+        const glm::vec3& position = positions[i];
+        float seed = position.x * 12.9898f + position.y * 78.233f + position.z * 43.123f;
+        float timeOffset = time + (float)((int)seed % 100) / 10.0f; // Simple pseudo-random offset
+
+        // Noise with sin
+        float noise = (std::sin(timeOffset * 3.0f) + std::sin(timeOffset * 5.3f + 1.2f) + std::sin(timeOffset * 7.7f + 3.5f)) * 0.33f; // -1 to 1 approx
+
+        // Intensity changes +/- 8%, color a little towards red
+        intensities[i] = baseIntensities[i] * (1.0f + noise * 0.08f);
+        colors[i] = glm::clamp(baseColors[i] + glm::vec3(noise * 0.03f, noise * 0.01f, 0.0f), 0.0f, 1.0f);
+        dirty[i] |= DIRTY_SHADING;
+        changed = true;
+    }
+    if (changed) ++revision;
+}
+
+void LightManager::setPositionsAndIntensities(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& newPositions,
+                                              const std::vector<float>& newIntensities)
+{
+    size_t count = std::min(indices.size(), std::min(newPositions.size(), newIntensities.size()));
+    for (size_t k = 0; k < count; ++k) {
+        uint32_t i = indices[k];
+        if (i >= types.size()) continue;
+        positions[i] = newPositions[k];
+        intensities[i] = newIntensities[k];
+        dirty[i] |= DIRTY_SHADING | DIRTY_TRANSFORM;
+        ++transformRevisions[i];
+    }
+    if (count) ++revision;
+}
+
+void LightManager::clearDirtyFlags()
+{
+    std::fill(dirty.begin(), dirty.end(), 0);
+}
@@ -2,35 +2,102 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
 #include "Light.h"
 
+// Lights as a structure of arrays: every property lives in its own array, indexed by light, so the per-frame
+// animation and the GPU packing walk tight contiguous arrays instead of whole Light structs.
+// All mutation goes through the setters. Each one flags the light dirty (what changed, see DirtyBits) and bumps
+// the revision, so the renderer uploads only changed lights and shadow caching can tell a moved light from a
+// flickering one. Light itself is only the interchange format (creation, GUI editing).
 class LightManager
 {
 public:
+    // Same as LIGHT_BUFFER_MAX_LIGHTS (the light tile masks have one bit per light up to it).
+    static const size_t MAX_LIGHTS = 512;
+
+    // What changed on a light since the dirty flags were last cleared.
+    enum DirtyBits : uint8_t {
+        DIRTY_SHADING = 1,     // Color, intensity, attenuation, shadow casting
+        DIRTY_TRANSFORM = 2    // Type, position, direction or cone: whatever its shadow map depends on
+    };
+
     LightManager();
     ~LightManager();
 
-    // Add a new light.
+    // Add a new light. Ignored past MAX_LIGHTS.
     void addLight(const Light& light);
     
-    // Remove a light with index.
+    // Remove a light with index. Later lights move down one index (and count as changed).
     void removeLight(size_t index);
     
-    // Modify light properties (color, position, ...).
+    // Replace every property of a light, flagging only what actually differs.
     void updateLight(size_t index, const Light& light);
     
     // Remove all lights.
     void clearLights();
 
-    const std::vector<Light>& getLights() const { return lights; }
-    std::vector<Light>& getLightsReference() { return lights; } // Direct access for dynamic updates (e.g. flickering effects).
-    size_t getLightCount() const { return lights.size(); }
-    Light& getLight(size_t index) { return lights[index]; }
+    size_t getLightCount() const { return types.size(); }
+    // Copy of every property, e.g. to edit and then updateLight().
+    Light getLight(size_t index) const;
+
+    LightType getType(size_t index) const { return types[index]; }
+    const glm::vec3& getPosition(size_t index) const { return positions[index]; }
+    const glm::vec3& getDirection(size_t index) const { return directions[index]; }
+    const glm::vec3& getColor(size_t index) const { return colors[index]; }
+    float getIntensity(size_t index) const { return intensities[index]; }
+    bool castsShadows(size_t index) const { return (flags[index] & CAST_SHADOWS) != 0; }
+    bool isStatic(size_t index) const { return (flags[index] & STATIC) != 0; }
+    bool flickers(size_t index) const { return (flags[index] & FLICKER) != 0; }
+
+    void setPosition(size_t index, const glm::vec3& position);
+    void setDirection(size_t index, const glm::vec3& direction);
+    void setColor(size_t index, const glm::vec3& color);
+    void setIntensity(size_t index, float intensity);
+    void setCastShadows(size_t index, bool castShadows);
+    void setStatic(size_t index, bool isStatic);
+    void setFlicker(size_t index, bool flicker);
+
+    // Batch animation, one pass over the arrays each.
+    // Fire flicker of every flickering light at time (seconds): intensity and color around their base values.
+    void updateFlicker(float time);
+    // Moves lights[indices[k]] to positions[k] with intensities[k] (all three the same length).
+    void setPositionsAndIntensities(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+                                    const std::vector<float>& intensities);
 
+    // Change tracking. The revision moves on any change; the dirty flags (DirtyBits per light) are for the
+    // one consumer that uploads the lights, which clears them afterwards.
+    uint64_t getRevision() const { return revision; }
+    const std::vector<uint8_t>& getDirtyFlags() const { return dirty; }
+    void clearDirtyFlags();
+    // Bumped with every DIRTY_TRANSFORM change of the light: equal values mean an identical shadow map.
+    uint64_t getTransformRevision(size_t index) const { return transformRevisions[index]; }
 
 private:
-    std::vector<Light> lights;
-    
-    // This is the maximum lights but not the maximum light to cast shadow. that is 8.
-    static const size_t MAX_LIGHTS = 32;
-};
\ No newline at end of file
+    enum Flags : uint8_t {
+        CAST_SHADOWS = 1,
+        STATIC = 2,
+        FLICKER = 4
+    };
+
+    std::vector<LightType> types;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> directions;
+    std::vector<glm::vec3> colors;
+    std::vector<float> intensities;
+    std::vector<float> constants;
+    std::vector<float> linears;
+    std::vector<float> quadratics;
+    std::vector<float> cutOffs;
+    std::vector<float> outerCutOffs;
+    std::vector<uint8_t> flags;
+    std::vector<float> baseIntensities;
+    std::vector<glm::vec3> baseColors;
+
+    std::vector<uint8_t> dirty;
+    std::vector<uint64_t> transformRevisions;
+    uint64_t revision;
+
+    void markDirty(size_t index, uint8_t bits);
+    void setFlag(size_t index, uint8_t flag, bool value, uint8_t dirtyBits);
+};
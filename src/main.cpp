@@ -3,11 +3,14 @@
 //Bridges raw input to Camera/GUI.
 
 #include <iostream>
+#include <stdexcept>
+#include <string>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "renderer/Renderer.h"
 #include "camera/Camera.h"
 #include "ui/GUI.h"
+#include "benchmark/Benchmark.h"
 
 // Force usage of discrete GPU on laptops with hybrid graphics
 
@@ -23,6 +26,9 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
+bool parseArguments(int argc, char** argv, GBufferLayout& gBufferLayout, bool& benchmark, BenchmarkSettings& settings,
+                    unsigned int& width, unsigned int& height, bool& hidden);
+int runBenchmark(GLFWwindow* window, Renderer& renderer, const BenchmarkSettings& settings);
 
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = WINDOW_WIDTH / 2.0f;
@@ -33,8 +39,18 @@ bool guiMode = false;  // Toggle for GUI vs camera control mode
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char** argv)
 {
+    GBufferLayout gBufferLayout = GBufferLayout::STANDARD;
+    bool benchmark = false;
+    bool hidden = false;
+    BenchmarkSettings benchmarkSettings;
+    unsigned int windowWidth = WINDOW_WIDTH;
+    unsigned int windowHeight = WINDOW_HEIGHT;
+    if (!parseArguments(argc, argv, gBufferLayout, benchmark, benchmarkSettings, windowWidth, windowHeight, hidden)) {
+        return -1;
+    }
+
     // Initialize GLFW. This is required before any other GLFW functions can be called.
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -47,7 +63,9 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
-    glfwWindowHint(GLFW_MAXIMIZED, GLFW_TRUE);
+    // Benchmarks run at exactly the requested size, a maximized window would depend on the desktop.
+    glfwWindowHint(GLFW_MAXIMIZED, benchmark ? GLFW_FALSE : GLFW_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, hidden ? GLFW_FALSE : GLFW_TRUE);
 
 #ifdef __APPLE__
     // Required for macOS, idk why but dont ever remove it.
@@ -55,7 +73,7 @@ int main()
 #endif
 
     // Create the main window object.
-    GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Cel Shading Renderer", nullptr, nullptr);
+    GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, "Cel Shading Renderer", nullptr, nullptr);
     if (!window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -82,8 +100,31 @@ int main()
     // Enable depth testing
     glEnable(GL_DEPTH_TEST);
 
+    if (benchmark) {
+        // No GUI, no input and no vsync: every frame renders as fast as the GPU allows.
+        glfwSwapInterval(0);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+
+        int framebufferWidth = 0, framebufferHeight = 0;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        if (framebufferWidth <= 0 || framebufferHeight <= 0) {
+            framebufferWidth = static_cast<int>(windowWidth);
+            framebufferHeight = static_cast<int>(windowHeight);
+        }
+        auto benchmarkRenderer = std::make_unique<Renderer>(framebufferWidth, framebufferHeight, gBufferLayout);
+        glfwSetWindowUserPointer(window, benchmarkRenderer.get());
+        benchmarkRenderer->enableShaderHotReload = false; // No file system polling inside timed frames
+
+        int result = runBenchmark(window, *benchmarkRenderer, benchmarkSettings);
+
+        glfwSetWindowUserPointer(window, nullptr);
+        benchmarkRenderer.reset();
+        glfwTerminate();
+        return result;
+    }
+
     // Initialize renderer and imGUI.
-    auto renderer = std::make_unique<Renderer>(WINDOW_WIDTH, WINDOW_HEIGHT);
+    auto renderer = std::make_unique<Renderer>(windowWidth, windowHeight, gBufferLayout);
     auto gui = std::make_unique<GUI>(window);
     gui->setRenderer(renderer.get());
     
@@ -108,11 +149,19 @@ int main()
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        // Everything between here and the swap is one profiler frame.
+        Profiler& profiler = renderer->getProfiler();
+        profiler.beginFrame();
+
         // Execute the rendering pipeline.
         renderer->render(camera, deltaTime);
         
         // Render the UI overlay on top of the 3D scene.
-        gui->render();
+        {
+            ProfileScope scope(profiler, "GUI");
+            gui->render();
+        }
+        profiler.endFrame();
 
         // Swap the front and back buffers.
         // We render to the back buffer and swap to prevent screen tearing/flickering.
@@ -129,6 +178,131 @@ int main()
     return 0;
 }
 
+bool parseArguments(int argc, char** argv, GBufferLayout& gBufferLayout, bool& benchmark, BenchmarkSettings& settings,
+                    unsigned int& width, unsigned int& height, bool& hidden)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        // Every option except the switches takes one value.
+        bool takesValue = arg == "--preset" || arg == "--duration" || arg == "--fixed-dt" || arg == "--warmup" ||
+                          arg == "--output" || arg == "--resolution";
+        if (takesValue && i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+
+        try {
+            if (arg == "--compact-gbuffer") {
+                // 12 bytes per pixel (octahedral normals, position from depth) instead of 32.
+                gBufferLayout = GBufferLayout::COMPACT;
+            } else if (arg == "--benchmark") {
+                benchmark = true;
+            } else if (arg == "--hidden") {
+                hidden = true;
+            } else if (arg == "--crazy") {
+                settings.crazyMode = true;
+            } else if (arg == "--preset") {
+                settings.preset = std::stoi(argv[++i]);
+            } else if (arg == "--duration") {
+                settings.duration = std::stof(argv[++i]);
+            } else if (arg == "--fixed-dt") {
+                settings.fixedDelta = std::stof(argv[++i]);
+            } else if (arg == "--warmup") {
+                settings.warmupFrames = std::stoi(argv[++i]);
+            } else if (arg == "--output") {
+                settings.outputPath = argv[++i];
+            } else if (arg == "--resolution") {
+                std::string value = argv[++i];
+                size_t x = value.find('x');
+                if (x == std::string::npos) throw std::invalid_argument(value);
+                width = static_cast<unsigned int>(std::stoul(value.substr(0, x)));
+                height = static_cast<unsigned int>(std::stoul(value.substr(x + 1)));
+            } else {
+                std::cerr << "Unknown argument: " << arg << std::endl;
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+            return false;
+        }
+    }
+
+    if (settings.duration <= 0.0f || settings.fixedDelta < 0.0f || settings.warmupFrames < 0 || width == 0 || height == 0) {
+        std::cerr << "Invalid benchmark settings" << std::endl;
+        return false;
+    }
+    if (hidden && !benchmark) {
+        std::cerr << "--hidden only applies to --benchmark" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Plays the benchmark camera path once and writes the results. Returns the process exit code.
+int runBenchmark(GLFWwindow* window, Renderer& renderer, const BenchmarkSettings& settings)
+{
+    renderer.loadPreset(settings.preset);
+    renderer.setCrazyMode(settings.crazyMode);
+
+    Profiler& profiler = renderer.getProfiler();
+    profiler.enabled = true;
+
+    Camera benchmarkCamera;
+    BenchmarkRun run(settings);
+
+    // Models stream in after startup; measuring before they're all there would benchmark an empty scene.
+    while (renderer.isLoadingAssets() && !glfwWindowShouldClose(window)) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderer.render(benchmarkCamera, 0.0f);
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    double previousSwap = glfwGetTime();
+    float frameDelta = 0.0f;
+    while (!glfwWindowShouldClose(window)) {
+        double start = glfwGetTime();
+        if (!run.advance(static_cast<float>(start - previousSwap), benchmarkCamera, frameDelta)) break;
+
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        profiler.beginFrame();
+        renderer.render(benchmarkCamera, frameDelta);
+        profiler.endFrame();
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+
+        // Swap to swap, which is what a player sees; the per-pass GPU times come from the profiler.
+        double swap = glfwGetTime();
+        run.recordFrame(static_cast<float>((swap - previousSwap) * 1000.0), profiler);
+        run.recordMemory(renderer.getMemoryReport());
+        previousSwap = swap;
+    }
+    glFinish();
+
+    const GBuffer* gBuffer = renderer.getGBuffer();
+    const char* glRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    const char* glVersion = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+    nlohmann::json config;
+    config["preset"] = settings.preset;
+    config["width"] = renderer.getWidth();
+    config["height"] = renderer.getHeight();
+    config["duration"] = settings.duration;
+    config["fixedDelta"] = settings.fixedDelta;
+    config["warmupFrames"] = settings.warmupFrames;
+    config["crazyMode"] = settings.crazyMode;
+    config["compactGBuffer"] = gBuffer && gBuffer->isCompact();
+    config["fusedLighting"] = renderer.useFusedLighting;
+    config["dynamicResolution"] = renderer.dynamicResolution.enabled;
+    config["glRenderer"] = glRenderer ? glRenderer : "";
+    config["glVersion"] = glVersion ? glVersion : "";
+
+    return run.writeResults(config) ? 0 : 1;
+}
+
 void processInput(GLFWwindow* window)
 {
     // Close the window if ESC is pressed.
@@ -0,0 +1,125 @@
+#include "AssetLoader.h"
+#include <chrono>
+#include <iostream>
+
+AssetLoader::AssetLoader(TextureCache& textureCache, unsigned int threadCount)
+    : textureCache(textureCache), inFlight(0), requested(0), finished(0), pool(std::make_unique<ThreadPool>(threadCount))
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+    pool.reset();
+}
+
+void AssetLoader::loadModel(Model* model, const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++inFlight;
+    }
+    ++requested;
+
+    pool->submit([this, model, path]() {
+        bool success = false;
+        try {
+            success = model->load(path);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to load " << path << ": " << e.what() << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        loadedModels.push_back({ model, path, success });
+        --inFlight;
+    });
+}
+
+// Shares a live texture right away, otherwise joins (or starts) the decode of its file.
+void AssetLoader::requestTexture(Model* model, size_t index)
+{
+    const std::string& file = model->getTextures()[index].file;
+    if (auto texture = textureCache.find(file)) {
+        model->setTexture(index, texture);
+        return;
+    }
+
+    auto inserted = textureUsers.emplace(file, std::vector<TextureUser>());
+    inserted.first->second.push_back({ model, index });
+    if (!inserted.second) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++inFlight;
+    }
+    pool->submit([this, file]() {
+        TextureImage image;
+        if (!TextureCache::decode(file, image)) {
+            image = TextureImage();
+            image.file = file;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        decodedTextures.push_back(std::move(image));
+        --inFlight;
+    });
+}
+
+std::vector<Model*> AssetLoader::update(double budgetMs)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&start]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    std::deque<LoadedModel> loaded;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded.swap(loadedModels);
+        for (auto& image : decodedTextures) {
+            textureUploads.push_back(std::move(image));
+        }
+        decodedTextures.clear();
+    }
+
+    // Finishing is only bookkeeping; the renderer copies the meshes into its pool, the textures wait for the budget below.
+    std::vector<Model*> ready;
+    for (auto& entry : loaded) {
+        if (entry.success) {
+            std::cout << "Successfully loaded " << entry.path << std::endl;
+        } else {
+            std::cerr << "Failed to load " << entry.path << std::endl;
+        }
+
+        entry.model->finishLoad();
+        for (size_t i = 0; i < entry.model->getTextures().size(); ++i) {
+            requestTexture(entry.model, i);
+        }
+        ready.push_back(entry.model);
+        ++finished;
+    }
+
+    bool first = true;
+    while (!textureUploads.empty() && (first || elapsedMs() < budgetMs)) {
+        TextureImage& image = textureUploads.front();
+        // A failed decode has no levels: its users just stay untextured.
+        std::shared_ptr<TextureResource> texture = image.levels.empty() ? nullptr : textureCache.upload(image);
+
+        auto users = textureUsers.find(image.file);
+        if (users != textureUsers.end()) {
+            for (const auto& user : users->second) {
+                user.model->setTexture(user.index, texture);
+            }
+            textureUsers.erase(users);
+        }
+        textureUploads.pop_front();
+        first = false;
+    }
+
+    return ready;
+}
+
+bool AssetLoader::isIdle() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return inFlight == 0 && loadedModels.empty() && decodedTextures.empty() && textureUploads.empty();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Model.h"
+#include "TextureCache.h"
+#include "../utils/ThreadPool.h"
+
+// Streams models in the background.
+// Workers run Model::load() (Assimp or the mesh cache) and decode textures; the main thread calls update()
+// once per frame, which finishes loaded models and uploads decoded textures into the TextureCache until the
+// frame's time budget is used up. Models only become drawable in update(), so the renderer can draw
+// whatever is ready while the rest is still on its way. A texture file used by several models is decoded
+// and uploaded once, every model waiting for it gets the same TextureResource.
+class AssetLoader
+{
+public:
+    // Default per-frame main-thread budget, in ms. One item always goes through, however large.
+    static constexpr double DEFAULT_UPLOAD_BUDGET_MS = 2.0;
+
+    explicit AssetLoader(TextureCache& textureCache, unsigned int threadCount = 0);
+    // Waits for jobs already running (they write into their models), drops the queued ones.
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // The model must stay alive until this loader is destroyed, and be left alone until update() hands it back.
+    void loadModel(Model* model, const std::string& path);
+
+    // GL thread. Returns the models that became drawable during this call.
+    std::vector<Model*> update(double budgetMs = DEFAULT_UPLOAD_BUDGET_MS);
+
+    // Nothing queued, loading or waiting for an upload.
+    bool isIdle() const;
+    size_t getRequestedCount() const { return requested; }
+    size_t getFinishedCount() const { return finished; }
+    size_t getPendingTextureCount() const { return textureUsers.size(); }
+
+private:
+    struct LoadedModel {
+        Model* model;
+        std::string path;
+        bool success;
+    };
+
+    struct TextureUser {
+        Model* model;
+        size_t index;   // Into Model::getTextures()
+    };
+
+    TextureCache& textureCache;
+
+    // Written by the workers, drained by update().
+    mutable std::mutex mutex;
+    std::deque<LoadedModel> loadedModels;
+    std::deque<TextureImage> decodedTextures;
+    size_t inFlight;            // Model and texture jobs
+
+    // Main thread only.
+    std::unordered_map<std::string, std::vector<TextureUser>> textureUsers; // Files being decoded or uploaded
+    std::deque<TextureImage> textureUploads;
+    size_t requested;
+    size_t finished;
+
+    // Last member: destroyed (joined) first, while everything the jobs touch still exists.
+    std::unique_ptr<ThreadPool> pool;
+
+    void requestTexture(Model* model, size_t index);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+
+// Axis-aligned box. Starts empty (min > max) so expand() can be called on the first point.
+struct BoundingBox {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+    glm::vec3 getExtents() const { return (max - min) * 0.5f; }
+
+    void expand(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const BoundingBox& other) {
+        if (!other.isValid()) return;
+        expand(other.min);
+        expand(other.max);
+    }
+
+    // Box of the transformed box (Arvo's method: project the extents on each world axis).
+    BoundingBox transformed(const glm::mat4& m) const {
+        if (!isValid()) return *this;
+
+        glm::vec3 center = glm::vec3(m * glm::vec4(getCenter(), 1.0f));
+        glm::vec3 extents = getExtents();
+        glm::vec3 worldExtents(0.0f);
+        for (int axis = 0; axis < 3; ++axis) {
+            worldExtents += glm::abs(glm::vec3(m[axis])) * extents[axis];
+        }
+
+        BoundingBox result;
+        result.min = center - worldExtents;
+        result.max = center + worldExtents;
+        return result;
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // Conservative under non-uniform scale: the radius grows with the largest axis scale.
+    BoundingSphere transformed(const glm::mat4& m) const {
+        BoundingSphere result;
+        result.center = glm::vec3(m * glm::vec4(center, 1.0f));
+        float maxScale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+        result.radius = radius * maxScale;
+        return result;
+    }
+};
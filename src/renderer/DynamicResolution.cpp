@@ -0,0 +1,50 @@
+#include "DynamicResolution.h"
+#include "GpuTimer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const float SMOOTHING = 0.2f;        // Exponential moving average weight of a new sample
+    const float DEAD_ZONE = 0.02f;       // Changes smaller than this are not worth the flicker
+    const float MAX_STEP_DOWN = 0.1f;
+    const float MAX_STEP_UP = 0.05f;
+    const float SCALE_QUANTUM = 1.0f / 64.0f;
+}
+
+float DynamicResolutionController::update(float gpuFrameMilliseconds, const Settings& settings)
+{
+    float minScale = std::clamp(settings.minScale, 0.25f, 1.0f);
+    float maxScale = std::clamp(settings.maxScale, minScale, 1.0f);
+
+    smoothedFrameTime = hasSample ? smoothedFrameTime + (gpuFrameMilliseconds - smoothedFrameTime) * SMOOTHING
+                                  : gpuFrameMilliseconds;
+    hasSample = true;
+
+    if (cooldown > 0) {
+        --cooldown;
+        return scale = std::clamp(scale, minScale, maxScale);
+    }
+
+    float budget = 1000.0f / std::max(settings.targetFrameRate, 1.0f) * settings.headroom;
+    float desired = scale * std::sqrt(budget / std::max(smoothedFrameTime, 0.01f));
+    desired = std::clamp(desired, scale - MAX_STEP_DOWN, scale + MAX_STEP_UP);
+    desired = std::clamp(std::round(desired / SCALE_QUANTUM) * SCALE_QUANTUM, minScale, maxScale);
+
+    if (std::abs(desired - scale) >= DEAD_ZONE || desired == minScale || desired == maxScale) {
+        if (desired != scale) {
+            // Predict the new cost so the average doesn't keep pushing with samples from the old scale.
+            smoothedFrameTime *= (desired * desired) / (scale * scale);
+            scale = desired;
+            cooldown = GpuFrameTimer::LATENCY;
+        }
+    }
+    return scale;
+}
+
+void DynamicResolutionController::reset(float newScale)
+{
+    scale = newScale;
+    smoothedFrameTime = 0.0f;
+    hasSample = false;
+    cooldown = 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Frame-time feedback loop for the internal render scale.
+// GPU cost is assumed to grow with the pixel count (scale^2), which is close enough for a deferred renderer
+// whose heavy passes are all per pixel. Measurements arrive a few frames late (see GpuFrameTimer), so the
+// controller waits that long after every change before judging it, and drops faster than it climbs back.
+class DynamicResolutionController
+{
+public:
+    struct Settings {
+        float targetFrameRate = 60.0f;
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        float headroom = 0.9f;  // Aim under the frame budget so small spikes don't drop a frame
+    };
+
+    // Feed one GPU frame time, returns the scale to render the next frames with.
+    float update(float gpuFrameMilliseconds, const Settings& settings);
+
+    void reset(float newScale = 1.0f);
+
+    float getScale() const { return scale; }
+    float getSmoothedFrameTime() const { return smoothedFrameTime; }
+
+private:
+    float scale = 1.0f;
+    float smoothedFrameTime = 0.0f;
+    bool hasSample = false;
+    int cooldown = 0;       // Samples to skip after a change, measured with the old scale
+};
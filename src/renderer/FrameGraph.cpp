@@ -0,0 +1,259 @@
+#include "FrameGraph.h"
+#include "Profiler.h"
+#include <iostream>
+
+namespace {
+    // Only the formats the passes use; anything else is counted as 4 bytes.
+    size_t bytesPerPixel(GLenum internalFormat)
+    {
+        switch (internalFormat) {
+            case GL_RGBA32F: return 16;
+            case GL_RGBA16F: return 8;
+            case GL_R16F: return 2;
+            case GL_R8: return 1;
+            default: return 4;
+        }
+    }
+
+    bool sameDesc(const FrameGraphTextureDesc& a, const FrameGraphTextureDesc& b)
+    {
+        return a.internalFormat == b.internalFormat && a.filter == b.filter;
+    }
+}
+
+FrameGraphHandle FrameGraph::Builder::create(const std::string& name, const FrameGraphTextureDesc& desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.producer = static_cast<int>(pass);
+    graph.resources.push_back(resource);
+
+    FrameGraphHandle handle = static_cast<FrameGraphHandle>(graph.resources.size() - 1);
+    graph.passes[pass].creates.push_back(handle);
+    return handle;
+}
+
+FrameGraphHandle FrameGraph::Builder::read(FrameGraphHandle texture)
+{
+    if (texture != INVALID) graph.passes[pass].reads.push_back(texture);
+    return texture;
+}
+
+void FrameGraph::Builder::setSideEffect()
+{
+    graph.passes[pass].sideEffect = true;
+}
+
+FrameGraph::FrameGraph()
+    : width(0), height(0), culledPasses(0), transientCount(0)
+{
+}
+
+FrameGraph::~FrameGraph()
+{
+    releasePool();
+}
+
+void FrameGraph::reset(unsigned int newWidth, unsigned int newHeight)
+{
+    if (newWidth != width || newHeight != height) {
+        releasePool();
+        width = newWidth;
+        height = newHeight;
+    }
+    passes.clear();
+    resources.clear();
+}
+
+FrameGraphHandle FrameGraph::importTexture(const std::string& name, GLuint texture)
+{
+    Resource resource;
+    resource.name = name;
+    resource.importedTexture = texture;
+    resources.push_back(resource);
+    return static_cast<FrameGraphHandle>(resources.size() - 1);
+}
+
+void FrameGraph::addPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute)
+{
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    passes.push_back(std::move(pass));
+
+    Builder builder(*this, passes.size() - 1);
+    setup(builder);
+}
+
+void FrameGraph::compile()
+{
+    cullPasses();
+    assignPhysicalTextures();
+}
+
+// Reference counting from the outputs back: a pass without side effects whose outputs all have no readers is
+// dropped, which may leave the textures it read unread in turn.
+void FrameGraph::cullPasses()
+{
+    for (auto& resource : resources) {
+        resource.refCount = 0;
+    }
+    for (auto& pass : passes) {
+        pass.culled = false;
+        pass.refCount = static_cast<int>(pass.creates.size());
+        for (FrameGraphHandle read : pass.reads) {
+            resources[read].refCount++;
+        }
+    }
+
+    std::vector<FrameGraphHandle> unread;
+    for (size_t i = 0; i < resources.size(); ++i) {
+        if (resources[i].refCount == 0 && resources[i].producer >= 0) unread.push_back(static_cast<FrameGraphHandle>(i));
+    }
+    while (!unread.empty()) {
+        Resource& resource = resources[unread.back()];
+        unread.pop_back();
+
+        Pass& producer = passes[resource.producer];
+        if (--producer.refCount > 0 || producer.sideEffect || producer.culled) continue;
+        producer.culled = true;
+        for (FrameGraphHandle read : producer.reads) {
+            Resource& input = resources[read];
+            if (--input.refCount == 0 && input.producer >= 0) unread.push_back(read);
+        }
+    }
+
+    culledPasses = 0;
+    for (const auto& pass : passes) {
+        if (pass.culled) culledPasses++;
+    }
+}
+
+// Transients in order of creation, each on the first pooled texture of its format that is free again by then.
+void FrameGraph::assignPhysicalTextures()
+{
+    for (size_t i = 0; i < passes.size(); ++i) {
+        if (passes[i].culled) continue;
+        for (FrameGraphHandle read : passes[i].reads) {
+            resources[read].lastUse = static_cast<int>(i);
+        }
+        for (FrameGraphHandle created : passes[i].creates) {
+            resources[created].lastUse = static_cast<int>(i);
+        }
+    }
+
+    for (auto& texture : pool) {
+        texture.busyUntil = -1;
+    }
+
+    transientCount = 0;
+    std::vector<bool> used(pool.size(), false);
+    for (auto& resource : resources) {
+        resource.physical = -1;
+        if (resource.producer < 0 || passes[resource.producer].culled) continue;
+
+        resource.physical = acquire(resource.desc, resource.producer, resource.lastUse);
+        used.resize(pool.size(), false);
+        used[resource.physical] = true;
+        transientCount++;
+    }
+
+    // Released from the back so the indices of this frame's assignments stay valid.
+    for (size_t i = pool.size(); i-- > 0;) {
+        if (used[i]) {
+            pool[i].unusedFrames = 0;
+            continue;
+        }
+        if (++pool[i].unusedFrames < RELEASE_AFTER_FRAMES) continue;
+
+        destroy(pool[i]);
+        pool.erase(pool.begin() + i);
+        for (auto& resource : resources) {
+            if (resource.physical > static_cast<int>(i)) resource.physical--;
+        }
+    }
+}
+
+int FrameGraph::acquire(const FrameGraphTextureDesc& desc, int firstPass, int lastPass)
+{
+    for (size_t i = 0; i < pool.size(); ++i) {
+        if (sameDesc(pool[i].desc, desc) && pool[i].busyUntil < firstPass) {
+            pool[i].busyUntil = lastPass;
+            return static_cast<int>(i);
+        }
+    }
+
+    PooledTexture texture;
+    texture.desc = desc;
+    texture.busyUntil = lastPass;
+
+    glGenTextures(1, &texture.texture);
+    glBindTexture(GL_TEXTURE_2D, texture.texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, desc.internalFormat, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &texture.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, texture.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.texture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Frame graph: framebuffer for a transient target is not complete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    pool.push_back(texture);
+    return static_cast<int>(pool.size() - 1);
+}
+
+void FrameGraph::execute(Profiler& profiler)
+{
+    for (const auto& pass : passes) {
+        if (pass.culled) continue;
+        ProfileScope scope(profiler, pass.name);
+        pass.execute(*this);
+    }
+}
+
+GLuint FrameGraph::getTexture(FrameGraphHandle texture) const
+{
+    if (texture == INVALID) return 0;
+    const Resource& resource = resources[texture];
+    if (resource.producer < 0) return resource.importedTexture;
+    return resource.physical >= 0 ? pool[resource.physical].texture : 0;
+}
+
+GLuint FrameGraph::getFramebuffer(FrameGraphHandle texture) const
+{
+    if (texture == INVALID) return 0;
+    const Resource& resource = resources[texture];
+    return resource.physical >= 0 ? pool[resource.physical].framebuffer : 0;
+}
+
+size_t FrameGraph::getPoolMemoryBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& texture : pool) {
+        bytes += static_cast<size_t>(width) * height * bytesPerPixel(texture.desc.internalFormat);
+    }
+    return bytes;
+}
+
+void FrameGraph::releasePool()
+{
+    for (auto& texture : pool) {
+        destroy(texture);
+    }
+    pool.clear();
+}
+
+void FrameGraph::destroy(PooledTexture& texture)
+{
+    if (texture.framebuffer) glDeleteFramebuffers(1, &texture.framebuffer);
+    if (texture.texture) glDeleteTextures(1, &texture.texture);
+    texture.framebuffer = 0;
+    texture.texture = 0;
+}
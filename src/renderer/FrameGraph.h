@@ -0,0 +1,122 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+class Profiler;
+
+// Texture a pass renders into. Transient textures always cover the full target size (width x height of reset()),
+// dynamic resolution only shrinks the viewports, as everywhere else.
+struct FrameGraphTextureDesc {
+    GLenum internalFormat = GL_RGBA8;
+    GLenum filter = GL_LINEAR;
+};
+
+// Index of a texture in the current frame's graph, INVALID when a pass didn't produce it.
+using FrameGraphHandle = int;
+
+// Screen-space passes of one frame, rebuilt every frame (a handful of passes, nothing worth caching):
+//   reset() -> addPass()... -> compile() -> execute()
+// Each pass declares what it reads and creates. compile() drops passes whose outputs nobody reads (unless the pass
+// has side effects: the screen, storage buffers), computes the lifetime of every transient texture and maps them onto
+// a pool of immutable textures (glTexStorage2D), so two transients of the same format whose lifetimes don't overlap
+// share one texture. The pool survives across frames; entries unused for a while are released.
+// Textures owned elsewhere (the G-Buffer) are imported: read-only, never allocated or culled.
+class FrameGraph
+{
+public:
+    static const FrameGraphHandle INVALID = -1;
+    static const unsigned int RELEASE_AFTER_FRAMES = 120;
+
+    class Builder
+    {
+    public:
+        FrameGraphHandle create(const std::string& name, const FrameGraphTextureDesc& desc);
+        // Returns texture, so reads can be declared inline. INVALID is ignored.
+        FrameGraphHandle read(FrameGraphHandle texture);
+        // Kept even when nothing reads its outputs.
+        void setSideEffect();
+
+    private:
+        friend class FrameGraph;
+        Builder(FrameGraph& graph, size_t pass) : graph(graph), pass(pass) {}
+        FrameGraph& graph;
+        size_t pass;
+    };
+
+    using SetupFunction = std::function<void(Builder&)>;
+    using ExecuteFunction = std::function<void(const FrameGraph&)>;
+
+    FrameGraph();
+    ~FrameGraph();
+
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+
+    // Starts a new frame. A new size releases the whole pool.
+    void reset(unsigned int width, unsigned int height);
+
+    FrameGraphHandle importTexture(const std::string& name, GLuint texture);
+    // setup runs immediately, execute during execute(), in the order the passes were added.
+    void addPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute);
+
+    void compile();
+    // Runs the live passes, one profiler scope each (named after the pass).
+    void execute(Profiler& profiler);
+
+    // For the passes: 0 for INVALID. Framebuffers only exist for transients (the texture at color attachment 0).
+    GLuint getTexture(FrameGraphHandle texture) const;
+    GLuint getFramebuffer(FrameGraphHandle texture) const;
+
+    // The last compiled frame, for the stats overlay.
+    size_t getPassCount() const { return passes.size(); }
+    size_t getCulledPassCount() const { return culledPasses; }
+    size_t getTransientCount() const { return transientCount; }
+    size_t getPooledTextureCount() const { return pool.size(); }
+    size_t getPoolMemoryBytes() const;
+
+private:
+    struct Pass {
+        std::string name;
+        ExecuteFunction execute;
+        std::vector<FrameGraphHandle> reads;
+        std::vector<FrameGraphHandle> creates;
+        bool sideEffect = false;
+        bool culled = false;
+        int refCount = 0;   // Outputs still read by a live pass, during compile()
+    };
+
+    struct Resource {
+        std::string name;
+        FrameGraphTextureDesc desc;
+        GLuint importedTexture = 0;
+        int producer = -1;  // Pass index, -1 for imported textures
+        int refCount = 0;   // Live passes reading it, during compile()
+        int lastUse = -1;   // Last live pass touching it
+        int physical = -1;  // Index into pool
+    };
+
+    struct PooledTexture {
+        FrameGraphTextureDesc desc;
+        GLuint texture = 0;
+        GLuint framebuffer = 0;
+        int busyUntil = -1;              // Last pass of the transient it holds this frame
+        unsigned int unusedFrames = 0;
+    };
+
+    std::vector<Pass> passes;
+    std::vector<Resource> resources;
+    std::vector<PooledTexture> pool;
+    unsigned int width, height;
+    size_t culledPasses;
+    size_t transientCount;
+
+    void cullPasses();
+    void assignPhysicalTextures();
+    int acquire(const FrameGraphTextureDesc& desc, int firstPass, int lastPass);
+    void releasePool();
+    static void destroy(PooledTexture& texture);
+};
@@ -0,0 +1,68 @@
+#include "Frustum.h"
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+    : planeCount(6)
+{
+    // glm is column major: m[col][row]. Each plane is row 3 +/- row N of the matrix.
+    const glm::mat4& m = viewProjection;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    planes[0] = row3 + row0; // Left
+    planes[1] = row3 - row0; // Right
+    planes[2] = row3 + row1; // Bottom
+    planes[3] = row3 - row1; // Top
+    planes[4] = row3 + row2; // Near (GL clip space, z in [-w, w])
+    planes[5] = row3 - row2; // Far
+
+    // Normalize so sphere tests can compare against the radius directly.
+    for (auto& plane : planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+}
+
+Frustum Frustum::fromBox(const glm::vec3& min, const glm::vec3& max)
+{
+    Frustum frustum;
+    frustum.planeCount = 6;
+    frustum.planes[0] = glm::vec4( 1.0f,  0.0f,  0.0f, -min.x);
+    frustum.planes[1] = glm::vec4(-1.0f,  0.0f,  0.0f,  max.x);
+    frustum.planes[2] = glm::vec4( 0.0f,  1.0f,  0.0f, -min.y);
+    frustum.planes[3] = glm::vec4( 0.0f, -1.0f,  0.0f,  max.y);
+    frustum.planes[4] = glm::vec4( 0.0f,  0.0f,  1.0f, -min.z);
+    frustum.planes[5] = glm::vec4( 0.0f,  0.0f, -1.0f,  max.z);
+    return frustum;
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const
+{
+    for (int i = 0; i < planeCount; ++i) {
+        if (glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w < -sphere.radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Conservative: may keep a box that only touches the corner region outside two planes, never drops a visible one.
+bool Frustum::intersects(const BoundingBox& box) const
+{
+    if (!box.isValid()) return true;
+
+    for (int i = 0; i < planeCount; ++i) {
+        // Farthest corner along the plane normal.
+        glm::vec3 normal = glm::vec3(planes[i]);
+        glm::vec3 positive(normal.x >= 0.0f ? box.max.x : box.min.x,
+                           normal.y >= 0.0f ? box.max.y : box.min.y,
+                           normal.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(normal, positive) + planes[i].w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
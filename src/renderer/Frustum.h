@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <array>
+#include "Bounds.h"
+
+// Set of inward-facing planes (xyz = normal, w = distance) for CPU visibility tests.
+// A default constructed Frustum has no planes and accepts everything.
+class Frustum
+{
+public:
+    Frustum() = default;
+
+    // Extract the six clip planes from a projection * view matrix (Gribb/Hartmann).
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    // Axis-aligned box as a frustum, for volumes that aren't a projection (point light range).
+    static Frustum fromBox(const glm::vec3& min, const glm::vec3& max);
+
+    bool intersects(const BoundingSphere& sphere) const;
+    bool intersects(const BoundingBox& box) const;
+
+    bool isEnabled() const { return planeCount > 0; }
+
+private:
+    std::array<glm::vec4, 6> planes;
+    int planeCount = 0;
+};
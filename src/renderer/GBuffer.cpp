@@ -1,7 +1,8 @@
 #include "GBuffer.h"
 #include <iostream>
 
-GBuffer::GBuffer() : gBuffer(0), gBaseColor(0), gNormal(0), gPosition(0), gQuantization(0), gDepth(0), rboDepth(0), width(0), height(0)
+GBuffer::GBuffer(GBufferLayout layout)
+    : gBuffer(0), gBaseColor(0), gNormal(0), gPosition(0), gQuantization(0), gDepth(0), rboDepth(0), width(0), height(0), layout(layout)
 {
 }
 
@@ -18,57 +19,59 @@ bool GBuffer::init(unsigned int windowWidth, unsigned int windowHeight)
     glGenFramebuffers(1, &gBuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
 
-    // Target 0: Albedo & Info
-    // RGB: Base Color (Diffuse Albedo)
-    // A:   Material
-    glGenTextures(1, &gBaseColor);
-    glBindTexture(GL_TEXTURE_2D, gBaseColor);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gBaseColor, 0);
-
-    //Target 1: Normals & Roughness
-    // RGB: World-space normal, A: Roughness
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-
-    // Target 2: Position & Metallic
-    // RGB: World Space Position. Essential for calculating light direction/distance per pixel.
-    // A:   Metallic factor (0.0 = Dielectric, 1.0 = Metal).
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gPosition, 0);
-
-    // Target 3: Stylization Data
-    // RGB: Quantization / Cel-Shading Control flags (e.g. number of bands)
-    // A:   I was planning to use it for Ambient Occlusion but not used for now.
-    glGenTextures(1, &gQuantization);
-    glBindTexture(GL_TEXTURE_2D, gQuantization);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, gQuantization, 0);
+    // Creates one NEAREST-filtered color target and attaches it. Immutable storage, resize() recreates everything.
+    auto createTarget = [&](unsigned int& texture, GLenum attachment, GLenum internalFormat) {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+    };
+
+    if (layout == GBufferLayout::COMPACT) {
+        // Target 0: RGB base color, A: material id (index into materials[], parameters are read from there)
+        createTarget(gBaseColor, GL_COLOR_ATTACHMENT0, GL_RGBA8);
+        // Target 1: octahedral world normal
+        createTarget(gNormal, GL_COLOR_ATTACHMENT1, GL_RG16_SNORM);
+        // Target 2: none, world position is rebuilt from depth
+        // Target 3: R: roughness, G: AO, B: edge weight (the per-pixel values that can come from textures)
+        createTarget(gQuantization, GL_COLOR_ATTACHMENT3, GL_RGBA8);
+    } else {
+        // Target 0: Albedo & Info
+        // RGB: Base Color (Diffuse Albedo)
+        // A:   Material
+        createTarget(gBaseColor, GL_COLOR_ATTACHMENT0, GL_RGBA16F);
+
+        //Target 1: Normals & Roughness
+        // RGB: World-space normal, A: Roughness
+        createTarget(gNormal, GL_COLOR_ATTACHMENT1, GL_RGBA16F);
+
+        // Target 2: Position & Metallic
+        // RGB: World Space Position. Essential for calculating light direction/distance per pixel.
+        // A:   Metallic factor (0.0 = Dielectric, 1.0 = Metal).
+        createTarget(gPosition, GL_COLOR_ATTACHMENT2, GL_RGBA16F);
+
+        // Target 3: Stylization Data
+        // RGB: Quantization / Cel-Shading Control flags (e.g. number of bands)
+        // A:   I was planning to use it for Ambient Occlusion but not used for now.
+        createTarget(gQuantization, GL_COLOR_ATTACHMENT3, GL_RGBA16F);
+    }
 
     // Depth Buffer
     // I need to use a depth texture to read depth later for edge detection.
     // GL_DEPTH_COMPONENT32F is the most precise one, i'm not sure it's needed but seems to have no impact.
     glGenTextures(1, &gDepth);
     glBindTexture(GL_TEXTURE_2D, gDepth);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0);
 
     // The Fragment Shader in Geometry Pass will output to locations 0, 1, 2, 3 that are the same as this array.
-    unsigned int attachments[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
+    // The compact layout has nothing at location 2, its output is dropped.
+    GLenum positionAttachment = (layout == GBufferLayout::COMPACT) ? GL_NONE : GL_COLOR_ATTACHMENT2;
+    GLenum attachments[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, positionAttachment, GL_COLOR_ATTACHMENT3 };
     glDrawBuffers(4, attachments);
 
     // Verify the framebuffer.
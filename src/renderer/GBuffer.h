@@ -2,11 +2,18 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <cstddef>
+
+// Target formats, fixed for the lifetime of the GBuffer (see assets/shaders/common/gbuffer_encoding.glsl).
+enum class GBufferLayout {
+    STANDARD, // 4 x RGBA16F, 32 bytes/pixel of color
+    COMPACT   // RGBA8 + RG16_SNORM + RGBA8, 12 bytes/pixel. No position target, rebuilt from depth
+};
 
 class GBuffer
 {
 public:
-    GBuffer();
+    explicit GBuffer(GBufferLayout layout = GBufferLayout::STANDARD);
     ~GBuffer();
 
     // Sets up the framebuffer and all textures.
@@ -28,15 +35,21 @@ public:
     
     unsigned int getBaseColorTexture() const { return gBaseColor; }  // Target 0: Diffuse Color + Material ID
     unsigned int getNormalTexture() const { return gNormal; }        // Target 1: Surface Normal vector + Roughness
-    unsigned int getPositionTexture() const { return gPosition; }    // Target 2: World Space Position + Metallic
+    unsigned int getPositionTexture() const { return gPosition; }    // Target 2: World Space Position + Metallic (0 when compact)
     unsigned int getQuantizationTexture() const { return gQuantization; } // Target 3: Custom data for Cel Shading + AO
     unsigned int getDepthTexture() const { return gDepth; }          // Depth Buffer
 
+    GBufferLayout getLayout() const { return layout; }
+    bool isCompact() const { return layout == GBufferLayout::COMPACT; }
+    // Color targets plus the 32F depth, as allocated.
+    size_t getMemoryBytes() const { return gBuffer ? static_cast<size_t>(width) * height * ((isCompact() ? 12 : 32) + 4) : 0; }
+
 private:
     unsigned int gBuffer;
     unsigned int gBaseColor, gNormal, gPosition, gQuantization, gDepth;
     unsigned int rboDepth;
     unsigned int width, height;
+    GBufferLayout layout;
 
     void cleanup();
 };
\ No newline at end of file
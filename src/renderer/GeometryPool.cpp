@@ -0,0 +1,106 @@
+#include "GeometryPool.h"
+#include <cstddef>
+
+namespace {
+    // New immutable buffer holding the old contents (copied on the GPU) followed by the staged data.
+    GLuint growBuffer(GLuint oldBuffer, size_t oldBytes, const void* data, size_t dataBytes)
+    {
+        GLuint buffer = 0;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+        if (oldBytes == 0) {
+            glBufferStorage(GL_COPY_WRITE_BUFFER, dataBytes, data, 0);
+        } else {
+            glBufferStorage(GL_COPY_WRITE_BUFFER, oldBytes + dataBytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+            glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, oldBytes, dataBytes, data);
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (oldBuffer) glDeleteBuffers(1, &oldBuffer);
+        return buffer;
+    }
+}
+
+GeometryPool::GeometryPool()
+    : vertexCount(0), indexCount(0), uploadedVertexCount(0), uploadedIndexCount(0), VAO(0), VBO(0), EBO(0)
+{
+    // The buffers are created by the first upload().
+    glGenVertexArrays(1, &VAO);
+}
+
+GeometryPool::~GeometryPool()
+{
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    if (VBO) glDeleteBuffers(1, &VBO);
+    if (EBO) glDeleteBuffers(1, &EBO);
+}
+
+GeometryRange GeometryPool::addMesh(const PackedVertex* meshVertices, size_t meshVertexCount, const uint16_t* meshIndices, size_t meshIndexCount)
+{
+    GeometryRange range;
+    range.firstIndex = static_cast<GLuint>(indexCount);
+    range.indexCount = static_cast<GLuint>(meshIndexCount);
+    range.baseVertex = static_cast<GLint>(vertexCount);
+
+    if (meshVertexCount) stagedVertices.insert(stagedVertices.end(), meshVertices, meshVertices + meshVertexCount);
+    if (meshIndexCount) stagedIndices.insert(stagedIndices.end(), meshIndices, meshIndices + meshIndexCount);
+    vertexCount += meshVertexCount;
+    indexCount += meshIndexCount;
+
+    return range;
+}
+
+void GeometryPool::upload()
+{
+    if (stagedVertices.empty() && stagedIndices.empty()) return;
+
+    if (!stagedVertices.empty()) {
+        VBO = growBuffer(VBO, uploadedVertexCount * sizeof(PackedVertex), stagedVertices.data(), stagedVertices.size() * sizeof(PackedVertex));
+    }
+    if (!stagedIndices.empty()) {
+        EBO = growBuffer(EBO, uploadedIndexCount * INDEX_SIZE, stagedIndices.data(), stagedIndices.size() * INDEX_SIZE);
+    }
+    bindBuffersToVertexArray();
+
+    uploadedVertexCount = vertexCount;
+    uploadedIndexCount = indexCount;
+    std::vector<PackedVertex>().swap(stagedVertices);
+    std::vector<uint16_t>().swap(stagedIndices);
+}
+
+void GeometryPool::bindBuffersToVertexArray()
+{
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // The element buffer binding is VAO state.
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+    // Position input (layout = 0): unorm16 in the model's bounds, decoded with decodePosition()
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+
+    // Normal vector input (layout = 1): snorm16 octahedral, decoded with decodeOctahedral()
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+
+    // Texture Coordinates input (layout = 2)
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryPool::bind() const
+{
+    glBindVertexArray(VAO);
+}
+
+void GeometryPool::unbind() const
+{
+    glBindVertexArray(0);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include "Model.h"
+
+// Layout of one glMultiDrawElementsIndirect record, as defined by the GL spec.
+struct DrawElementsIndirectCommand {
+    GLuint count;         // Index count
+    GLuint instanceCount;
+    GLuint firstIndex;    // Offset into the shared index buffer, in indices
+    GLint baseVertex;     // Added to every index, so meshes keep their local 0-based indices
+    GLuint baseInstance;  // First element of instances[] used by this draw
+};
+
+// Where a mesh ended up inside the pool.
+struct GeometryRange {
+    GLuint firstIndex = 0;
+    GLuint indexCount = 0;
+    GLint baseVertex = 0;
+};
+
+// Every mesh of every model in one vertex buffer + one index buffer behind a single VAO.
+// Vertices are PackedVertex and indices 16-bit, local to each mesh (MeshBuilder keeps meshes under 64K vertices).
+// With the per-instance data in an SSBO nothing has to be rebound between draws, which is what lets
+// the whole scene go out as a few glMultiDrawElementsIndirect calls.
+// The buffers are immutable (glBufferStorage). Meshes added after an upload grow the pool into new buffers,
+// with the already uploaded part copied on the GPU, so only the meshes not uploaded yet are kept on the CPU.
+class GeometryPool
+{
+public:
+    // Index type of every draw from the pool.
+    static const GLenum INDEX_TYPE = GL_UNSIGNED_SHORT;
+    static const size_t INDEX_SIZE = sizeof(uint16_t);
+
+    GeometryPool();
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // Append a mesh to the CPU staging copy. Visible to the GPU after the next upload().
+    GeometryRange addMesh(const PackedVertex* vertices, size_t vertexCount, const uint16_t* indices, size_t indexCount);
+
+    // Move the staged meshes to the GPU, if any were added since the last upload.
+    void upload();
+
+    void bind() const;
+    void unbind() const;
+
+    size_t getVertexCount() const { return vertexCount; }
+    size_t getIndexCount() const { return indexCount; }
+    size_t getMemoryBytes() const { return vertexCount * sizeof(PackedVertex) + indexCount * INDEX_SIZE; }
+    // CPU copies of the meshes not uploaded yet, part of getMemoryBytes().
+    size_t getStagedBytes() const { return stagedVertices.size() * sizeof(PackedVertex) + stagedIndices.size() * INDEX_SIZE; }
+
+private:
+    // Not uploaded yet, they go right after the uploaded part.
+    std::vector<PackedVertex> stagedVertices;
+    std::vector<uint16_t> stagedIndices;
+    size_t vertexCount, indexCount;                 // Uploaded + staged
+    size_t uploadedVertexCount, uploadedIndexCount;
+
+    GLuint VAO, VBO, EBO;
+
+    // Points the VAO at the current VBO/EBO. Attribute pointers capture the buffer, so this runs after every grow.
+    void bindBuffersToVertexArray();
+};
@@ -0,0 +1,45 @@
+#include "GpuMemory.h"
+#include <glad/glad.h>
+
+size_t GpuMemoryReport::getTotalBytes() const
+{
+    size_t total = 0;
+    for (size_t categoryBytes : bytes) total += categoryBytes;
+    return total;
+}
+
+// Both extensions report kilobytes.
+void GpuMemoryReport::queryDriver()
+{
+    driverDedicatedBytes = 0;
+    driverAvailableBytes = 0;
+    driverSource = "";
+
+    if (GLAD_GL_NVX_gpu_memory_info) {
+        GLint dedicatedKB = 0, availableKB = 0;
+        glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &dedicatedKB);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &availableKB);
+        driverDedicatedBytes = static_cast<size_t>(dedicatedKB) * 1024;
+        driverAvailableBytes = static_cast<size_t>(availableKB) * 1024;
+        driverSource = "NVX";
+    } else if (GLAD_GL_ATI_meminfo) {
+        // Total free, largest free block, total auxiliary free, largest auxiliary free block.
+        GLint textureFreeKB[4] = { 0, 0, 0, 0 };
+        glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, textureFreeKB);
+        driverAvailableBytes = static_cast<size_t>(textureFreeKB[0]) * 1024;
+        driverSource = "ATI";
+    }
+}
+
+const char* GpuMemoryReport::getCategoryName(GpuMemoryCategory category)
+{
+    switch (category) {
+        case GpuMemoryCategory::GBUFFER: return "G-Buffer";
+        case GpuMemoryCategory::SHADOW_MAPS: return "Shadow maps";
+        case GpuMemoryCategory::RENDER_TARGETS: return "Render targets";
+        case GpuMemoryCategory::GEOMETRY: return "Geometry";
+        case GpuMemoryCategory::TEXTURES: return "Textures";
+        case GpuMemoryCategory::BUFFERS: return "Buffers";
+        default: return "";
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+// What the renderer's GL storage is used for.
+enum class GpuMemoryCategory {
+    GBUFFER,
+    SHADOW_MAPS,
+    RENDER_TARGETS, // Frame graph pool, Hi-Z pyramid
+    GEOMETRY,       // Geometry pool vertex and index buffers
+    TEXTURES,       // Model textures, every mip level
+    BUFFERS,        // Uniform and shader storage buffers
+    COUNT
+};
+
+// Video memory of one frame. Every owner of GL storage reports what it allocated (sizes times formats, before
+// driver padding and alignment), Renderer::updateMemoryReport() sorts that into categories once a frame.
+// The driver's own numbers come on top where an extension exposes them; they cover the whole process
+// (and on ATI only say what's free).
+struct GpuMemoryReport {
+    static const size_t CATEGORY_COUNT = static_cast<size_t>(GpuMemoryCategory::COUNT);
+
+    std::array<size_t, CATEGORY_COUNT> bytes{};
+    size_t stagedBytes = 0;             // CPU copies waiting for an upload, in no category
+
+    size_t driverDedicatedBytes = 0;    // GL_NVX_gpu_memory_info only
+    size_t driverAvailableBytes = 0;    // 0 when neither extension is there
+    const char* driverSource = "";      // "NVX", "ATI" or empty
+
+    size_t& operator[](GpuMemoryCategory category) { return bytes[static_cast<size_t>(category)]; }
+    size_t operator[](GpuMemoryCategory category) const { return bytes[static_cast<size_t>(category)]; }
+
+    size_t getTotalBytes() const;
+    bool hasDriverInfo() const { return driverAvailableBytes != 0; }
+
+    // Fills the driver fields. GL thread.
+    void queryDriver();
+
+    static const char* getCategoryName(GpuMemoryCategory category);
+};
@@ -0,0 +1,49 @@
+#include "GpuTimer.h"
+
+GpuFrameTimer::GpuFrameTimer()
+    : current(0), oldest(0)
+{
+    glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+    pending.fill(false);
+}
+
+GpuFrameTimer::~GpuFrameTimer()
+{
+    glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+}
+
+void GpuFrameTimer::begin()
+{
+    // Still unread after LATENCY frames: drop it rather than wait, the pair is needed again.
+    if (pending[current]) {
+        pending[current] = false;
+        if (oldest == current) oldest = (oldest + 1) % LATENCY;
+    }
+    glQueryCounter(queries[current * 2], GL_TIMESTAMP);
+}
+
+void GpuFrameTimer::end()
+{
+    glQueryCounter(queries[current * 2 + 1], GL_TIMESTAMP);
+    pending[current] = true;
+    current = (current + 1) % LATENCY;
+}
+
+bool GpuFrameTimer::poll(float& milliseconds)
+{
+    if (!pending[oldest]) return false;
+
+    // The end stamp finishes last, once it's there both are.
+    GLint available = 0;
+    glGetQueryObjectiv(queries[oldest * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return false;
+
+    GLuint64 start = 0, stop = 0;
+    glGetQueryObjectui64v(queries[oldest * 2], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(queries[oldest * 2 + 1], GL_QUERY_RESULT, &stop);
+    pending[oldest] = false;
+    oldest = (oldest + 1) % LATENCY;
+
+    milliseconds = static_cast<float>(static_cast<double>(stop - start) / 1.0e6);
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+
+// GPU time between begin() and end(), measured with a pair of timestamp queries.
+// A few query pairs are used round robin and read back only once the GPU has finished them,
+// so the CPU never stalls on a result; the price is that a measurement arrives a few frames late.
+class GpuFrameTimer
+{
+public:
+    // Frames in flight before a query pair is reused.
+    static const int LATENCY = 4;
+
+    GpuFrameTimer();
+    ~GpuFrameTimer();
+
+    GpuFrameTimer(const GpuFrameTimer&) = delete;
+    GpuFrameTimer& operator=(const GpuFrameTimer&) = delete;
+
+    void begin();
+    void end();
+
+    // Oldest finished measurement not returned yet, in milliseconds. False when none came back since the last call.
+    bool poll(float& milliseconds);
+
+private:
+    std::array<GLuint, LATENCY * 2> queries;
+    std::array<bool, LATENCY> pending;
+    int current;   // Pair used by the frame being recorded
+    int oldest;    // Next pair to read back
+};
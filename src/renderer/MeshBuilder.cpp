@@ -0,0 +1,465 @@
+#include "MeshBuilder.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <unordered_map>
+
+namespace {
+    // Simulated LRU cache of the Forsyth optimizer. Larger than any real post-transform cache on purpose,
+    // the scoring falls off with the position anyway.
+    const int FORSYTH_CACHE_SIZE = 32;
+    // FIFO cache used to find cluster boundaries and measure locality in optimizeOverdraw().
+    const unsigned int FIFO_CACHE_SIZE = 16;
+
+    struct MeshChunk {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // Forsyth's vertex score: recently used vertices and vertices with few triangles left come first.
+    float vertexScore(int cachePosition, unsigned int remainingTriangles)
+    {
+        if (remainingTriangles == 0) return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            // The last triangle's vertices get a fixed score, so the next one doesn't always pick the same edge.
+            if (cachePosition < 3) {
+                score = 0.75f;
+            } else {
+                float scale = 1.0f / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+                score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scale, 1.5f);
+            }
+        }
+        // Valence boost: finish off vertices with few triangles left, instead of leaving lone triangles behind.
+        return score + 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+    }
+
+    // FIFO of the last FIFO_CACHE_SIZE missed vertices, with timestamps instead of an actual queue:
+    // a vertex is cached if fewer than FIFO_CACHE_SIZE misses happened since its own.
+    class FifoCache
+    {
+    public:
+        explicit FifoCache(size_t vertexCount) : timestamps(vertexCount, 0), time(FIFO_CACHE_SIZE + 1) {}
+
+        void reset() { time += FIFO_CACHE_SIZE + 1; }
+
+        unsigned int access(const uint32_t* triangle)
+        {
+            unsigned int misses = 0;
+            for (int k = 0; k < 3; ++k) {
+                if (time - timestamps[triangle[k]] > FIFO_CACHE_SIZE) {
+                    timestamps[triangle[k]] = time++;
+                    ++misses;
+                }
+            }
+            return misses;
+        }
+
+    private:
+        std::vector<unsigned int> timestamps;
+        unsigned int time;
+    };
+
+    // Greedy split in triangle order, each chunk with at most MAX_VERTICES distinct vertices.
+    std::vector<MeshChunk> splitForShortIndices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+    {
+        std::vector<MeshChunk> chunks;
+        if (vertices.size() <= MeshBuilder::MAX_VERTICES) {
+            chunks.push_back({ vertices, indices });
+            return chunks;
+        }
+
+        const uint32_t unused = UINT32_MAX;
+        std::vector<uint32_t> remap(vertices.size(), unused);
+        std::vector<uint32_t> touched;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            if (chunks.empty() || chunks.back().vertices.size() + 3 > MeshBuilder::MAX_VERTICES) {
+                for (uint32_t v : touched) remap[v] = unused;
+                touched.clear();
+                chunks.emplace_back();
+            }
+
+            MeshChunk& chunk = chunks.back();
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = indices[t + k];
+                if (remap[v] == unused) {
+                    remap[v] = static_cast<uint32_t>(chunk.vertices.size());
+                    chunk.vertices.push_back(vertices[v]);
+                    touched.push_back(v);
+                }
+                chunk.indices.push_back(remap[v]);
+            }
+        }
+        return chunks;
+    }
+
+    // Cells of a grid over the mesh bounds; vertices only share a cell if their normals point the same way
+    // (dominant axis and sign), so the hard creases of flat-shaded models and both sides of thin walls survive.
+    class VertexGrid
+    {
+    public:
+        VertexGrid(const std::vector<Vertex>& vertices, int resolution) : cells(vertices.size())
+        {
+            glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+            for (const auto& vertex : vertices) {
+                minimum = glm::min(minimum, vertex.Position);
+                maximum = glm::max(maximum, vertex.Position);
+            }
+            glm::vec3 extent = maximum - minimum;
+            float cellSize = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f)) / static_cast<float>(resolution);
+
+            std::unordered_map<uint64_t, uint32_t> ids;
+            ids.reserve(vertices.size());
+            for (size_t v = 0; v < vertices.size(); ++v) {
+                glm::vec3 cell = glm::floor((vertices[v].Position - minimum) / cellSize);
+                uint64_t key = normalBucket(vertices[v].Normal);
+                for (int axis = 0; axis < 3; ++axis) {
+                    key = (key << 20) | static_cast<uint64_t>(std::min(cell[axis], 1048575.0f));
+                }
+                auto inserted = ids.emplace(key, static_cast<uint32_t>(ids.size()));
+                cells[v] = inserted.first->second;
+            }
+            cellCount = ids.size();
+        }
+
+        uint32_t cellOf(uint32_t vertex) const { return cells[vertex]; }
+        size_t getCellCount() const { return cellCount; }
+
+        // Triangles with a corner in each of three different cells, the ones that survive the collapse.
+        size_t countTriangles(const std::vector<uint32_t>& indices) const
+        {
+            size_t count = 0;
+            for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+                uint32_t a = cells[indices[t]], b = cells[indices[t + 1]], c = cells[indices[t + 2]];
+                if (a != b && b != c && a != c) count++;
+            }
+            return count;
+        }
+
+    private:
+        std::vector<uint32_t> cells;
+        size_t cellCount;
+
+        static uint64_t normalBucket(const glm::vec3& n)
+        {
+            glm::vec3 a = glm::abs(n);
+            int axis = (a.x >= a.y && a.x >= a.z) ? 0 : (a.y >= a.z ? 1 : 2);
+            return static_cast<uint64_t>(axis * 2 + (n[axis] < 0.0f ? 1 : 0));
+        }
+    };
+}
+
+std::vector<PackedMesh> MeshBuilder::build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                           const BoundingBox& box)
+{
+    std::vector<PackedMesh> meshes;
+    for (auto& chunk : splitForShortIndices(vertices, indices)) {
+        if (chunk.indices.size() < 3) continue;
+
+        optimizeVertexCache(chunk.indices, chunk.vertices.size());
+        optimizeOverdraw(chunk.indices, chunk.vertices);
+        optimizeVertexFetch(chunk.vertices, chunk.indices);
+
+        PackedMesh mesh;
+        mesh.vertices.reserve(chunk.vertices.size());
+        for (const auto& vertex : chunk.vertices) {
+            mesh.vertices.push_back(pack(vertex, box));
+        }
+        mesh.indices.assign(chunk.indices.begin(), chunk.indices.end());
+        mesh.lods.push_back({ 0, static_cast<uint32_t>(chunk.indices.size()) });
+
+        // Every level is simplified from the full mesh, not from the previous level, so errors don't add up.
+        // They come after LOD 0's vertex order was fixed, which only makes their fetches a little less local.
+        size_t previousCount = chunk.indices.size();
+        for (int lod = 1; lod < MAX_LODS; ++lod) {
+            size_t target = (chunk.indices.size() / 3 >> lod) * 3;
+            std::vector<uint32_t> lodIndices = simplify(chunk.vertices, chunk.indices, target);
+            if (lodIndices.empty() || static_cast<float>(lodIndices.size()) > MIN_LOD_REDUCTION * static_cast<float>(previousCount)) break;
+
+            optimizeVertexCache(lodIndices, chunk.vertices.size());
+            mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(lodIndices.size()) });
+            mesh.indices.insert(mesh.indices.end(), lodIndices.begin(), lodIndices.end());
+            previousCount = lodIndices.size();
+        }
+        meshes.push_back(std::move(mesh));
+    }
+    return meshes;
+}
+
+PackedVertex MeshBuilder::pack(const Vertex& vertex, const BoundingBox& box)
+{
+    PackedVertex packed = {};
+
+    glm::vec3 extent = box.max - box.min;
+    for (int axis = 0; axis < 3; ++axis) {
+        float t = extent[axis] > 0.0f ? (vertex.Position[axis] - box.min[axis]) / extent[axis] : 0.0f;
+        packed.position[axis] = static_cast<uint16_t>(std::lround(glm::clamp(t, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    // Same mapping as encodeOctahedral() in octahedral.glsl.
+    glm::vec3 n = vertex.Normal;
+    float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    n = length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec2 octahedral(n.x, n.y);
+    if (n.z < 0.0f) {
+        octahedral = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * glm::vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    for (int axis = 0; axis < 2; ++axis) {
+        packed.normal[axis] = static_cast<int16_t>(std::lround(glm::clamp(octahedral[axis], -1.0f, 1.0f) * 32767.0f));
+    }
+
+    packed.texCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+    packed.texCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+    return packed;
+}
+
+// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation". Always emits the best-scoring triangle that touches
+// the simulated cache; when none does, continues with the first triangle not emitted yet.
+void MeshBuilder::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) return;
+
+    // Triangles around every vertex. The first remaining[v] entries of a list are the triangles not emitted yet.
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) remaining[indices[i]]++;
+
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) score[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    std::vector<uint32_t> cache, nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    size_t cursor = 0;
+    long best = -1;
+    while (output.size() < triangleCount * 3) {
+        if (best < 0) {
+            while (emitted[cursor]) ++cursor;
+            best = static_cast<long>(cursor);
+        }
+
+        const uint32_t* triangle = &indices[best * 3];
+        emitted[best] = true;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = triangle[k];
+            unsigned int* list = &adjacency[offsets[v]];
+            for (unsigned int i = 0; i < remaining[v]; ++i) {
+                if (list[i] == static_cast<unsigned int>(best)) {
+                    std::swap(list[i], list[remaining[v] - 1]);
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // The triangle's vertices move to the front, the rest shifts back and the tail falls out.
+        nextCache.assign(triangle, triangle + 3);
+        for (uint32_t v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) nextCache.push_back(v);
+        }
+        for (size_t i = FORSYTH_CACHE_SIZE; i < nextCache.size(); ++i) {
+            cachePosition[nextCache[i]] = -1;
+            score[nextCache[i]] = vertexScore(-1, remaining[nextCache[i]]);
+        }
+        if (nextCache.size() > static_cast<size_t>(FORSYTH_CACHE_SIZE)) nextCache.resize(FORSYTH_CACHE_SIZE);
+        cache.swap(nextCache);
+
+        for (size_t i = 0; i < cache.size(); ++i) {
+            cachePosition[cache[i]] = static_cast<int>(i);
+            score[cache[i]] = vertexScore(static_cast<int>(i), remaining[cache[i]]);
+        }
+
+        best = -1;
+        float bestScore = -1.0f;
+        for (uint32_t v : cache) {
+            const unsigned int* list = &adjacency[offsets[v]];
+            for (unsigned int i = 0; i < remaining[v]; ++i) {
+                const uint32_t* candidate = &indices[list[i] * 3];
+                float candidateScore = score[candidate[0]] + score[candidate[1]] + score[candidate[2]];
+                if (candidateScore > bestScore) {
+                    bestScore = candidateScore;
+                    best = static_cast<long>(list[i]);
+                }
+            }
+        }
+    }
+
+    output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+    indices.swap(output);
+}
+
+// Pedro Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+// The cache-optimized order is cut into clusters (at cache flushes, then wherever the running miss ratio
+// is already good enough), and the clusters are sorted so the ones facing away from the mesh center,
+// which tend to occlude the rest, are drawn first.
+void MeshBuilder::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) return;
+
+    FifoCache cache(vertices.size());
+    std::vector<size_t> hardBoundaries;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (cache.access(&indices[t * 3]) == 3) hardBoundaries.push_back(t);
+    }
+    if (hardBoundaries.empty() || hardBoundaries[0] != 0) hardBoundaries.insert(hardBoundaries.begin(), 0);
+    hardBoundaries.push_back(triangleCount);
+
+    std::vector<size_t> clusters;
+    for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c) {
+        size_t start = hardBoundaries[c], end = hardBoundaries[c + 1];
+
+        cache.reset();
+        unsigned int clusterMisses = 0;
+        for (size_t t = start; t < end; ++t) clusterMisses += cache.access(&indices[t * 3]);
+        float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+        cache.reset();
+        clusters.push_back(start);
+        unsigned int runningMisses = 0, runningTriangles = 0;
+        for (size_t t = start; t + 1 < end; ++t) {
+            runningMisses += cache.access(&indices[t * 3]);
+            runningTriangles++;
+            if (static_cast<float>(runningMisses) <= clusterThreshold * static_cast<float>(runningTriangles)) {
+                clusters.push_back(t + 1);
+                cache.reset();
+                runningMisses = runningTriangles = 0;
+            }
+        }
+    }
+    if (clusters.size() < 2) return;
+    clusters.push_back(triangleCount);
+
+    glm::vec3 meshCenter(0.0f);
+    for (const auto& vertex : vertices) meshCenter += vertex.Position;
+    meshCenter /= static_cast<float>(std::max<size_t>(vertices.size(), 1));
+
+    // Area-weighted centroid and normal of every cluster.
+    struct Cluster {
+        size_t start, end;
+        float sortKey;
+    };
+    std::vector<Cluster> sorted;
+    sorted.reserve(clusters.size() - 1);
+    for (size_t c = 0; c + 1 < clusters.size(); ++c) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const glm::vec3& a = vertices[indices[t * 3 + 0]].Position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3& d = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 cross = glm::cross(b - a, d - a);
+            float triangleArea = glm::length(cross);
+            centroid += (a + b + d) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+        centroid = area > 0.0f ? centroid / area : vertices[indices[clusters[c] * 3]].Position;
+        float normalLength = glm::length(normal);
+        normal = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+        sorted.push_back({ clusters[c], clusters[c + 1], glm::dot(centroid - meshCenter, normal) });
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (const auto& cluster : sorted) {
+        output.insert(output.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+    }
+    output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+    indices.swap(output);
+}
+
+void MeshBuilder::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    const uint32_t unused = UINT32_MAX;
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (auto& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+}
+
+// Vertex clustering (Rossignac and Borrel), the approach of meshoptimizer's simplifySloppy: every vertex snaps
+// to one representative per grid cell and triangles that lose a corner are dropped. Rougher than edge collapses,
+// but it never fails on the non-manifold, seam-split meshes the props come as, and the outlines hide the rest.
+// The grid resolution is searched for the largest triangle count not above the target.
+std::vector<uint32_t> MeshBuilder::simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                            size_t targetIndexCount)
+{
+    std::vector<uint32_t> result;
+    size_t targetTriangles = targetIndexCount / 3;
+    if (targetTriangles == 0 || vertices.empty()) return result;
+
+    int low = 1, high = 1024, best = 0;
+    while (low <= high) {
+        int resolution = (low + high) / 2;
+        if (VertexGrid(vertices, resolution).countTriangles(indices) <= targetTriangles) {
+            best = resolution;
+            low = resolution + 1;
+        } else {
+            high = resolution - 1;
+        }
+    }
+    if (best == 0) return result;
+
+    VertexGrid grid(vertices, best);
+
+    // The representative is the vertex closest to the average of its cell, so it keeps real attributes.
+    std::vector<glm::vec3> average(grid.getCellCount(), glm::vec3(0.0f));
+    std::vector<unsigned int> members(grid.getCellCount(), 0);
+    for (uint32_t v = 0; v < vertices.size(); ++v) {
+        average[grid.cellOf(v)] += vertices[v].Position;
+        members[grid.cellOf(v)]++;
+    }
+    const uint32_t none = UINT32_MAX;
+    std::vector<uint32_t> representative(grid.getCellCount(), none);
+    std::vector<float> bestDistance(grid.getCellCount(), FLT_MAX);
+    for (uint32_t v = 0; v < vertices.size(); ++v) {
+        uint32_t cell = grid.cellOf(v);
+        glm::vec3 offset = vertices[v].Position - average[cell] / static_cast<float>(members[cell]);
+        float distance = glm::dot(offset, offset);
+        if (distance < bestDistance[cell]) {
+            bestDistance[cell] = distance;
+            representative[cell] = v;
+        }
+    }
+
+    result.reserve(targetTriangles * 3);
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        uint32_t a = grid.cellOf(indices[t]), b = grid.cellOf(indices[t + 1]), c = grid.cellOf(indices[t + 2]);
+        if (a == b || b == c || a == c) continue;
+        result.push_back(representative[a]);
+        result.push_back(representative[b]);
+        result.push_back(representative[c]);
+    }
+    return result;
+}
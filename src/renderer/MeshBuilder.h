@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "Bounds.h"
+
+// Full precision vertex, as imported by Assimp. Only lives on the CPU until the mesh is built.
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+};
+
+// What the GeometryPool stores and the vertex shaders read, 16 bytes instead of 32.
+struct PackedVertex {
+    uint16_t position[4];   // unorm16 inside the model's bounding box (decodePosition() in scene_data.glsl), w unused
+    int16_t normal[2];      // snorm16 octahedral (decodeOctahedral() in octahedral.glsl)
+    uint16_t texCoords[2];  // Half floats
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must match the attribute layout in GeometryPool");
+
+// One level of detail: a range of the mesh's indices. Every level uses the same vertices.
+struct MeshLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+// A mesh ready for the pool: 16-bit indices, relative to its own first vertex. indices holds every level back to back,
+// LOD 0 (the full mesh) first; lods has at least that one entry.
+struct PackedMesh {
+    std::vector<PackedVertex> vertices;
+    std::vector<uint16_t> indices;
+    std::vector<MeshLod> lods;
+};
+
+// Offline-style mesh build step, run once per import (the result goes into the mesh cache):
+// - meshes with more vertices than 16-bit indices can address are split,
+// - triangles are reordered for the post-transform vertex cache (Forsyth's algorithm), then clustered and
+//   sorted front to back from the mesh center to cut overdraw without losing much of that locality
+//   (Sander et al., as done by meshoptimizer),
+// - vertices are reordered in first-use order for fetch locality and quantized,
+// - coarser levels of detail are generated, each aiming at half the triangles of the previous one.
+class MeshBuilder
+{
+public:
+    static const size_t MAX_VERTICES = 65536;
+    static const int MAX_LODS = 4;
+    // A level that keeps more than this share of the previous level's triangles isn't worth its indices.
+    static constexpr float MIN_LOD_REDUCTION = 0.85f;
+
+    // Quantizes against box, which must contain every vertex (the model's bounds, shared by all its meshes).
+    static std::vector<PackedMesh> build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                         const BoundingBox& box);
+
+    static PackedVertex pack(const Vertex& vertex, const BoundingBox& box);
+
+    static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+    // Keeps the cache miss ratio of every cluster within threshold times the input's. Expects an already
+    // cache-optimized index order.
+    static void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+    // Renumbers vertices in the order the indices first use them and drops unused ones.
+    static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+    // Index buffer of at most about targetIndexCount indices into the same vertices, empty if none comes close.
+    static std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                          size_t targetIndexCount);
+};
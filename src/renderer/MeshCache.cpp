@@ -0,0 +1,332 @@
+#include "MeshCache.h"
+#include "Model.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char MAGIC[4] = { 'C', 'S', 'M', 'C' };
+    const uint64_t BLOB_ALIGNMENT = 16;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        uint32_t meshCount;
+        uint32_t vertexSize;    // sizeof(PackedVertex) when written, guards against a silently changed struct
+        float boundsMin[3];
+        float boundsMax[3];
+        float sphereCenter[3];
+        float sphereRadius;
+    };
+
+    struct MeshEntry {
+        uint64_t vertexOffset;  // Bytes from the start of the file
+        uint64_t indexOffset;
+        uint64_t textureOffset; // '\n'-separated diffuse texture names, relative to the model directory
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t textureBytes;
+        uint32_t lodCount;
+        uint32_t lodFirstIndex[MeshBuilder::MAX_LODS]; // Relative to the mesh's indices
+        uint32_t lodIndexCount[MeshBuilder::MAX_LODS];
+    };
+
+    uint64_t alignUp(uint64_t value)
+    {
+        return (value + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+    }
+
+    bool inFile(uint64_t offset, uint64_t bytes, size_t fileSize)
+    {
+        return offset <= fileSize && bytes <= fileSize - offset;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    bytes = static_cast<const unsigned char*>(view);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    bytes = nullptr;
+    length = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+#else
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    fileDescriptor = fd;
+    bytes = static_cast<const unsigned char*>(view);
+    length = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes) munmap(const_cast<unsigned char*>(bytes), length);
+    if (fileDescriptor >= 0) ::close(fileDescriptor);
+    bytes = nullptr;
+    length = 0;
+    fileDescriptor = -1;
+}
+#endif
+
+std::string MeshCache::getCachePath(const std::string& sourcePath)
+{
+    return sourcePath + ".meshcache";
+}
+
+bool MeshCache::hashFile(const std::string& path, uint64_t& hash, uint64_t& size)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    hash = 14695981039346656037ull;
+    size = 0;
+    char buffer[64 * 1024];
+    while (file) {
+        file.read(buffer, sizeof(buffer));
+        std::streamsize count = file.gcount();
+        for (std::streamsize i = 0; i < count; ++i) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 1099511628211ull;
+        }
+        size += static_cast<uint64_t>(count);
+    }
+    return true;
+}
+
+bool MeshCache::load(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, Contents& contents)
+{
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(cachePath)) return false;
+
+    const unsigned char* data = file->data();
+    size_t fileSize = file->size();
+    if (fileSize < sizeof(FileHeader)) return false;
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.vertexSize != sizeof(PackedVertex) || header.sourceHash != sourceHash || header.sourceSize != sourceSize) {
+        return false;
+    }
+    if (!inFile(sizeof(FileHeader), static_cast<uint64_t>(header.meshCount) * sizeof(MeshEntry), fileSize)) return false;
+
+    std::vector<MeshView> meshes(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; ++i) {
+        MeshEntry entry;
+        std::memcpy(&entry, data + sizeof(FileHeader) + i * sizeof(MeshEntry), sizeof(entry));
+
+        uint64_t vertexBytes = static_cast<uint64_t>(entry.vertexCount) * sizeof(PackedVertex);
+        uint64_t indexBytes = static_cast<uint64_t>(entry.indexCount) * sizeof(uint16_t);
+        if (!inFile(entry.vertexOffset, vertexBytes, fileSize) || !inFile(entry.indexOffset, indexBytes, fileSize) ||
+            !inFile(entry.textureOffset, entry.textureBytes, fileSize) ||
+            entry.vertexOffset % BLOB_ALIGNMENT != 0 || entry.indexOffset % BLOB_ALIGNMENT != 0 ||
+            entry.lodCount == 0 || entry.lodCount > static_cast<uint32_t>(MeshBuilder::MAX_LODS)) {
+            std::cerr << "Malformed mesh cache, ignoring: " << cachePath << std::endl;
+            return false;
+        }
+        for (uint32_t lod = 0; lod < entry.lodCount; ++lod) {
+            if (entry.lodFirstIndex[lod] > entry.indexCount || entry.lodIndexCount[lod] > entry.indexCount - entry.lodFirstIndex[lod]) {
+                std::cerr << "Malformed mesh cache, ignoring: " << cachePath << std::endl;
+                return false;
+            }
+        }
+
+        // Sizes can be right and the content still stale or corrupt: an index past the mesh would reach into
+        // another mesh's vertices (or past the pool) on the GPU. Touches the index pages the upload reads anyway.
+        const uint16_t* indices = reinterpret_cast<const uint16_t*>(data + entry.indexOffset);
+        for (uint32_t index = 0; index < entry.indexCount; ++index) {
+            if (indices[index] >= entry.vertexCount) {
+                std::cerr << "Malformed mesh cache, ignoring: " << cachePath << std::endl;
+                return false;
+            }
+        }
+
+        MeshView& view = meshes[i];
+        view.vertices = reinterpret_cast<const PackedVertex*>(data + entry.vertexOffset);
+        view.vertexCount = entry.vertexCount;
+        view.indices = indices;
+        view.indexCount = entry.indexCount;
+        for (uint32_t lod = 0; lod < entry.lodCount; ++lod) {
+            view.lods.push_back({ entry.lodFirstIndex[lod], entry.lodIndexCount[lod] });
+        }
+
+        std::string names(reinterpret_cast<const char*>(data + entry.textureOffset), entry.textureBytes);
+        size_t start = 0;
+        while (start < names.size()) {
+            size_t end = names.find('\n', start);
+            if (end == std::string::npos) end = names.size();
+            if (end > start) view.diffuseTextures.push_back(names.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+
+    contents.meshes = std::move(meshes);
+    contents.boundingBox.min = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    contents.boundingBox.max = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    contents.boundingSphere.center = glm::vec3(header.sphereCenter[0], header.sphereCenter[1], header.sphereCenter[2]);
+    contents.boundingSphere.radius = header.sphereRadius;
+    contents.file = std::move(file);
+    return true;
+}
+
+bool MeshCache::write(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize,
+                      const std::vector<Mesh>& meshes, const BoundingBox& boundingBox, const BoundingSphere& boundingSphere)
+{
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.vertexSize = sizeof(PackedVertex);
+    for (int axis = 0; axis < 3; ++axis) {
+        header.boundsMin[axis] = boundingBox.min[axis];
+        header.boundsMax[axis] = boundingBox.max[axis];
+        header.sphereCenter[axis] = boundingSphere.center[axis];
+    }
+    header.sphereRadius = boundingSphere.radius;
+
+    // Lay out everything first, the entries need the final offsets.
+    std::vector<MeshEntry> entries(meshes.size());
+    std::vector<std::string> textureNames(meshes.size());
+    uint64_t offset = sizeof(FileHeader) + meshes.size() * sizeof(MeshEntry);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        for (const auto& texture : meshes[i].textures) {
+            textureNames[i] += texture.path + "\n";
+        }
+        entries[i].textureOffset = offset;
+        entries[i].textureBytes = static_cast<uint32_t>(textureNames[i].size());
+        offset += textureNames[i].size();
+    }
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        entries[i].vertexCount = meshes[i].vertexCount;
+        entries[i].indexCount = meshes[i].indexCount;
+        entries[i].lodCount = static_cast<uint32_t>(std::min<size_t>(meshes[i].lods.size(), MeshBuilder::MAX_LODS));
+        for (uint32_t lod = 0; lod < entries[i].lodCount; ++lod) {
+            entries[i].lodFirstIndex[lod] = meshes[i].lods[lod].firstIndex;
+            entries[i].lodIndexCount[lod] = meshes[i].lods[lod].indexCount;
+        }
+        entries[i].vertexOffset = alignUp(offset);
+        offset = entries[i].vertexOffset + static_cast<uint64_t>(meshes[i].vertexCount) * sizeof(PackedVertex);
+        entries[i].indexOffset = alignUp(offset);
+        offset = entries[i].indexOffset + static_cast<uint64_t>(meshes[i].indexCount) * sizeof(uint16_t);
+    }
+
+    // Written under a temporary name and renamed, so an interrupted write never leaves a truncated cache behind.
+    std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write mesh cache: " << cachePath << std::endl;
+            return false;
+        }
+
+        uint64_t written = 0;
+        auto put = [&](const void* bytes, uint64_t count) {
+            file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(count));
+            written += count;
+        };
+        auto padTo = [&](uint64_t target) {
+            static const char zeros[BLOB_ALIGNMENT] = {};
+            put(zeros, target - written);
+        };
+
+        put(&header, sizeof(header));
+        put(entries.data(), entries.size() * sizeof(MeshEntry));
+        for (const auto& names : textureNames) put(names.data(), names.size());
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            padTo(entries[i].vertexOffset);
+            put(meshes[i].vertexData, static_cast<uint64_t>(meshes[i].vertexCount) * sizeof(PackedVertex));
+            padTo(entries[i].indexOffset);
+            put(meshes[i].indexData, static_cast<uint64_t>(meshes[i].indexCount) * sizeof(uint16_t));
+        }
+
+        if (!file) {
+            std::cerr << "Failed to write mesh cache: " << cachePath << std::endl;
+            file.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    std::remove(cachePath.c_str());
+    if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "Failed to write mesh cache: " << cachePath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Bounds.h"
+#include "MeshBuilder.h"
+
+struct Mesh;
+
+// Read-only view of a whole file, memory-mapped so a cache hit never copies the vertex data on the CPU side.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
+
+// Binary copy of an imported model, stored next to the source as "<model>.meshcache".
+// Layout: header, one entry per mesh, the diffuse texture names, then the vertex and index blobs
+// (16-byte aligned, already built by MeshBuilder: PackedVertex / uint16 indices of every level of detail, ready for
+// the GeometryPool).
+// The header carries a hash of the source file; any edit to the .obj, or a format bump, is a cache miss.
+class MeshCache
+{
+public:
+    // Bump whenever the layout, the PackedVertex struct, the import flags or the mesh build step change.
+    static const uint32_t VERSION = 3;
+
+    struct MeshView {
+        const PackedVertex* vertices = nullptr;   // Into the mapping
+        uint32_t vertexCount = 0;
+        const uint16_t* indices = nullptr;
+        uint32_t indexCount = 0;            // Every level of detail
+        std::vector<MeshLod> lods;
+        std::vector<std::string> diffuseTextures;
+    };
+
+    // A validated cache file. The views stay valid as long as the file is kept open.
+    struct Contents {
+        std::unique_ptr<MappedFile> file;
+        std::vector<MeshView> meshes;
+        BoundingBox boundingBox;
+        BoundingSphere boundingSphere;
+    };
+
+    static std::string getCachePath(const std::string& sourcePath);
+
+    // 64-bit FNV-1a of the whole file. False if it can't be read.
+    static bool hashFile(const std::string& path, uint64_t& hash, uint64_t& size);
+
+    // False on a missing, stale (different source hash/size or version) or malformed cache.
+    static bool load(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, Contents& contents);
+
+    static bool write(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize,
+                      const std::vector<Mesh>& meshes, const BoundingBox& boundingBox, const BoundingSphere& boundingSphere);
+};
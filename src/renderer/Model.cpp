@@ -1,81 +1,80 @@
 #include "Model.h"
+#include "GeometryPool.h"
 #include <iostream>
 #include <vector>
-#define STB_IMAGE_IMPLEMENTATION
-#include "../utils/stb_image.h"
+#include <cmath>
+#include <algorithm>
+#include <cstring>
 
-// Upload geometry to the GPU.
-// Creates the VAO, VBO, and EBO configuration.
-void Mesh::setupMesh() {
-    // Generate buffers
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-    
-    // Upload Vertex Data
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-    // Upload Indices
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-    // Position input (layout = 0)
-    // 3 floats (x, y, z)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    
-    // Normal vector input (layout = 1)
-    // 3 floats (nx, ny, nz)
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    
-    // Texture Coordinates input (layout = 2)
-    // 2 floats (u, v)
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+Model::Model() {
+}
 
-    glBindVertexArray(0); // Unbind to prevent modifications
+Model::~Model() {
+    // Geometry lives in the GeometryPool, which owns the GL buffers.
 }
 
-// Render the objects.
-void Mesh::draw() {
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+void Model::finishLoad() {
+    loaded = true;
 }
 
-Model::Model(const std::string& path) {
-    loadModel(path);
+void Model::setTexture(size_t index, std::shared_ptr<TextureResource> texture) {
+    if (index >= textures_loaded.size() || !texture) return;
+    textureResources.resize(textures_loaded.size());
+    textures_loaded[index].id = texture->id;
+    textureResources[index] = std::move(texture);
 }
 
-Model::~Model() {
-    // Clean up all the buffers.
+void Model::addToPool(GeometryPool& pool) {
+    if (inPool || !loaded) return;
     for (auto& mesh : meshes) {
-        glDeleteVertexArrays(1, &mesh.VAO);
-        glDeleteBuffers(1, &mesh.VBO);
-        glDeleteBuffers(1, &mesh.EBO);
+        GeometryRange range = pool.addMesh(mesh.vertexData, mesh.vertexCount, mesh.indexData, mesh.indexCount);
+        mesh.firstIndex = range.firstIndex;
+        mesh.baseVertex = range.baseVertex;
+
+        // The pool has its own copy now; bounds were computed at load.
+        std::vector<PackedVertex>().swap(mesh.packedVertices);
+        std::vector<uint16_t>().swap(mesh.packedIndices);
+        mesh.vertexData = nullptr;
+        mesh.indexData = nullptr;
     }
+    cacheFile.reset();
+    inPool = true;
 }
 
-// Draw all sub-meshes of the object.
-void Model::draw() {
-    for (auto& mesh : meshes) {
-        mesh.draw();
+void Model::appendDrawCommands(std::vector<DrawElementsIndirectCommand>& commands, GLuint instanceCount, GLuint baseInstance,
+                               int lod) const {
+    if (!inPool) return;
+    for (const auto& mesh : meshes) {
+        const MeshLod& level = mesh.lods[std::min(static_cast<size_t>(std::max(lod, 0)), mesh.lods.size() - 1)];
+        DrawElementsIndirectCommand command;
+        command.count = level.indexCount;
+        command.instanceCount = instanceCount;
+        command.firstIndex = mesh.firstIndex + level.firstIndex;
+        command.baseVertex = mesh.baseVertex;
+        command.baseInstance = baseInstance;
+        commands.push_back(command);
     }
 }
 
 size_t Model::getVertexCount() const {
     size_t count = 0;
+    if (!loaded) return count;
     for (const auto& mesh : meshes) {
-        count += mesh.vertices.size();
+        count += mesh.vertexCount;
     }
     return count;
 }
 
-void Model::loadModel(const std::string& path) {
+size_t Model::getTriangleCount(int lod) const {
+    size_t count = 0;
+    if (!loaded) return count;
+    for (const auto& mesh : meshes) {
+        count += mesh.lods[std::min(static_cast<size_t>(std::max(lod, 0)), mesh.lods.size() - 1)].indexCount / 3;
+    }
+    return count;
+}
+
+bool Model::load(const std::string& path) {
     // Handle running from different directories.
     std::vector<std::string> possiblePaths = {
         path,
@@ -83,6 +82,20 @@ void Model::loadModel(const std::string& path) {
         "../" + path      // From build/ back to project root
     };
     
+    // The binary cache next to the source is only trusted if it was built from exactly this file.
+    uint64_t sourceHash = 0, sourceSize = 0;
+    for (const auto& testPath : possiblePaths) {
+        if (!MeshCache::hashFile(testPath, sourceHash, sourceSize)) continue;
+
+        MeshCache::Contents contents;
+        if (MeshCache::load(MeshCache::getCachePath(testPath), sourceHash, sourceSize, contents)) {
+            directory = testPath.substr(0, testPath.find_last_of('/'));
+            loadFromCache(contents);
+            return true;
+        }
+        break;
+    }
+
     Assimp::Importer importer;
     const aiScene* scene = nullptr;
     std::string actualPath;
@@ -92,9 +105,9 @@ void Model::loadModel(const std::string& path) {
         // Flags: 
         // - Triangulate: Ensure we always have triangles (GL_TRIANGLES).
         // - FlipUVs: OpenGL expects Y=0 at bottom, textures often have Y=0 at top.
-        // - CalcTangentSpace: Needed for Normal Mapping (future proofing).
         // - GenNormals: If file lacks normals, clear them up.
-        scene = importer.ReadFile(testPath, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_GenNormals);
+        // No CalcTangentSpace: the vertex format has no tangents, so they were computed and thrown away.
+        scene = importer.ReadFile(testPath, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals);
         if (scene && !(scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) && scene->mRootNode) {
             actualPath = testPath;
             break;
@@ -103,11 +116,81 @@ void Model::loadModel(const std::string& path) {
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-        return;
+        return false;
     }
 
     directory = actualPath.substr(0, actualPath.find_last_of('/'));
     processNode(scene->mRootNode, scene);
+    computeBounds();
+    buildMeshes();
+
+    if (MeshCache::hashFile(actualPath, sourceHash, sourceSize) &&
+        MeshCache::write(MeshCache::getCachePath(actualPath), sourceHash, sourceSize, meshes, boundingBox, boundingSphere)) {
+        std::cout << "Mesh cache written: " << MeshCache::getCachePath(actualPath) << std::endl;
+    }
+    return true;
+}
+
+void Model::loadFromCache(MeshCache::Contents& contents) {
+    meshes.clear();
+    meshes.reserve(contents.meshes.size());
+    for (const auto& view : contents.meshes) {
+        Mesh mesh;
+        mesh.vertexData = view.vertices;
+        mesh.indexData = view.indices;
+        mesh.vertexCount = view.vertexCount;
+        mesh.indexCount = view.indexCount;
+        mesh.lods = view.lods;
+        mesh.textures = loadTextures(view.diffuseTextures, "texture_diffuse");
+        meshes.push_back(std::move(mesh));
+    }
+
+    boundingBox = contents.boundingBox;
+    boundingSphere = contents.boundingSphere;
+    cacheFile = std::move(contents.file);
+}
+
+// Box from the vertex extremes, sphere around the box center (tighter than the box's circumscribed sphere).
+void Model::computeBounds() {
+    boundingBox = BoundingBox();
+    for (const auto& mesh : meshes) {
+        for (const auto& vertex : mesh.vertices) {
+            boundingBox.expand(vertex.Position);
+        }
+    }
+    if (!boundingBox.isValid()) return;
+
+    boundingSphere.center = boundingBox.getCenter();
+    float radiusSquared = 0.0f;
+    for (const auto& mesh : meshes) {
+        for (const auto& vertex : mesh.vertices) {
+            glm::vec3 offset = vertex.Position - boundingSphere.center;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+    }
+    boundingSphere.radius = std::sqrt(radiusSquared);
+}
+
+// An imported mesh can come out as several: one per 64K vertices. They keep the imported textures.
+void Model::buildMeshes() {
+    std::vector<Mesh> built;
+    built.reserve(meshes.size());
+    for (const auto& imported : meshes) {
+        std::vector<PackedMesh> parts = MeshBuilder::build(imported.vertices, imported.indices, boundingBox);
+        for (auto& part : parts) {
+            Mesh mesh;
+            mesh.packedVertices = std::move(part.vertices);
+            mesh.packedIndices = std::move(part.indices);
+            mesh.vertexData = mesh.packedVertices.data();
+            mesh.indexData = mesh.packedIndices.data();
+            mesh.vertexCount = static_cast<GLuint>(mesh.packedVertices.size());
+            mesh.indexCount = static_cast<GLuint>(mesh.packedIndices.size());
+            mesh.lods = std::move(part.lods);
+            mesh.textures = imported.textures;
+            built.push_back(std::move(mesh));
+        }
+    }
+    meshes = std::move(built);
 }
 
 void Model::processNode(aiNode* node, const aiScene* scene) {
@@ -130,6 +213,8 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture> textures;
+    vertices.reserve(mesh->mNumVertices);
+    indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
 
     // Walk through each of the mesh's vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
@@ -179,24 +264,30 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
     }
 
     Mesh result;
-    result.vertices = vertices;
-    result.indices = indices;
-    result.textures = textures;
-    result.setupMesh();
+    result.vertices = std::move(vertices);
+    result.indices = std::move(indices);
+    result.textures = std::move(textures);
     
     return result;
 }
 
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName) {
-    std::vector<Texture> textures;
+    std::vector<std::string> paths;
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
         aiString str;
         mat->GetTexture(type, i, &str);
-        
+        paths.push_back(str.C_Str());
+    }
+    return loadTextures(paths, typeName);
+}
+
+std::vector<Texture> Model::loadTextures(const std::vector<std::string>& paths, const std::string& typeName) {
+    std::vector<Texture> textures;
+    for (const auto& path : paths) {
         // Check if texture was loaded before and if it is skip it
         bool skip = false;
         for (unsigned int j = 0; j < textures_loaded.size(); j++) {
-            if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
+            if (textures_loaded[j].path == path) {
                 textures.push_back(textures_loaded[j]);
                 skip = true;
                 break;
@@ -204,70 +295,20 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
         }
         
         if (!skip) {   // If texture hasn't been loaded already, load it
+            // Only located here; decoding and upload go through the renderer-wide TextureCache,
+            // so a file shared by several models is loaded once.
             Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), directory);
+            texture.id = 0;
             texture.type = typeName;
-            texture.path = str.C_Str();
-            if (texture.id > 0) {
+            texture.path = path;
+            texture.file = TextureCache::resolve(directory, path);
+            if (!texture.file.empty()) {
                 textures.push_back(texture);
                 textures_loaded.push_back(texture);
+            } else {
+                std::cout << "Texture failed to load at path: " << directory + '/' + path << std::endl;
             }
         }
     }
     return textures;
 }
-
-unsigned int Model::TextureFromFile(const char* path, const std::string& directory) {
-    std::string filename = std::string(path);
-    filename = directory + '/' + filename;
-    
-    // Try multiple possible paths since the executable might be in build/Release/
-    std::vector<std::string> possiblePaths = {
-        filename,
-        "../../" + filename,  // From build/Release/ back to project root
-        "../" + filename      // From build/ back to project root
-    };
-    
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    
-    int width, height, nrComponents;
-    unsigned char* data = nullptr;
-    std::string actualPath;
-    
-    // Load image using stb_image
-    for (const auto& testPath : possiblePaths) {
-        data = stbi_load(testPath.c_str(), &width, &height, &nrComponents, 0);
-        if (data) {
-            actualPath = testPath;
-            break;
-        }
-    }
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-        
-        // Upload to GPU
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // Parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    } else {
-        std::cout << "Texture failed to load at path: " << filename << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
-}
\ No newline at end of file
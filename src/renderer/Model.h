@@ -9,58 +9,113 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include "Bounds.h"
+#include "MeshBuilder.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
 
-struct Vertex {
-    glm::vec3 Position;  
-    glm::vec3 Normal;    
-    glm::vec2 TexCoords; 
-};
+class GeometryPool;
+struct DrawElementsIndirectCommand;
 
 struct Texture {
     unsigned int id;
     std::string type; // e.g., "texture_diffuse", "texture_specular"
     std::string path; // Used to prevent reloading the same texture twice
+    std::string file; // Resolved on disk (maybe a compressed .ktx2/.dds next to it), the TextureCache key
 };
 
 // I need this beacause some of my models are made of multiple Meshes
 struct Mesh {
+    // Full precision import, only kept until MeshBuilder has turned it into the packed data.
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
+
+    // Built copy, only kept until addToPool(). After an Assimp import vertexData/indexData point into
+    // packedVertices/packedIndices; on a mesh cache hit those stay empty and the pointers go into the mapped cache file.
+    std::vector<PackedVertex> packedVertices;
+    std::vector<uint16_t> packedIndices;
+    const PackedVertex* vertexData = nullptr;
+    const uint16_t* indexData = nullptr;
+    GLuint vertexCount = 0;
+    GLuint indexCount = 0;          // Every level of detail
+    std::vector<MeshLod> lods;      // Ranges of the indices above, LOD 0 first
     std::vector<Texture> textures;
-    unsigned int VAO, VBO, EBO;
-    
-    // Uploads the geometry to the GPU.
-    void setupMesh();
-    void draw();
+
+    // Location inside the shared GeometryPool, set by Model::addToPool().
+    GLuint firstIndex = 0;
+    GLint baseVertex = 0;
 };
 
+// Loading is split in two so the slow part can run on a worker thread (see AssetLoader):
+// load() parses the file and finds its textures without touching GL, finishLoad() then runs on the GL thread.
+// Until finishLoad() the model is an empty placeholder: nothing to draw, no bounds, and the main thread
+// must not look at anything else in it while a worker may still be filling it.
 class Model {
 public:
-    Model(const std::string& path);
+    Model();
     ~Model();
+
+    // CPU half. Safe on any thread; returns false if the file couldn't be imported.
+    bool load(const std::string& path);
+    // GL thread, after load(). Textures are not created here: the loader gets them from the TextureCache
+    // and hands them over with setTexture(), the model draws untextured until then.
+    void finishLoad();
+    bool isLoaded() const { return loaded; }
+
+    // One entry per distinct texture file, only valid once isLoaded().
+    const std::vector<Texture>& getTextures() const { return textures_loaded; }
+    // Keeps a reference on the shared texture; index is the position in getTextures().
+    void setTexture(size_t index, std::shared_ptr<TextureResource> texture);
     
-    // Draws every mesh in this model.
-    void draw();
+    // Copies every mesh into the shared pool and drops the CPU copy. Must happen before the model is drawn.
+    // Does nothing before finishLoad().
+    void addToPool(GeometryPool& pool);
+    bool isInPool() const { return inPool; }
+
+    // One indirect command per mesh, drawing instanceCount instances starting at baseInstance.
+    // lod is clamped per mesh, a mesh too small to simplify draws its full triangles at every level.
+    void appendDrawCommands(std::vector<DrawElementsIndirectCommand>& commands, GLuint instanceCount, GLuint baseInstance,
+                            int lod = 0) const;
     
     // Helper to check if we actually loaded any textures.
-    bool hasTexture() const { return !textures_loaded.empty(); }
+    bool hasTexture() const { return getDiffuseTexture() != 0; }
     
-    // Returns the ID of the first loaded texture (usually diffuse) or 0 if none.
-    unsigned int getDiffuseTexture() const { return !textures_loaded.empty() ? textures_loaded[0].id : 0; }
+    // Returns the ID of the first loaded texture (usually diffuse) or 0 if none (or not uploaded yet).
+    unsigned int getDiffuseTexture() const { return loaded && !textures_loaded.empty() ? textures_loaded[0].id : 0; }
+    // Its bindless handle, 0 if there's none (or the texture cache doesn't make handles).
+    GLuint64 getDiffuseHandle() const { return hasTexture() && !textureResources.empty() && textureResources[0] ? textureResources[0]->handle : 0; }
     
     size_t getVertexCount() const;
+    // Triangles drawn per instance at that level of detail.
+    size_t getTriangleCount(int lod = 0) const;
+
+    // Object-space bounds of all meshes, computed once on load. Used for culling, and the box the vertex
+    // positions are quantized in (the shaders get it back through Scene::setModelBounds()). Only valid once isLoaded().
+    const BoundingBox& getBoundingBox() const { return boundingBox; }
+    const BoundingSphere& getBoundingSphere() const { return boundingSphere; }
     
 private:
     std::vector<Mesh> meshes;
     std::vector<Texture> textures_loaded;
     std::string directory;
+    bool inPool = false;
+    bool loaded = false;    // Main thread only
+    std::vector<std::shared_ptr<TextureResource>> textureResources; // Parallel to textures_loaded
+    BoundingBox boundingBox;
+    BoundingSphere boundingSphere;
+    // Keeps the mesh data of a cache hit mapped until addToPool().
+    std::unique_ptr<MappedFile> cacheFile;
     
     // recursive brain of the operation
-    void loadModel(const std::string& path);
+    void loadFromCache(MeshCache::Contents& contents);
     void processNode(aiNode* node, const aiScene* scene);
     Mesh processMesh(aiMesh* mesh, const aiScene* scene);
+    void computeBounds();
+    // Splits, reorders and quantizes the imported meshes (see MeshBuilder). Needs the bounds.
+    void buildMeshes();
     
     // Material parsing magic
     std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
-    unsigned int TextureFromFile(const char* path, const std::string& directory);
+    // Shared by the Assimp and cache paths; a texture already used by another mesh is not loaded again.
+    std::vector<Texture> loadTextures(const std::vector<std::string>& paths, const std::string& typeName);
 };
\ No newline at end of file
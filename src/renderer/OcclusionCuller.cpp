@@ -0,0 +1,197 @@
+#include "OcclusionCuller.h"
+#include "Shader.h"
+#include "UniformBlocks.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // Same as local_size_x of occlusion_cull.comp and local_size_x/y of hiz_downsample.comp.
+    const GLuint CULL_GROUP_SIZE = 64;
+    const GLuint HIZ_GROUP_SIZE = 8;
+
+    // Run start of candidates no command draws (models not in the geometry pool yet), same as NO_RUN in the shader.
+    const uint32_t NO_RUN = 0xFFFFFFFFu;
+}
+
+OcclusionCuller::OcclusionCuller()
+    : candidateBuffer(OCCLUSION_CANDIDATE_BINDING), countBuffer(OCCLUSION_COUNT_BINDING),
+      visibilityBuffer(INSTANCE_VISIBILITY_BINDING), candidateCount(0), commandCount(0), commandBuffer(0),
+      hiZTexture(0), hiZWidth(0), hiZHeight(0), hiZLevels(0)
+{
+    cullShader = std::make_unique<Shader>("assets/shaders/culling/occlusion_cull.comp");
+    hiZShader = std::make_unique<Shader>("assets/shaders/culling/hiz_downsample.comp");
+    if (isAvailable()) {
+        std::cout << "Occlusion culling shaders compiled successfully" << std::endl;
+    } else {
+        std::cerr << "Occlusion culling shaders failed to build, the geometry pass draws the frustum-culled list" << std::endl;
+    }
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    if (hiZTexture) glDeleteTextures(1, &hiZTexture);
+}
+
+bool OcclusionCuller::isAvailable() const
+{
+    return cullShader && hiZShader && cullShader->isLinked() && hiZShader->isLinked();
+}
+
+bool OcclusionCuller::pollReload()
+{
+    bool reloaded = false;
+    if (cullShader && cullShader->pollReload()) reloaded = true;
+    if (hiZShader && hiZShader->pollReload()) reloaded = true;
+    return reloaded;
+}
+
+void OcclusionCuller::prepare(const std::vector<uint32_t>& candidateIds, const std::vector<DrawElementsIndirectCommand>& commands,
+                              ShaderStorageBuffer& visibleInstanceBuffer, GLuint indirectBuffer)
+{
+    candidateCount = static_cast<GLuint>(candidateIds.size());
+    commandCount = static_cast<GLuint>(commands.size());
+    commandBuffer = indirectBuffer;
+
+    // A command's baseInstance is the first id of its run: every id between it and baseInstance + instanceCount
+    // belongs to that run, and its survivors are compacted to the front of the same range.
+    candidates.resize(candidateIds.size() * 2);
+    uint32_t instanceCount = 1;
+    for (size_t i = 0; i < candidateIds.size(); ++i) {
+        candidates[i * 2] = candidateIds[i];
+        candidates[i * 2 + 1] = NO_RUN;
+        instanceCount = std::max(instanceCount, candidateIds[i] + 1);
+    }
+    for (const auto& command : commands) {
+        for (GLuint i = 0; i < command.instanceCount; ++i) {
+            candidates[(command.baseInstance + i) * 2 + 1] = command.baseInstance;
+        }
+    }
+    candidateBuffer.allocate(static_cast<GLsizeiptr>(std::max<size_t>(candidates.size(), 2) * sizeof(uint32_t)), candidates.data());
+
+    // Phase 1's copy addresses the second half of the visible ids.
+    phaseCommands.resize(commands.size() * 2);
+    for (size_t i = 0; i < commands.size(); ++i) {
+        phaseCommands[i] = commands[i];
+        phaseCommands[i].instanceCount = 0;
+        phaseCommands[commands.size() + i] = phaseCommands[i];
+        phaseCommands[commands.size() + i].baseInstance += candidateCount;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, phaseCommands.size() * sizeof(DrawElementsIndirectCommand),
+                 phaseCommands.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    GLsizeiptr idBytes = static_cast<GLsizeiptr>(std::max<GLuint>(candidateCount, 1) * 2 * sizeof(uint32_t));
+    visibleInstanceBuffer.allocate(idBytes);
+    countBuffer.allocate(idBytes);
+    GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer.getID());
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    // New instances start as not visible last frame: phase 1 tests them before they're drawn.
+    GLsizeiptr visibilityBytes = static_cast<GLsizeiptr>(instanceCount * sizeof(uint32_t));
+    if (visibilityBuffer.getSize() < visibilityBytes) {
+        visibilityBuffer.allocate(visibilityBytes);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibilityBuffer.getID());
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void OcclusionCuller::cull(Phase phase)
+{
+    if (!isAvailable() || candidateCount == 0) return;
+
+    candidateBuffer.bind();
+    countBuffer.bind();
+    visibilityBuffer.bind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDIRECT_COMMAND_BINDING, commandBuffer);
+
+    cullShader->use();
+    cullShader->setInt("phase", static_cast<int>(phase));
+    cullShader->setInt("candidateCount", static_cast<int>(candidateCount));
+    cullShader->setInt("commandCount", static_cast<int>(commandCount));
+    cullShader->setInt("hiZLevels", hiZLevels);
+    cullShader->setInt("hiZ", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hiZTexture);
+
+    // Survivors first, then their counts into the commands once every run is complete.
+    cullShader->setBool("patchCommands", false);
+    glDispatchCompute((candidateCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    cullShader->setBool("patchCommands", true);
+    glDispatchCompute((commandCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void OcclusionCuller::allocateHiZ(unsigned int targetWidth, unsigned int targetHeight)
+{
+    int width = std::max(1, static_cast<int>((targetWidth + 1) / 2));
+    int height = std::max(1, static_cast<int>((targetHeight + 1) / 2));
+    if (hiZTexture && width == hiZWidth && height == hiZHeight) return;
+
+    if (hiZTexture) glDeleteTextures(1, &hiZTexture);
+    hiZWidth = width;
+    hiZHeight = height;
+    hiZLevels = 1;
+    while ((std::max(width, height) >> hiZLevels) > 0) ++hiZLevels;
+
+    glGenTextures(1, &hiZTexture);
+    glBindTexture(GL_TEXTURE_2D, hiZTexture);
+    glTexStorage2D(GL_TEXTURE_2D, hiZLevels, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// One dispatch per level. Sizes follow the render area (rounded up per level), not the allocation.
+void OcclusionCuller::buildHiZ(GLuint depthTexture, unsigned int renderWidth, unsigned int renderHeight,
+                               unsigned int targetWidth, unsigned int targetHeight)
+{
+    if (!isAvailable()) return;
+    allocateHiZ(targetWidth, targetHeight);
+
+    hiZShader->use();
+    hiZShader->setInt("sourceDepth", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+
+    int sourceWidth = static_cast<int>(renderWidth);
+    int sourceHeight = static_cast<int>(renderHeight);
+    for (int level = 0; level < hiZLevels; ++level) {
+        // Level 0 reads the depth texture; the read-only image is then unused but has to be valid.
+        glBindImageTexture(0, hiZTexture, std::max(level - 1, 0), GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        hiZShader->setBool("fromDepth", level == 0);
+        hiZShader->setInt("sourceWidth", sourceWidth);
+        hiZShader->setInt("sourceHeight", sourceHeight);
+
+        int levelWidth = (sourceWidth + 1) / 2;
+        int levelHeight = (sourceHeight + 1) / 2;
+        glDispatchCompute((levelWidth + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (levelHeight + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        sourceWidth = std::max(levelWidth, 1);
+        sourceHeight = std::max(levelHeight, 1);
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+size_t OcclusionCuller::getHiZMemoryBytes() const
+{
+    if (!hiZTexture) return 0;
+    size_t bytes = 0;
+    for (int level = 0; level < hiZLevels; ++level) {
+        bytes += static_cast<size_t>(std::max(hiZWidth >> level, 1)) * std::max(hiZHeight >> level, 1) * sizeof(float);
+    }
+    return bytes;
+}
+
+size_t OcclusionCuller::getBufferMemoryBytes() const
+{
+    return static_cast<size_t>(candidateBuffer.getSize() + countBuffer.getSize() + visibilityBuffer.getSize());
+}
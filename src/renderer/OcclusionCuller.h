@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+#include <vector>
+#include "ShaderStorageBuffer.h"
+#include "GeometryPool.h"
+
+class Shader;
+
+// Two-phase GPU occlusion culling of the geometry pass, on top of the CPU frustum culling:
+// 1. the candidates that were visible last frame are drawn untested,
+// 2. a hierarchical depth buffer (Hi-Z: farthest depth per texel of every mip) is built from that depth,
+// 3. every candidate's box is tested against it; survivors that 1 didn't draw are drawn on top.
+// Both draws reuse the CPU list's indirect commands (and its texture groups) with instance counts written by the
+// GPU, so nothing is read back. The result of 3 is the next frame's "visible last frame".
+class OcclusionCuller
+{
+public:
+    enum Phase {
+        PHASE_PREVIOUSLY_VISIBLE = 0,
+        PHASE_DISOCCLUDED = 1
+    };
+
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    // False if a compute shader failed to build (or link); the geometry pass then draws the frustum-culled list directly.
+    bool isAvailable() const;
+    bool pollReload();
+
+    // Uploads a frustum-culled list (one layer): its ids as candidates, and one copy of its commands per phase
+    // with no instances yet. Both phases write their ids into visibleInstanceBuffer, phase 1 after phase 0's.
+    void prepare(const std::vector<uint32_t>& candidateIds, const std::vector<DrawElementsIndirectCommand>& commands,
+                 ShaderStorageBuffer& visibleInstanceBuffer, GLuint indirectBuffer);
+    // Compacts the ids of one phase and writes their counts into that phase's commands.
+    // PHASE_DISOCCLUDED needs the Hi-Z of this frame, see buildHiZ().
+    void cull(Phase phase);
+    // Index of the phase's copy of commands[0] in the indirect buffer.
+    GLuint getCommandOffset(Phase phase) const { return static_cast<GLuint>(phase) * commandCount; }
+
+    // Downsamples the bottom-left renderWidth x renderHeight pixels of depthTexture (targetWidth x targetHeight,
+    // the Hi-Z is allocated for the full size so dynamic resolution never reallocates it).
+    void buildHiZ(GLuint depthTexture, unsigned int renderWidth, unsigned int renderHeight,
+                  unsigned int targetWidth, unsigned int targetHeight);
+
+    // The Hi-Z mip chain, and the candidate/count/visibility buffers.
+    size_t getHiZMemoryBytes() const;
+    size_t getBufferMemoryBytes() const;
+
+private:
+    std::unique_ptr<Shader> cullShader;
+    std::unique_ptr<Shader> hiZShader;
+
+    ShaderStorageBuffer candidateBuffer;   // uvec2 per candidate: visible id, first id of its run
+    ShaderStorageBuffer countBuffer;       // Survivors per run and phase
+    ShaderStorageBuffer visibilityBuffer;  // Per instance id, kept across frames (only grows)
+    std::vector<uint32_t> candidates;
+    std::vector<DrawElementsIndirectCommand> phaseCommands;
+    GLuint candidateCount;
+    GLuint commandCount;
+    GLuint commandBuffer;                  // The renderer's indirect buffer, written through INDIRECT_COMMAND_BINDING
+
+    GLuint hiZTexture;
+    int hiZWidth;
+    int hiZHeight;
+    int hiZLevels;
+
+    void allocateHiZ(unsigned int targetWidth, unsigned int targetHeight);
+};
@@ -0,0 +1,154 @@
+#include "Profiler.h"
+
+namespace {
+    // Weight of a new frame in the rolling averages (about the last 20 frames).
+    const float AVERAGE_WEIGHT = 0.05f;
+}
+
+Profiler::Profiler()
+    : currentFrame(0), recording(false), epoch(std::chrono::steady_clock::now()), resolvedFrames(0), droppedFrames(0)
+{
+}
+
+Profiler::~Profiler()
+{
+    for (auto& frame : frames) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        }
+    }
+}
+
+double Profiler::now() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+GLuint Profiler::acquireQuery(Frame& frame)
+{
+    if (frame.usedQueries == frame.queries.size()) {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    return frame.queries[frame.usedQueries++];
+}
+
+void Profiler::beginFrame()
+{
+    currentFrame = (currentFrame + 1) % FRAME_LATENCY;
+
+    // Read back whatever finished, oldest first. The slot about to be reused is the oldest.
+    for (int i = 0; i < FRAME_LATENCY; ++i) {
+        Frame& frame = frames[(currentFrame + i) % FRAME_LATENCY];
+        if (frame.pending) resolve(frame);
+    }
+
+    Frame& frame = frames[currentFrame];
+    if (frame.pending) {
+        frame.pending = false;
+        ++droppedFrames;
+    }
+
+    recording = enabled;
+    if (!recording) return;
+
+    frame.records.clear();
+    frame.usedQueries = 0;
+    openScopes.clear();
+    beginScope("Frame");
+}
+
+void Profiler::endFrame()
+{
+    if (!recording) return;
+
+    // Anything left open ends with the frame.
+    while (!openScopes.empty()) endScope();
+
+    frames[currentFrame].pending = true;
+    recording = false;
+}
+
+void Profiler::beginScope(const std::string& name)
+{
+    if (!recording) return;
+
+    Frame& frame = frames[currentFrame];
+    Record record;
+    record.path = openScopes.empty() ? name : frame.records[openScopes.back()].path + "/" + name;
+    record.depth = static_cast<int>(openScopes.size());
+    record.startQuery = acquireQuery(frame);
+    record.endQuery = acquireQuery(frame);
+    record.cpuStart = now();
+    record.cpuEnd = record.cpuStart;
+    glQueryCounter(record.startQuery, GL_TIMESTAMP);
+
+    openScopes.push_back(frame.records.size());
+    frame.records.push_back(std::move(record));
+}
+
+void Profiler::endScope()
+{
+    if (!recording || openScopes.empty()) return;
+
+    Record& record = frames[currentFrame].records[openScopes.back()];
+    openScopes.pop_back();
+    glQueryCounter(record.endQuery, GL_TIMESTAMP);
+    record.cpuEnd = now();
+}
+
+bool Profiler::resolve(Frame& frame)
+{
+    if (frame.records.empty()) {
+        frame.pending = false;
+        return true;
+    }
+
+    // The frame scope ends last, once its end stamp is available all the others are too.
+    GLint available = 0;
+    glGetQueryObjectiv(frame.records.front().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return false;
+
+    GLuint64 frameStart = 0;
+    glGetQueryObjectui64v(frame.records.front().startQuery, GL_QUERY_RESULT, &frameStart);
+    double cpuFrameStart = frame.records.front().cpuStart;
+
+    scopes.clear();
+    lastFrame.clear();
+    for (const auto& record : frame.records) {
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(record.startQuery, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(record.endQuery, GL_QUERY_RESULT, &end);
+
+        float gpuMs = static_cast<float>(static_cast<double>(end - start) / 1.0e6);
+        float gpuStartMs = static_cast<float>(static_cast<double>(start - frameStart) / 1.0e6);
+        float cpuMs = static_cast<float>(record.cpuEnd - record.cpuStart);
+        float cpuStartMs = static_cast<float>(record.cpuStart - cpuFrameStart);
+
+        ScopeStats sample;
+        size_t slash = record.path.find_last_of('/');
+        sample.path = record.path;
+        sample.name = slash == std::string::npos ? record.path : record.path.substr(slash + 1);
+        sample.depth = record.depth;
+        sample.cpuMs = cpuMs;
+        sample.gpuMs = gpuMs;
+        sample.cpuStartMs = cpuStartMs;
+        sample.gpuStartMs = gpuStartMs;
+        lastFrame.push_back(sample);
+
+        auto inserted = averages.emplace(record.path, sample);
+        ScopeStats& stats = inserted.first->second;
+        if (!inserted.second) {
+            stats.cpuMs += (cpuMs - stats.cpuMs) * AVERAGE_WEIGHT;
+            stats.gpuMs += (gpuMs - stats.gpuMs) * AVERAGE_WEIGHT;
+            stats.cpuStartMs += (cpuStartMs - stats.cpuStartMs) * AVERAGE_WEIGHT;
+            stats.gpuStartMs += (gpuStartMs - stats.gpuStartMs) * AVERAGE_WEIGHT;
+        }
+        scopes.push_back(stats);
+    }
+
+    ++resolvedFrames;
+    frame.pending = false;
+    return true;
+}
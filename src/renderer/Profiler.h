@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Hierarchical CPU + GPU profiler for the frame.
+// Every scope records a std::chrono interval and a pair of GL_TIMESTAMP queries. Frames are kept in a ring of
+// FRAME_LATENCY slots and a slot is only read back once the GPU finished it; a frame whose queries still aren't done
+// when its slot comes around again is dropped instead of waited for, so profiling never stalls the pipeline.
+// Timestamps rather than GL_TIME_ELAPSED because elapsed-time queries can't nest (per-light scopes inside the shadow pass).
+class Profiler
+{
+public:
+    static const int FRAME_LATENCY = 3;
+
+    // Timings of one scope, in the order of the last frame read back.
+    struct ScopeStats {
+        std::string path;       // Parent names joined by '/'
+        std::string name;
+        int depth = 0;          // 0 is the whole frame
+        float cpuMs = 0.0f;
+        float gpuMs = 0.0f;
+        float cpuStartMs = 0.0f; // Offset from the start of the frame, for the timeline graph
+        float gpuStartMs = 0.0f;
+    };
+
+    Profiler();
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Takes effect at the next beginFrame().
+    bool enabled = true;
+
+    void beginFrame();
+    void endFrame();
+
+    // Scopes nest; names only need to be unique among siblings.
+    void beginScope(const std::string& name);
+    void endScope();
+
+    // Rolling averages.
+    const std::vector<ScopeStats>& getScopes() const { return scopes; }
+    // Raw timings of the last frame read back; it changes whenever getResolvedFrames() does.
+    const std::vector<ScopeStats>& getLastFrame() const { return lastFrame; }
+    unsigned int getResolvedFrames() const { return resolvedFrames; }
+    unsigned int getDroppedFrames() const { return droppedFrames; }
+
+private:
+    struct Record {
+        std::string path;   // Parent names joined by '/', the key of the rolling averages
+        int depth;
+        GLuint startQuery, endQuery;
+        double cpuStart, cpuEnd;
+    };
+
+    struct Frame {
+        std::vector<Record> records;
+        std::vector<GLuint> queries; // Grows to the largest scope count seen, reused every time the slot comes around
+        size_t usedQueries = 0;
+        bool pending = false;        // Recorded but not read back yet
+    };
+
+    std::array<Frame, FRAME_LATENCY> frames;
+    int currentFrame;
+    bool recording;                  // Between beginFrame/endFrame of an enabled frame
+    std::vector<size_t> openScopes;  // Indices into the current frame's records
+    std::chrono::steady_clock::time_point epoch;
+
+    std::unordered_map<std::string, ScopeStats> averages;
+    std::vector<ScopeStats> scopes;
+    std::vector<ScopeStats> lastFrame;
+    unsigned int resolvedFrames;
+    unsigned int droppedFrames;
+
+    double now() const;
+    GLuint acquireQuery(Frame& frame);
+    // False (and nothing read) if the GPU isn't done with the frame yet.
+    bool resolve(Frame& frame);
+};
+
+// RAII helper: profiles the enclosing block.
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler& profiler, const std::string& name) : profiler(profiler) { profiler.beginScope(name); }
+    ~ProfileScope() { profiler.endScope(); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler& profiler;
+};
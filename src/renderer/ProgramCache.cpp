@@ -0,0 +1,178 @@
+#include "ProgramCache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    const char MAGIC[4] = { 'C', 'S', 'P', 'B' };
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;    // Stage sources + driver strings, see hashSources()
+        uint32_t binaryFormat;
+        uint32_t binaryLength;
+    };
+
+    void fnv1a(uint64_t& hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    }
+
+    void fnv1a(uint64_t& hash, const std::string& text)
+    {
+        fnv1a(hash, text.data(), text.size());
+        fnv1a(hash, "\0", 1); // Keeps "ab" + "c" apart from "a" + "bc"
+    }
+
+    std::string driverString(GLenum name)
+    {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+
+    // The program cache follows the binary, not the working directory (which differs between IDE and shell runs).
+    std::filesystem::path executableDirectory()
+    {
+#ifdef _WIN32
+        char buffer[MAX_PATH];
+        DWORD length = GetModuleFileNameA(nullptr, buffer, MAX_PATH);
+        if (length > 0 && length < MAX_PATH) return std::filesystem::path(std::string(buffer, length)).parent_path();
+#else
+        char buffer[4096];
+        ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer));
+        if (length > 0 && static_cast<size_t>(length) < sizeof(buffer)) return std::filesystem::path(std::string(buffer, length)).parent_path();
+#endif
+        return std::filesystem::current_path();
+    }
+}
+
+bool ProgramCache::isSupported()
+{
+    static const bool supported = [] {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }();
+    return supported;
+}
+
+std::string ProgramCache::getCachePath(const std::string& programKey)
+{
+    uint64_t hash = 14695981039346656037ull;
+    fnv1a(hash, programKey);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.glbin", static_cast<unsigned long long>(hash));
+    return (executableDirectory() / "shader_cache" / name).string();
+}
+
+uint64_t ProgramCache::hashSources(const std::vector<std::string>& sources)
+{
+    uint64_t hash = 14695981039346656037ull;
+    fnv1a(hash, driverString(GL_VENDOR));
+    fnv1a(hash, driverString(GL_RENDERER));
+    fnv1a(hash, driverString(GL_VERSION));
+    for (const auto& source : sources) {
+        fnv1a(hash, source);
+    }
+    return hash;
+}
+
+GLuint ProgramCache::load(const std::string& cachePath, uint64_t sourceHash)
+{
+    if (!isSupported()) return 0;
+
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open()) return 0;
+
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.sourceHash != sourceHash || header.binaryLength == 0) {
+        return 0;
+    }
+
+    std::vector<char> binary(header.binaryLength);
+    if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size()))) return 0;
+
+    // The driver may still refuse a binary it wrote itself (e.g. after an update that kept the version string).
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+bool ProgramCache::store(const std::string& cachePath, uint64_t sourceHash, GLuint program)
+{
+    if (!isSupported()) return false;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return false;
+
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceHash = sourceHash;
+
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) return false;
+    header.binaryFormat = format;
+    header.binaryLength = static_cast<uint32_t>(written);
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+    // Same temporary + rename scheme as the mesh cache, a half-written binary is never picked up.
+    std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write program cache: " << cachePath << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), written);
+        if (!file) {
+            file.close();
+            std::remove(temporaryPath.c_str());
+            std::cerr << "Failed to write program cache: " << cachePath << std::endl;
+            return false;
+        }
+    }
+
+    std::remove(cachePath.c_str());
+    if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        std::cerr << "Failed to write program cache: " << cachePath << std::endl;
+        return false;
+    }
+    return true;
+}
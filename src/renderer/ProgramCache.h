@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Linked program binaries (glGetProgramBinary), stored in "shader_cache/" next to the executable.
+// One file per program, named after its stage paths. The file carries a hash of the preprocessed stage
+// sources plus the driver's vendor/renderer/version strings, so an edited shader, an include change or a
+// driver update is a miss and the program is compiled from source again (and the file rewritten).
+class ProgramCache
+{
+public:
+    // Bump whenever the file layout changes.
+    static const uint32_t VERSION = 1;
+
+    // False when the driver offers no binary format (then nothing is read or written).
+    static bool isSupported();
+
+    // programKey identifies the program (its stage paths), sources are the final stage texts.
+    static std::string getCachePath(const std::string& programKey);
+    static uint64_t hashSources(const std::vector<std::string>& sources);
+
+    // New linked program from the cache, or 0 on a missing, stale or rejected binary.
+    static GLuint load(const std::string& cachePath, uint64_t sourceHash);
+    // program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+    static bool store(const std::string& cachePath, uint64_t sourceHash, GLuint program);
+};
@@ -12,16 +12,21 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <random>
-
-const size_t Renderer::MAX_SHADOW_CASTING_LIGHTS;
-
-Renderer::Renderer(unsigned int width, unsigned int height) 
-    : width(width), height(height), edgeDetectionFlags(static_cast<int>(EdgeDetectionType::DEPTH_BASED)),
-      lightingFBO(0), lightingTexture(0), edgeFBO(0), edgeTexture(0), 
-      quadVAO(0), quadVBO(0)
+#include <algorithm>
+#include <cfloat>
+
+Renderer::Renderer(unsigned int width, unsigned int height, GBufferLayout gBufferLayout) 
+    : width(width), height(height), renderWidth(width), renderHeight(height), renderScale(1.0f), gpuFrameTime(0.0f),
+      shadowFrame(0), renderedShadowProjection(0.0f),
+      uploadedLightRevision(0), shadowDataDirty(true), quadVAO(0), quadVBO(0), indirectBuffer(0), lightTilesValid(false),
+      cameraViewProjection(1.0f), cameraPosition(0.0f), cameraView(1.0f), cameraFov(ZOOM), cameraAspect(1.0f),
+      edgeDetectionFlags(static_cast<int>(EdgeDetectionType::DEPTH_BASED))
 {
     // G-Buffer for deferred shading
-    gBuffer = std::make_unique<GBuffer>();
+    gBuffer = std::make_unique<GBuffer>(gBufferLayout);
+    
+    // Worker threads for the per-frame CPU work (culling), see cullDrawList().
+    jobSystem = std::make_unique<JobSystem>();
     if (!gBuffer->init(width, height)) {
         std::cerr << "Failed to initialize G-Buffer" << std::endl;
     }
@@ -29,18 +34,30 @@ Renderer::Renderer(unsigned int width, unsigned int height)
     // Initialize the LightManager to handle scene lights.
     lightManager = std::make_unique<LightManager>();
     
-    // Initialize framebuffers/textures for intermediate render passes.
-    initializeRenderTargets();
+    // GPU frame time feeding the dynamic resolution controller.
+    gpuFrameTimer = std::make_unique<GpuFrameTimer>();
+    profiler = std::make_unique<Profiler>();
+    
+    // Intermediate render targets are allocated by the frame graph as the passes need them.
+    frameGraph = std::make_unique<FrameGraph>();
     initializeShadowMapping(); // Allocates shadow map textures
     initializeQuad();          // Sets up the fullscreen quad
     
-    // Load scene assets.
+    // Load scene assets. Models stream in on worker threads, see streamAssets().
     initializeLights();
+    // The geometry pass picks the handle per fragment within a multi-draw, which needs NV_gpu_shader5 (see geometry.frag).
+    bindlessTextures = GLAD_GL_ARB_bindless_texture && GLAD_GL_NV_gpu_shader5;
+    textureCache = std::make_unique<TextureCache>(bindlessTextures);
+    assetLoader = std::make_unique<AssetLoader>(*textureCache);
     loadModels();
     initializeShaders();
+    initializeUniformBuffers(); // FrameBlock/LightBlock shared by all programs, material SSBO
     
     // Set up material properties for all loaded models.
     initializeModelMaterials();
+    
+    // Flatten the scene into instanced batches and merge its geometry into one pool.
+    buildScene();
 }
 
 Renderer::~Renderer()
@@ -50,31 +67,169 @@ Renderer::~Renderer()
 
 void Renderer::render(const Camera& camera, float deltaTime)
 {
+    // Pick up edited shaders before anything binds them.
+    if (enableShaderHotReload) reloadShaders();
+
     // Reset frame stats.
     resetStats();
+    gpuFrameTimer->begin();
+    
+    // Internal resolution for this frame, from the GPU time of a few frames ago.
+    updateRenderScale();
+    
+    // Camera and shadow settings for every program in this frame.
+    updateFrameBlock(camera);
     
     // 1. Shadow Update Pass:
     // Check if lights have moved or changed state, and re-allocate shadow maps if necessary.
-    updateShadowMaps();
+    {
+        ProfileScope scope(*profiler, "Shadow update");
+        updateShadowMaps();
+    }
     
     // Update for flickering.
-    updateLights(deltaTime);
-    updateCrazyTorches(deltaTime);
+    {
+        ProfileScope scope(*profiler, "Scene update");
+        streamAssets();
+        updateLights(deltaTime);
+        updateCrazyTorches(deltaTime);
+        updateDynamicInstances();
+    }
+    
+    // The scene is final for this frame: cull for the camera on the workers while the shadow passes are recorded.
+    updateInstanceLods();
+    startCameraCulling();
     
     // 2. Shadow Map Pass - render depth from each light perspective
-    shadowMapPass();
+    {
+        ProfileScope scope(*profiler, "Shadow maps");
+        shadowMapPass();
+    }
+    
+    // Light data + light-space matrices, skipped when nothing changed since the last upload.
+    updateLightBlock();
     
     // 3. Geometry Pass - fill the G-Buffer.
-    geometryPass(camera);
+    {
+        ProfileScope scope(*profiler, "Geometry");
+        updateMaterialBuffer();
+        geometryPass(camera);
+    }
+    
+    // Lighting/edge programs for this frame's settings and materials (compiled the first time a combination shows up).
+    if (selectShaderVariants()) resolveUniforms();
+    
+    // Light culling and 4-6, scheduled by the frame graph.
+    renderScreenPasses();
+    
+    gpuFrameTimer->end();
+
+    updateMemoryReport();
+    enforceMemoryBudget();
+}
+
+// Every pass reading the G-Buffer, as a frame graph: intermediate targets are transient (pooled, shared when
+// their lifetimes allow) and passes nobody reads from are dropped, e.g. edge detection with outlining off.
+void Renderer::renderScreenPasses()
+{
+    FrameGraph& graph = *frameGraph;
+    graph.reset(width, height);
+    
+    FrameGraphHandle gBaseColor = graph.importTexture("gBaseColor", gBuffer->getBaseColorTexture());
+    FrameGraphHandle gNormal = graph.importTexture("gNormal", gBuffer->getNormalTexture());
+    FrameGraphHandle gPosition = graph.importTexture("gPosition", gBuffer->getPositionTexture());
+    FrameGraphHandle gQuantization = graph.importTexture("gQuantization", gBuffer->getQuantizationTexture());
+    FrameGraphHandle gDepth = graph.importTexture("gDepth", gBuffer->getDepthTexture());
+    auto readGBuffer = [&](FrameGraph::Builder& builder) {
+        for (FrameGraphHandle texture : { gBaseColor, gNormal, gPosition, gQuantization, gDepth }) {
+            builder.read(texture);
+        }
+    };
     
-    // 4. Lighting Pass - calculate lighting using G-Buffer.
-    lightingPass(camera);
+    // Light culling - per-tile light lists from the G-Buffer bounds (a storage buffer, so never dropped).
+    graph.addPass("Light culling", [&](FrameGraph::Builder& builder) {
+        builder.read(gNormal);
+        builder.read(gPosition);
+        builder.read(gDepth);
+        builder.setSideEffect();
+    }, [this](const FrameGraph&) {
+        lightCullingPass();
+    });
+    
+    FrameGraphHandle lighting = FrameGraph::INVALID;
+    FrameGraphHandle edges = FrameGraph::INVALID;
+    bool fused = useFusedLighting && fusedLightingShader && fusedLightingShader->isLinked();
+    if (fused) {
+        // 4-6 in a single compute dispatch.
+        graph.addPass("Fused lighting", [&](FrameGraph::Builder& builder) {
+            readGBuffer(builder);
+            lighting = builder.create("Fused output", { GL_RGBA8, GL_LINEAR });
+        }, [&](const FrameGraph& resources) {
+            fusedLightingPass(resources.getTexture(lighting));
+        });
+    } else {
+        // 4. Lighting Pass - calculate lighting using G-Buffer.
+        graph.addPass("Lighting", [&](FrameGraph::Builder& builder) {
+            readGBuffer(builder);
+            lighting = builder.create("Lighting", { GL_RGBA16F, GL_LINEAR });
+        }, [&](const FrameGraph& resources) {
+            lightingPass(resources.getFramebuffer(lighting));
+        });
+        
+        // 5. Edge Detection Pass - generate outlines.
+        graph.addPass("Edge detection", [&](FrameGraph::Builder& builder) {
+            builder.read(gPosition);
+            builder.read(gNormal);
+            builder.read(gDepth);
+            builder.read(lighting);
+            edges = builder.create("Edges", { GL_RGBA8, GL_LINEAR });
+        }, [&](const FrameGraph& resources) {
+            edgeDetectionPass(resources.getFramebuffer(edges), resources.getTexture(lighting));
+        });
+    }
+    
+    // 6. Composite Pass - combine lighting and edges on the screen. The fused output already has its edges mixed in
+    // (or their strength in alpha below full resolution).
+    graph.addPass("Composite", [&](FrameGraph::Builder& builder) {
+        builder.read(lighting);
+        if (!fused && edgeParams.enableOutlining) builder.read(edges);
+        builder.setSideEffect();
+    }, [&](const FrameGraph& resources) {
+        if (fused) {
+            presentFusedOutput(resources.getTexture(lighting), resources.getFramebuffer(lighting));
+        } else {
+            compositePass(resources.getTexture(lighting), resources.getTexture(edges));
+        }
+    });
     
-    // 5. Edge Detection Pass - generate outlines.
-    edgeDetectionPass();
+    graph.compile();
+    graph.execute(*profiler);
+}
+
+// Pick this frame's internal resolution. Targets are never reallocated for it, only the viewports change.
+void Renderer::updateRenderScale()
+{
+    float frameTime = 0.0f;
+    bool measured = gpuFrameTimer->poll(frameTime);
+    if (measured) gpuFrameTime = frameTime;
+    
+    const auto& params = dynamicResolution;
+    if (params.enabled) {
+        DynamicResolutionController::Settings settings;
+        settings.targetFrameRate = params.targetFrameRate;
+        settings.minScale = params.minScale;
+        settings.maxScale = params.maxScale;
+        renderScale = measured ? resolutionController.update(frameTime, settings) : resolutionController.getScale();
+    } else {
+        renderScale = std::clamp(params.fixedScale, 0.25f, 1.0f);
+        // Switching the controller on starts from wherever the manual scale was.
+        resolutionController.reset(renderScale);
+    }
     
-    // 6. Composite Pass - combine lighting and edges.
-    compositePass();
+    renderWidth = std::max(1u, static_cast<unsigned int>(std::lround(width * renderScale)));
+    renderHeight = std::max(1u, static_cast<unsigned int>(std::lround(height * renderScale)));
+    renderWidth = std::min(renderWidth, width);
+    renderHeight = std::min(renderHeight, height);
 }
 
 void Renderer::resize(unsigned int newWidth, unsigned int newHeight)
@@ -85,13 +240,7 @@ void Renderer::resize(unsigned int newWidth, unsigned int newHeight)
     // Resize G-Buffer textures.
     gBuffer->resize(width, height);
     
-    // Reallocate used textures.
-    glBindTexture(GL_TEXTURE_2D, lightingTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    
-    // Edge texture.
-    glBindTexture(GL_TEXTURE_2D, edgeTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    // The frame graph's targets follow on its next reset().
     
     // Update the OpenGL state.
     glViewport(0, 0, width, height);
@@ -100,166 +249,653 @@ void Renderer::resize(unsigned int newWidth, unsigned int newHeight)
 // Compile and link all shader programs.
 void Renderer::initializeShaders()
 {
-    try {
-        // Geometry Pass - transforms vertices and outputs to G-Buffer
-        geometryShader = std::make_unique<Shader>("assets/shaders/geometry.vert", "assets/shaders/geometry.frag");
-        std::cout << "Geometry shader compiled successfully" << std::endl;
-        
-        // Lighting Pass - deferred lighting on full-screen quad
-        hybridCelShader = std::make_unique<Shader>("assets/shaders/quad.vert", "assets/shaders/lighting/hybrid_cel_lighting.frag");
-        std::cout << "Hybrid cel shading shader compiled successfully" << std::endl;
-        
-        // Edge Detection - post-process outline detection
-        edgeDetectionShader = std::make_unique<Shader>("assets/shaders/quad.vert", "assets/shaders/edge_detection.frag");
-        std::cout << "Edge detection shader compiled successfully" << std::endl;
-        
-        // Composite - merge lit scene with edges
-        compositeShader = std::make_unique<Shader>("assets/shaders/quad.vert", "assets/shaders/composite.frag");
+    // Geometry Pass - transforms vertices and outputs to G-Buffer
+    ShaderDefines geometryDefines;
+    if (bindlessTextures) geometryDefines.push_back({ "BINDLESS_TEXTURES", "1" });
+    geometryShader = std::make_unique<Shader>("assets/shaders/geometry.vert", "assets/shaders/geometry.frag", geometryDefines);
+    if (geometryShader->isLinked()) {
+        std::cout << "Geometry shader compiled successfully" << (bindlessTextures ? " (bindless textures)" : "") << std::endl;
+    } else {
+        std::cerr << "Geometry shader failed to build" << std::endl;
+    }
+    
+    // Lighting Pass - deferred lighting on full-screen quad. Variants are compiled on first use.
+    hybridCelVariants = std::make_unique<ShaderVariants>("Hybrid cel shading", [](const ShaderDefines& defines) {
+        return std::make_unique<Shader>("assets/shaders/quad.vert", "assets/shaders/lighting/hybrid_cel_lighting.frag", defines);
+    });
+    
+    // Light culling - compute pass between the geometry and lighting passes
+    lightCullingShader = std::make_unique<Shader>("assets/shaders/lighting/light_culling.comp");
+    if (lightCullingShader->isLinked()) {
+        std::cout << "Light culling shader compiled successfully" << std::endl;
+    } else {
+        std::cerr << "Light culling shader failed to build, lighting walks every light" << std::endl;
+    }
+    
+    // Occlusion culling - compute passes around the geometry pass
+    occlusionCuller = std::make_unique<OcclusionCuller>();
+    
+    // Edge Detection - post-process outline detection
+    edgeDetectionVariants = std::make_unique<ShaderVariants>("Edge detection", [](const ShaderDefines& defines) {
+        return std::make_unique<Shader>("assets/shaders/quad.vert", "assets/shaders/edge_detection.frag", defines);
+    });
+    
+    // Composite - merge lit scene with edges
+    compositeShader = std::make_unique<Shader>("assets/shaders/quad.vert", "assets/shaders/composite.frag");
+    if (compositeShader->isLinked()) {
         std::cout << "Composite shader compiled successfully" << std::endl;
-        
-        // 5. Shadow Shaders
-        // Shadow Mapping uses shaders to render depth from light perspective.
-        try {
-            // Dir/Spot shadow map (depth only)
-            shadowMapShader = std::make_unique<Shader>("assets/shaders/shadow_map.vert", "assets/shaders/shadow_map.frag");
-            std::cout << "Directional/Spot shadow shader compiled successfully" << std::endl;
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to load shadow shaders: " << e.what() << std::endl;
-            shadowMapShader = nullptr;
+    } else {
+        std::cerr << "Composite shader failed to build" << std::endl;
+    }
+    
+    // Lighting + edges + composite fused into one compute pass. Without it the three passes above are used.
+    fusedLightingVariants = std::make_unique<ShaderVariants>("Fused lighting", [](const ShaderDefines& defines) {
+        return std::make_unique<Shader>("assets/shaders/lighting/fused_lighting.comp", defines);
+    });
+    
+    // 5. Shadow Shaders
+    // Shadow Mapping uses shaders to render depth from light perspective.
+    // Dir/Spot shadow map (depth only)
+    shadowMapShader = std::make_unique<Shader>("assets/shaders/shadow_map.vert", "assets/shaders/shadow_map.frag");
+    if (shadowMapShader->isLinked()) {
+        std::cout << "Directional/Spot shadow shader compiled successfully" << std::endl;
+    } else {
+        std::cerr << "Directional/Spot shadow shader failed to build" << std::endl;
+    }
+    
+    // Point light cubemap shadow (uses geometry shader for 6-face render)
+    pointShadowShader = std::make_unique<Shader>("assets/shaders/point_shadow.vert", 
+                                                "assets/shaders/point_shadow.frag",
+                                                "assets/shaders/point_shadow.geom");
+    if (pointShadowShader->isLinked()) {
+        std::cout << "Point light shadow shader compiled successfully" << std::endl;
+    } else {
+        std::cerr << "Point light shadow shader failed to build" << std::endl;
+    }
+
+    // Single-pass point shadows need gl_Layer in the vertex shader, which isn't core in 4.6.
+    if (GLAD_GL_ARB_shader_viewport_layer_array || GLAD_GL_AMD_vertex_shader_layer) {
+        pointShadowLayeredShader = std::make_unique<Shader>("assets/shaders/point_shadow_layered.vert",
+                                                            "assets/shaders/point_shadow.frag");
+        // A driver may still reject gl_Layer in the VS: kept (hot reload), but never selected while unlinked.
+        if (pointShadowLayeredShader->isLinked()) {
+            std::cout << "Layered point light shadow shader compiled successfully" << std::endl;
+        } else {
+            std::cerr << "Layered point light shadow shader failed to build, point shadows use the geometry shader" << std::endl;
         }
-        
-        try {
-            // Point light cubemap shadow (uses geometry shader for 6-face render)
-            pointShadowShader = std::make_unique<Shader>("assets/shaders/point_shadow.vert", 
-                                                        "assets/shaders/point_shadow.frag",
-                                                        "assets/shaders/point_shadow.geom");
-            std::cout << "Point light shadow shader compiled successfully" << std::endl;
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to load point shadow shaders: " << e.what() << std::endl;
-            pointShadowShader = nullptr;
+
+        // Same idea for the directional cascades. Without it each cascade is its own pass.
+        shadowMapLayeredShader = std::make_unique<Shader>("assets/shaders/shadow_map_layered.vert",
+                                                          "assets/shaders/shadow_map.frag");
+        if (shadowMapLayeredShader->isLinked()) {
+            std::cout << "Layered cascade shadow shader compiled successfully" << std::endl;
+        } else {
+            std::cerr << "Layered cascade shadow shader failed to build, cascades are drawn one by one" << std::endl;
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load shaders: " << e.what() << std::endl;
+    } else {
+        std::cout << "Vertex shader layer output not supported, point shadows use the geometry shader" << std::endl;
     }
+
+    selectShaderVariants();
+    resolveUniforms();
 }
 
-// Configure FBOs for intermediate passes.
-void Renderer::initializeRenderTargets()
+// Swaps in any program whose sources changed; the uniform handles of a swapped program are stale afterwards.
+void Renderer::reloadShaders()
 {
-    // Lighting FBO - stores lit scene before edge detection
-    glGenFramebuffers(1, &lightingFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, lightingFBO);
-    
-    glGenTextures(1, &lightingTexture);
-    glBindTexture(GL_TEXTURE_2D, lightingTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lightingTexture, 0);
-    
-    // Edge FBO - stores edge map
-    glGenFramebuffers(1, &edgeFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, edgeFBO);
-    
-    glGenTextures(1, &edgeTexture);
-    glBindTexture(GL_TEXTURE_2D, edgeTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, edgeTexture, 0);
-    
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    bool reloaded = false;
+    for (Shader* shader : { geometryShader.get(), shadowMapShader.get(), shadowMapLayeredShader.get(),
+                            pointShadowShader.get(), pointShadowLayeredShader.get(), lightCullingShader.get(),
+                            compositeShader.get() }) {
+        if (shader && shader->pollReload()) reloaded = true;
+    }
+    if (occlusionCuller) occlusionCuller->pollReload();
+    for (ShaderVariants* variants : { hybridCelVariants.get(), edgeDetectionVariants.get(), fusedLightingVariants.get() }) {
+        if (variants && variants->pollReload()) reloaded = true;
+    }
+    if (reloaded) resolveUniforms();
+}
+
+// Permutation keys. Lighting: bit per IlluminationModel in the scene, then quantization, PCF and the PCF kernel.
+// Edge detection: the EdgeDetectionType flags. The fused pass takes both, edges from bit 16.
+namespace {
+    const uint32_t LIGHTING_MATERIAL_TYPES_MASK = 0x1F;
+    const uint32_t LIGHTING_QUANTIZATION = 1u << 5;
+    const uint32_t LIGHTING_SHADOW_PCF = 1u << 6;
+    const uint32_t LIGHTING_SHADOW_POISSON = 1u << 7;
+    const uint32_t LIGHTING_POISSON_TAPS_SHIFT = 8;  // 2 bits: 8 << n taps
+    const uint32_t EDGE_FILTERS_MASK = 0x1F;
+    const uint32_t FUSED_EDGE_SHIFT = 16;
+}
+
+// Points the lighting/edge passes at the variants that match the current settings and scene, so the
+// shaders carry no branches (or registers) for disabled features. Only the path in use is built.
+// True if a pass changed program; its uniform handles must then be resolved again.
+bool Renderer::selectShaderVariants()
+{
+    uint32_t lightingKey = getSceneMaterialTypes();
+    if (materialParams.enableQuantization) lightingKey |= LIGHTING_QUANTIZATION;
+    if (shadowParams.enablePCF && shadowParams.shadowPCFSamples > 0) {
+        lightingKey |= LIGHTING_SHADOW_PCF;
+        if (shadowParams.shadowFilter == ShadowFilter::POISSON) {
+            uint32_t tapsLog = shadowParams.poissonTaps >= 32 ? 2 : (shadowParams.poissonTaps >= 16 ? 1 : 0);
+            lightingKey |= LIGHTING_SHADOW_POISSON | (tapsLog << LIGHTING_POISSON_TAPS_SHIFT);
+        }
+    }
+    uint32_t edgeKey = static_cast<uint32_t>(edgeDetectionFlags) & EDGE_FILTERS_MASK;
+
+    Shader* previousLighting = hybridCelShader;
+    Shader* previousEdges = edgeDetectionShader;
+    Shader* previousFused = fusedLightingShader;
+
+    if (useFusedLighting && fusedLightingVariants) {
+        ShaderDefines defines = lightingDefines(lightingKey);
+        for (const auto& define : edgeDetectionDefines(edgeKey)) defines.push_back(define);
+        fusedLightingShader = fusedLightingVariants->get(lightingKey | (edgeKey << FUSED_EDGE_SHIFT), defines);
+    }
+    // Also the fallback when the fused variant failed to build (or to link, which doesn't throw).
+    if (!useFusedLighting || !fusedLightingShader || !fusedLightingShader->isLinked()) {
+        if (hybridCelVariants) hybridCelShader = hybridCelVariants->get(lightingKey, lightingDefines(lightingKey));
+        if (edgeDetectionVariants) edgeDetectionShader = edgeDetectionVariants->get(edgeKey, edgeDetectionDefines(edgeKey));
+    }
+
+    return hybridCelShader != previousLighting || edgeDetectionShader != previousEdges ||
+           fusedLightingShader != previousFused;
+}
+
+// Bit per IlluminationModel used by a scene material.
+uint32_t Renderer::getSceneMaterialTypes() const
+{
+    uint32_t types = 0;
+    for (const ModelMaterial* material : sceneMaterials) {
+        types |= 1u << static_cast<uint32_t>(material->model);
+    }
+    return types & LIGHTING_MATERIAL_TYPES_MASK;
+}
+
+ShaderDefines Renderer::lightingDefines(uint32_t key)
+{
+    uint32_t types = key & LIGHTING_MATERIAL_TYPES_MASK;
+    ShaderDefines defines = {
+        { "MATERIAL_TYPES", std::to_string(types) },
+        { "QUANTIZATION", (key & LIGHTING_QUANTIZATION) ? "1" : "0" },
+        { "SHADOW_PCF", (key & LIGHTING_SHADOW_PCF) ? "1" : "0" },
+        { "SHADOW_POISSON", (key & LIGHTING_SHADOW_POISSON) ? "1" : "0" },
+        { "SHADOW_POISSON_TAPS", std::to_string(8u << ((key >> LIGHTING_POISSON_TAPS_SHIFT) & 3u)) },
+    };
+    // Exactly one model: no per-pixel type at all.
+    if (types != 0 && (types & (types - 1)) == 0) {
+        uint32_t type = 0;
+        while ((types >> type) != 1u) ++type;
+        defines.push_back({ "SINGLE_MATERIAL_TYPE", std::to_string(type) });
+    }
+    return defines;
+}
+
+ShaderDefines Renderer::edgeDetectionDefines(uint32_t key)
+{
+    return { { "EDGE_FILTERS", std::to_string(key & EDGE_FILTERS_MASK) } };
+}
+
+// Look up every uniform the per-frame code touches once, and set the ones that never change (sampler units).
+void Renderer::resolveUniforms()
+{
+    if (geometryShader) {
+        geometryModelUniforms.hasTexture = geometryShader->getUniform<bool>("hasTexture");
+
+        // Diffuse texture always lives in TU0.
+        geometryShader->use();
+        geometryShader->setInt("texture_diffuse1", 0);
+        geometryShader->setBool("compactGBuffer", gBuffer->isCompact());
+    }
+
+    if (shadowMapShader) {
+        shadowUniforms.lightSpaceMatrix = shadowMapShader->getUniform<glm::mat4>("lightSpaceMatrix");
+    }
+
+    if (pointShadowShader) {
+        for (size_t i = 0; i < pointShadowUniforms.shadowMatrices.size(); ++i) {
+            pointShadowUniforms.shadowMatrices[i] = pointShadowShader->getUniform<glm::mat4>("shadowMatrices[" + std::to_string(i) + "]");
+        }
+        pointShadowUniforms.lightPos = pointShadowShader->getUniform<glm::vec3>("lightPos");
+        pointShadowUniforms.layerBase = pointShadowShader->getUniform<int>("layerBase");
+    }
+
+    if (shadowMapLayeredShader) {
+        for (size_t i = 0; i < SHADOW_CASCADE_COUNT; ++i) {
+            cascadeShadowUniforms.cascadeMatrices[i] = shadowMapLayeredShader->getUniform<glm::mat4>("cascadeMatrices[" + std::to_string(i) + "]");
+        }
+        cascadeShadowUniforms.layerBase = shadowMapLayeredShader->getUniform<int>("layerBase");
+    }
+    if (pointShadowLayeredShader) {
+        for (size_t i = 0; i < pointShadowLayeredUniforms.shadowMatrices.size(); ++i) {
+            pointShadowLayeredUniforms.shadowMatrices[i] = pointShadowLayeredShader->getUniform<glm::mat4>("shadowMatrices[" + std::to_string(i) + "]");
+        }
+        pointShadowLayeredUniforms.lightPos = pointShadowLayeredShader->getUniform<glm::vec3>("lightPos");
+        pointShadowLayeredUniforms.layerBase = pointShadowLayeredShader->getUniform<int>("layerBase");
+    }
+
+    if (hybridCelShader) {
+        lightingUniforms = resolveLightingUniforms(*hybridCelShader);
+        setLightingSamplers(*hybridCelShader);
+    }
+
+    if (lightCullingShader) {
+        lightCullingShader->use();
+        lightCullingShader->setInt("gNormal", 0);
+        lightCullingShader->setInt("gPosition", 1);
+        lightCullingShader->setInt("gDepth", 2);
+        lightCullingShader->setBool("compactGBuffer", gBuffer->isCompact());
+    }
+
+    if (edgeDetectionShader) {
+        edgeUniforms = resolveEdgeDetectionUniforms(*edgeDetectionShader);
+
+        edgeDetectionShader->use();
+        edgeDetectionShader->setInt("gPosition", 0);
+        edgeDetectionShader->setInt("gNormal", 1);
+        edgeDetectionShader->setInt("gDepth", 2);
+        edgeDetectionShader->setInt("colorTexture", 3);
+        edgeDetectionShader->setBool("compactGBuffer", gBuffer->isCompact());
+    }
+
+    if (compositeShader) {
+        auto& u = compositeUniforms;
+        u.enableOutlining = compositeShader->getUniform<bool>("enableOutlining");
+        u.edgeColor = compositeShader->getUniform<glm::vec3>("edgeColor");
+        u.uvScale = compositeShader->getUniform<glm::vec2>("uvScale");
+        u.uvMax = compositeShader->getUniform<glm::vec2>("uvMax");
+        u.upscaleRatio = compositeShader->getUniform<float>("upscaleRatio");
+        u.sharpenEdges = compositeShader->getUniform<bool>("sharpenEdges");
+
+        compositeShader->use();
+        compositeShader->setInt("lightingTexture", 0);
+        compositeShader->setInt("edgeTexture", 1);
+    }
+
+    if (fusedLightingShader) {
+        auto& u = fusedLightingUniforms;
+        u.lighting = resolveLightingUniforms(*fusedLightingShader);
+        u.edges = resolveEdgeDetectionUniforms(*fusedLightingShader);
+        u.enableOutlining = fusedLightingShader->getUniform<bool>("enableOutlining");
+        u.deferComposite = fusedLightingShader->getUniform<bool>("deferComposite");
+
+        // Same units as the lighting pass, the output image is on image unit 0.
+        setLightingSamplers(*fusedLightingShader);
+    }
+
+    glUseProgram(0);
+}
+
+Renderer::LightingPassUniforms Renderer::resolveLightingUniforms(const Shader& shader)
+{
+    LightingPassUniforms u;
+    u.diffuseQuantizationBands = shader.getUniform<int>("diffuseQuantizationBands");
+    u.specularThreshold1 = shader.getUniform<float>("specularThreshold1");
+    u.specularThreshold2 = shader.getUniform<float>("specularThreshold2");
+    u.globalMaterialType = shader.getUniform<int>("globalMaterialType");
+    u.useLightTiles = shader.getUniform<bool>("useLightTiles");
+    return u;
+}
+
+Renderer::EdgeDetectionPassUniforms Renderer::resolveEdgeDetectionUniforms(const Shader& shader)
+{
+    EdgeDetectionPassUniforms u;
+    u.depthThreshold = shader.getUniform<float>("depthThreshold");
+    u.normalThreshold = shader.getUniform<float>("normalThreshold");
+    u.sobelThreshold = shader.getUniform<float>("sobelThreshold");
+    u.colorThreshold = shader.getUniform<float>("colorThreshold");
+    u.edgeColor = shader.getUniform<glm::vec3>("edgeColor");
+    u.screenSize = shader.getUniform<glm::vec2>("screenSize");
+    u.depthExponent = shader.getUniform<float>("depthExponent");
+    u.normalSplit = shader.getUniform<float>("normalSplit");
+    u.sobelScale = shader.getUniform<float>("sobelScale");
+    u.smoothWidth = shader.getUniform<float>("smoothWidth");
+    u.laplacianThreshold = shader.getUniform<float>("laplacianThreshold");
+    u.laplacianScale = shader.getUniform<float>("laplacianScale");
+    return u;
+}
+
+// G-Buffer in TU0-3, then the shadow atlas and one unit per cube array tier.
+// Giving every sampler its own unit avoids 2D and cube samplers aliasing the same unit.
+void Renderer::setLightingSamplers(Shader& shader)
+{
+    shader.use();
+    shader.setInt("gBaseColor", 0);
+    shader.setInt("gNormal", 1);
+    shader.setInt("gPosition", 2);
+    shader.setInt("gQuantization", 3);
+    shader.setInt("gDepth", GBUFFER_DEPTH_TEXTURE_UNIT);
+    shader.setBool("compactGBuffer", gBuffer->isCompact());
+    shader.setInt("shadowAtlas", SHADOW_ATLAS_TEXTURE_UNIT);
+    for (int tier = 0; tier < ShadowCubeArray::TIER_COUNT; ++tier) {
+        shader.setInt("shadowCubeArrays[" + std::to_string(tier) + "]", SHADOW_CUBE_ARRAY_TEXTURE_UNIT_BASE + tier);
+    }
+    shader.setInt("shadowCascades", SHADOW_CASCADE_TEXTURE_UNIT);
+}
+
+// Allocate the shared uniform buffers. They stay bound to their binding points for the whole run.
+void Renderer::initializeUniformBuffers()
+{
+    frameBlock = std::make_unique<UniformBuffer>(sizeof(FrameBlockData), FRAME_BLOCK_BINDING);
+    lightBlock = std::make_unique<UniformBuffer>(sizeof(LightBlockData), LIGHT_BLOCK_BINDING);
+    lightBlockData = LightBlockData{};
+
+    // lights[]; sized in updateLightBlock() for the current light count.
+    lightBuffer = std::make_unique<ShaderStorageBuffer>(LIGHT_BUFFER_BINDING);
+
+    // Storage buffer for materials[]; sized in updateMaterialBuffer() once the scene registered its materials.
+    materialBuffer = std::make_unique<ShaderStorageBuffer>(MATERIAL_BUFFER_BINDING);
+
+    // Culled instance ids, refilled before every scene draw.
+    visibleInstanceBuffer = std::make_unique<ShaderStorageBuffer>(VISIBLE_INSTANCE_BINDING);
+
+    // Per-tile light masks; sized for the screen in lightCullingPass().
+    lightTileBuffer = std::make_unique<ShaderStorageBuffer>(LIGHT_TILE_BINDING);
+}
+
+// Camera and shadow settings change almost every frame, so this is always one write.
+void Renderer::updateFrameBlock(const Camera& camera)
+{
+    if (!frameBlock) return;
+
+    FrameBlockData data{};
+    data.view = camera.getViewMatrix();
+    data.projection = camera.getProjectionMatrix(static_cast<float>(width) / height);
+    cameraViewProjection = data.projection * data.view;
+    data.inverseViewProjection = glm::inverse(cameraViewProjection);
+    cameraPosition = camera.Position;
+    cameraView = data.view;
+    cameraFov = camera.Zoom;
+    cameraAspect = static_cast<float>(width) / height;
+    data.viewPos = camera.Position;
+    data.shadowBias = shadowParams.shadowBias;
+    data.shadowNormalBias = shadowParams.shadowNormalBias;
+    data.shadowPCFSamples = shadowParams.shadowPCFSamples;
+    data.shadowIntensity = shadowParams.shadowIntensity;
+    data.enablePCF = shadowParams.enablePCF ? 1 : 0;
+    data.shadowFarPlane = shadowParams.farPlane;
+    data.renderWidth = static_cast<int32_t>(renderWidth);
+    data.renderHeight = static_cast<int32_t>(renderHeight);
+
+    frameBlock->update(&data, sizeof(data));
+}
+
+// Repack and upload only the lights the LightManager flagged or whose shadow data changed, in contiguous runs.
+void Renderer::updateLightBlock()
+{
+    if (!lightBlock || !lightBuffer) return;
+
+    uint64_t revision = lightManager->getRevision();
+    if (revision == uploadedLightRevision && !shadowDataDirty) return;
+
+    size_t lightCount = std::min(lightManager->getLightCount(), LIGHT_BUFFER_MAX_LIGHTS);
+    const auto& lightDirty = lightManager->getDirtyFlags();
+
+    // A new count shifts the indices: repack and reallocate everything.
+    bool repackAll = gpuLights.size() != lightCount;
+    if (repackAll) {
+        gpuLights.resize(lightCount);
+        lightBuffer->allocate(static_cast<GLsizeiptr>(std::max<size_t>(lightCount, 1) * sizeof(GPULight)));
+    }
+
+    auto packLight = [&](size_t i) {
+        Light light = lightManager->getLight(i);
+        auto& gpuLight = gpuLights[i];
+        gpuLight.position = light.position;
+        gpuLight.type = static_cast<int32_t>(light.type);
+        gpuLight.direction = light.direction;
+        gpuLight.intensity = light.intensity;
+        gpuLight.color = light.color;
+        gpuLight.constant = light.constant;
+        gpuLight.linear = light.linear;
+        gpuLight.quadratic = light.quadratic;
+        gpuLight.cutOff = light.cutOff;
+        gpuLight.outerCutOff = light.outerCutOff;
+
+        // Lights that didn't get a shadow slot this frame are lit without shadows.
+        ShadowMapData* shadowData = i < shadowMaps.size() ? &shadowMaps[i] : nullptr;
+        bool hasShadow = light.castShadows && shadowData && shadowData->isActive;
+        gpuLight.castShadows = hasShadow ? 1 : 0;
+        gpuLight.shadowTier = hasShadow ? shadowData->slot.tier : 0;
+        gpuLight.shadowLayer = hasShadow ? shadowData->slot.index : 0;
+        // Same cutoff as the lighting shader, so culling never drops a light that would have contributed.
+        gpuLight.range = light.getRange(0.001f);
+        gpuLight.shadowRect = (hasShadow && light.type == LightType::SPOT) ? shadowAtlas->getTileUV(shadowData->slot) : glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+        // Matrix to transform world position to light-space (only meaningful for spot lights).
+        gpuLight.lightSpaceMatrix = shadowData ? shadowData->lightSpaceMatrix : glm::mat4(1.0f);
+
+        // Directional lights: the cascades of their slot.
+        if (hasShadow && light.type == LightType::DIRECTIONAL) {
+            for (size_t c = 0; c < SHADOW_CASCADE_COUNT; ++c) {
+                lightBlockData.cascadeMatrices[shadowData->slot.index * SHADOW_CASCADE_COUNT + c] = shadowData->cascadeMatrices[c];
+            }
+        }
+        if (shadowData) shadowData->gpuDirty = false;
+    };
+
+    auto needsUpload = [&](size_t i) {
+        return repackAll || (i < lightDirty.size() && lightDirty[i] != 0) ||
+               (i < shadowMaps.size() && shadowMaps[i].gpuDirty);
+    };
+
+    for (size_t first = 0; first < lightCount; ++first) {
+        if (!needsUpload(first)) continue;
+
+        size_t end = first;
+        while (end < lightCount && needsUpload(end)) {
+            packLight(end);
+            ++end;
+        }
+        lightBuffer->update(&gpuLights[first], static_cast<GLsizeiptr>((end - first) * sizeof(GPULight)),
+                            static_cast<GLintptr>(first * sizeof(GPULight)));
+        first = end;
+    }
+
+    lightBlockData.numLights = static_cast<int32_t>(lightCount);
+    lightBlockData.cascadeCount = getCascadeCount();
+    lightBlock->update(&lightBlockData, sizeof(lightBlockData));
+
+    lightManager->clearDirtyFlags();
+    uploadedLightRevision = revision;
+    shadowDataDirty = false;
 }
 
-// Pre-allocate shadow map data. GPU resources allocated wheen needed in updateShadowMaps().
+// Allocate the shadow atlas and cube arrays once. They're only recreated when the resolution settings change.
 void Renderer::initializeShadowMapping()
 {
-    shadowMaps.resize(MAX_SHADOW_CASTING_LIGHTS);
+    shadowAtlas = std::make_unique<ShadowAtlas>();
+    shadowCubeArray = std::make_unique<ShadowCubeArray>();
+    shadowCascades = std::make_unique<ShadowCascadeArray>();
+    shadowAtlas->configure(shadowParams.shadowMapSize);
+    shadowCubeArray->configure(shadowParams.cubeShadowMapSize);
+    shadowCascades->configure(shadowParams.cascadeMapSize);
+}
+
+// Asks every owner of GL storage what it allocated. A few dozen getters, cheaper than keeping a registry in sync.
+void Renderer::updateMemoryReport()
+{
+    GpuMemoryReport report;
+    report[GpuMemoryCategory::GBUFFER] = gBuffer->getMemoryBytes();
+    report[GpuMemoryCategory::SHADOW_MAPS] = shadowAtlas->getMemoryBytes() + shadowCubeArray->getMemoryBytes() +
+                                             shadowCascades->getMemoryBytes();
+    report[GpuMemoryCategory::RENDER_TARGETS] = frameGraph->getPoolMemoryBytes() +
+                                                (occlusionCuller ? occlusionCuller->getHiZMemoryBytes() : 0);
+    if (geometryPool) {
+        report.stagedBytes = geometryPool->getStagedBytes();
+        report[GpuMemoryCategory::GEOMETRY] = geometryPool->getMemoryBytes() - report.stagedBytes;
+    }
+    report[GpuMemoryCategory::TEXTURES] = textureCache->getMemoryBytes();
+
+    // The indirect commands (a few KB, resized every pass) aren't counted.
+    size_t buffers = 0;
+    for (const UniformBuffer* buffer : { frameBlock.get(), lightBlock.get() }) {
+        if (buffer) buffers += static_cast<size_t>(buffer->getSize());
+    }
+    for (const ShaderStorageBuffer* buffer : { lightBuffer.get(), materialBuffer.get(), visibleInstanceBuffer.get(), lightTileBuffer.get() }) {
+        if (buffer) buffers += static_cast<size_t>(buffer->getSize());
+    }
+    if (scene) buffers += scene->getBufferMemoryBytes();
+    if (occlusionCuller) buffers += occlusionCuller->getBufferMemoryBytes();
+    report[GpuMemoryCategory::BUFFERS] = buffers;
+
+    report.queryDriver();
+    memoryReport = report;
 }
 
-// Check which lights need shadow maps (they have isCastingShadows = true) and allocate them.
+// Only ever lowers the shadow sizes; raising them again is left to the user. A step waits until the storage
+// reflects the previous one (updateShadowMaps() reallocates at the start of the next frame).
+void Renderer::enforceMemoryBudget()
+{
+    size_t budgetBytes = static_cast<size_t>(std::max(memoryBudget.budgetMB, 0)) * 1024 * 1024;
+    bool over = memoryBudget.enabled && memoryReport.getTotalBytes() > budgetBytes;
+    if (over && !overMemoryBudget) {
+        std::cerr << "Memory budget: " << memoryReport.getTotalBytes() / (1024 * 1024) << " MB tracked, over the "
+                  << memoryBudget.budgetMB << " MB budget" << std::endl;
+    }
+    overMemoryBudget = over;
+    if (!over || !memoryBudget.autoDowngradeShadows) return;
+
+    bool configured = shadowAtlas->getBaseTileSize() == shadowParams.shadowMapSize &&
+                      shadowCubeArray->getBaseFaceSize() == shadowParams.cubeShadowMapSize &&
+                      shadowCascades->getSize() == shadowParams.cascadeMapSize;
+    if (!configured) return;
+
+    // Largest storage first, down to the smallest size the GUI offers for it.
+    struct Candidate {
+        const char* name;
+        int* size;
+        int minSize;
+        size_t bytes;
+    };
+    Candidate candidates[] = {
+        { "Spot shadow map size", &shadowParams.shadowMapSize, 512, shadowAtlas->getMemoryBytes() },
+        { "Point shadow map size", &shadowParams.cubeShadowMapSize, 256, shadowCubeArray->getMemoryBytes() },
+        { "Cascade shadow map size", &shadowParams.cascadeMapSize, 512, shadowCascades->getMemoryBytes() },
+    };
+    Candidate* largest = nullptr;
+    for (auto& candidate : candidates) {
+        if (*candidate.size / 2 < candidate.minSize) continue;
+        if (!largest || candidate.bytes > largest->bytes) largest = &candidate;
+    }
+    if (!largest) return;
+
+    *largest->size /= 2;
+    std::cout << "Memory budget: " << largest->name << " lowered to " << *largest->size << std::endl;
+}
+
+// Rough screen-space importance: how far the light reaches over how far it is from the camera.
+// Directional lights cover the whole view and always come first.
+float Renderer::computeShadowPriority(const Light& light) const
+{
+    if (light.type == LightType::DIRECTIONAL) return FLT_MAX;
+
+    // Distance where the attenuation brings the light under ~1% of its intensity, capped by the shadow range.
+    if (light.intensity <= 0.0f) return 0.0f;
+    float range = std::min(shadowParams.farPlane, light.getRange(0.01f / light.intensity));
+
+    float distance = glm::length(light.position - cameraPosition);
+    return std::max(range, 0.0f) / std::max(distance, 0.1f);
+}
+
+// Hand out shadow slots for this frame. No GPU allocation happens here: lights are ranked by priority and
+// the best ones get the sharpest tiers. A light keeps its slot (and a static light its cached depth) while its
+// tier doesn't change; lights that stop casting, like the sun at night, keep theirs until somebody needs it.
 void Renderer::updateShadowMaps()
 {
-    const auto& lights = lightManager->getLights();
-    size_t lightCount = std::min(lights.size(), MAX_SHADOW_CASTING_LIGHTS);
-    
-    // Manage the shadow map.
-    for (size_t i = 0; i < lightCount; ++i) {
-        const auto& light = lights[i];
+    // Resolution changed in the GUI: new storage, every slot is gone (the generations make the lights re-render).
+    shadowAtlas->configure(shadowParams.shadowMapSize);
+    shadowCubeArray->configure(shadowParams.cubeShadowMapSize);
+    shadowCascades->configure(shadowParams.cascadeMapSize);
+    shadowAtlas->setLinearFiltering(shadowParams.enablePCF);
+    shadowCubeArray->setLinearFiltering(shadowParams.enablePCF);
+    shadowCascades->setLinearFiltering(shadowParams.enablePCF);
+
+    size_t lightCount = std::min(lightManager->getLightCount(), LIGHT_BUFFER_MAX_LIGHTS);
+
+    // Slot owners are light indices, which shift when a light is added or removed.
+    if (shadowMaps.size() != lightCount) {
+        shadowAtlas->getAllocator().releaseAll();
+        shadowCubeArray->getAllocator().releaseAll();
+        shadowCascades->getAllocator().releaseAll();
+        shadowMaps.assign(lightCount, ShadowMapData());
+        for (size_t i = 0; i < lightCount; ++i) {
+            shadowMaps[i].type = lightManager->getType(i);
+        }
+        shadowDataDirty = true;
+    }
+
+    ++shadowFrame;
+
+    // Each light type has its own pool: cascades for directional, atlas tiles for spot, cubes for point lights.
+    auto poolOf = [&](LightType type) -> ShadowSlotAllocator& {
+        if (type == LightType::DIRECTIONAL) return shadowCascades->getAllocator();
+        if (type == LightType::POINT) return shadowCubeArray->getAllocator();
+        return shadowAtlas->getAllocator();
+    };
+
+    std::vector<uint32_t> cascadeCasters;
+    std::vector<uint32_t> atlasCasters;
+    std::vector<uint32_t> cubeCasters;
+    for (uint32_t i = 0; i < lightCount; ++i) {
+        Light light = lightManager->getLight(i);
         auto& shadowData = shadowMaps[i];
-        
-        // Point lights need cubemaps, others use 2D maps
-        int requiredSize = (light.type == LightType::POINT) ? shadowParams.cubeShadowMapSize : shadowParams.shadowMapSize;
 
-        // Reallocate if type or size changed
-        if (!shadowData.isActive || shadowData.type != light.type || shadowData.size != requiredSize || !light.castShadows) {
+        // Type changed: the old slot is in the other pool.
+        if (shadowData.type != light.type) {
+            poolOf(shadowData.type).release(i);
+            shadowData.type = light.type;
+            shadowData.slot = ShadowSlot();
+            shadowData.hasRendered = false;
+        }
+
+        if (!light.castShadows) {
             if (shadowData.isActive) {
-                cleanupShadowMap(shadowData);
-            }
-            
-            if (!light.castShadows) {
-                continue;
-            }
-            glGenFramebuffers(1, &shadowData.FBO);
-            
-            if (light.type == LightType::POINT) {
-                // Cubemap for point lights (6 faces)
-                glGenTextures(1, &shadowData.depthCubemap);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, shadowData.depthCubemap);
-                
-                for (unsigned int i = 0; i < 6; ++i) {
-                    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT,
-                                requiredSize, requiredSize, 0, 
-                                GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-                }
-                
-                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-                
-                // Attach depth cubemap to the FBO.
-                glBindFramebuffer(GL_FRAMEBUFFER, shadowData.FBO);
-                glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowData.depthCubemap, 0);
-                glDrawBuffer(GL_NONE); // No color buffer needed (depth only)
-                glReadBuffer(GL_NONE);
-                
-            } else {
-                // 2D depth texture for directional/spot lights
-                glGenTextures(1, &shadowData.depthMap);
-                glBindTexture(GL_TEXTURE_2D, shadowData.depthMap);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 
-                            requiredSize, requiredSize, 0, 
-                            GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                // Clamp to border with white (max depth = no shadow outside map)
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-                float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f }; // White border = max depth (no shadow outside map)
-                glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-                
-                glBindFramebuffer(GL_FRAMEBUFFER, shadowData.FBO);
-                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadowData.depthMap, 0);
-                glDrawBuffer(GL_NONE);
-                glReadBuffer(GL_NONE);
+                shadowData.isActive = false;
+                markShadowDataDirty(shadowData);
             }
-            
-            shadowData.type = light.type;
-            shadowData.size = requiredSize;
-            shadowData.isActive = true;
-            
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            continue;
         }
+
+        shadowData.priority = computeShadowPriority(light);
+        if (light.type == LightType::DIRECTIONAL) cascadeCasters.push_back(i);
+        else if (light.type == LightType::POINT) cubeCasters.push_back(i);
+        else atlasCasters.push_back(i);
     }
-    
-    // Remove unused shadow maps for performance.
-    for (size_t i = lightCount; i < shadowMaps.size(); ++i) {
-        if (shadowMaps[i].isActive) {
-            cleanupShadowMap(shadowMaps[i]);
+
+    auto assignSlots = [&](std::vector<uint32_t>& casters, ShadowSlotAllocator& allocator) {
+        std::stable_sort(casters.begin(), casters.end(), [&](uint32_t a, uint32_t b) {
+            return shadowMaps[a].priority > shadowMaps[b].priority;
+        });
+
+        // The rank picks the tier: the first slots of tier 0 go to the most important lights, and so on.
+        int tier = 0;
+        int tierEnd = allocator.getSlotCount(0);
+        for (size_t rank = 0; rank < casters.size(); ++rank) {
+            while (static_cast<int>(rank) >= tierEnd && tier + 1 < allocator.getTierCount()) {
+                ++tier;
+                tierEnd += allocator.getSlotCount(tier);
+            }
+
+            uint32_t lightIndex = casters[rank];
+            auto& shadowData = shadowMaps[lightIndex];
+            ShadowSlot slot = allocator.acquire(lightIndex, tier, shadowFrame);
+
+            if (slot != shadowData.slot) {
+                shadowData.slot = slot;
+                shadowData.hasRendered = false;
+                markShadowDataDirty(shadowData);
+            }
+            if (slot.isValid() != shadowData.isActive) {
+                shadowData.isActive = slot.isValid();
+                markShadowDataDirty(shadowData);
+            }
         }
-    }
+    };
+    assignSlots(cascadeCasters, shadowCascades->getAllocator());
+    assignSlots(atlasCasters, shadowAtlas->getAllocator());
+    assignSlots(cubeCasters, shadowCubeArray->getAllocator());
 }
 
 // Execute the shadow render pass for all active lights.
@@ -267,32 +903,87 @@ void Renderer::shadowMapPass()
 {
     if (!shadowMapShader || !pointShadowShader) return;
     
-    const auto& lights = lightManager->getLights();
-    size_t lightCount = std::min(lights.size(), MAX_SHADOW_CASTING_LIGHTS);
+    size_t lightCount = std::min(lightManager->getLightCount(), shadowMaps.size());
+    
+    // A new projection invalidates every cached map.
+    glm::vec3 projection(shadowParams.orthoSize, shadowParams.nearPlane, shadowParams.farPlane);
+    if (projection != renderedShadowProjection) {
+        for (auto& shadowData : shadowMaps) {
+            shadowData.hasRendered = false;
+        }
+        renderedShadowProjection = projection;
+    }
     
-    for (size_t i = 0; i < lightCount; ++i) {
-        const auto& light = lights[i];
+    // Maps without valid content are always drawn, otherwise the light would sample someone else's depth.
+    // Maps that merely went out of date share the per-frame budget, least recently updated first (round-robin).
+    pendingShadowUpdates.clear();
+    for (uint32_t i = 0; i < lightCount; ++i) {
         auto& shadowData = shadowMaps[i];
-        
         if (!shadowData.isActive) continue;
         
-        // Skip static lights that have already been rendered
-        if (light.isStatic && shadowData.hasRendered) {
-             continue;
+        Light light = lightManager->getLight(i);
+        if (!shadowData.hasRendered) {
+            renderShadowMapForLight(i, light, shadowData);
+        } else if (isShadowMapOutdated(i, light, shadowData)) {
+            pendingShadowUpdates.push_back(i);
         }
-
-        renderShadowMapForLight(i, light, shadowData);
-        
-        shadowData.hasRendered = true;
     }
     
+    std::stable_sort(pendingShadowUpdates.begin(), pendingShadowUpdates.end(), [&](uint32_t a, uint32_t b) {
+        return shadowMaps[a].lastUpdateFrame < shadowMaps[b].lastUpdateFrame;
+    });
+    
+    size_t budget = pendingShadowUpdates.size();
+    if (shadowParams.maxShadowUpdatesPerFrame > 0) {
+        budget = std::min(budget, static_cast<size_t>(shadowParams.maxShadowUpdatesPerFrame));
+    }
+    for (size_t i = 0; i < budget; ++i) {
+        uint32_t lightIndex = pendingShadowUpdates[i];
+        renderShadowMapForLight(lightIndex, lightManager->getLight(lightIndex), shadowMaps[lightIndex]);
+    }
+    stats.shadowMapsDeferred = static_cast<unsigned int>(pendingShadowUpdates.size() - budget);
+    
     // Reset viewport to match the screen size for the next pass.
     glViewport(0, 0, width, height);
 }
 
+bool Renderer::isShadowMapOutdated(size_t lightIndex, const Light& light, const ShadowMapData& shadowData) const
+{
+    if (!shadowData.hasRendered) return true;
+    
+    // Static lights ignore scene changes: their maps are only redrawn when the light itself is edited.
+    if (!light.isStatic && scene && scene->getRevision() != shadowData.renderedSceneRevision) return true;
+    
+    // Untouched transform (flicker and color edits don't count): the light side is exactly what was drawn.
+    bool transformChanged = lightManager->getTransformRevision(lightIndex) != shadowData.renderedTransformRevision;
+    
+    if (transformChanged && light.type != LightType::DIRECTIONAL &&
+        glm::length(light.position - shadowData.renderedPosition) > shadowParams.positionTolerance) {
+        return true;
+    }
+    
+    if (transformChanged && light.type != LightType::POINT) {
+        float cosAngle = glm::dot(glm::normalize(light.direction), shadowData.renderedDirection);
+        if (cosAngle < std::cos(shadowParams.directionTolerance)) return true;
+    }
+    
+    if (light.type == LightType::SPOT) return transformChanged && light.cutOff != shadowData.renderedCutOff;
+    
+    // Cascades follow the camera. Refit with the direction the map was drawn with, so only camera movement counts here.
+    if (light.type == LightType::DIRECTIONAL) {
+        std::array<glm::mat4, SHADOW_CASCADE_COUNT> cascadeMatrices;
+        computeShadowCascades(shadowData.renderedDirection, cascadeMatrices);
+        return cascadeMatrices != shadowData.cascadeMatrices;
+    }
+    
+    return false;
+}
+
 // Dispatcher for specific shadow render functions.
 void Renderer::renderShadowMapForLight(size_t lightIndex, const Light& light, ShadowMapData& shadowData)
 {
+    ProfileScope scope(*profiler, "Light " + std::to_string(lightIndex));
+    
     switch (light.type) {
         case LightType::DIRECTIONAL:
             renderDirectionalShadow(light, shadowData);
@@ -304,41 +995,119 @@ void Renderer::renderShadowMapForLight(size_t lightIndex, const Light& light, Sh
             renderSpotShadow(light, shadowData);
             break;
     }
+    
+    // Remember what this map shows, see isShadowMapOutdated().
+    shadowData.hasRendered = true;
+    shadowData.renderedPosition = light.position;
+    shadowData.renderedDirection = light.type != LightType::POINT ? glm::normalize(light.direction) : glm::vec3(0.0f);
+    shadowData.renderedCutOff = light.cutOff;
+    shadowData.renderedSceneRevision = scene ? scene->getRevision() : 0;
+    shadowData.renderedTransformRevision = lightManager->getTransformRevision(lightIndex);
+    shadowData.lastUpdateFrame = shadowFrame;
+    stats.shadowMapUpdates++;
 }
 
-// Render shadow map for sun/moon.
+// Render the cascades of the sun/moon.
 void Renderer::renderDirectionalShadow(const Light& light, ShadowMapData& shadowData)
 {
-    glViewport(0, 0, shadowParams.shadowMapSize, shadowParams.shadowMapSize);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowData.FBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    computeShadowCascades(glm::normalize(light.direction), shadowData.cascadeMatrices);
+    markShadowDataDirty(shadowData);
     
-    shadowMapShader->use();
-    
-    // Orthographic projection for parallel light rays
-    glm::mat4 lightProjection = glm::ortho(-shadowParams.orthoSize, shadowParams.orthoSize, 
-                                           -shadowParams.orthoSize, shadowParams.orthoSize, 
-                                           shadowParams.nearPlane, shadowParams.farPlane);
+    int cascadeCount = getCascadeCount();
+    std::array<Frustum, SHADOW_CASCADE_COUNT> cascadeFrusta;
+    for (int c = 0; c < cascadeCount; ++c) {
+        cascadeFrusta[c] = Frustum(shadowData.cascadeMatrices[c]);
+    }
     
-    glm::vec3 lightDir = glm::normalize(light.direction);
-    // Position the virtual light camera
-    glm::vec3 lightPos = -lightDir * (shadowParams.farPlane * 0.5f); 
-    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    // Only this light's layers of the cascade array are cleared and drawn to.
+    shadowCascades->bindCascades(shadowData.slot, cascadeCount);
     
-    // Handle gimbal lock to avoid artifacts
-    if (abs(glm::dot(lightDir, up)) > 0.99f) {
-        up = glm::vec3(1.0f, 0.0f, 0.0f);
+    if (shadowMapLayeredShader && shadowMapLayeredShader->isLinked()) {
+        // One pass: every instance is listed once per cascade it touches, the VS routes it with gl_Layer.
+        shadowMapLayeredShader->use();
+        for (size_t c = 0; c < SHADOW_CASCADE_COUNT; ++c) {
+            cascadeShadowUniforms.cascadeMatrices[c].set(shadowData.cascadeMatrices[c]);
+        }
+        cascadeShadowUniforms.layerBase.set(shadowData.slot.index * static_cast<int>(SHADOW_CASCADE_COUNT));
+        renderScene(shadowMapLayeredShader.get(), cascadeFrusta.data(), cascadeCount);
+    } else {
+        shadowMapShader->use();
+        for (int c = 0; c < cascadeCount; ++c) {
+            shadowCascades->bindLayer(shadowData.slot, c);
+            shadowUniforms.lightSpaceMatrix.set(shadowData.cascadeMatrices[c]);
+            renderScene(shadowMapShader.get(), cascadeFrusta[c]);
+        }
     }
     
-    glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f), up);
-    shadowData.lightSpaceMatrix = lightProjection * lightView;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+int Renderer::getCascadeCount() const
+{
+    return glm::clamp(shadowParams.cascadeCount, 1, static_cast<int>(SHADOW_CASCADE_COUNT));
+}
+
+// Practical split scheme (blend of uniform and logarithmic splits) over [camera near, cascadeDistance].
+// Each cascade is fitted with a bounding sphere, so its size doesn't change when the camera turns, and its origin
+// is snapped to whole texels, so the shadows don't shimmer when the camera moves.
+void Renderer::computeShadowCascades(const glm::vec3& lightDir, std::array<glm::mat4, SHADOW_CASCADE_COUNT>& matrices) const
+{
+    int cascadeCount = getCascadeCount();
+    float nearPlane = NEAR_PLANE;
+    float farPlane = glm::clamp(shadowParams.cascadeDistance, nearPlane + 1.0f, FAR_PLANE);
+    float mapSize = static_cast<float>(shadowCascades->getSize());
     
-    shadowMapShader->setMat4("lightSpaceMatrix", shadowData.lightSpaceMatrix);
+    glm::mat4 inverseView = glm::inverse(cameraView);
+    float tanHalfFovY = std::tan(glm::radians(cameraFov) * 0.5f);
+    float tanHalfFovX = tanHalfFovY * cameraAspect;
     
-    // Render scene depth from light's view
-    renderScene(shadowMapShader.get());
+    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    if (abs(glm::dot(lightDir, up)) > 0.99f) {
+        up = glm::vec3(1.0f, 0.0f, 0.0f);
+    }
     
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    float splitNear = nearPlane;
+    for (int c = 0; c < cascadeCount; ++c) {
+        float t = static_cast<float>(c + 1) / cascadeCount;
+        float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+        float splitFar = glm::mix(uniformSplit, logSplit, shadowParams.cascadeSplitLambda);
+        
+        // Corners of this slice of the view frustum, in world space.
+        std::array<glm::vec3, 8> corners;
+        glm::vec3 center(0.0f);
+        for (int i = 0; i < 8; ++i) {
+            float depth = (i & 4) ? splitFar : splitNear;
+            glm::vec3 viewCorner((i & 1 ? 1.0f : -1.0f) * tanHalfFovX * depth,
+                                 (i & 2 ? 1.0f : -1.0f) * tanHalfFovY * depth,
+                                 -depth);
+            corners[i] = glm::vec3(inverseView * glm::vec4(viewCorner, 1.0f));
+            center += corners[i] / 8.0f;
+        }
+        float radius = 0.0f;
+        for (const auto& corner : corners) {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+        
+        // Pull the light camera back by the shadow range so casters outside the slice still land in the map.
+        float casterDistance = shadowParams.farPlane;
+        glm::mat4 lightView = glm::lookAt(center - lightDir * (radius + casterDistance), center, up);
+        glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + casterDistance);
+        
+        // Move the projection so the world origin falls exactly on a texel.
+        glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        glm::vec2 texelOrigin = glm::vec2(origin) * (mapSize * 0.5f);
+        glm::vec2 offset = (glm::round(texelOrigin) - texelOrigin) * (2.0f / mapSize);
+        lightProjection[3][0] += offset.x;
+        lightProjection[3][1] += offset.y;
+        
+        matrices[c] = lightProjection * lightView;
+        splitNear = splitFar;
+    }
+    for (size_t c = cascadeCount; c < matrices.size(); ++c) {
+        matrices[c] = matrices[cascadeCount - 1];
+    }
 }
 
 // Render 6 faces of a cubemap for point lights.
@@ -346,11 +1115,13 @@ void Renderer::renderPointShadow(const Light& light, ShadowMapData& shadowData)
 {
     if (!pointShadowShader) return;
     
-    glViewport(0, 0, shadowParams.cubeShadowMapSize, shadowParams.cubeShadowMapSize);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowData.FBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    // Clears only this light's 6 faces in the cube array of its tier.
+    shadowCubeArray->bindCube(shadowData.slot);
     
-    pointShadowShader->use();
+    bool layered = shadowParams.layeredPointShadows && supportsLayeredPointShadows();
+    Shader* shader = layered ? pointShadowLayeredShader.get() : pointShadowShader.get();
+    const PointShadowPassUniforms& uniforms = layered ? pointShadowLayeredUniforms : pointShadowUniforms;
+    shader->use();
     
     // FOV has to be 90 degrees for cubemaps or we will see artifacts.
     float aspect = 1.0f;
@@ -372,14 +1143,25 @@ void Renderer::renderPointShadow(const Light& light, ShadowMapData& shadowData)
     shadowData.shadowTransforms[5] = shadowProj * glm::lookAt(light.position, 
         light.position + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
     
-    // Upload to the Geometry Shader (which replicates the geometry to 6 faces).
+    // Upload to the Geometry Shader (which replicates the geometry to 6 faces), or to the layered VS.
     for (unsigned int i = 0; i < 6; ++i) {
-        pointShadowShader->setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowData.shadowTransforms[i]);
+        uniforms.shadowMatrices[i].set(shadowData.shadowTransforms[i]);
     }
-    pointShadowShader->setVec3("lightPos", light.position);
-    pointShadowShader->setFloat("farPlane", shadowParams.farPlane);
+    uniforms.lightPos.set(light.position);
+    uniforms.layerBase.set(shadowData.slot.index * 6);
     
-    renderScene(pointShadowShader.get());
+    if (layered) {
+        // One frustum per face: an instance is only drawn into the faces it can actually touch.
+        std::array<Frustum, 6> faceFrusta;
+        for (size_t i = 0; i < faceFrusta.size(); ++i) {
+            faceFrusta[i] = Frustum(shadowData.shadowTransforms[i]);
+        }
+        renderScene(shader, faceFrusta.data(), faceFrusta.size());
+    } else {
+        // The geometry shader writes all faces, so cull against the whole range: anything within farPlane of the light.
+        glm::vec3 range(shadowParams.farPlane);
+        renderScene(shader, Frustum::fromBox(light.position - range, light.position + range));
+    }
     
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
@@ -387,9 +1169,7 @@ void Renderer::renderPointShadow(const Light& light, ShadowMapData& shadowData)
 // Render shadowed scene from spotlight's perspective
 void Renderer::renderSpotShadow(const Light& light, ShadowMapData& shadowData)
 {
-    glViewport(0, 0, shadowParams.shadowMapSize, shadowParams.shadowMapSize);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowData.FBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    shadowAtlas->bindTile(shadowData.slot);
     
     shadowMapShader->use();
     
@@ -408,352 +1188,641 @@ void Renderer::renderSpotShadow(const Light& light, ShadowMapData& shadowData)
     glm::mat4 lightView = glm::lookAt(light.position, lightTarget, up);
     shadowData.lightSpaceMatrix = lightProjection * lightView;
     
-    shadowMapShader->setMat4("lightSpaceMatrix", shadowData.lightSpaceMatrix);
+    shadowUniforms.lightSpaceMatrix.set(shadowData.lightSpaceMatrix);
+    markShadowDataDirty(shadowData);
     
-    renderScene(shadowMapShader.get());
+    renderScene(shadowMapShader.get(), Frustum(shadowData.lightSpaceMatrix));
     
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-// Static scene setup that draws all objects. Used by shadow pass and geometry pass.
-void Renderer::renderScene(Shader* shader, const glm::mat4& viewProjection)
+// Flatten the static scene into instances. Called once after loading and again when crazy mode toggles
+// (it hides the wall torches). The placement is authored here only; every pass draws the same list.
+void Renderer::buildScene()
 {
+    if (!scene) {
+        scene = std::make_unique<Scene>();
+        geometryPool = std::make_unique<GeometryPool>();
+        glGenBuffers(1, &indirectBuffer);
+    }
+    scene->clear();
+
     // 5x5 floor grid centered at 0,0
     const int gridSize = 5;
     const float tileSpacing = 4.0f;
     const float startX = -(gridSize - 1) * tileSpacing * 0.5f;
     const float startZ = -(gridSize - 1) * tileSpacing * 0.5f;
-    
+
+    // First floor stone tiles
     for (int x = 0; x < gridSize; ++x) {
         for (int z = 0; z < gridSize; ++z) {
             glm::mat4 tileMatrix = glm::mat4(1.0f);
             tileMatrix = glm::translate(tileMatrix, glm::vec3(
                 startX + x * tileSpacing,
-                -1.0f, // Floor height
+                -1.0f,
                 startZ + z * tileSpacing
             ));
-            renderModel(floorTileModel, tileMatrix, shader);
+            addToScene(floorTileModel, floorMaterial, tileMatrix);
         }
     }
 
-    // Walls and corners at +/- 10.0
+    // Dirt Floor (Grass/Dirt)
+    for (float x = -22.0f; x < 22.0f; x += 4.0f) {
+        for (float z = -22.0f; z < 22.0f; z += 4.0f) {
+            // Skip existing stone floor area (from -10 to 10)
+            if (x >= -10.0f && x < 10.0f && z >= -10.0f && z < 10.0f) continue;
+
+            int seed = (int)(x * 31.0f + z * 17.0f);
+            int choice = std::abs(seed) % 100;
+
+            glm::mat4 model;
+            if (choice < 40) {
+                 // Large Dirt
+                 model = glm::mat4(1.0f);
+                 model = glm::translate(model, glm::vec3(x + 2.0f, -1.0f, z + 2.0f));
+                 addToScene(floorDirtLargeModel, dirtMaterial, model);
+            } else if (choice < 70) {
+                 // Large Rocky
+                 model = glm::mat4(1.0f);
+                 model = glm::translate(model, glm::vec3(x + 2.0f, -1.0f, z + 2.0f));
+                 addToScene(floorDirtLargeRockyModel, dirtMaterial, model);
+            } else {
+                 // 4 Small tiles
+                 for (float sx = 0.0f; sx < 4.0f; sx += 2.0f) {
+                     for (float sz = 0.0f; sz < 4.0f; sz += 2.0f) {
+                         int subSeed = (int)((x + sx) * 53.0f + (z + sz) * 29.0f);
+                         int tileType = std::abs(subSeed) % 5;
+
+                         model = glm::mat4(1.0f);
+                         model = glm::translate(model, glm::vec3(x + sx + 1.0f, -1.0f, z + sz + 1.0f));
+
+                         if (tileType == 0) addToScene(floorDirtSmallAModel, dirtMaterial, model);
+                         else if (tileType == 1) addToScene(floorDirtSmallBModel, dirtMaterial, model);
+                         else if (tileType == 2) addToScene(floorDirtSmallCModel, dirtMaterial, model);
+                         else if (tileType == 3) addToScene(floorDirtSmallDModel, dirtMaterial, model);
+                         else addToScene(floorDirtSmallWeedsModel, dirtMaterial, model);
+                     }
+                 }
+            }
+        }
+    }
+
+    // Walls
     float wallY = -1.0f;
-    float wallOffset = 10.0f; 
-    float cornerOffset = 10.0f; 
-    
-    // -10, -10
+    float wallOffset = 10.0f;
+    float cornerOffset = 10.0f;
+
+    // Place Corners
     glm::mat4 m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-cornerOffset, wallY, -cornerOffset));
     m = glm::rotate(m, glm::radians(90.0f), glm::vec3(0,1,0));
-    renderModel(cornerModel, m, shader);
-    
-    // 10, -10
+    addToScene(cornerModel, wallMaterial, m);
+
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(cornerOffset, wallY, -cornerOffset));
-    renderModel(cornerModel, m, shader);
-    
-    // -10, 10
+    addToScene(cornerModel, wallMaterial, m);
+
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-cornerOffset, wallY, cornerOffset));
     m = glm::rotate(m, glm::radians(180.0f), glm::vec3(0,1,0));
-    renderModel(cornerModel, m, shader);
-    
-    // 10, 10
+    addToScene(cornerModel, wallMaterial, m);
+
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(cornerOffset, wallY, cornerOffset));
     m = glm::rotate(m, glm::radians(-90.0f), glm::vec3(0,1,0));
-    renderModel(cornerModel, m, shader);
-    
-    // Position of center of walls between corners (4 per side)
+    addToScene(cornerModel, wallMaterial, m);
+
+    // Place Walls
     float xPositions[] = { -6.0f, -2.0f, 2.0f, 6.0f };
-    
-    // -Z Wall
+
     for (int i = 0; i < 4; ++i) {
         glm::vec3 pos(xPositions[i], wallY, -wallOffset);
         glm::mat4 m = glm::mat4(1.0f);
         m = glm::translate(m, pos);
-        
-        // Door, Window, or Wall
+
         if (i == 2) {
-             renderModel(doorwayModel, m, shader);
+             addToScene(doorwayModel, wallMaterial, m);
         } else if (i == 1) {
-             renderModel(windowOpenModel, m, shader);
+             addToScene(windowOpenModel, wallMaterial, m);
         } else {
-             renderModel(wallModel, m, shader);
+             addToScene(wallModel, wallMaterial, m);
         }
-        
-        // Add a torch to the first wall segment
+
         if (i == 0) {
             if (!isCrazyMode) {
                 glm::mat4 t = glm::mat4(1.0f);
                 t = glm::translate(t, pos + glm::vec3(0.0f, 2.3f, 0.4f)); 
-                renderModel(torchModel, t, shader);
+                addToScene(torchModel, torchMaterial, t);
             }
         }
     }
-    
-    // +Z Wall rotated 180 degrees
+
     for (int i = 0; i < 4; ++i) {
         glm::vec3 pos(xPositions[i], wallY, wallOffset);
         glm::mat4 m = glm::mat4(1.0f);
         m = glm::translate(m, pos);
         m = glm::rotate(m, glm::radians(180.0f), glm::vec3(0,1,0));
-        
+
         if (i == 0) {
-            renderModel(windowClosedModel, m, shader);
+            addToScene(windowClosedModel, wallMaterial, m);
         } else if (i == 2) {
-            renderModel(windowOpenModel, m, shader);
+            addToScene(windowOpenModel, wallMaterial, m);
         } else {
-            renderModel(wallModel, m, shader);
+            addToScene(wallModel, wallMaterial, m);
         }
     }
-    
-    // -X Wall rotated 90 degrees
+
     for (int i = 0; i < 4; ++i) {
         glm::vec3 pos(-wallOffset, wallY, xPositions[i]);
         glm::mat4 m = glm::mat4(1.0f);
         m = glm::translate(m, pos);
         m = glm::rotate(m, glm::radians(90.0f), glm::vec3(0,1,0));
-        
+
         if (i == 1) {
-            renderModel(windowOpenModel, m, shader);
+            addToScene(windowOpenModel, wallMaterial, m);
         } else {
-            renderModel(wallModel, m, shader);
+            addToScene(wallModel, wallMaterial, m);
         }
-        
+
         if (i == 0) {
-            glm::mat4 t = m;
-            t = glm::translate(t, glm::vec3(0.0f, 2.3f, 0.4f)); 
-            if (!isCrazyMode) renderModel(torchModel, t, shader);
+            if (!isCrazyMode) {
+                glm::mat4 t = m;
+                t = glm::translate(t, glm::vec3(0.0f, 2.3f, 0.4f)); 
+                addToScene(torchModel, torchMaterial, t);
+            }
         }
     }
-    
-    // +X Wall rotated -90 degrees
+
     for (int i = 0; i < 4; ++i) {
         glm::vec3 pos(wallOffset, wallY, xPositions[i]);
         glm::mat4 m = glm::mat4(1.0f);
         m = glm::translate(m, pos);
         m = glm::rotate(m, glm::radians(-90.0f), glm::vec3(0,1,0));
-        
+
         if (i == 2) {
-            renderModel(windowClosedModel, m, shader);
+            addToScene(windowClosedModel, wallMaterial, m);
         } else {
-            renderModel(wallModel, m, shader);
+            addToScene(wallModel, wallMaterial, m);
         }
-        
+
         if (i == 3) {
              glm::mat4 t = m;
-             t = glm::translate(t, glm::vec3(0.0f, 2.3f, 0.4f));
-             if (!isCrazyMode) renderModel(torchModel, t, shader);
+             t = glm::translate(t, glm::vec3(0.0f, 2.6f, 0.4f));
+             addToScene(torchModel, torchMaterial, t);
         }
     }
-    
+
     // Second Floor
-    float floor2Y = wallY + 4.0f; // Because wall models are exactly 4 units tall
+    float floor2Y = wallY + 4.0f; // First floor wall height
 
-    // 1. Ceiling
-    // Skip the corner tiles (X=4, Z=4) to create a space for the stairs.
+    // 1. Ceiling of first floor and wood floor of second floor
     for (int x = 0; x < gridSize; ++x) {
         for (int z = 0; z < gridSize; ++z) {
+            // Stair opening
             if (x == 4 && (z == 4 || z == 3)) continue;
+
             glm::mat4 tileMatrix = glm::mat4(1.0f);
             tileMatrix = glm::translate(tileMatrix, glm::vec3(
                 startX + x * tileSpacing,
                 floor2Y, 
                 startZ + z * tileSpacing
             ));
-            renderModel(ceilingModel, tileMatrix, shader);
+            addToScene(ceilingModel, ceilingMaterial, tileMatrix);
         }
     }
 
-    // 2. Wood Floor
-    // Placed on top of the ceiling tiles (y + 0.1) to avoid z-fighting.
     for (int x = 0; x < gridSize; ++x) {
         for (int z = 0; z < gridSize; ++z) {
             if (x == 4 && (z == 4 || z == 3)) continue;
+
             glm::mat4 tileMatrix = glm::mat4(1.0f);
             tileMatrix = glm::translate(tileMatrix, glm::vec3(
                 startX + x * tileSpacing,
                 floor2Y + 0.1f, 
                 startZ + z * tileSpacing
             ));
-            renderModel(woodFloorModel, tileMatrix, shader);
+            addToScene(woodFloorModel, woodFloorMaterial, tileMatrix);
         }
     }
-    
-    // 3. Stairs
+
+    // 2. Stairs
     glm::mat4 stairMatrix = glm::mat4(1.0f);
     glm::vec3 stairPos(8.0f, -1.0f, 10.0f);
     glm::vec3 stairAxis(0.0f, 1.0f, 0.0f);
     stairMatrix = glm::translate(stairMatrix, stairPos);
     stairMatrix = glm::rotate(stairMatrix, glm::radians(180.0f), stairAxis); 
-    renderModel(stairModel, stairMatrix, shader);
-    
-    // 4. Second Floor Room
+    addToScene(stairModel, stairMaterial, stairMatrix);
+
+    // 3. Second Floor Walls
+    float f2WallY = floor2Y;
+
     for(int i=0; i<2; ++i) {
         glm::mat4 m = glm::mat4(1.0f);
         float xPos = 2.0f + (float)i * 4.0f;
-        glm::vec3 pos(xPos, floor2Y, 2.0f);
+        glm::vec3 pos(xPos, f2WallY, 2.0f);
         m = glm::translate(m, pos);
-        renderModel(wallModel, m, shader);
+        addToScene(wallModel, wallMaterial, m);
     }
-    
+
     for(int i=0; i<2; ++i) {
         glm::mat4 m = glm::mat4(1.0f);
         float xPos = 2.0f + (float)i * 4.0f;
-        glm::vec3 pos(xPos, floor2Y, 10.0f);
+        glm::vec3 pos(xPos, f2WallY, 10.0f);
         glm::vec3 axis(0.0f, 1.0f, 0.0f);
         m = glm::translate(m, pos);
         m = glm::rotate(m, glm::radians(180.0f), axis);
-        renderModel(wallModel, m, shader);
-        
+        addToScene(wallModel, wallMaterial, m);
+
         if (i == 1) {
             glm::mat4 t = m;
-            t = glm::translate(t, glm::vec3(0.0f, 2.3f, 0.4f)); 
-            renderModel(torchModel, t, shader);
+            t = glm::translate(t, glm::vec3(0.0f, 2.3f, 0.4f));
+            addToScene(torchModel, torchMaterial, t);
         }
     }
-    
+
     {
         glm::mat4 m = glm::mat4(1.0f);
-        glm::vec3 pos(-2.0f, floor2Y, 6.0f);
+        glm::vec3 pos(-2.0f, f2WallY, 6.0f);
         glm::vec3 axis(0.0f, 1.0f, 0.0f);
         m = glm::translate(m, pos);
         m = glm::rotate(m, glm::radians(90.0f), axis);
-        renderModel(wallModel, m, shader);
+        addToScene(wallModel, wallMaterial, m);
     }
-    
+
     {
         glm::mat4 m = glm::mat4(1.0f);
-        glm::vec3 pos(10.0f, floor2Y, 6.0f);
+        glm::vec3 pos(10.0f, f2WallY, 6.0f);
         glm::vec3 axis(0.0f, 1.0f, 0.0f);
         m = glm::translate(m, pos);
         m = glm::rotate(m, glm::radians(-90.0f), axis);
-        renderModel(windowOpenModel, m, shader);
+        addToScene(windowOpenModel, wallMaterial, m);
     }
-    
-    // 5. Corners for Second Floor
-    glm::mat4 m2 = glm::mat4(1.0f);
+
+    // 4. Ceiling for Second Floor Room
+    float ceilingHeight = f2WallY + 4.0f; // Top of second floor
+
+    for (int x = 2; x <= 4; ++x) {
+        for (int z = 3; z <= 4; ++z) {
+             glm::mat4 tileMatrix = glm::mat4(1.0f);
+             tileMatrix = glm::translate(tileMatrix, glm::vec3(
+                 startX + x * tileSpacing,
+                 ceilingHeight, 
+                 startZ + z * tileSpacing
+             ));
+             addToScene(ceilingModel, ceilingMaterial, tileMatrix);
+        }
+    }
+
+    // 5. Torches on Second Floor
+    {
+         glm::mat4 t = glm::mat4(1.0f);
+         t = glm::translate(t, glm::vec3(-9.6f, 1.3f, 6.0f)); 
+         if (!isCrazyMode) addToScene(torchModel, torchMaterial, t);
+    }
+
+    {
+         glm::vec3 pos(-2.0f, f2WallY, 6.0f);
+         glm::mat4 m = glm::mat4(1.0f); 
+         m = glm::translate(m, pos);
+         m = glm::rotate(m, glm::radians(90.0f), glm::vec3(0,1,0));
+
+         glm::mat4 t = m;
+         t = glm::translate(t, glm::vec3(0.0f, 2.3f, 0.4f));
+         addToScene(torchModel, torchMaterial, t);
+    }
+
+    // 6. Corners for Second Floor
+    m = glm::mat4(1.0f);
     {
-        glm::vec3 pos(-2.0f, floor2Y, 2.0f);
+        glm::vec3 pos(-2.0f, f2WallY, 2.0f);
         glm::vec3 axis(0.0f, 1.0f, 0.0f);
-        m2 = glm::translate(m2, pos);
-        m2 = glm::rotate(m2, glm::radians(90.0f), axis);
-        renderModel(cornerModel, m2, shader);
+        m = glm::translate(m, pos);
+        m = glm::rotate(m, glm::radians(90.0f), axis);
+        addToScene(cornerModel, wallMaterial, m);
     }
-    
-    m2 = glm::mat4(1.0f);
+
+    m = glm::mat4(1.0f);
     {
-        glm::vec3 pos(10.0f, floor2Y, 2.0f);
-        m2 = glm::translate(m2, pos);
-        renderModel(cornerModel, m2, shader);
+        glm::vec3 pos(10.0f, f2WallY, 2.0f);
+        m = glm::translate(m, pos);
+        addToScene(cornerModel, wallMaterial, m);
     }
-    
-    m2 = glm::mat4(1.0f);
+
+    m = glm::mat4(1.0f);
     {
-        glm::vec3 pos(-2.0f, floor2Y, 10.0f);
+        glm::vec3 pos(-2.0f, f2WallY, 10.0f);
         glm::vec3 axis(0.0f, 1.0f, 0.0f);
-        m2 = glm::translate(m2, pos);
-        m2 = glm::rotate(m2, glm::radians(180.0f), axis);
-        renderModel(cornerModel, m2, shader);
+        m = glm::translate(m, pos);
+        m = glm::rotate(m, glm::radians(180.0f), axis);
+        addToScene(cornerModel, wallMaterial, m);
     }
-    
-    m2 = glm::mat4(1.0f);
+
+    m = glm::mat4(1.0f);
     {
-        glm::vec3 pos(10.0f, floor2Y, 10.0f);
+        glm::vec3 pos(10.0f, f2WallY, 10.0f);
         glm::vec3 axis(0.0f, 1.0f, 0.0f);
-        m2 = glm::translate(m2, pos);
-        m2 = glm::rotate(m2, glm::radians(-90.0f), axis);
-        renderModel(cornerModel, m2, shader);
+        m = glm::translate(m, pos);
+        m = glm::rotate(m, glm::radians(-90.0f), axis);
+        addToScene(cornerModel, wallMaterial, m);
     }
-    
-    float ceilingHeight = floor2Y + 4.0f;
-    for (int x = 2; x <= 4; ++x) {
-        for (int z = 3; z <= 4; ++z) {
-            glm::mat4 tileMatrix = glm::mat4(1.0f);
-            tileMatrix = glm::translate(tileMatrix, glm::vec3(
-                startX + x * tileSpacing,
-                ceilingHeight, 
-                startZ + z * tileSpacing
-            ));
-            renderModel(ceilingModel, tileMatrix, shader);
+
+    buildDecorations();
+
+    scene->build();
+    geometryPool->upload();
+    updateDynamicInstances();
+
+    std::cout << "Scene built: " << scene->getStaticInstanceCount() << " instances in "
+              << scene->getBatches().size() << " batches, " << geometryPool->getVertexCount() << " pooled vertices" << std::endl;
+}
+
+// Registers the model/material pair (first use assigns the id) and adds one static instance.
+void Renderer::addToScene(const std::unique_ptr<Model>& model, const ModelMaterial& material, const glm::mat4& transform)
+{
+    if (!model || !scene) return;
+    scene->addInstance(getSceneModelId(model.get()), getSceneMaterialId(&material), transform);
+}
+
+uint32_t Renderer::getSceneModelId(Model* model)
+{
+    for (uint32_t i = 0; i < sceneModels.size(); ++i) {
+        if (sceneModels[i] == model) return i;
+    }
+    sceneModels.push_back(model);
+    // Models still loading get their geometry and bounds in streamAssets().
+    if (!model->isLoaded()) return static_cast<uint32_t>(sceneModels.size() - 1);
+    if (geometryPool) model->addToPool(*geometryPool);
+    if (scene) scene->setModelBounds(static_cast<uint32_t>(sceneModels.size() - 1), model->getBoundingBox(), model->getBoundingSphere());
+    return static_cast<uint32_t>(sceneModels.size() - 1);
+}
+
+uint32_t Renderer::getSceneMaterialId(const ModelMaterial* material)
+{
+    for (uint32_t i = 0; i < sceneMaterials.size(); ++i) {
+        if (sceneMaterials[i] == material) return i;
+    }
+    sceneMaterials.push_back(material);
+    materialDirty.push_back(true);
+    return static_cast<uint32_t>(sceneMaterials.size() - 1);
+}
+
+// Objects that move every frame: the crazy mode torches follow their lights.
+void Renderer::updateDynamicInstances()
+{
+    if (!scene) return;
+
+    dynamicSceneInstances.clear();
+    if (isCrazyMode && torchModel) {
+        uint32_t modelId = getSceneModelId(torchModel.get());
+        uint32_t materialId = getSceneMaterialId(&torchMaterial);
+
+        for (uint32_t lightIndex : crazyTorchParams.lightIndex) {
+            // Find the light to get current pos
+            if (lightIndex < lightManager->getLightCount()) {
+                glm::mat4 t = glm::mat4(1.0f);
+                // Center the model on the light.
+                t = glm::translate(t, lightManager->getPosition(lightIndex));
+                t = glm::translate(t, glm::vec3(0.0f, -1.9f, 0.0f));
+                dynamicSceneInstances.push_back({ modelId, materialId, t });
+            }
         }
     }
-    
-    // 7. Extra Torches beacuse the scene was too dark
-    {
-            glm::mat4 t = glm::mat4(1.0f);
-            t = glm::translate(t, glm::vec3(-9.6f, 1.3f, 6.0f)); 
-            if (!isCrazyMode) renderModel(torchModel, t, shader);
+
+    if (dynamicSceneInstances.empty() && scene->getDynamicInstanceCount() == 0) return;
+    scene->setDynamicInstances(dynamicSceneInstances);
+}
+
+// Camera LOD of every instance; cullDrawList() only reads the result, so the camera and shadow lists never race on it.
+void Renderer::updateInstanceLods()
+{
+    size_t instanceCount = scene ? scene->getStaticInstanceCount() + scene->getDynamicInstanceCount() : 0;
+    instanceLods.resize(instanceCount, 0);
+    if (!lodParams.enabled) {
+        std::fill(instanceLods.begin(), instanceLods.end(), 0);
+        return;
     }
-    {
-            glm::vec3 pos(-2.0f, floor2Y, 6.0f);
-            glm::mat4 m = glm::mat4(1.0f); 
-            m = glm::translate(m, pos);
-            m = glm::rotate(m, glm::radians(90.0f), glm::vec3(0,1,0));
+    
+    // Diameter over screen height: 2r / (2d tan(fov/2)).
+    float sizeScale = 1.0f / std::tan(glm::radians(cameraFov) * 0.5f);
+    float screenSize = lodParams.screenSize;
+    float hysteresis = lodParams.hysteresis;
+    jobSystem->parallelFor(instanceCount, 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const InstanceBounds& bounds = scene->getInstanceBounds(static_cast<uint32_t>(i));
+            float distance = glm::length(bounds.sphere.center - cameraPosition);
+            if (!bounds.box.isValid() || distance <= bounds.sphere.radius) {
+                instanceLods[i] = 0;
+                continue;
+            }
             
-            glm::mat4 t = m;
-            t = glm::translate(t, glm::vec3(0.0f, 2.3f, 0.4f));
-            if (!isCrazyMode) renderModel(torchModel, t, shader);
-            renderModel(torchModel, t, shader); 
+            float size = bounds.sphere.radius * sizeScale / distance;
+            int current = instanceLods[i];
+            int lod = 0;
+            float threshold = screenSize;
+            for (int k = 1; k < MeshBuilder::MAX_LODS; ++k, threshold *= 0.5f) {
+                // Boundaries the instance is already past move away from it.
+                float limit = threshold * (current >= k ? 1.0f + hysteresis : 1.0f - hysteresis);
+                if (size >= limit) break;
+                lod = k;
+            }
+            instanceLods[i] = static_cast<uint8_t>(lod);
+        }
+    });
+}
+
+// Culls every scene instance against the frustum and turns the survivors into indirect commands
+// (one per mesh per batch). Visible ids are compacted per batch, so a command still covers a contiguous run.
+// Geometry commands are grouped by diffuse texture, since that's the only state left that changes between draws
+// (a single group with bindless textures, the shader then reads the handle from the model buffer).
+// With several layer frusta every batch gets one run per layer, the layer packed into the visible ids.
+// The (batch, layer) pairs are culled in parallel, then laid out in order, so the result doesn't depend on the
+// thread count. Only reads the scene: safe on a worker as long as nothing edits the scene meanwhile.
+void Renderer::cullDrawList(const Frustum* layerFrusta, size_t layerCount, bool groupByTexture, int lodBias, DrawList& list) const
+{
+    list.visibleInstanceIds.clear();
+    list.indirectCommands.clear();
+    list.drawGroups.clear();
+    list.culled = 0;
+    list.groupByTexture = groupByTexture;
+    if (!scene || layerCount == 0) return;
+
+    // Depth-only passes ignore materials and textures, so they take the coarser per-model batches.
+    const std::vector<SceneBatch>& staticBatches = groupByTexture ? scene->getBatches() : scene->getDepthBatches();
+    const std::vector<SceneBatch>& dynamicBatches = groupByTexture ? scene->getDynamicBatches() : scene->getDynamicDepthBatches();
+    size_t batchCount = staticBatches.size() + dynamicBatches.size();
+    auto batchAt = [&](size_t index) -> const SceneBatch& {
+        return index < staticBatches.size() ? staticBatches[index] : dynamicBatches[index - staticBatches.size()];
+    };
+
+    // Survivors of every item are split by level of detail, each level being a run of its own.
+    const size_t lodCount = MeshBuilder::MAX_LODS;
+    size_t itemCount = batchCount * layerCount;
+    if (list.itemVisible.size() < itemCount * lodCount) list.itemVisible.resize(itemCount * lodCount);
+
+    std::atomic<unsigned int> culled(0);
+    jobSystem->parallelFor(itemCount, 16, [&](size_t begin, size_t end) {
+        unsigned int culledHere = 0;
+        for (size_t item = begin; item < end; ++item) {
+            const SceneBatch& batch = batchAt(item / layerCount);
+            size_t layer = item % layerCount;
+            const Frustum& frustum = layerFrusta[layer];
+            bool cull = enableFrustumCulling && frustum.isEnabled();
+            uint32_t layerBits = static_cast<uint32_t>(layer) << VISIBLE_INSTANCE_LAYER_SHIFT;
+
+            std::vector<uint32_t>* visible = &list.itemVisible[item * lodCount];
+            for (size_t lod = 0; lod < lodCount; ++lod) visible[lod].clear();
+            for (uint32_t i = 0; i < batch.instanceCount; ++i) {
+                uint32_t instanceIndex = batch.firstInstance + i;
+                if (cull) {
+                    const InstanceBounds& bounds = scene->getInstanceBounds(instanceIndex);
+                    // Cheap sphere test first, the box only for what's left (invalid boxes always pass).
+                    if (bounds.box.isValid() && (!frustum.intersects(bounds.sphere) || !frustum.intersects(bounds.box))) {
+                        culledHere++;
+                        continue;
+                    }
+                }
+                int lod = instanceIndex < instanceLods.size() ? instanceLods[instanceIndex] + lodBias : 0;
+                visible[std::min(std::max(lod, 0), static_cast<int>(lodCount) - 1)].push_back(instanceIndex | layerBits);
+            }
+        }
+        culled += culledHere;
+    });
+    list.culled = culled;
+
+    // Collect per group first, then lay the groups out back to back.
+    for (auto& commands : list.groupCommands) commands.clear();
+    for (size_t run = 0; run < itemCount * lodCount; ++run) {
+        const std::vector<uint32_t>& visible = list.itemVisible[run];
+        if (visible.empty()) continue;
+        size_t item = run / lodCount;
+        int lod = static_cast<int>(run % lodCount);
+
+        GLuint firstVisible = static_cast<GLuint>(list.visibleInstanceIds.size());
+        GLuint visibleCount = static_cast<GLuint>(visible.size());
+        list.visibleInstanceIds.insert(list.visibleInstanceIds.end(), visible.begin(), visible.end());
+
+        const Model* model = sceneModels[batchAt(item / layerCount).modelId];
+        GLuint texture = (groupByTexture && !bindlessTextures && model->hasTexture()) ? model->getDiffuseTexture() : 0;
+
+        size_t group = 0;
+        while (group < list.drawGroups.size() && list.drawGroups[group].texture != texture) ++group;
+        if (group == list.drawGroups.size()) {
+            IndirectDrawGroup newGroup;
+            newGroup.texture = texture;
+            list.drawGroups.push_back(newGroup);
+            if (list.groupCommands.size() < list.drawGroups.size()) list.groupCommands.emplace_back();
+        }
+
+        model->appendDrawCommands(list.groupCommands[group], visibleCount, firstVisible, lod);
+        list.drawGroups[group].vertexCount += static_cast<unsigned int>(model->getVertexCount() * visibleCount);
+        list.drawGroups[group].triangleCount += static_cast<unsigned int>(model->getTriangleCount(lod) * visibleCount);
     }
 
-    // Terrain outside building (procedural-ish)
-    for (float x = -22.0f; x < 22.0f; x += 4.0f) {
-        for (float z = -22.0f; z < 22.0f; z += 4.0f) {
-            // Skip existing stone floor area (from -10 to 10)
-            if (x >= -10.0f && x < 10.0f && z >= -10.0f && z < 10.0f) continue;
+    for (size_t i = 0; i < list.drawGroups.size(); ++i) {
+        const auto& commands = list.groupCommands[i];
+        list.drawGroups[i].firstCommand = static_cast<GLuint>(list.indirectCommands.size());
+        list.drawGroups[i].commandCount = static_cast<GLsizei>(commands.size());
+        list.indirectCommands.insert(list.indirectCommands.end(), commands.begin(), commands.end());
+    }
+}
 
-            int seed = (int)(x * 31.0f + z * 17.0f); // random values that I hardcoded
-            int choice = std::abs(seed) % 100;
+// Camera culling only needs this frame's camera and scene, both final once the scene update is done:
+// the workers build the geometry pass's list while this thread records the shadow passes.
+void Renderer::startCameraCulling()
+{
+    Frustum frustum(cameraViewProjection);
+    jobSystem->run(cameraCullJobs, [this, frustum]() {
+        cullDrawList(&frustum, 1, true, 0, cameraDrawList);
+    });
+}
 
-            glm::mat4 model;
-            if (choice < 40) {
-                 model = glm::mat4(1.0f);
-                 model = glm::translate(model, glm::vec3(x + 2.0f, -1.0f, z + 2.0f));
-                 renderModel(floorDirtLargeModel, model, shader);
-            } else if (choice < 70) {
-                 model = glm::mat4(1.0f);
-                 model = glm::translate(model, glm::vec3(x + 2.0f, -1.0f, z + 2.0f));
-                 renderModel(floorDirtLargeRockyModel, model, shader);
-            } else {
-                 // 4 Small tiles per grid cell
-                 for (float sx = 0.0f; sx < 4.0f; sx += 2.0f) {
-                     for (float sz = 0.0f; sz < 4.0f; sz += 2.0f) {
-                         int subSeed = (int)((x + sx) * 53.0f + (z + sz) * 29.0f);
-                         int tileType = std::abs(subSeed) % 5;
-                         
-                         glm::mat4 subModel = glm::mat4(1.0f);
-                         subModel = glm::translate(subModel, glm::vec3(x + sx + 1.0f, -1.0f, z + sz + 1.0f));
-                         
-                         if (tileType == 0) renderModel(floorDirtSmallAModel, subModel, shader);
-                         else if (tileType == 1) renderModel(floorDirtSmallBModel, subModel, shader);
-                         else if (tileType == 2) renderModel(floorDirtSmallCModel, subModel, shader);
-                         else if (tileType == 3) renderModel(floorDirtSmallDModel, subModel, shader);
-                         else renderModel(floorDirtSmallWeedsModel, subModel, shader);
-                     }
-                 }
+// Draws the visible part of the flattened scene from the geometry pool. Used by shadow pass and geometry pass.
+void Renderer::renderScene(Shader* shader, const Frustum* layerFrusta, size_t layerCount)
+{
+    if (!scene || !shader || !geometryPool || layerCount == 0) return;
+
+    bool geometry = shader == geometryShader.get();
+    cullDrawList(layerFrusta, layerCount, geometry, geometry ? 0 : lodParams.shadowBias, shadowDrawList);
+    submitDrawList(shadowDrawList);
+}
+
+void Renderer::addDrawListStats(const DrawList& list)
+{
+    unsigned int visible = static_cast<unsigned int>(list.visibleInstanceIds.size());
+    if (list.groupByTexture) {
+        stats.visibleInstances += visible;
+        stats.culledInstances += list.culled;
+    } else {
+        stats.shadowVisibleInstances += visible;
+        stats.shadowCulledInstances += list.culled;
+    }
+    // Upper bounds with occlusion culling, which decides on the GPU.
+    for (const auto& group : list.drawGroups) {
+        stats.vertexCount += group.vertexCount;
+        stats.triangleCount += group.triangleCount;
+    }
+}
+
+// Uploads a culled draw list and issues it, with the currently bound program.
+void Renderer::submitDrawList(const DrawList& list)
+{
+    addDrawListStats(list);
+    if (list.indirectCommands.empty() || !geometryPool) return;
+
+    // Models first registered by updateDynamicInstances() still need their geometry on the GPU.
+    geometryPool->upload();
+
+    // A few KB at most; a fresh allocation per pass (orphaning) avoids waiting on the previous pass's draws.
+    visibleInstanceBuffer->allocate(static_cast<GLsizeiptr>(list.visibleInstanceIds.size() * sizeof(uint32_t)), list.visibleInstanceIds.data());
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, list.indirectCommands.size() * sizeof(DrawElementsIndirectCommand),
+                 list.indirectCommands.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    issueDrawList(list, 0);
+}
+
+// Draws an uploaded list. commandOffset selects a copy of its commands further into the indirect buffer.
+// Indirect path: one glMultiDrawElementsIndirect per texture group (geometry) or a single one (depth).
+// Fallback path: the same commands issued one by one as instanced draws.
+void Renderer::issueDrawList(const DrawList& list, GLuint commandOffset)
+{
+    if (useIndirectDraws) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    }
+    geometryPool->bind();
+
+    for (const auto& group : list.drawGroups) {
+        if (list.groupByTexture && !bindlessTextures) {
+            // texture_diffuse1 is bound to TU0 at init.
+            geometryModelUniforms.hasTexture.set(group.texture != 0);
+            if (group.texture != 0) {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, group.texture);
             }
         }
-    }
-    
-    renderDecorations(shader);
 
-    // Render Crazy Torches
-    if (isCrazyMode) {
-        for (const auto& params : crazyTorchParams) {
-             // Find the light to get current pos
-             if (params.lightIndex < lightManager->getLights().size()) {
-                 const auto& light = lightManager->getLights()[params.lightIndex];
-                 
-                 glm::mat4 t = glm::mat4(1.0f);
-                 // Center the model on the light.
-                 t = glm::translate(t, light.position);
-                 t = glm::translate(t, glm::vec3(0.0f, -1.9f, 0.0f));
-                 renderModel(torchModel, t, shader);
-             }
+        if (useIndirectDraws) {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GeometryPool::INDEX_TYPE,
+                                        (void*)(sizeof(DrawElementsIndirectCommand) * (commandOffset + group.firstCommand)),
+                                        group.commandCount, 0);
+            stats.drawCalls++;
+        } else {
+            for (GLsizei i = 0; i < group.commandCount; ++i) {
+                const auto& command = list.indirectCommands[group.firstCommand + i];
+                glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, static_cast<GLsizei>(command.count), GeometryPool::INDEX_TYPE,
+                                                              (void*)(GeometryPool::INDEX_SIZE * command.firstIndex),
+                                                              static_cast<GLsizei>(command.instanceCount), command.baseVertex, command.baseInstance);
+            }
+            stats.drawCalls += static_cast<unsigned int>(group.commandCount);
         }
     }
+
+    if (useIndirectDraws) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    geometryPool->unbind();
 }
 
 // Helpers for fullscreen post-processing.
@@ -773,506 +1842,111 @@ void Renderer::initializeQuad()
     glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-}
-
-// Geometry Pass - fill G-Buffer with position, normals, albedo, depth
-void Renderer::geometryPass(const Camera& camera)
-{
-    gBuffer->bind();
-    glViewport(0, 0, width, height);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    if (geometryShader) {
-        geometryShader->use();
-        
-        glm::mat4 projection = camera.getProjectionMatrix(static_cast<float>(width) / height);
-        glm::mat4 view = camera.getViewMatrix();
-        
-        geometryShader->setMat4("projection", projection);
-        geometryShader->setMat4("view", view);
-        
-        // Basically the same as renderScene() but with materials
-        const int gridSize = 5;
-        const float tileSpacing = 4.0f;
-        const float startX = -(gridSize - 1) * tileSpacing * 0.5f;
-        const float startZ = -(gridSize - 1) * tileSpacing * 0.5f;
-        
-        // Render floor tiles with floor material
-        setModelMaterial(floorMaterial);
-        
-        for (int x = 0; x < gridSize; ++x) {
-            for (int z = 0; z < gridSize; ++z) {
-                glm::mat4 tileMatrix = glm::mat4(1.0f);
-                tileMatrix = glm::translate(tileMatrix, glm::vec3(
-                    startX + x * tileSpacing,
-                    -1.0f,
-                    startZ + z * tileSpacing
-                ));
-                renderModel(floorTileModel, tileMatrix, geometryShader.get());
-            }
-        }
-
-        // Render Dirt Floor (Grass/Dirt)
-        setModelMaterial(dirtMaterial);
-        for (float x = -22.0f; x < 22.0f; x += 4.0f) {
-            for (float z = -22.0f; z < 22.0f; z += 4.0f) {
-                // Skip existing stone floor area (from -10 to 10)
-                if (x >= -10.0f && x < 10.0f && z >= -10.0f && z < 10.0f) continue;
-
-                int seed = (int)(x * 31.0f + z * 17.0f);
-                int choice = std::abs(seed) % 100;
-
-                glm::mat4 model;
-                if (choice < 40) {
-                     // Large Dirt
-                     model = glm::mat4(1.0f);
-                     model = glm::translate(model, glm::vec3(x + 2.0f, -1.0f, z + 2.0f));
-                     renderModel(floorDirtLargeModel, model, geometryShader.get());
-                } else if (choice < 70) {
-                     // Large Rocky
-                     model = glm::mat4(1.0f);
-                     model = glm::translate(model, glm::vec3(x + 2.0f, -1.0f, z + 2.0f));
-                     renderModel(floorDirtLargeRockyModel, model, geometryShader.get());
-                } else {
-                     // 4 Small tiles
-                     for (float sx = 0.0f; sx < 4.0f; sx += 2.0f) {
-                         for (float sz = 0.0f; sz < 4.0f; sz += 2.0f) {
-                             int subSeed = (int)((x + sx) * 53.0f + (z + sz) * 29.0f);
-                             int tileType = std::abs(subSeed) % 5;
-                             
-                             model = glm::mat4(1.0f);
-                             model = glm::translate(model, glm::vec3(x + sx + 1.0f, -1.0f, z + sz + 1.0f));
-                             
-                             if (tileType == 0) renderModel(floorDirtSmallAModel, model, geometryShader.get());
-                             else if (tileType == 1) renderModel(floorDirtSmallBModel, model, geometryShader.get());
-                             else if (tileType == 2) renderModel(floorDirtSmallCModel, model, geometryShader.get());
-                             else if (tileType == 3) renderModel(floorDirtSmallDModel, model, geometryShader.get());
-                             else renderModel(floorDirtSmallWeedsModel, model, geometryShader.get());
-                         }
-                     }
-                }
-            }
-        }
-        
-        
-        // Render Walls
-        float wallY = -1.0f;
-        float wallOffset = 10.0f;
-        float cornerOffset = 10.0f;
-        
-        // Place Corners
-        setModelMaterial(wallMaterial);
-        glm::mat4 m = glm::mat4(1.0f);
-        m = glm::translate(m, glm::vec3(-cornerOffset, wallY, -cornerOffset));
-        m = glm::rotate(m, glm::radians(90.0f), glm::vec3(0,1,0));
-        renderModel(cornerModel, m, geometryShader.get());
-        
-        m = glm::mat4(1.0f);
-        m = glm::translate(m, glm::vec3(cornerOffset, wallY, -cornerOffset));
-        renderModel(cornerModel, m, geometryShader.get());
-        
-        m = glm::mat4(1.0f);
-        m = glm::translate(m, glm::vec3(-cornerOffset, wallY, cornerOffset));
-        m = glm::rotate(m, glm::radians(180.0f), glm::vec3(0,1,0));
-        renderModel(cornerModel, m, geometryShader.get());
-        
-        m = glm::mat4(1.0f);
-        m = glm::translate(m, glm::vec3(cornerOffset, wallY, cornerOffset));
-        m = glm::rotate(m, glm::radians(-90.0f), glm::vec3(0,1,0));
-        renderModel(cornerModel, m, geometryShader.get());
-        
-        // Place Walls
-        float xPositions[] = { -6.0f, -2.0f, 2.0f, 6.0f };
-        
-        for (int i = 0; i < 4; ++i) {
-            glm::vec3 pos(xPositions[i], wallY, -wallOffset);
-            glm::mat4 m = glm::mat4(1.0f);
-            m = glm::translate(m, pos);
-            
-            if (i == 2) {
-                 setModelMaterial(wallMaterial); 
-                 renderModel(doorwayModel, m, geometryShader.get());
-            } else if (i == 1) {
-                 setModelMaterial(wallMaterial); 
-                 renderModel(windowOpenModel, m, geometryShader.get());
-            } else {
-                 setModelMaterial(wallMaterial);
-                 renderModel(wallModel, m, geometryShader.get());
-            }
-            
-            if (i == 0) {
-                if (!isCrazyMode) {
-                    setModelMaterial(torchMaterial);
-                    glm::mat4 t = glm::mat4(1.0f);
-                    t = glm::translate(t, pos + glm::vec3(0.0f, 2.3f, 0.4f)); 
-                    renderModel(torchModel, t, geometryShader.get());
-                }
-            }
-        }
-        
-        for (int i = 0; i < 4; ++i) {
-            glm::vec3 pos(xPositions[i], wallY, wallOffset);
-            glm::mat4 m = glm::mat4(1.0f);
-            m = glm::translate(m, pos);
-            m = glm::rotate(m, glm::radians(180.0f), glm::vec3(0,1,0));
-            
-            if (i == 0) {
-                setModelMaterial(wallMaterial); 
-                renderModel(windowClosedModel, m, geometryShader.get());
-            } else if (i == 2) {
-                setModelMaterial(wallMaterial); 
-                renderModel(windowOpenModel, m, geometryShader.get());
-            } else {
-                setModelMaterial(wallMaterial);
-                renderModel(wallModel, m, geometryShader.get());
-            }
-        }
-        
-        for (int i = 0; i < 4; ++i) {
-            glm::vec3 pos(-wallOffset, wallY, xPositions[i]);
-            glm::mat4 m = glm::mat4(1.0f);
-            m = glm::translate(m, pos);
-            m = glm::rotate(m, glm::radians(90.0f), glm::vec3(0,1,0));
-            
-            if (i == 1) {
-                setModelMaterial(wallMaterial); 
-                renderModel(windowOpenModel, m, geometryShader.get());
-            } else {
-                setModelMaterial(wallMaterial);
-                renderModel(wallModel, m, geometryShader.get());
-            }
-            
-            if (i == 0) {
-                if (!isCrazyMode) {
-                    setModelMaterial(torchMaterial);
-                    glm::mat4 t = m;
-                    t = glm::translate(t, glm::vec3(0.0f, 2.3f, 0.4f)); 
-                    renderModel(torchModel, t, geometryShader.get());
-                }
-            }
-        }
-        
-        for (int i = 0; i < 4; ++i) {
-            glm::vec3 pos(wallOffset, wallY, xPositions[i]);
-            glm::mat4 m = glm::mat4(1.0f);
-            m = glm::translate(m, pos);
-            m = glm::rotate(m, glm::radians(-90.0f), glm::vec3(0,1,0));
-            
-            if (i == 2) {
-                setModelMaterial(wallMaterial); 
-                renderModel(windowClosedModel, m, geometryShader.get());
-            } else {
-                setModelMaterial(wallMaterial);
-                renderModel(wallModel, m, geometryShader.get());
-            }
-            
-            if (i == 3) {
-                 setModelMaterial(torchMaterial);
-                 glm::mat4 t = m;
-                 t = glm::translate(t, glm::vec3(0.0f, 2.6f, 0.4f));
-                 renderModel(torchModel, t, geometryShader.get());
-            }
-        }
-
-        // Second Floor
-        float floor2Y = wallY + 4.0f; // First floor wall height
-        
-        // 1. Ceiling of first floor and wood floor of second floor
-        setModelMaterial(ceilingMaterial);
-        for (int x = 0; x < gridSize; ++x) {
-            for (int z = 0; z < gridSize; ++z) {
-                // Stair opening
-                if (x == 4 && (z == 4 || z == 3)) continue;
-                
-                glm::mat4 tileMatrix = glm::mat4(1.0f);
-                tileMatrix = glm::translate(tileMatrix, glm::vec3(
-                    startX + x * tileSpacing,
-                    floor2Y, 
-                    startZ + z * tileSpacing
-                ));
-                renderModel(ceilingModel, tileMatrix, geometryShader.get());
-            }
-        }
-
-        setModelMaterial(woodFloorMaterial);
-        for (int x = 0; x < gridSize; ++x) {
-            for (int z = 0; z < gridSize; ++z) {
-                if (x == 4 && (z == 4 || z == 3)) continue;
-                
-                glm::mat4 tileMatrix = glm::mat4(1.0f);
-                tileMatrix = glm::translate(tileMatrix, glm::vec3(
-                    startX + x * tileSpacing,
-                    floor2Y + 0.1f, 
-                    startZ + z * tileSpacing
-                ));
-                renderModel(woodFloorModel, tileMatrix, geometryShader.get());
-            }
-        }
-        
-        // 2. Stairs
-        setModelMaterial(stairMaterial);
-        glm::mat4 stairMatrix = glm::mat4(1.0f);
-        glm::vec3 stairPos(8.0f, -1.0f, 10.0f);
-        glm::vec3 stairAxis(0.0f, 1.0f, 0.0f);
-        stairMatrix = glm::translate(stairMatrix, stairPos);
-        stairMatrix = glm::rotate(stairMatrix, glm::radians(180.0f), stairAxis); 
-        renderModel(stairModel, stairMatrix, geometryShader.get());
-        
-        // 3. Second Floor Walls
-        setModelMaterial(wallMaterial); 
-        
-        float f2WallY = floor2Y;
-        
-        for(int i=0; i<2; ++i) {
-            glm::mat4 m = glm::mat4(1.0f);
-            float xPos = 2.0f + (float)i * 4.0f;
-            glm::vec3 pos(xPos, f2WallY, 2.0f);
-            m = glm::translate(m, pos);
-            renderModel(wallModel, m, geometryShader.get());
-        }
-        
-        for(int i=0; i<2; ++i) {
-            glm::mat4 m = glm::mat4(1.0f);
-            float xPos = 2.0f + (float)i * 4.0f;
-            glm::vec3 pos(xPos, f2WallY, 10.0f);
-            glm::vec3 axis(0.0f, 1.0f, 0.0f);
-            m = glm::translate(m, pos);
-            m = glm::rotate(m, glm::radians(180.0f), axis);
-            setModelMaterial(wallMaterial);
-            renderModel(wallModel, m, geometryShader.get());
-            
-            if (i == 1) {
-                setModelMaterial(torchMaterial);
-                glm::mat4 t = m;
-                t = glm::translate(t, glm::vec3(0.0f, 2.3f, 0.4f));
-                renderModel(torchModel, t, geometryShader.get());
-            }
-        }
-        
-        {
-            setModelMaterial(wallMaterial);
-            glm::mat4 m = glm::mat4(1.0f);
-            glm::vec3 pos(-2.0f, f2WallY, 6.0f);
-            glm::vec3 axis(0.0f, 1.0f, 0.0f);
-            m = glm::translate(m, pos);
-            m = glm::rotate(m, glm::radians(90.0f), axis);
-            renderModel(wallModel, m, geometryShader.get());
-        }
-        
-        {
-            setModelMaterial(wallMaterial); 
-            glm::mat4 m = glm::mat4(1.0f);
-            glm::vec3 pos(10.0f, f2WallY, 6.0f);
-            glm::vec3 axis(0.0f, 1.0f, 0.0f);
-            m = glm::translate(m, pos);
-            m = glm::rotate(m, glm::radians(-90.0f), axis);
-            renderModel(windowOpenModel, m, geometryShader.get());
-        }
-        
-        // 4. Ceiling for Second Floor Room
-        setModelMaterial(ceilingMaterial);
-        float ceilingHeight = f2WallY + 4.0f; // Top of second floor
-        
-        for (int x = 2; x <= 4; ++x) {
-            for (int z = 3; z <= 4; ++z) {
-                 glm::mat4 tileMatrix = glm::mat4(1.0f);
-                 tileMatrix = glm::translate(tileMatrix, glm::vec3(
-                     startX + x * tileSpacing,
-                     ceilingHeight, 
-                     startZ + z * tileSpacing
-                 ));
-                 renderModel(ceilingModel, tileMatrix, geometryShader.get());
-            }
-        }
-        
-        // 5. Torches on Second Floor
-        
-        {
-             glm::mat4 t = glm::mat4(1.0f);
-             t = glm::translate(t, glm::vec3(-9.6f, 1.3f, 6.0f)); 
-             setModelMaterial(torchMaterial);
-             if (!isCrazyMode) renderModel(torchModel, t, geometryShader.get());
-        }
-        
-        {
-             glm::vec3 pos(-2.0f, f2WallY, 6.0f);
-             glm::mat4 m = glm::mat4(1.0f); 
-             m = glm::translate(m, pos);
-             m = glm::rotate(m, glm::radians(90.0f), glm::vec3(0,1,0));
-             
-             glm::mat4 t = m;
-             t = glm::translate(t, glm::vec3(0.0f, 2.3f, 0.4f));
-             setModelMaterial(torchMaterial);
-             renderModel(torchModel, t, geometryShader.get());
-        }
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+}
 
-        setModelMaterial(wallMaterial);
-        
-        m = glm::mat4(1.0f);
-        {
-            glm::vec3 pos(-2.0f, f2WallY, 2.0f);
-            glm::vec3 axis(0.0f, 1.0f, 0.0f);
-            m = glm::translate(m, pos);
-            m = glm::rotate(m, glm::radians(90.0f), axis);
-            renderModel(cornerModel, m, geometryShader.get());
-        }
-        
-        m = glm::mat4(1.0f);
-        {
-            glm::vec3 pos(10.0f, f2WallY, 2.0f);
-            m = glm::translate(m, pos);
-            renderModel(cornerModel, m, geometryShader.get());
-        }
-        
-        m = glm::mat4(1.0f);
-        {
-            glm::vec3 pos(-2.0f, f2WallY, 10.0f);
-            glm::vec3 axis(0.0f, 1.0f, 0.0f);
-            m = glm::translate(m, pos);
-            m = glm::rotate(m, glm::radians(180.0f), axis);
-            renderModel(cornerModel, m, geometryShader.get());
-        }
-        
-        m = glm::mat4(1.0f);
-        {
-            glm::vec3 pos(10.0f, f2WallY, 10.0f);
-            glm::vec3 axis(0.0f, 1.0f, 0.0f);
-            m = glm::translate(m, pos);
-            m = glm::rotate(m, glm::radians(-90.0f), axis);
-            renderModel(cornerModel, m, geometryShader.get());
-        }
-        renderDecorations(geometryShader.get());
-
-        if (isCrazyMode) {
-            setModelMaterial(torchMaterial);
-            for (const auto& params : crazyTorchParams) {
-                 if (params.lightIndex < lightManager->getLights().size()) {
-                     const auto& light = lightManager->getLights()[params.lightIndex];
-                     
-                     glm::mat4 t = glm::mat4(1.0f);
-                     t = glm::translate(t, light.position);
-                     t = glm::translate(t, glm::vec3(0.0f, -1.9f, 0.0f));
-                     renderModel(torchModel, t, geometryShader.get());
-                 }
-            }
-        }
+// Geometry Pass - fill G-Buffer with position, normals, albedo, depth
+void Renderer::geometryPass(const Camera& camera)
+{
+    // Usually finished long ago, during the shadow passes.
+    jobSystem->wait(cameraCullJobs);
+    
+    bool occlusionCulling = enableOcclusionCulling && useIndirectDraws && geometryShader && geometryPool &&
+                            occlusionCuller && occlusionCuller->isAvailable() && !cameraDrawList.indirectCommands.empty();
+    if (occlusionCulling) {
+        occlusionGeometryPass();
+        return;
+    }
+    
+    gBuffer->bind();
+    glViewport(0, 0, renderWidth, renderHeight);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    
+    if (geometryShader) {
+        geometryShader->use();
         
-        if (isCrazyMode) {
-            setModelMaterial(torchMaterial);
-            for (const auto& params : crazyTorchParams) {
-                 if (params.lightIndex < lightManager->getLights().size()) {
-                     const auto& light = lightManager->getLights()[params.lightIndex];
-                     
-                     glm::mat4 t = glm::mat4(1.0f);
-                     t = glm::translate(t, light.position);
-                     t = glm::translate(t, glm::vec3(0.0f, -1.9f, 0.0f));
-                     renderModel(torchModel, t, geometryShader.get());
-                 }
-            }
-        }
+        // view/projection come from FrameBlock, model matrices and materials from the scene storage buffers.
+        submitDrawList(cameraDrawList);
     }
     
     gBuffer->unbind();
 }
 
+// Same G-Buffer in two draws of the frustum-culled list (see OcclusionCuller): what was visible last frame,
+// then, tested against the Hi-Z of that depth, what has come into view. The instance counts never come back
+// to the CPU, so the stats still show the frustum survivors.
+void Renderer::occlusionGeometryPass()
+{
+    addDrawListStats(cameraDrawList);
+    geometryPool->upload();
+    occlusionCuller->prepare(cameraDrawList.visibleInstanceIds, cameraDrawList.indirectCommands,
+                             *visibleInstanceBuffer, indirectBuffer);
+    
+    occlusionCuller->cull(OcclusionCuller::PHASE_PREVIOUSLY_VISIBLE);
+    gBuffer->bind();
+    glViewport(0, 0, renderWidth, renderHeight);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    geometryShader->use();
+    issueDrawList(cameraDrawList, occlusionCuller->getCommandOffset(OcclusionCuller::PHASE_PREVIOUSLY_VISIBLE));
+    gBuffer->unbind();
+    
+    occlusionCuller->buildHiZ(gBuffer->getDepthTexture(), renderWidth, renderHeight, width, height);
+    occlusionCuller->cull(OcclusionCuller::PHASE_DISOCCLUDED);
+    
+    gBuffer->bind();
+    glViewport(0, 0, renderWidth, renderHeight);
+    geometryShader->use();
+    issueDrawList(cameraDrawList, occlusionCuller->getCommandOffset(OcclusionCuller::PHASE_DISOCCLUDED));
+    gBuffer->unbind();
+}
+
+// One work group per screen tile: bounds of the tile's G-Buffer positions against every light's range.
+// The result is a light bitmask per tile that the lighting pass walks instead of the whole light list.
+void Renderer::lightCullingPass()
+{
+    lightTilesValid = false;
+    // Unlinked: lightTilesValid stays false and the lighting pass ignores the tile masks.
+    if (!enableLightCulling || !lightCullingShader || !lightCullingShader->isLinked()) return;
+    
+    GLuint tilesX = (renderWidth + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+    GLuint tilesY = (renderHeight + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+    GLsizeiptr tileBufferSize = static_cast<GLsizeiptr>(tilesX) * tilesY * LIGHT_TILE_WORDS * sizeof(uint32_t);
+    if (lightTileBuffer->getSize() < tileBufferSize) {
+        lightTileBuffer->allocate(tileBufferSize);
+    }
+    
+    lightCullingShader->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gBuffer->getNormalTexture());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, gBuffer->getPositionTexture());
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, gBuffer->getDepthTexture());
+    
+    glDispatchCompute(tilesX, tilesY, 1);
+    
+    // The lighting pass reads the masks from its fragment shader.
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    lightTilesValid = true;
+}
+
 // Deferred Lighting Pass
 // This is the core of the pipeline. It takes the G-Buffer data and generates the final image by applying lighting equations, shadow mapping, and cel shading logic.
 // All calculations are done in screen-space.
-void Renderer::lightingPass(const Camera& camera)
+void Renderer::lightingPass(GLuint targetFramebuffer)
 {
-    // Render lightingFBO.
     // The result will be used as an input texture for the subsequent edge detection and composite passes.
-    glBindFramebuffer(GL_FRAMEBUFFER, lightingFBO);
-    glViewport(0, 0, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    glViewport(0, 0, renderWidth, renderHeight);
     glClear(GL_COLOR_BUFFER_BIT);
     
     if (hybridCelShader) {
         hybridCelShader->use();
+        bindLightingTextures();
         
-        // Bind G-Buffer textures
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gBuffer->getBaseColorTexture());
-        hybridCelShader->setInt("gBaseColor", 0);
-        
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gBuffer->getNormalTexture());
-        hybridCelShader->setInt("gNormal", 1);
-        
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, gBuffer->getPositionTexture());
-        hybridCelShader->setInt("gPosition", 2);
-        
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, gBuffer->getQuantizationTexture());
-        hybridCelShader->setInt("gQuantization", 3);
-        
-        // Bind shadow maps (cubemaps for point, 2D for dir/spot)
-        const auto& lights = lightManager->getLights();
-        size_t lightCount = std::min(lights.size(), MAX_SHADOW_CASTING_LIGHTS);
-        
-        for (size_t i = 0; i < lightCount; ++i) {
-            const auto& light = lights[i];
-            const auto& shadowData = shadowMaps[i];
-            
-            if (!shadowData.isActive) continue;
-            
-            // Texture units: 4+ reserved for shadow maps
-            int textureUnit = 4 + i * 2; 
-            
-            if (light.type == LightType::POINT) {
-                // Cube Map for point light shadows
-                glActiveTexture(GL_TEXTURE0 + textureUnit);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, shadowData.depthCubemap);
-                hybridCelShader->setInt("shadowCubeMaps[" + std::to_string(i) + "]", textureUnit);
-            } else {
-                // 2D Shadow Map for directional/spot lights
-                glActiveTexture(GL_TEXTURE0 + textureUnit);
-                glBindTexture(GL_TEXTURE_2D, shadowData.depthMap);
-                hybridCelShader->setInt("shadowMaps[" + std::to_string(i) + "]", textureUnit);
-                // Matrix to transform world position to light-space
-                hybridCelShader->setMat4("lightSpaceMatrices[" + std::to_string(i) + "]", shadowData.lightSpaceMatrix);
-            }
-        }
-        
-        // Upload light properties to shader
-        hybridCelShader->setInt("numLights", lightCount);
-        
-        for (size_t i = 0; i < lightCount; ++i) {
-            const auto& light = lights[i];
-            std::string base = "lights[" + std::to_string(i) + "]";
-            hybridCelShader->setInt(base + ".type", static_cast<int>(light.type));
-            hybridCelShader->setVec3(base + ".position", light.position);
-            hybridCelShader->setVec3(base + ".direction", light.direction);
-            hybridCelShader->setVec3(base + ".color", light.color);
-            hybridCelShader->setFloat(base + ".intensity", light.intensity);
-            hybridCelShader->setFloat(base + ".constant", light.constant);
-            hybridCelShader->setFloat(base + ".linear", light.linear);
-            hybridCelShader->setFloat(base + ".quadratic", light.quadratic);
-            hybridCelShader->setFloat(base + ".cutOff", light.cutOff);
-            hybridCelShader->setFloat(base + ".outerCutOff", light.outerCutOff);
-            hybridCelShader->setBool(base + ".castShadows", light.castShadows);
-        }
-        
-        // Shadow and camera settings
-        hybridCelShader->setFloat("shadowBias", shadowParams.shadowBias);
-        hybridCelShader->setFloat("shadowNormalBias", shadowParams.shadowNormalBias);
-        hybridCelShader->setInt("shadowPCFSamples", shadowParams.shadowPCFSamples);
-        hybridCelShader->setFloat("shadowIntensity", shadowParams.shadowIntensity);
-        hybridCelShader->setBool("enablePCF", shadowParams.enablePCF);
-        hybridCelShader->setFloat("shadowFarPlane", shadowParams.farPlane);
-        
-        hybridCelShader->setVec3("viewPos", camera.Position);
-        hybridCelShader->setMat4("view", camera.getViewMatrix());
-        hybridCelShader->setMat4("projection", camera.getProjectionMatrix(static_cast<float>(width) / height));
-        
-        // Material/toon settings
-        hybridCelShader->setBool("enableQuantization", materialParams.enableQuantization);
-        hybridCelShader->setInt("diffuseQuantizationBands", materialParams.diffuseQuantizationBands);
-        hybridCelShader->setFloat("specularThreshold1", materialParams.specularThreshold1);
-        hybridCelShader->setFloat("specularThreshold2", materialParams.specularThreshold2);
-        hybridCelShader->setInt("globalMaterialType", static_cast<int>(globalIlluminationModel));
+        // Lights, light-space matrices, shadow and camera settings are read from LightBlock/FrameBlock.
+        setLightingUniforms(lightingUniforms);
         
         renderQuad();
     }
@@ -1280,11 +1954,51 @@ void Renderer::lightingPass(const Camera& camera)
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+// Bind G-Buffer textures and shadow maps (sampler units are fixed in resolveUniforms)
+void Renderer::bindLightingTextures()
+{
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gBuffer->getBaseColorTexture());
+    
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, gBuffer->getNormalTexture());
+    
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, gBuffer->getPositionTexture());
+    
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, gBuffer->getQuantizationTexture());
+    
+    // Compact layout rebuilds positions from depth.
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_DEPTH_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, gBuffer->getDepthTexture());
+    
+    // Bind the shadow atlas (spot), the per-tier cube arrays (point) and the cascades (directional). Which tile/cube a light uses is in LightBlock.
+    glActiveTexture(GL_TEXTURE0 + SHADOW_ATLAS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, shadowAtlas->getTexture());
+    for (int tier = 0; tier < ShadowCubeArray::TIER_COUNT; ++tier) {
+        glActiveTexture(GL_TEXTURE0 + SHADOW_CUBE_ARRAY_TEXTURE_UNIT_BASE + tier);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, shadowCubeArray->getTexture(tier));
+    }
+    glActiveTexture(GL_TEXTURE0 + SHADOW_CASCADE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadowCascades->getTexture());
+}
+
+// Material/toon settings
+void Renderer::setLightingUniforms(const LightingPassUniforms& u)
+{
+    u.diffuseQuantizationBands.set(materialParams.diffuseQuantizationBands);
+    u.specularThreshold1.set(materialParams.specularThreshold1);
+    u.specularThreshold2.set(materialParams.specularThreshold2);
+    u.globalMaterialType.set(static_cast<int>(globalIlluminationModel));
+    u.useLightTiles.set(lightTilesValid);
+}
+
 // Edge Detection Pass - find depth/normal/color discontinuities for outlines
-void Renderer::edgeDetectionPass()
+void Renderer::edgeDetectionPass(GLuint targetFramebuffer, GLuint lightingTexture)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, edgeFBO);
-    glViewport(0, 0, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    glViewport(0, 0, renderWidth, renderHeight);
     glClear(GL_COLOR_BUFFER_BIT); // Clear buffer
     
     if (edgeDetectionShader) {
@@ -1293,36 +2007,18 @@ void Renderer::edgeDetectionPass()
         // Feed the G-Buffer into the edge detector.
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, gBuffer->getPositionTexture());
-        edgeDetectionShader->setInt("gPosition", 0);
         
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, gBuffer->getNormalTexture());
-        edgeDetectionShader->setInt("gNormal", 1);
         
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, gBuffer->getDepthTexture());
-        edgeDetectionShader->setInt("gDepth", 2);
         
         // Also feed the lighting result for color-based edge detection.
         glActiveTexture(GL_TEXTURE3);
         glBindTexture(GL_TEXTURE_2D, lightingTexture);
-        edgeDetectionShader->setInt("colorTexture", 3);
         
-        // Threshold settings (lower = more sensitive)
-        edgeDetectionShader->setInt("edgeFlags", edgeDetectionFlags);
-        edgeDetectionShader->setFloat("depthThreshold", edgeParams.depthThreshold);
-        edgeDetectionShader->setFloat("normalThreshold", edgeParams.normalThreshold);
-        edgeDetectionShader->setFloat("sobelThreshold", edgeParams.sobelThreshold);
-        edgeDetectionShader->setFloat("colorThreshold", edgeParams.colorThreshold);
-        edgeDetectionShader->setVec3("edgeColor", edgeParams.edgeColor);
-        edgeDetectionShader->setVec2("screenSize", glm::vec2(width, height));
-        // Extra parameters
-        edgeDetectionShader->setFloat("depthExponent", edgeParams.depthExponent);
-        edgeDetectionShader->setFloat("normalSplit", edgeParams.normalSplit);
-        edgeDetectionShader->setFloat("sobelScale", edgeParams.sobelScale);
-        edgeDetectionShader->setFloat("smoothWidth", edgeParams.smoothWidth);
-        edgeDetectionShader->setFloat("laplacianThreshold", edgeParams.laplacianThreshold);
-        edgeDetectionShader->setFloat("laplacianScale", edgeParams.laplacianScale);
+        setEdgeDetectionUniforms(edgeUniforms);
         
         renderQuad();
     }
@@ -1330,32 +2026,98 @@ void Renderer::edgeDetectionPass()
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void Renderer::setEdgeDetectionUniforms(const EdgeDetectionPassUniforms& u)
+{
+    // Threshold settings (lower = more sensitive). The enabled filters are baked into the variant.
+    u.depthThreshold.set(edgeParams.depthThreshold);
+    u.normalThreshold.set(edgeParams.normalThreshold);
+    u.sobelThreshold.set(edgeParams.sobelThreshold);
+    u.colorThreshold.set(edgeParams.colorThreshold);
+    u.edgeColor.set(edgeParams.edgeColor);
+    u.screenSize.set(glm::vec2(width, height));
+    // Extra parameters
+    u.depthExponent.set(edgeParams.depthExponent);
+    u.normalSplit.set(edgeParams.normalSplit);
+    u.sobelScale.set(edgeParams.sobelScale);
+    u.smoothWidth.set(edgeParams.smoothWidth);
+    u.laplacianThreshold.set(edgeParams.laplacianThreshold);
+    u.laplacianScale.set(edgeParams.laplacianScale);
+}
+
 // Composite Pass - combine lit scene with edge outlines, render to screen
-void Renderer::compositePass()
+void Renderer::compositePass(unsigned int colorTexture, unsigned int edgeMask)
 {
     glViewport(0, 0, width, height);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
     if (compositeShader) {
         compositeShader->use();
+        auto& u = compositeUniforms;
         
         // Input 1: lit scene.
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, lightingTexture);
-        compositeShader->setInt("lightingTexture", 0);
+        glBindTexture(GL_TEXTURE_2D, colorTexture);
         
         // Input 2: edges map (black lines on transparent background).
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, edgeTexture);
-        compositeShader->setInt("edgeTexture", 1);
+        glBindTexture(GL_TEXTURE_2D, edgeMask);
         
         // Toggle outlining on/off.
-        compositeShader->setBool("enableOutlining", edgeParams.enableOutlining);
+        u.enableOutlining.set(edgeParams.enableOutlining);
+        u.edgeColor.set(edgeParams.edgeColor);
+        
+        // Upsample from the rendered part of the targets (all of it at full resolution).
+        glm::vec2 targetSize(width, height);
+        u.uvScale.set(glm::vec2(renderWidth, renderHeight) / targetSize);
+        u.uvMax.set((glm::vec2(renderWidth, renderHeight) - 0.5f) / targetSize);
+        u.upscaleRatio.set(static_cast<float>(width) / renderWidth);
+        u.sharpenEdges.set(dynamicResolution.sharpenEdges);
         
         renderQuad();
     }
 }
 
+// Fused Lighting Pass - lighting, edge detection and composite of one screen tile per work group.
+// The G-Buffer neighbourhood edges need is loaded into shared memory once, and the composited pixel is written directly,
+// so there is no lighting or edge target. At full resolution the result is blitted to the default framebuffer;
+// below it, the image keeps the edge strength in alpha and compositePass mixes while upsampling.
+void Renderer::fusedLightingPass(GLuint outputTexture)
+{
+    bool upsample = renderWidth != width || renderHeight != height;
+    
+    fusedLightingShader->use();
+    bindLightingTextures();
+    glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    
+    auto& u = fusedLightingUniforms;
+    setLightingUniforms(u.lighting);
+    setEdgeDetectionUniforms(u.edges);
+    u.enableOutlining.set(edgeParams.enableOutlining);
+    u.deferComposite.set(upsample);
+    
+    GLuint tilesX = (renderWidth + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+    GLuint tilesY = (renderHeight + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+    glDispatchCompute(tilesX, tilesY, 1);
+    
+    // Sampled by compositePass when upsampling, otherwise read through the framebuffer by the blit.
+    glMemoryBarrier(upsample ? GL_TEXTURE_FETCH_BARRIER_BIT : GL_FRAMEBUFFER_BARRIER_BIT);
+}
+
+void Renderer::presentFusedOutput(GLuint outputTexture, GLuint outputFramebuffer)
+{
+    if (renderWidth != width || renderHeight != height) {
+        compositePass(outputTexture, outputTexture);
+        return;
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, outputFramebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 // Fullscreen quad for post-processing
 void Renderer::renderQuad()
 {
@@ -1365,116 +2127,29 @@ void Renderer::renderQuad()
 }
 void Renderer::loadModels()
 {
-    // Load mesh assets with error handling
-
-    try {
-        floorTileModel = std::make_unique<Model>("assets/models/floor_tile_large.obj");
-        std::cout << "Successfully loaded floor_tile_large.obj" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load floor tile model: " << e.what() << std::endl;
-    }
-
-    try {
-        wallModel = std::make_unique<Model>("assets/models/wall.obj");
-        std::cout << "Successfully loaded wall.obj" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load wall model: " << e.what() << std::endl;
-    }
-
-    try {
-        cornerModel = std::make_unique<Model>("assets/models/wall_corner.obj");
-        std::cout << "Successfully loaded wall_corner.obj" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load corner model: " << e.what() << std::endl;
-    }
-
-    try {
-        doorwayModel = std::make_unique<Model>("assets/models/wall_doorway.obj");
-        std::cout << "Successfully loaded wall_doorway.obj" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load doorway model: " << e.what() << std::endl;
-    }
-
-    try {
-        windowOpenModel = std::make_unique<Model>("assets/models/wall_window_open.obj");
-        std::cout << "Successfully loaded wall_window_open.obj" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load window open model: " << e.what() << std::endl;
-    }
-
-    try {
-        windowClosedModel = std::make_unique<Model>("assets/models/wall_window_closed.obj");
-        std::cout << "Successfully loaded wall_window_closed.obj" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load window closed model: " << e.what() << std::endl;
-    }
-
-    try {
-        ceilingModel = std::make_unique<Model>("assets/models/ceiling_tile.obj");
-        std::cout << "Successfully loaded ceiling_tile.obj" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load ceiling model: " << e.what() << std::endl;
-    }
-
-    try {
-        woodFloorModel = std::make_unique<Model>("assets/models/floor_wood_large.obj");
-        std::cout << "Successfully loaded floor_wood_large.obj" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load wood floor model: " << e.what() << std::endl;
-    }
-
-    try {
-        stairModel = std::make_unique<Model>("assets/models/stairs_wood_decorated.obj");
-        std::cout << "Successfully loaded stairs_wood_decorated.obj" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load stair model: " << e.what() << std::endl;
-    }
-
-    try {
-        torchModel = std::make_unique<Model>("assets/models/torch_lit.obj");
-        std::cout << "Successfully loaded torch_lit.obj" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load torch model: " << e.what() << std::endl;
-    }
-
-    // Load Extended Ground Models
-    try {
-        floorDirtLargeModel = std::make_unique<Model>("assets/models/floor_dirt_large.obj");
-        std::cout << "Successfully loaded floor_dirt_large.obj" << std::endl;
-    } catch (const std::exception& e) { std::cerr << "Failed to load floor_dirt_large: " << e.what() << std::endl; }
-
-    try {
-        floorDirtLargeRockyModel = std::make_unique<Model>("assets/models/floor_dirt_large_rocky.obj");
-        std::cout << "Successfully loaded floor_dirt_large_rocky.obj" << std::endl;
-    } catch (const std::exception& e) { std::cerr << "Failed to load floor_dirt_large_rocky: " << e.what() << std::endl; }
-
-    try {
-        floorDirtSmallAModel = std::make_unique<Model>("assets/models/floor_dirt_small_A.obj");
-        std::cout << "Successfully loaded floor_dirt_small_A.obj" << std::endl;
-    } catch (const std::exception& e) { std::cerr << "Failed to load floor_dirt_small_A: " << e.what() << std::endl; }
-
-    try {
-        floorDirtSmallBModel = std::make_unique<Model>("assets/models/floor_dirt_small_B.obj");
-        std::cout << "Successfully loaded floor_dirt_small_B.obj" << std::endl;
-    } catch (const std::exception& e) { std::cerr << "Failed to load floor_dirt_small_B: " << e.what() << std::endl; }
-
-    try {
-        floorDirtSmallCModel = std::make_unique<Model>("assets/models/floor_dirt_small_C.obj");
-        std::cout << "Successfully loaded floor_dirt_small_C.obj" << std::endl;
-    } catch (const std::exception& e) { std::cerr << "Failed to load floor_dirt_small_C: " << e.what() << std::endl; }
-
-    try {
-        floorDirtSmallDModel = std::make_unique<Model>("assets/models/floor_dirt_small_D.obj");
-        std::cout << "Successfully loaded floor_dirt_small_D.obj" << std::endl;
-    } catch (const std::exception& e) { std::cerr << "Failed to load floor_dirt_small_D: " << e.what() << std::endl; }
-
-    try {
-        floorDirtSmallWeedsModel = std::make_unique<Model>("assets/models/floor_dirt_small_weeds.obj");
-        std::cout << "Successfully loaded floor_dirt_small_weeds.obj" << std::endl;
-    } catch (const std::exception& e) { std::cerr << "Failed to load floor_dirt_small_weeds: " << e.what() << std::endl; }
-
-    // Use try-catch for decorations as well
-    const std::vector<std::pair<std::string, std::unique_ptr<Model>*>> decorationAssets = {
+    // Every model starts as an empty placeholder and is filled in by the asset loader's workers.
+    // The scene can be built right away; instances of a model simply draw nothing until it arrives.
+    const std::vector<std::pair<std::string, std::unique_ptr<Model>*>> modelAssets = {
+        // Structure
+        {"assets/models/floor_tile_large.obj", &floorTileModel},
+        {"assets/models/wall.obj", &wallModel},
+        {"assets/models/wall_corner.obj", &cornerModel},
+        {"assets/models/wall_doorway.obj", &doorwayModel},
+        {"assets/models/wall_window_open.obj", &windowOpenModel},
+        {"assets/models/wall_window_closed.obj", &windowClosedModel},
+        {"assets/models/ceiling_tile.obj", &ceilingModel},
+        {"assets/models/floor_wood_large.obj", &woodFloorModel},
+        {"assets/models/stairs_wood_decorated.obj", &stairModel},
+        {"assets/models/torch_lit.obj", &torchModel},
+        // Extended ground
+        {"assets/models/floor_dirt_large.obj", &floorDirtLargeModel},
+        {"assets/models/floor_dirt_large_rocky.obj", &floorDirtLargeRockyModel},
+        {"assets/models/floor_dirt_small_A.obj", &floorDirtSmallAModel},
+        {"assets/models/floor_dirt_small_B.obj", &floorDirtSmallBModel},
+        {"assets/models/floor_dirt_small_C.obj", &floorDirtSmallCModel},
+        {"assets/models/floor_dirt_small_D.obj", &floorDirtSmallDModel},
+        {"assets/models/floor_dirt_small_weeds.obj", &floorDirtSmallWeedsModel},
+        // Decorations
         {"assets/models/table_long_decorated_A.obj", &tableLongDecoratedModel},
         {"assets/models/chair.obj", &chairModel},
         {"assets/models/stool.obj", &stoolModel},
@@ -1493,35 +2168,57 @@ void Renderer::loadModels()
         {"assets/models/Parts_Pile_Large.obj", &metalPartsModel},
         {"assets/models/Textiles_Stack_Large_Colored.obj", &textilesModel}
     };
+    for (const auto& asset : modelAssets) {
+        *asset.second = std::make_unique<Model>();
+        assetLoader->loadModel(asset.second->get(), asset.first);
+    }
+}
+
+// Hands models that finished loading to the pool and the scene. Runs at the start of every frame.
+void Renderer::streamAssets()
+{
+    std::vector<Model*> ready = assetLoader->update();
+
+    // Textures arrive on their own, after the model: the handles are refreshed every frame (unchanged ones cost nothing).
+    if (bindlessTextures && scene) {
+        for (uint32_t i = 0; i < sceneModels.size(); ++i) {
+            scene->setModelTexture(i, sceneModels[i]->getDiffuseHandle());
+        }
+    }
+    if (ready.empty()) return;
 
-    for (const auto& asset : decorationAssets) {
-        try {
-            *asset.second = std::make_unique<Model>(asset.first.c_str());
-            std::cout << "Successfully loaded " << asset.first << std::endl;
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to load " << asset.first << ": " << e.what() << std::endl;
+    for (Model* model : ready) {
+        for (uint32_t i = 0; i < sceneModels.size(); ++i) {
+            if (sceneModels[i] != model) continue;
+            model->addToPool(*geometryPool);
+            if (scene) scene->setModelBounds(i, model->getBoundingBox(), model->getBoundingSphere());
         }
     }
+
+    // New geometry: instance bounds change, and even static lights have to redraw their shadows.
+    if (scene) scene->refreshInstanceBounds();
+    for (auto& shadowData : shadowMaps) {
+        shadowData.hasRendered = false;
+    }
 }
  
 
-// Spawns all the decorations.
-void Renderer::renderDecorations(Shader* shader)
+// Places all the decorations.
+void Renderer::buildDecorations()
 {
     float floorY = -1.0f;
 
     // Side Tables (Left/Right)
     // Table and chairs setup
-    auto drawSideTable = [&](float tx, float tz, float spacing = 1.5f) {
+    auto placeSideTable = [&](float tx, float tz, float spacing = 1.5f) {
         // Table Rotated to X-axis (-180)
-        setModelMaterial(tableMaterial);
         glm::mat4 m = glm::mat4(1.0f);
         m = glm::translate(m, glm::vec3(tx, floorY, tz));
         m = glm::rotate(m, glm::radians(-180.0f), glm::vec3(0,1,0));
-        renderModel(tableLongDecoratedModel, m, shader);
+        addToScene(tableLongDecoratedModel, tableMaterial, m);
 
         // Chairs with random offsets in rotation and position so they seem natural
-        auto drawChair = [&](float cx, float cz, float baseRot) {
+        auto placeChair = [&](float cx, float cz, float baseRot) {
             float seed = (cx * 13.0f + cz * 37.0f + tx * 7.0f);
             float jitterRot = std::fmod(std::abs(std::sin(seed) * 100.0f), 20.0f) - 10.0f;
             float jitterX = (std::fmod(std::abs(std::cos(seed * 0.5f) * 100.0f), 0.2f) - 0.1f);
@@ -1530,30 +2227,28 @@ void Renderer::renderDecorations(Shader* shader)
             glm::mat4 cm = glm::mat4(1.0f);
             cm = glm::translate(cm, glm::vec3(tx + cx + jitterX, floorY, tz + cz + jitterZ));
             cm = glm::rotate(cm, glm::radians(baseRot + jitterRot), glm::vec3(0,1,0));
-            setModelMaterial(chairMaterial);
-            renderModel(chairModel, cm, shader);
+            addToScene(chairModel, chairMaterial, cm);
         };
 
-        drawChair(-1.0f, -spacing, 180.0f);
-        drawChair(-1.0f,  spacing, 180.0f);
-        
-        drawChair( 1.0f, -spacing, 0.0f);
-        drawChair( 1.0f,  spacing, 0.0f);
+        placeChair(-1.0f, -spacing, 180.0f);
+        placeChair(-1.0f,  spacing, 180.0f);
 
-        drawChair( 0.0f, -2.5f, 90.0f);
-        drawChair( 0.0f,  2.5f, 270.0f);
+        placeChair( 1.0f, -spacing, 0.0f);
+        placeChair( 1.0f,  spacing, 0.0f);
+
+        placeChair( 0.0f, -2.5f, 90.0f);
+        placeChair( 0.0f,  2.5f, 270.0f);
     };
 
     // Central table with chairs
     // Chairs positions rotated 90 degrees around table.
-    auto drawCentralTable = [&](float tx, float tz) {
-        setModelMaterial(tableMaterial);
+    auto placeCentralTable = [&](float tx, float tz) {
         glm::mat4 m = glm::mat4(1.0f);
         m = glm::translate(m, glm::vec3(tx, floorY, tz));
         m = glm::rotate(m, glm::radians(-90.0f), glm::vec3(0,1,0));
-        renderModel(tableLongDecoratedModel, m, shader);
+        addToScene(tableLongDecoratedModel, tableMaterial, m);
 
-        auto drawChair = [&](float cx, float cz, float baseRot) {
+        auto placeChair = [&](float cx, float cz, float baseRot) {
             // Rotate chair position and orientation
             float rcx = cz;
             float rcz = -cx;
@@ -1568,74 +2263,65 @@ void Renderer::renderDecorations(Shader* shader)
             glm::mat4 cm = glm::mat4(1.0f);
             cm = glm::translate(cm, glm::vec3(tx + rcx + jitterX, floorY, tz + rcz + jitterZ));
             cm = glm::rotate(cm, glm::radians(rRot + jitterRot), glm::vec3(0,1,0));
-            setModelMaterial(chairMaterial);
-            renderModel(chairModel, cm, shader);
+            addToScene(chairModel, chairMaterial, cm);
         };
 
-        drawChair(-1.0f, -1.0f, 180.0f);
-        drawChair(-1.0f,  1.0f, 180.0f);
-        drawChair( 1.0f, -1.0f, 0.0f);
-        drawChair( 1.0f,  1.0f, 0.0f);
-        drawChair( 0.0f, -2.5f, 90.0f);
-        drawChair( 0.0f,  2.5f, 270.0f);
+        placeChair(-1.0f, -1.0f, 180.0f);
+        placeChair(-1.0f,  1.0f, 180.0f);
+        placeChair( 1.0f, -1.0f, 0.0f);
+        placeChair( 1.0f,  1.0f, 0.0f);
+        placeChair( 0.0f, -2.5f, 90.0f);
+        placeChair( 0.0f,  2.5f, 270.0f);
     };
 
-    // Draw Tables
-    drawSideTable(-6.0f, 4.0f, 1.0f);
-    drawSideTable( 6.0f, -3.0f, 0.7f);
-    drawCentralTable(0.0f, 5.0f);
+    // Place Tables
+    placeSideTable(-6.0f, 4.0f, 1.0f);
+    placeSideTable( 6.0f, -3.0f, 0.7f);
+    placeCentralTable(0.0f, 5.0f);
 
 
     // Barrel
-    setModelMaterial(barrelMaterial);
     glm::mat4 m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-8.5f, floorY, 8.5f));
-    renderModel(barrelModel, m, shader);
+    addToScene(barrelModel, barrelMaterial, m);
 
     // Candles on top of barrel
-    setModelMaterial(candleMaterial);
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-8.5f, floorY + 1.5f, 8.5f)); // Raised by 0.5 units (1.0 -> 1.5)
-    renderModel(candleTripleModel, m, shader);
+    addToScene(candleTripleModel, candleMaterial, m);
 
     // Crates in corner
-    setModelMaterial(crateMaterial);
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(8.5f, floorY, -8.5f));
     m = glm::rotate(m, glm::radians(30.0f), glm::vec3(0,1,0));
-    renderModel(crateStackModel, m, shader);
+    addToScene(crateStackModel, crateMaterial, m);
 
     // Candles on window
-    setModelMaterial(shelfMaterial);
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-10.0f, 0.4f, -2.0f));
     m = glm::rotate(m, glm::radians(90.0f), glm::vec3(0,1,0));
-    renderModel(shelfSmallCandlesModel, m, shader);
+    addToScene(shelfSmallCandlesModel, shelfMaterial, m);
 
     // Sword & Shield on South Wall
-    setModelMaterial(swordShieldMaterial);
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-0.5f, floorY + 2.25f, 9.6f));
     m = glm::rotate(m, glm::radians(180.0f), glm::vec3(0,1,0));
-    renderModel(swordShieldModel, m, shader);
+    addToScene(swordShieldModel, swordShieldMaterial, m);
 
 
     // Wood pallets
-    setModelMaterial(woodPalletMaterial);
-    
+
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-8.5f, floorY, -3.5f));
     m = glm::rotate(m, glm::radians(90.0f), glm::vec3(0,1,0));
     m = glm::rotate(m, glm::radians(5.0f), glm::vec3(0,1,0)); 
-    renderModel(woodPalletModel, m, shader);
+    addToScene(woodPalletModel, woodPalletMaterial, m);
 
     // wood Planks
     {
-        setModelMaterial(woodPlanksMaterial);
         glm::mat4 rm = m;
         rm = glm::translate(rm, glm::vec3(0.0f, 0.3f, 0.0f));
-        renderModel(woodPlanksModel, rm, shader);
-        setModelMaterial(woodPalletMaterial);
+        addToScene(woodPlanksModel, woodPlanksMaterial, rm);
     }
 
     // Pallet 2
@@ -1643,15 +2329,13 @@ void Renderer::renderDecorations(Shader* shader)
     m = glm::translate(m, glm::vec3(-8.5f, floorY, -5.5f));
     m = glm::rotate(m, glm::radians(90.0f), glm::vec3(0,1,0));
     m = glm::rotate(m, glm::radians(-3.0f), glm::vec3(0,1,0));
-    renderModel(woodPalletModel, m, shader);
+    addToScene(woodPalletModel, woodPalletMaterial, m);
 
     // Stone bricks
     {
-        setModelMaterial(stoneStackMaterial);
         glm::mat4 rm = m;
         rm = glm::translate(rm, glm::vec3(0.0f, 0.3f, 0.0f));
-        renderModel(stoneStackModel, rm, shader);
-        setModelMaterial(woodPalletMaterial);
+        addToScene(stoneStackModel, stoneStackMaterial, rm);
     }
 
     // Pallet 3
@@ -1659,15 +2343,13 @@ void Renderer::renderDecorations(Shader* shader)
     m = glm::translate(m, glm::vec3(-3.5f, floorY, -8.5f)); 
     m = glm::rotate(m, glm::radians(0.0f), glm::vec3(0,1,0)); 
     m = glm::rotate(m, glm::radians(2.0f), glm::vec3(0,1,0));
-    renderModel(woodPalletModel, m, shader);
+    addToScene(woodPalletModel, woodPalletMaterial, m);
 
     // Gold bars
     {
-        setModelMaterial(goldBarsMaterial);
         glm::mat4 rm = m;
         rm = glm::translate(rm, glm::vec3(0.0f, 0.3f, 0.0f));
-        renderModel(goldBarsModel, rm, shader);
-        setModelMaterial(woodPalletMaterial);
+        addToScene(goldBarsModel, goldBarsMaterial, rm);
     }
 
     // Pallet 4
@@ -1675,87 +2357,53 @@ void Renderer::renderDecorations(Shader* shader)
     m = glm::translate(m, glm::vec3(-5.5f, floorY, -8.5f));
     m = glm::rotate(m, glm::radians(0.0f), glm::vec3(0,1,0));
     m = glm::rotate(m, glm::radians(-4.0f), glm::vec3(0,1,0));
-    renderModel(woodPalletModel, m, shader);
+    addToScene(woodPalletModel, woodPalletMaterial, m);
 
     // Metal parts
     {
-        setModelMaterial(metalPartsMaterial);
         glm::mat4 rm = m;
         rm = glm::translate(rm, glm::vec3(0.0f, 0.3f, 0.0f));
-        renderModel(metalPartsModel, rm, shader);
-        setModelMaterial(woodPalletMaterial);
+        addToScene(metalPartsModel, metalPartsMaterial, rm);
     }
 
     // Pallet 5
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-8.0f, floorY, -8.0f)); 
     m = glm::rotate(m, glm::radians(45.0f), glm::vec3(0,1,0)); 
-    renderModel(woodPalletModel, m, shader);
+    addToScene(woodPalletModel, woodPalletMaterial, m);
 
     // Textiles
     {
-        setModelMaterial(textilesMaterial);
         glm::mat4 rm = m;
         rm = glm::translate(rm, glm::vec3(0.0f, 0.3f, 0.0f));
-        renderModel(textilesModel, rm, shader);
-        setModelMaterial(woodPalletMaterial);
+        addToScene(textilesModel, textilesMaterial, rm);
     }
 
 
 
     // Second Floor
     float floor2Y = 3.1f; 
-   
+
     // Bed
-    setModelMaterial(bedMaterial);
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-0.1f, floor2Y, 4.0f));
-    renderModel(bedModel, m, shader);
+    addToScene(bedModel, bedMaterial, m);
 
     // Chest with money
-    setModelMaterial(chestMaterial);
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-0.1f, floor2Y, 6.5f)); 
     m = glm::rotate(m, glm::radians(180.0f), glm::vec3(0,1,0)); 
-    renderModel(chestGoldModel, m, shader);
+    addToScene(chestGoldModel, chestMaterial, m);
 
     // Banner
-    setModelMaterial(bannerMaterial);
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(4.0f, floor2Y, 2.1f)); 
-    renderModel(bannerModel, m, shader);
-    
+    addToScene(bannerModel, bannerMaterial, m);
+
     // Stool
-    setModelMaterial(stoolMaterial);
     m = glm::mat4(1.0f);
     m = glm::translate(m, glm::vec3(-0.5f, floor2Y, 9.0f));
-    renderModel(stoolModel, m, shader);
-}
-
-// This function sets the model matrix and texture uniforms before the draw command and also collects basic rendering statistics (draw-call count, vertices).
-void Renderer::renderModel(const std::unique_ptr<Model>& model, const glm::mat4& modelMatrix, Shader* shader)
-{
-    if (!model || !shader) return;
-    
-    // Set model matrix on the target shader
-    shader->setMat4("model", modelMatrix);
-
-    // Handle texture binding.
-    // If the model has a diffuse texture, we bind it to TU0.
-    bool hasTexture = model->hasTexture();
-    shader->setBool("hasTexture", hasTexture);
-    
-    if (hasTexture) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, model->getDiffuseTexture());
-        shader->setInt("texture_diffuse1", 0);
-    }
-    
-    model->draw();
-    
-    // Stats for the performance overlay
-    stats.drawCalls++;
-    stats.vertexCount += model->getVertexCount();
+    addToScene(stoolModel, stoolMaterial, m);
 }
 
 // This associates each material to a name for the GUI.
@@ -1850,6 +2498,7 @@ void Renderer::resetParamsToDefaults() {
     resetMat(textilesMaterial);
     
     initializeModelMaterials();
+    markAllMaterialsDirty();
 }
 
 // Initialize scene lights (sun, moon, torches)
@@ -1920,10 +2569,8 @@ void Renderer::updateLights(float deltaTime)
     static float totalTime = 0.0f;
     totalTime += deltaTime;
     
-    auto& lights = lightManager->getLightsReference();
-    
     // Update Sun and Moon (0 and 1)
-    if (lights.size() >= 2) {
+    if (lightManager->getLightCount() >= 2) {
         float cycleSpeed = 0.01f;
         float rawTime = totalTime * cycleSpeed;
         float progress = rawTime - floor(rawTime);
@@ -1934,7 +2581,7 @@ void Renderer::updateLights(float deltaTime)
         float sinTilt = sin(tilt);
 
         // Update light state based on its active window
-        auto updateCelestia = [&](Light& light, float t, float startT, float endT, float maxI, float minI) {
+        auto updateCelestia = [&](size_t lightIndex, float t, float startT, float endT, float maxI, float minI) {
             float windowSize = endT - startT;
             
             // Handle wrapping logic if light spans across 1.0 -> 0.0 boundary
@@ -1957,69 +2604,98 @@ void Renderer::updateLights(float deltaTime)
 
                 // Direction is opposite to position
                 glm::vec3 dir(-worldX, -worldY, -worldZ);
-                light.direction = glm::normalize(dir);
+                lightManager->setDirection(lightIndex, glm::normalize(dir));
                 
                 // Intensity changes using Y
                 float ramp = glm::smoothstep(0.0f, 0.2f, worldY);
-                light.intensity = glm::mix(minI, maxI, ramp);
+                lightManager->setIntensity(lightIndex, glm::mix(minI, maxI, ramp));
             } else {
                 // Inactive
-                light.intensity = 0.0f;
-                light.direction = glm::normalize(glm::vec3(-1.0f, 0.0f, 0.0f)); 
+                lightManager->setIntensity(lightIndex, 0.0f);
+                lightManager->setDirection(lightIndex, glm::normalize(glm::vec3(-1.0f, 0.0f, 0.0f)));
             }
+            
+            // Disable shadow casting for lights that are off/too dim.
+            lightManager->setCastShadows(lightIndex, lightManager->getIntensity(lightIndex) > 0.001f);
         };
 
         // Sun: Active from 0.0 to 0.55 (Day)
-        updateCelestia(lights[0], progress, 0.0f, 0.55f, 1.0f, 0.0f);
+        updateCelestia(0, progress, 0.0f, 0.55f, 1.0f, 0.0f);
         
         // Moon: Active from 0.50 to 1.05 (Night) - Overlaps slightly with sun for dusk/dawn
-        updateCelestia(lights[1], progress, 0.50f, 1.05f, 0.5f, 0.0f);
-
-        // Disable shadow casting for lights that are off/too dim.
-        // Sun (Index 0)
-        lights[0].castShadows = (lights[0].intensity > 0.001f);
-
-        // Moon (Index 1)
-        lights[1].castShadows = (lights[1].intensity > 0.001f);
+        updateCelestia(1, progress, 0.50f, 1.05f, 0.5f, 0.0f);
     }
 
     // Flicker Logic for Torches
-    for (auto& light : lights) {
-        if (light.flicker) {
-             // Unique offset based on position to de-sync lights
-             float seed = light.position.x * 12.9898f + light.position.y * 78.233f + light.position.z * 43.123f;
-             float timeOffset = totalTime + (float)((int)seed % 100) / 10.0f; // Simple pseudo-random offset
-             
-             // Noise with sin
-             float noise = (sin(timeOffset * 3.0f) + sin(timeOffset * 5.3f + 1.2f) + sin(timeOffset * 7.7f + 3.5f)) * 0.33f; // -1 to 1 approx
-             
-             // Intensity changes +/- 8%
-             light.intensity = light.baseIntensity * (1.0f + noise * 0.08f);
-             
-             // Color changes
-             glm::vec3 colorOffset = glm::vec3(noise * 0.03f, noise * 0.01f, 0.0f);
-             light.color = glm::clamp(light.baseColor + colorOffset, 0.0f, 1.0f);
-        }
+    lightManager->updateFlicker(totalTime);
+}
+
+// Converts the GUI-facing material to the std430 layout of materials[].
+GPUMaterial Renderer::packMaterial(const ModelMaterial& material)
+{
+    GPUMaterial gpu{};
+    gpu.albedo = material.params.albedo;
+    gpu.roughness = material.params.roughness;
+    gpu.specularShininess = material.params.specularShininess;
+    gpu.materialType = static_cast<int32_t>(material.model);
+    gpu.minnaertK = material.params.minnaertK;
+    gpu.orenNayarRoughness = material.params.orenNayarRoughness;
+    gpu.ashikhminShirleyNu = material.params.ashikhminShirleyNu;
+    gpu.ashikhminShirleyNv = material.params.ashikhminShirleyNv;
+    gpu.cookTorranceRoughness = material.params.cookTorranceRoughness;
+    gpu.cookTorranceF0 = material.params.cookTorranceF0;
+    gpu.intensityCorrection = material.params.intensityCorrection;
+    gpu.ambientOcclusion = 1.0f; // Placeholder for AO texture that I will implement later
+    return gpu;
+}
+
+void Renderer::markMaterialDirty(const ModelMaterial& material)
+{
+    for (size_t i = 0; i < sceneMaterials.size(); ++i) {
+        if (sceneMaterials[i] == &material) materialDirty[i] = true;
     }
 }
 
-// Uploads the parameters to the GPU.
-// Used by geometryPass to set material uniforms before drawing.
-void Renderer::setModelMaterial(const ModelMaterial& material)
+void Renderer::markAllMaterialsDirty()
 {
-    if (geometryShader) {
-        geometryShader->setVec3("albedo", material.params.albedo);
-        geometryShader->setFloat("roughness", material.params.roughness);
-        geometryShader->setFloat("specularShininess", material.params.specularShininess);
-        geometryShader->setInt("materialType", static_cast<int>(material.model));
-        geometryShader->setFloat("minnaertK", material.params.minnaertK);
-        geometryShader->setFloat("orenNayarRoughness", material.params.orenNayarRoughness);
-        geometryShader->setFloat("ashikhminShirleyNu", material.params.ashikhminShirleyNu);
-        geometryShader->setFloat("ashikhminShirleyNv", material.params.ashikhminShirleyNv);
-        geometryShader->setFloat("cookTorranceRoughness", material.params.cookTorranceRoughness);
-        geometryShader->setFloat("cookTorranceF0", material.params.cookTorranceF0);
-        geometryShader->setFloat("intensityCorrection", material.params.intensityCorrection);
-        geometryShader->setFloat("ambientOcclusion", 1.0f); // Placeholder for AO texture that I will implement later
+    materialDirty.assign(sceneMaterials.size(), true);
+}
+
+// Uploads the scene materials marked dirty, each contiguous run with one write; most frames nothing.
+// The shader picks its entry through the per-instance material id.
+void Renderer::updateMaterialBuffer()
+{
+    if (!materialBuffer || sceneMaterials.empty()) return;
+
+    GLsizeiptr size = static_cast<GLsizeiptr>(sceneMaterials.size() * sizeof(GPUMaterial));
+    if (size != materialBuffer->getSize()) {
+        // The compact layout stores the material index in 8 bits of the base color target.
+        if (gBuffer->isCompact() && sceneMaterials.size() > 256) {
+            std::cerr << "Compact G-Buffer can address 256 materials, scene has " << sceneMaterials.size()
+                      << "; materials past index 255 will shade with the wrong parameters" << std::endl;
+        }
+
+        materialData.resize(sceneMaterials.size());
+        for (size_t i = 0; i < sceneMaterials.size(); ++i) {
+            materialData[i] = packMaterial(*sceneMaterials[i]);
+        }
+        materialBuffer->allocate(size, materialData.data());
+        materialDirty.assign(sceneMaterials.size(), false);
+        return;
+    }
+
+    for (size_t first = 0; first < materialDirty.size(); ++first) {
+        if (!materialDirty[first]) continue;
+
+        size_t end = first;
+        while (end < materialDirty.size() && materialDirty[end]) {
+            materialData[end] = packMaterial(*sceneMaterials[end]);
+            materialDirty[end] = false;
+            ++end;
+        }
+        materialBuffer->update(&materialData[first], static_cast<GLsizeiptr>((end - first) * sizeof(GPUMaterial)),
+                               static_cast<GLintptr>(first * sizeof(GPUMaterial)));
+        first = end;
     }
 }
 
@@ -2122,6 +2798,16 @@ void Renderer::savePreset(int index) {
     shadowJson["shadowPCFSamples"] = shadowParams.shadowPCFSamples;
     shadowJson["shadowIntensity"] = shadowParams.shadowIntensity;
     shadowJson["enablePCF"] = shadowParams.enablePCF;
+    shadowJson["shadowFilter"] = static_cast<int>(shadowParams.shadowFilter);
+    shadowJson["poissonTaps"] = shadowParams.poissonTaps;
+    shadowJson["layeredPointShadows"] = shadowParams.layeredPointShadows;
+    shadowJson["positionTolerance"] = shadowParams.positionTolerance;
+    shadowJson["directionTolerance"] = shadowParams.directionTolerance;
+    shadowJson["maxShadowUpdatesPerFrame"] = shadowParams.maxShadowUpdatesPerFrame;
+    shadowJson["cascadeMapSize"] = shadowParams.cascadeMapSize;
+    shadowJson["cascadeCount"] = shadowParams.cascadeCount;
+    shadowJson["cascadeDistance"] = shadowParams.cascadeDistance;
+    shadowJson["cascadeSplitLambda"] = shadowParams.cascadeSplitLambda;
     // Save shadow params
     root["shadowParams"] = shadowJson;
 
@@ -2226,6 +2912,16 @@ void Renderer::loadPreset(int index) {
             if(sj.contains("shadowPCFSamples")) shadowParams.shadowPCFSamples = sj["shadowPCFSamples"];
             if(sj.contains("shadowIntensity")) shadowParams.shadowIntensity = sj["shadowIntensity"];
             if(sj.contains("enablePCF")) shadowParams.enablePCF = sj["enablePCF"];
+            if(sj.contains("shadowFilter")) shadowParams.shadowFilter = static_cast<ShadowFilter>(sj["shadowFilter"].get<int>());
+            if(sj.contains("poissonTaps")) shadowParams.poissonTaps = sj["poissonTaps"];
+            if(sj.contains("layeredPointShadows")) shadowParams.layeredPointShadows = sj["layeredPointShadows"];
+            if(sj.contains("positionTolerance")) shadowParams.positionTolerance = sj["positionTolerance"];
+            if(sj.contains("directionTolerance")) shadowParams.directionTolerance = sj["directionTolerance"];
+            if(sj.contains("maxShadowUpdatesPerFrame")) shadowParams.maxShadowUpdatesPerFrame = sj["maxShadowUpdatesPerFrame"];
+            if(sj.contains("cascadeMapSize")) shadowParams.cascadeMapSize = sj["cascadeMapSize"];
+            if(sj.contains("cascadeCount")) shadowParams.cascadeCount = sj["cascadeCount"];
+            if(sj.contains("cascadeDistance")) shadowParams.cascadeDistance = sj["cascadeDistance"];
+            if(sj.contains("cascadeSplitLambda")) shadowParams.cascadeSplitLambda = sj["cascadeSplitLambda"];
         }
 
         // 5. Per-Model Materials
@@ -2263,6 +2959,7 @@ void Renderer::loadPreset(int index) {
             loadModelMat("goldBars", goldBarsMaterial);
             loadModelMat("metalParts", metalPartsMaterial);
             loadModelMat("textiles", textilesMaterial);
+            markAllMaterialsDirty();
         }
 
         std::cout << "Loaded preset from " << filename << std::endl;
@@ -2275,37 +2972,12 @@ void Renderer::loadPreset(int index) {
 // Called by destructor.
 void Renderer::cleanup()
 {
-    // Clean up shadow maps
-    for (auto& shadowData : shadowMaps) {
-        cleanupShadowMap(shadowData);
-    }
-    
-    if (lightingFBO) glDeleteFramebuffers(1, &lightingFBO);
-    if (lightingTexture) glDeleteTextures(1, &lightingTexture);
-    if (edgeFBO) glDeleteFramebuffers(1, &edgeFBO);
-    if (edgeTexture) glDeleteTextures(1, &edgeTexture);
+    // Workers write into the models, so they stop before anything else goes away.
+    assetLoader.reset();
+    frameGraph.reset();
     if (quadVAO) glDeleteVertexArrays(1, &quadVAO);
     if (quadVBO) glDeleteBuffers(1, &quadVBO);
-}
-
-// Frees the FBO and Textures associated with a shadow map.
-// Resets the struct state.
-void Renderer::cleanupShadowMap(ShadowMapData& shadowData)
-{
-    if (shadowData.FBO) {
-        glDeleteFramebuffers(1, &shadowData.FBO);
-        shadowData.FBO = 0;
-    }
-    if (shadowData.depthMap) {
-        glDeleteTextures(1, &shadowData.depthMap);
-        shadowData.depthMap = 0;
-    }
-    if (shadowData.depthCubemap) {
-        glDeleteTextures(1, &shadowData.depthCubemap);
-        shadowData.depthCubemap = 0;
-    }
-    shadowData.isActive = false;
-    shadowData.hasRendered = false;
+    if (indirectBuffer) glDeleteBuffers(1, &indirectBuffer);
 }
 
 // Helper to compute the logical view-projection matrix for a light source.
@@ -2343,15 +3015,43 @@ glm::mat4 Renderer::calculateLightSpaceMatrix(const Light& light) const
     return lightProjection * lightView;
 }
 
+void Renderer::CrazyTorchParams::clear()
+{
+    lightIndex.clear();
+    speed.clear();
+    radius.clear();
+    angle.clear();
+    centerOffset.clear();
+    color.clear();
+}
+
+void Renderer::CrazyTorchParams::add(uint32_t light, float torchSpeed, float torchRadius, float torchAngle,
+                                     const glm::vec3& torchCenterOffset, const glm::vec3& torchColor)
+{
+    lightIndex.push_back(light);
+    speed.push_back(torchSpeed);
+    radius.push_back(torchRadius);
+    angle.push_back(torchAngle);
+    centerOffset.push_back(torchCenterOffset);
+    color.push_back(torchColor);
+}
+
 void Renderer::setCrazyMode(bool enable)
 {
     isCrazyMode = enable;
     
+    // Restore original positions and colors (and drop the extra torches of a previous run)
+    crazyTorchParams.clear();
+    initializeLights();
+    
     if (isCrazyMode) {
-        // Initialize Crazy Parameters
-        crazyTorchParams.clear();
+        // Extra orbiting torches: plain point lights without shadows, so they only cost lighting.
+        for (int i = 0; i < crazyExtraTorches; ++i) {
+            Light torch = Light::createPointLight(glm::vec3(0.0f, 1.9f, 0.0f), glm::vec3(1.0f, 0.6f, 0.2f), 1.0f);
+            torch.castShadows = false;
+            lightManager->addLight(torch);
+        }
         
-        auto& lights = lightManager->getLightsReference();
         int colorIndex = 0;
         
         // Colors: Cyan, Magenta, Yellow, Green
@@ -2370,32 +3070,28 @@ void Renderer::setCrazyMode(bool enable)
         std::uniform_real_distribution<float> disAngle(0.0f, 6.28f);
         std::uniform_real_distribution<float> disOffset(-0.5f, 0.5f);
         
-        for (size_t i = 0; i < lights.size(); ++i) {
-            if (lights[i].type == LightType::POINT && lights[i].position.y < 4.0f) {
-                
-                CrazyTorchParams params;
-                params.lightIndex = i;
-                params.speed = disSpeed(gen) * (std::rand() % 2 == 0 ? 1.0f : -1.0f); // Random direction
-                params.radius = disRadius(gen);
-                params.angle = disAngle(gen);
-                params.centerOffset = glm::vec3(disOffset(gen), 0.0f, disOffset(gen)); // +/- 0.5 offset from center 0,0
-                params.color = colors[colorIndex % colors.size()];
-                
-                crazyTorchParams.push_back(params);
+        for (uint32_t i = 0; i < lightManager->getLightCount(); ++i) {
+            if (lightManager->getType(i) == LightType::POINT && lightManager->getPosition(i).y < 4.0f) {
+                glm::vec3 color = colors[colorIndex % colors.size()];
+                crazyTorchParams.add(i,
+                                     disSpeed(gen) * (std::rand() % 2 == 0 ? 1.0f : -1.0f), // Random direction
+                                     disRadius(gen),
+                                     disAngle(gen),
+                                     glm::vec3(disOffset(gen), 0.0f, disOffset(gen)), // +/- 0.5 offset from center 0,0
+                                     color);
                 
                 // Set initial crazy state
-                lights[i].isStatic = false; // Must be dynamic now
-                lights[i].color = params.color;
+                lightManager->setStatic(i, false); // Must be dynamic now
+                lightManager->setFlicker(i, false);
+                lightManager->setColor(i, color);
                 
                 colorIndex++;
             }
         }
-        
-    } else {
-        // Reset Logic
-        crazyTorchParams.clear();
-        initializeLights(); // Restore original positions and colors
     }
+
+    // Static torches are hidden while crazy mode is on.
+    buildScene();
 }
 
 void Renderer::updateCrazyTorches(float deltaTime)
@@ -2403,33 +3099,32 @@ void Renderer::updateCrazyTorches(float deltaTime)
     if (!isCrazyMode) return;
     
     crazyModeTime += deltaTime;
-
-    auto& lights = lightManager->getLightsReference();
     
-    for (auto& params : crazyTorchParams) {
-        if (params.lightIndex >= lights.size()) continue;
-        
-        auto& light = lights[params.lightIndex];
-        
-        // precise rotation based on accumulated frames in params
-        params.angle += params.speed * deltaTime;
-        
-        // Circle around (0,0) + offset
-        float x = cos(params.angle) * params.radius + params.centerOffset.x;
-        float z = sin(params.angle) * params.radius + params.centerOffset.z;
-        float y = 1.9f; 
-        
-        light.position = glm::vec3(x, y, z);
-        
-        light.flicker = false;
-        
-        // Time based flickering (0.5 to 2.5)
-        float t = crazyModeTime;
-        float offset = (float)params.lightIndex;
+    // One pass per property over the parameter arrays, then a single batched write into the LightManager.
+    CrazyTorchParams& params = crazyTorchParams;
+    size_t count = params.size();
+    params.positions.resize(count);
+    params.intensities.resize(count);
+    
+    // precise rotation based on accumulated frames in params
+    for (size_t k = 0; k < count; ++k) {
+        params.angle[k] += params.speed[k] * deltaTime;
+    }
+    
+    // Circle around (0,0) + offset
+    for (size_t k = 0; k < count; ++k) {
+        float x = cos(params.angle[k]) * params.radius[k] + params.centerOffset[k].x;
+        float z = sin(params.angle[k]) * params.radius[k] + params.centerOffset[k].z;
+        params.positions[k] = glm::vec3(x, 1.9f, z);
+    }
+    
+    // Time based flickering (0.5 to 2.5)
+    float t = crazyModeTime;
+    for (size_t k = 0; k < count; ++k) {
+        float offset = static_cast<float>(params.lightIndex[k]);
         float noise = sin(t * 10.0f + offset) + sin(t * 23.0f + offset * 2.0f) * 0.5f + sin(t * 5.0f + offset * 0.5f) * 0.25f;
-        
-        light.intensity = glm::clamp(1.5f + (noise * 0.6f), 0.5f, 2.5f);
-        
-        light.color = params.color;
+        params.intensities[k] = glm::clamp(1.5f + (noise * 0.6f), 0.5f, 2.5f);
     }
+    
+    lightManager->setPositionsAndIntensities(params.lightIndex, params.positions, params.intensities);
 }
@@ -9,9 +9,26 @@
 #include <nlohmann/json.hpp>
 #include "GBuffer.h"
 #include "Shader.h"
+#include "ShaderVariants.h"
+#include "UniformBuffer.h"
+#include "ShaderStorageBuffer.h"
+#include "GeometryPool.h"
+#include "AssetLoader.h"
+#include "TextureCache.h"
+#include "UniformBlocks.h"
 #include "Model.h"
+#include "Scene.h"
+#include "Frustum.h"
+#include "ShadowAtlas.h"
+#include "OcclusionCuller.h"
+#include "FrameGraph.h"
+#include "GpuTimer.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+#include "DynamicResolution.h"
 #include "../camera/Camera.h"
 #include "../lighting/LightManager.h"
+#include "../utils/JobSystem.h"
 
 using json = nlohmann::json;
 
@@ -32,10 +49,16 @@ enum class EdgeDetectionType {
     LAPLACIAN = 16    
 };
 
+// Soft shadow kernels (with PCF enabled). Every tap is a hardware-filtered depth compare.
+enum class ShadowFilter {
+    GRID,    // (shadowPCFSamples + 1)^2 taps two texels apart, as smooth as the old (2n + 1)^2 texel box
+    POISSON  // poissonTaps taps on a disk of shadowPCFSamples texels, rotated per pixel
+};
+
 class Renderer
 {
 public:
-    Renderer(unsigned int width, unsigned int height);
+    Renderer(unsigned int width, unsigned int height, GBufferLayout gBufferLayout = GBufferLayout::STANDARD);
     ~Renderer();
 
     void render(const Camera& camera, float deltaTime);
@@ -57,10 +80,72 @@ public:
     struct Stats {
         unsigned int drawCalls = 0;
         unsigned int vertexCount = 0;
+        unsigned int triangleCount = 0;     // At the levels of detail drawn
+
+        // Frustum culling, camera pass and all shadow passes summed.
+        unsigned int visibleInstances = 0;
+        unsigned int culledInstances = 0;
+        unsigned int shadowVisibleInstances = 0;
+        unsigned int shadowCulledInstances = 0;
+
+        // Shadow maps drawn this frame, and out-of-date ones left for a later frame by the update budget.
+        unsigned int shadowMapUpdates = 0;
+        unsigned int shadowMapsDeferred = 0;
     };
     
     const Stats& getStats() const { return stats; }
-    void resetStats() { stats = {0, 0}; }
+    const GBuffer* getGBuffer() const { return gBuffer.get(); }
+    const FrameGraph* getFrameGraph() const { return frameGraph.get(); }
+    void resetStats() { stats = Stats(); }
+
+    // Internal resolution. The G-Buffer, lighting and edge targets stay allocated at the window size;
+    // a scale below 1 only shrinks the viewport they're drawn with, and compositePass upsamples to the screen.
+    struct DynamicResolutionParams {
+        bool enabled = false;          // Scale follows the GPU frame time, otherwise fixedScale is used
+        float targetFrameRate = 60.0f;
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        float fixedScale = 1.0f;
+        bool sharpenEdges = true;      // Edge-aware upsample keeping the outlines crisp, plain bilinear otherwise
+    } dynamicResolution;
+
+    // Level of detail per instance, from the projected size of its bounding sphere (diameter / screen height).
+    // LOD k starts below screenSize / 2^(k-1); a switch back to the finer level needs hysteresis more on top.
+    struct LodParams {
+        bool enabled = true;
+        float screenSize = 0.25f;
+        float hysteresis = 0.15f;
+        int shadowBias = 1;            // Shadow passes reuse the camera's choice, this many levels coarser
+    } lodParams;
+
+    // Budget for the tracked video memory (GpuMemoryReport::getTotalBytes()). Going over it logs a warning and,
+    // with autoDowngradeShadows, halves the largest shadow storage one step per frame until the total fits.
+    // Render targets always cover the window, so a lower render scale wouldn't free anything.
+    struct MemoryBudget {
+        bool enabled = false;
+        int budgetMB = 1024;
+        bool autoDowngradeShadows = false;
+    } memoryBudget;
+
+    // Allocations of the last frame per category, plus the driver's numbers where available.
+    const GpuMemoryReport& getMemoryReport() const { return memoryReport; }
+    bool isOverMemoryBudget() const { return overMemoryBudget; }
+
+    unsigned int getWidth() const { return width; }
+    unsigned int getHeight() const { return height; }
+    float getRenderScale() const { return renderScale; }
+    unsigned int getRenderWidth() const { return renderWidth; }
+    unsigned int getRenderHeight() const { return renderHeight; }
+    // Last GPU time of render(), in ms, a few frames old. 0 until the first measurement.
+    float getGpuFrameTime() const { return gpuFrameTime; }
+
+    // CPU/GPU time per pass. The caller brackets each frame (render() and the GUI) with beginFrame/endFrame.
+    Profiler& getProfiler() { return *profiler; }
+
+    // Models still streaming in (see AssetLoader). The scene renders meanwhile, with whatever has arrived.
+    bool isLoadingAssets() const { return assetLoader && !assetLoader->isIdle(); }
+    const AssetLoader* getAssetLoader() const { return assetLoader.get(); }
+    const TextureCache* getTextureCache() const { return textureCache.get(); }
 
     // Every parameter for the materials
     struct MaterialParams {
@@ -123,6 +208,11 @@ public:
     ModelMaterial crateMaterial = {{}, {}, "Crates"};
     ModelMaterial swordShieldMaterial = {{}, {}, "Sword & Shield"};
 
+    // The materials above are edited in place (GUI, presets). Whoever changes one marks it here, and only
+    // the marked entries of materials[] are uploaded before the next geometry pass.
+    void markMaterialDirty(const ModelMaterial& material);
+    void markAllMaterialsDirty();
+
     // Edge Detection
     struct EdgeParams {
         bool enableOutlining = true;
@@ -151,23 +241,78 @@ public:
         int shadowPCFSamples = 2;           
         float shadowIntensity = 0.7f;       
         bool enablePCF = true;              
+        ShadowFilter shadowFilter = ShadowFilter::POISSON;
+        int poissonTaps = 16;               // 8, 16 or 32
         float orthoSize = 20.0f;            
         float nearPlane = 0.5f;             
         float farPlane = 50.0f;             
+        bool layeredPointShadows = true;    // Per-face culling + gl_Layer from the VS instead of the geometry shader
+
+        // Cached maps are only redrawn once the light moved or turned past these, or the scene changed.
+        float positionTolerance = 0.01f;    // World units
+        float directionTolerance = 0.005f;  // Radians, the sun needs a few frames to turn this far
+        int maxShadowUpdatesPerFrame = 2;   // Out-of-date maps refreshed per frame, oldest first. 0 = no limit
+
+        // Directional lights: the view up to cascadeDistance is split into cascadeCount cascades.
+        int cascadeMapSize = 1024;          // Per cascade
+        int cascadeCount = 4;               // 1..SHADOW_CASCADE_COUNT
+        float cascadeDistance = 40.0f;
+        float cascadeSplitLambda = 0.75f;   // 0 = uniform splits, 1 = logarithmic
     } shadowParams;
 
+    // False when the driver lacks vertex shader layer output (or the layered program didn't link);
+    // point shadows then always use the geometry shader.
+    bool supportsLayeredPointShadows() const { return pointShadowLayeredShader && pointShadowLayeredShader->isLinked(); }
+
+    // With GL_ARB_bindless_texture (and GL_NV_gpu_shader5, for non-uniform handles) the diffuse textures are resident handles in the model buffer and the geometry
+    // pass is a single multi-draw instead of one per texture. Decided at startup: the handles and the geometry
+    // program depend on it.
+    bool usesBindlessTextures() const { return bindlessTextures; }
+
+    // Submit the scene with glMultiDrawElementsIndirect (one call per diffuse texture / shadow pass).
+    // When off, every mesh of every batch is a separate instanced draw from the same pool, handy for comparisons.
+    bool useIndirectDraws = true;
+
+    // Recompile a program when one of its files (includes too) is saved, a broken edit keeps the old one.
+    bool enableShaderHotReload = true;
+
+    // Test every instance against the camera frustum / light volume before it's submitted.
+    bool enableFrustumCulling = true;
+
+    // Draw the geometry pass in two halves with a Hi-Z test in between, skipping hidden instances on the GPU.
+    // Needs useIndirectDraws (the instance counts are written into the indirect commands).
+    bool enableOcclusionCulling = true;
+
+    // Bin the lights into screen tiles with a compute pass, so each pixel only shades the lights reaching it.
+    bool enableLightCulling = true;
+
+    // Lighting, edge detection and composite in one compute dispatch that writes the final image.
+    // Off runs them as three fullscreen passes, whose lighting/edge targets are easier to inspect in a debugger.
+    bool useFusedLighting = true;
+
     // Crazy Mode
     bool isCrazyMode = false;
     
+    int crazyExtraTorches = 0; // Orbiting point lights on top of the wall torches, applied on the next toggle
+
+    // Orbit parameters of the crazy torches, one array per property (index k is torch k).
     struct CrazyTorchParams {
-        float speed;
-        float radius;
-        float angle;
-        glm::vec3 centerOffset;
-        glm::vec3 color;
-        size_t lightIndex;
+        std::vector<uint32_t> lightIndex;
+        std::vector<float> speed;
+        std::vector<float> radius;
+        std::vector<float> angle;
+        std::vector<glm::vec3> centerOffset;
+        std::vector<glm::vec3> color;
+        // Scratch for LightManager::setPositionsAndIntensities()
+        std::vector<glm::vec3> positions;
+        std::vector<float> intensities;
+
+        size_t size() const { return lightIndex.size(); }
+        void clear();
+        void add(uint32_t light, float torchSpeed, float torchRadius, float torchAngle,
+                 const glm::vec3& torchCenterOffset, const glm::vec3& torchColor);
     };
-    std::vector<CrazyTorchParams> crazyTorchParams;
+    CrazyTorchParams crazyTorchParams;
     
     void setCrazyMode(bool enable);
     void updateCrazyTorches(float deltaTime);
@@ -179,37 +324,163 @@ public:
 private:
     unsigned int width, height;
     std::unique_ptr<GBuffer> gBuffer;
+
+    // Dynamic resolution state, see DynamicResolutionParams.
+    unsigned int renderWidth, renderHeight; // Viewport of every pass before compositing
+    float renderScale;
+    float gpuFrameTime;
+    std::unique_ptr<GpuFrameTimer> gpuFrameTimer;
+    std::unique_ptr<Profiler> profiler;
+    DynamicResolutionController resolutionController;
+    void updateRenderScale();
     std::unique_ptr<LightManager> lightManager;
 
-    // Shadow map data structure for each light
+    // Shadow state of each light (indexed like the LightManager's lights).
+    // The depth itself lives in shadowAtlas (directional/spot) or shadowCubeArray (point).
     struct ShadowMapData {
-        unsigned int FBO = 0;
-        unsigned int depthMap = 0;        // For directional/spot lights
-        unsigned int depthCubemap = 0;     // For point lights
-        glm::mat4 lightSpaceMatrix;       // For directional/spot
+        glm::mat4 lightSpaceMatrix = glm::mat4(1.0f); // For spot lights
         std::array<glm::mat4, 6> shadowTransforms; // For point lights (6 cube faces)
-        bool isActive = false;
-        LightType type;
-        int size = 0;
-        bool hasRendered = false; // For static lights
+        std::array<glm::mat4, SHADOW_CASCADE_COUNT> cascadeMatrices; // For directional lights
+        ShadowSlot slot;          // Atlas tile or cube, kept across frames while nobody else needs it
+        bool isActive = false;    // Casts shadows and got a slot this frame
+        LightType type = LightType::POINT;
+        float priority = 0.0f;    // Higher gets the better tier, see computeShadowPriority()
+        bool hasRendered = false; // Slot holds this light's depth, cleared whenever the slot changes
+
+        // State the map was rendered with, compared against every frame to tell if it's out of date.
+        glm::vec3 renderedPosition = glm::vec3(0.0f);
+        glm::vec3 renderedDirection = glm::vec3(0.0f);
+        float renderedCutOff = 0.0f;
+        uint64_t renderedSceneRevision = 0;
+        uint64_t renderedTransformRevision = 0; // LightManager::getTransformRevision() when drawn
+        uint64_t lastUpdateFrame = 0;
+        bool gpuDirty = true;     // Slot or matrices changed since the light was last uploaded
     };
     
-    static const size_t MAX_SHADOW_CASTING_LIGHTS = 8;
     std::vector<ShadowMapData> shadowMaps;
+    std::unique_ptr<ShadowAtlas> shadowAtlas;         // Spot lights
+    std::unique_ptr<ShadowCubeArray> shadowCubeArray; // Point lights
+    std::unique_ptr<ShadowCascadeArray> shadowCascades; // Directional lights
+    uint64_t shadowFrame;                             // LRU clock of the shadow slots
+    glm::vec3 renderedShadowProjection;               // orthoSize/nearPlane/farPlane the cached maps were drawn with
+    std::vector<uint32_t> pendingShadowUpdates;       // Scratch list for shadowMapPass()
+
+    // Whether the cached map no longer matches the light/scene. Lights without a valid map always need one.
+    bool isShadowMapOutdated(size_t lightIndex, const Light& light, const ShadowMapData& shadowData) const;
+    void markShadowDataDirty(ShadowMapData& shadowData) { shadowData.gpuDirty = true; shadowDataDirty = true; }
+
+    // Split the camera view into cascades and fit a texel-snapped ortho projection around each one.
+    void computeShadowCascades(const glm::vec3& lightDir, std::array<glm::mat4, SHADOW_CASCADE_COUNT>& matrices) const;
+    int getCascadeCount() const;
 
     // Pipeline Shaders
     std::unique_ptr<Shader> geometryShader;       // Pass 1: Fill G-Buffer
     std::unique_ptr<Shader> shadowMapShader;      // Pass 0a: Depth map (Dir/Spot)
+    std::unique_ptr<Shader> shadowMapLayeredShader; // Pass 0a alt: every cascade of a directional light in one pass
     std::unique_ptr<Shader> pointShadowShader;    // Pass 0b: Cube depth map (Point)
-    std::unique_ptr<Shader> hybridCelShader;      // Pass 2: Lighting & Cel Shading
-    std::unique_ptr<Shader> edgeDetectionShader;  // Pass 3: Edge Filters
+    std::unique_ptr<Shader> pointShadowLayeredShader; // Pass 0b alt: same, layered from the VS, no geometry shader
+    std::unique_ptr<Shader> lightCullingShader;   // Pass 2a: Compute, per-tile light lists
+    std::unique_ptr<OcclusionCuller> occlusionCuller; // Pass 1 alt: compute culling against a Hi-Z of the G-Buffer depth
+    Shader* hybridCelShader = nullptr;            // Pass 2: Lighting & Cel Shading (current variant)
+    Shader* edgeDetectionShader = nullptr;        // Pass 3: Edge Filters (current variant)
     std::unique_ptr<Shader> compositeShader;      // Pass 4: Final Mix
+    Shader* fusedLightingShader = nullptr;        // Pass 2-4 alt: Compute, lighting + edges + mix per screen tile (current variant)
 
-    // Render targets result textures
-    unsigned int lightingFBO;
-    unsigned int lightingTexture;
-    unsigned int edgeFBO;
-    unsigned int edgeTexture;
+    // Permutations of the passes above, see selectShaderVariants().
+    std::unique_ptr<ShaderVariants> hybridCelVariants;
+    std::unique_ptr<ShaderVariants> edgeDetectionVariants;
+    std::unique_ptr<ShaderVariants> fusedLightingVariants;
+
+    // Pre-resolved uniform handles, resolved once in initializeShaders() so the per-frame code does no string work.
+    // Per-draw uniforms of the geometry pass (model matrices and materials come from the scene SSBOs).
+    struct ModelUniforms {
+        Uniform<bool> hasTexture;
+    };
+
+    struct ShadowPassUniforms {
+        Uniform<glm::mat4> lightSpaceMatrix;
+    };
+
+    struct CascadeShadowPassUniforms {
+        std::array<Uniform<glm::mat4>, SHADOW_CASCADE_COUNT> cascadeMatrices;
+        Uniform<int> layerBase;
+    };
+
+    struct PointShadowPassUniforms {
+        std::array<Uniform<glm::mat4>, 6> shadowMatrices;
+        Uniform<glm::vec3> lightPos;
+        Uniform<int> layerBase;
+    };
+
+    // Lights, shadow settings and camera come from LightBlock/FrameBlock, only the toon settings are plain uniforms.
+    struct LightingPassUniforms {
+        Uniform<int> diffuseQuantizationBands;
+        Uniform<float> specularThreshold1;
+        Uniform<float> specularThreshold2;
+        Uniform<int> globalMaterialType;
+        Uniform<bool> useLightTiles;
+    };
+
+    struct EdgeDetectionPassUniforms {
+        Uniform<float> depthThreshold;
+        Uniform<float> normalThreshold;
+        Uniform<float> sobelThreshold;
+        Uniform<float> colorThreshold;
+        Uniform<glm::vec3> edgeColor;
+        Uniform<glm::vec2> screenSize;
+        Uniform<float> depthExponent;
+        Uniform<float> normalSplit;
+        Uniform<float> sobelScale;
+        Uniform<float> smoothWidth;
+        Uniform<float> laplacianThreshold;
+        Uniform<float> laplacianScale;
+    };
+
+    struct CompositePassUniforms {
+        Uniform<bool> enableOutlining;
+        Uniform<glm::vec3> edgeColor;
+        Uniform<glm::vec2> uvScale;
+        Uniform<glm::vec2> uvMax;
+        Uniform<float> upscaleRatio;
+        Uniform<bool> sharpenEdges;
+    };
+
+    // The fused pass takes the uniforms of all three passes it replaces.
+    struct FusedLightingPassUniforms {
+        LightingPassUniforms lighting;
+        EdgeDetectionPassUniforms edges;
+        Uniform<bool> enableOutlining;
+        Uniform<bool> deferComposite;
+    };
+
+    ModelUniforms geometryModelUniforms;
+    ShadowPassUniforms shadowUniforms;
+    CascadeShadowPassUniforms cascadeShadowUniforms;
+    PointShadowPassUniforms pointShadowUniforms;
+    PointShadowPassUniforms pointShadowLayeredUniforms;
+    LightingPassUniforms lightingUniforms;
+    EdgeDetectionPassUniforms edgeUniforms;
+    CompositePassUniforms compositeUniforms;
+    FusedLightingPassUniforms fusedLightingUniforms;
+
+    // Texture units used by the lighting pass. Assigned once, only the bound textures change per frame.
+    // G-Buffer uses 0-3, then the atlas, one cube array per tier and the cascades, whatever the number of lights.
+    static const int SHADOW_ATLAS_TEXTURE_UNIT = 4;
+    static const int SHADOW_CUBE_ARRAY_TEXTURE_UNIT_BASE = 5;
+    static const int SHADOW_CASCADE_TEXTURE_UNIT = 8;
+    static const int GBUFFER_DEPTH_TEXTURE_UNIT = 9;
+
+    // Uniform buffers shared by all programs (see UniformBlocks.h for the layouts).
+    std::unique_ptr<UniformBuffer> frameBlock;   // binding 0: camera + shadow settings, written every frame
+    std::unique_ptr<UniformBuffer> lightBlock;   // binding 1: light count + cascade matrices, written on change
+    LightBlockData lightBlockData;
+    std::unique_ptr<ShaderStorageBuffer> lightBuffer; // binding 5: lights[], only changed lights are rewritten
+    std::vector<GPULight> gpuLights;             // CPU copy of lightBuffer
+    uint64_t uploadedLightRevision;              // LightManager revision currently in lightBuffer
+    bool shadowDataDirty;                        // Set when any ShadowMapData::gpuDirty is
+
+    // Lighting/edge/fused output targets, rebuilt every frame by renderScreenPasses().
+    std::unique_ptr<FrameGraph> frameGraph;
 
     // Quad for screen-space rendering
     unsigned int quadVAO, quadVBO;
@@ -250,25 +521,122 @@ private:
     std::unique_ptr<Model> crateStackModel;
     std::unique_ptr<Model> swordShieldModel;
 
+    // Shared by all models; entries are weak, the models own their textures.
+    std::unique_ptr<TextureCache> textureCache;
+    bool bindlessTextures = false;
+
+    GpuMemoryReport memoryReport;
+    bool overMemoryBudget = false;
+    // Declared after the models it fills in, so it is always destroyed first.
+    std::unique_ptr<AssetLoader> assetLoader;
+
+    // Flattened scene (see buildScene()). Ids in the instances index these tables.
+    std::unique_ptr<Scene> scene;
+    std::vector<Model*> sceneModels;
+    std::vector<const ModelMaterial*> sceneMaterials;
+    std::vector<SceneInstance> dynamicSceneInstances;
+
+    // Vertices/indices of every scene model, behind the one VAO all scene passes use.
+    std::unique_ptr<GeometryPool> geometryPool;
+
+    // materials[] for the geometry pass, one GPUMaterial per sceneMaterials entry.
+    std::unique_ptr<ShaderStorageBuffer> materialBuffer;
+    std::vector<GPUMaterial> materialData;
+    std::vector<bool> materialDirty;    // Parallel to sceneMaterials
+
+    // A contiguous run of indirect commands that goes out as one glMultiDrawElementsIndirect.
+    struct IndirectDrawGroup {
+        GLuint texture = 0;      // Diffuse texture bound to TU0, 0 for untextured models
+        GLuint firstCommand = 0;
+        GLsizei commandCount = 0;
+        unsigned int vertexCount = 0; // For the stats overlay
+        unsigned int triangleCount = 0;
+    };
+
+    // The instances of one view that survived culling and the commands drawing them. Filled by cullDrawList(),
+    // which only reads the scene and may run on the job system; uploaded and drawn by submitDrawList().
+    struct DrawList {
+        std::vector<uint32_t> visibleInstanceIds;
+        std::vector<DrawElementsIndirectCommand> indirectCommands;
+        std::vector<IndirectDrawGroup> drawGroups; // Grouped by diffuse texture in the geometry pass, a single group otherwise
+        unsigned int culled = 0;
+        bool groupByTexture = false;
+
+        // Scratch, kept for its capacity: survivors of every (batch, layer) pair, culled in parallel.
+        std::vector<std::vector<uint32_t>> itemVisible;
+        std::vector<std::vector<DrawElementsIndirectCommand>> groupCommands;
+    };
+
+    // Culling and draw list building for the camera and every shadow view.
+    std::unique_ptr<JobSystem> jobSystem;
+    DrawList cameraDrawList;         // Built while the shadow maps are drawn, see startCameraCulling()
+    JobSystem::JobGroup cameraCullJobs;
+    DrawList shadowDrawList;         // Rebuilt for every shadow view
+    std::vector<uint8_t> instanceLods; // Camera LOD per instance id, kept across frames for the hysteresis
+    std::unique_ptr<ShaderStorageBuffer> visibleInstanceBuffer;
+    GLuint indirectBuffer;
+
+    // Light bitmask per LIGHT_TILE_SIZE^2 screen tile, rewritten every frame by lightCullingPass().
+    std::unique_ptr<ShaderStorageBuffer> lightTileBuffer;
+    bool lightTilesValid; // False when the pass was skipped, the lighting pass then shades every light
+
+    glm::mat4 cameraViewProjection; // This frame's, for culling the geometry pass
+    glm::vec3 cameraPosition;       // This frame's, for shadow priorities
+    glm::mat4 cameraView;           // This frame's, with cameraFov and cameraAspect for fitting the cascades
+    float cameraFov;
+    float cameraAspect;
+
     int edgeDetectionFlags;
 
     // Initialization
     void initializeShaders();
-    void initializeRenderTargets();
+    void resolveUniforms();
+    void reloadShaders();
+    bool selectShaderVariants();
+    uint32_t getSceneMaterialTypes() const;
+    static ShaderDefines lightingDefines(uint32_t key);
+    static ShaderDefines edgeDetectionDefines(uint32_t key);
+    static LightingPassUniforms resolveLightingUniforms(const Shader& shader);
+    static EdgeDetectionPassUniforms resolveEdgeDetectionUniforms(const Shader& shader);
+    void setLightingSamplers(Shader& shader);
+    void initializeUniformBuffers();
+    void updateFrameBlock(const Camera& camera);
+    void updateLightBlock();
     void initializeShadowMapping();
     void initializeLights();
     void initializeQuad();
     void loadModels();
+    void streamAssets();
     void initializeModelMaterials();
     
     // Shadow pass
     void updateShadowMaps();
+    float computeShadowPriority(const Light& light) const;
+
+    // End of every frame: gathers memoryReport and applies memoryBudget.
+    void updateMemoryReport();
+    void enforceMemoryBudget();
     
     // Rendering stages
-    void renderScene(Shader* shader, const glm::mat4& viewProjection = glm::mat4(1.0f));
-    void renderDecorations(Shader* shader); 
-    void renderModel(const std::unique_ptr<Model>& model, const glm::mat4& modelMatrix, Shader* shader);
-    void setModelMaterial(const ModelMaterial& material);
+    void renderScene(Shader* shader, const Frustum& frustum = Frustum()) { renderScene(shader, &frustum, 1); }
+    // Layered variant: each instance is drawn once per layer frustum it intersects (layer = index in the array).
+    void renderScene(Shader* shader, const Frustum* layerFrusta, size_t layerCount);
+    static GPUMaterial packMaterial(const ModelMaterial& material);
+    void updateMaterialBuffer();
+    void cullDrawList(const Frustum* layerFrusta, size_t layerCount, bool groupByTexture, int lodBias, DrawList& list) const;
+    void updateInstanceLods();
+    void addDrawListStats(const DrawList& list);
+    void submitDrawList(const DrawList& list);
+    void issueDrawList(const DrawList& list, GLuint commandOffset);
+    void startCameraCulling();
+
+    // Scene building
+    void buildScene();
+    void buildDecorations();
+    void addToScene(const std::unique_ptr<Model>& model, const ModelMaterial& material, const glm::mat4& transform);
+    uint32_t getSceneModelId(Model* model);
+    uint32_t getSceneMaterialId(const ModelMaterial* material);
+    void updateDynamicInstances();
     
     void shadowMapPass();
     void renderShadowMapForLight(size_t lightIndex, const Light& light, ShadowMapData& shadowData);
@@ -277,13 +645,21 @@ private:
     void renderSpotShadow(const Light& light, ShadowMapData& shadowData);
     
     void geometryPass(const Camera& camera);  // Fill G-Buffer
-    void lightingPass(const Camera& camera);  // Calculate lighting
-    void edgeDetectionPass();                 // Draw outlines
-    void compositePass();                     // Combine layers
+    void occlusionGeometryPass();             // Same, two halves around the Hi-Z test
+    void lightCullingPass();                  // Bin lights into screen tiles
+    void renderScreenPasses();                // Light culling and 4-6 through the frame graph
+    void lightingPass(GLuint targetFramebuffer); // Calculate lighting
+    void edgeDetectionPass(GLuint targetFramebuffer, GLuint lightingTexture); // Draw outlines
+    // Combine layers, upsampling them to the screen. Edge strength is read from edgeMask's alpha.
+    void compositePass(unsigned int colorTexture, unsigned int edgeMask);
+    void fusedLightingPass(GLuint outputTexture); // Lighting + outlines + composite in one compute dispatch
+    void presentFusedOutput(GLuint outputTexture, GLuint outputFramebuffer);
+    void bindLightingTextures();              // G-Buffer and shadow maps, shared by the lighting passes
+    void setLightingUniforms(const LightingPassUniforms& u);
+    void setEdgeDetectionUniforms(const EdgeDetectionPassUniforms& u);
     void renderQuad();                        // Helper for screen-space effects
     
     void cleanup();
-    void cleanupShadowMap(ShadowMapData& shadowData);
     
     glm::mat4 calculateLightSpaceMatrix(const Light& light) const;
     
@@ -0,0 +1,213 @@
+#include "Scene.h"
+#include <algorithm>
+
+namespace {
+    // Zero bounds and no texture, every field set (GLM_FORCE_CTOR_INIT decides what glm zeroes by itself).
+    GPUModel emptyModel()
+    {
+        GPUModel model{};
+        model.positionMin = glm::vec4(0.0f);
+        model.positionExtent = glm::vec4(0.0f);
+        return model;
+    }
+}
+
+Scene::Scene()
+    : instanceBuffer(std::make_unique<ShaderStorageBuffer>(INSTANCE_BUFFER_BINDING)),
+      modelBuffer(std::make_unique<ShaderStorageBuffer>(MODEL_BUFFER_BINDING)), dynamicCapacity(0), revision(0)
+{
+}
+
+Scene::~Scene()
+{
+}
+
+void Scene::setModelBounds(uint32_t modelId, const BoundingBox& box, const BoundingSphere& sphere)
+{
+    if (modelId >= modelBounds.size()) {
+        modelBounds.resize(modelId + 1);
+    }
+    modelBounds[modelId].box = box;
+    modelBounds[modelId].sphere = sphere;
+
+    // A few dozen models, set once each as they arrive: a full upload is fine.
+    if (modelId >= modelData.size()) {
+        modelData.resize(modelId + 1, emptyModel());
+    }
+    if (box.isValid()) {
+        modelData[modelId].positionMin = glm::vec4(box.min, 0.0f);
+        modelData[modelId].positionExtent = glm::vec4(box.max - box.min, 0.0f);
+    }
+    uploadModels();
+}
+
+void Scene::setModelTexture(uint32_t modelId, uint64_t handle)
+{
+    if (modelId >= modelData.size()) {
+        if (handle == 0) return;
+        modelData.resize(modelId + 1, emptyModel());
+    }
+    uint32_t low = static_cast<uint32_t>(handle);
+    uint32_t high = static_cast<uint32_t>(handle >> 32);
+    GPUModel& model = modelData[modelId];
+    if (model.diffuseTexture[0] == low && model.diffuseTexture[1] == high) return;
+    model.diffuseTexture[0] = low;
+    model.diffuseTexture[1] = high;
+    uploadModels();
+}
+
+void Scene::uploadModels()
+{
+    GLsizeiptr size = static_cast<GLsizeiptr>(modelData.size() * sizeof(GPUModel));
+    if (size != modelBuffer->getSize()) {
+        modelBuffer->allocate(size, modelData.data());
+    } else {
+        modelBuffer->update(modelData.data(), size);
+    }
+}
+
+void Scene::refreshInstanceBounds()
+{
+    instanceBounds.resize(staticInstances.size() + dynamicInstances.size());
+    updateInstanceBounds(staticInstances, 0);
+    updateInstanceBounds(dynamicInstances, staticInstances.size());
+    ++revision;
+}
+
+void Scene::clear()
+{
+    staticInstances.clear();
+    batches.clear();
+    depthBatches.clear();
+    ++revision;
+}
+
+void Scene::addInstance(uint32_t modelId, uint32_t materialId, const glm::mat4& transform)
+{
+    staticInstances.push_back({ modelId, materialId, transform });
+}
+
+void Scene::build()
+{
+    buildBatches(staticInstances, 0, batches, depthBatches);
+
+    // Dynamic instances sit right after the static block, so their batch offsets move with it.
+    buildBatches(dynamicInstances, static_cast<uint32_t>(staticInstances.size()), dynamicBatches, dynamicDepthBatches);
+
+    instanceBounds.resize(staticInstances.size() + dynamicInstances.size());
+    updateInstanceBounds(staticInstances, 0);
+    updateInstanceBounds(dynamicInstances, staticInstances.size());
+
+    uploadAll();
+    ++revision;
+}
+
+void Scene::setDynamicInstances(const std::vector<SceneInstance>& instances)
+{
+    // Same objects in the same place: nothing to upload, and cached shadow maps stay valid.
+    if (sameInstances(instances, dynamicInstances)) return;
+
+    dynamicInstances = instances;
+    ++revision;
+    buildBatches(dynamicInstances, static_cast<uint32_t>(staticInstances.size()), dynamicBatches, dynamicDepthBatches);
+
+    instanceBounds.resize(staticInstances.size() + dynamicInstances.size());
+    updateInstanceBounds(dynamicInstances, staticInstances.size());
+
+    if (dynamicInstances.size() > dynamicCapacity) {
+        uploadAll();
+        return;
+    }
+
+    if (dynamicInstances.empty()) return;
+
+    std::vector<GPUInstance> data;
+    data.reserve(dynamicInstances.size());
+    for (const auto& instance : dynamicInstances) {
+        data.push_back(toGPUInstance(instance));
+    }
+
+    instanceBuffer->update(data.data(), data.size() * sizeof(GPUInstance), staticInstances.size() * sizeof(GPUInstance));
+}
+
+bool Scene::sameInstances(const std::vector<SceneInstance>& a, const std::vector<SceneInstance>& b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].modelId != b[i].modelId || a[i].materialId != b[i].materialId || a[i].transform != b[i].transform) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Scene::buildBatches(std::vector<SceneInstance>& instances, uint32_t baseOffset,
+                         std::vector<SceneBatch>& materialBatches, std::vector<SceneBatch>& modelBatches)
+{
+    materialBatches.clear();
+    modelBatches.clear();
+
+    // Model first (VAO/texture changes are the expensive part), material second.
+    // stable_sort keeps the authoring order inside a batch, which makes debugging easier.
+    std::stable_sort(instances.begin(), instances.end(), [](const SceneInstance& a, const SceneInstance& b) {
+        if (a.modelId != b.modelId) return a.modelId < b.modelId;
+        return a.materialId < b.materialId;
+    });
+
+    for (uint32_t i = 0; i < instances.size(); ++i) {
+        const auto& instance = instances[i];
+        uint32_t offset = baseOffset + i;
+
+        if (materialBatches.empty() || materialBatches.back().modelId != instance.modelId || materialBatches.back().materialId != instance.materialId) {
+            materialBatches.push_back({ instance.modelId, instance.materialId, offset, 0 });
+        }
+        materialBatches.back().instanceCount++;
+
+        if (modelBatches.empty() || modelBatches.back().modelId != instance.modelId) {
+            modelBatches.push_back({ instance.modelId, instance.materialId, offset, 0 });
+        }
+        modelBatches.back().instanceCount++;
+    }
+}
+
+// (Re)allocate the buffer with room for the static block plus some headroom for dynamic instances.
+void Scene::uploadAll()
+{
+    dynamicCapacity = std::max<size_t>(dynamicInstances.size() * 2, 16);
+
+    std::vector<GPUInstance> data;
+    data.reserve(staticInstances.size() + dynamicCapacity);
+    for (const auto& instance : staticInstances) {
+        data.push_back(toGPUInstance(instance));
+    }
+    for (const auto& instance : dynamicInstances) {
+        data.push_back(toGPUInstance(instance));
+    }
+    data.resize(staticInstances.size() + dynamicCapacity, GPUInstance{ glm::mat4(1.0f), 0, 0, {0, 0} });
+
+    instanceBuffer->allocate(data.size() * sizeof(GPUInstance), data.data());
+}
+
+void Scene::updateInstanceBounds(const std::vector<SceneInstance>& instances, size_t offset)
+{
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const auto& instance = instances[i];
+        InstanceBounds& bounds = instanceBounds[offset + i];
+
+        if (instance.modelId < modelBounds.size() && modelBounds[instance.modelId].box.isValid()) {
+            bounds.box = modelBounds[instance.modelId].box.transformed(instance.transform);
+            bounds.sphere = modelBounds[instance.modelId].sphere.transformed(instance.transform);
+        } else {
+            bounds = InstanceBounds(); // Invalid box: always visible
+        }
+    }
+}
+
+GPUInstance Scene::toGPUInstance(const SceneInstance& instance)
+{
+    GPUInstance gpu{};
+    gpu.model = instance.transform;
+    gpu.materialId = instance.materialId;
+    gpu.modelId = instance.modelId;
+    return gpu;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include "ShaderStorageBuffer.h"
+#include "UniformBlocks.h"
+#include "Bounds.h"
+
+// One placed object. Ids index into the Renderer's model/material tables.
+struct SceneInstance {
+    uint32_t modelId;
+    uint32_t materialId;
+    glm::mat4 transform;
+};
+
+// A run of instances sharing model (and material) that goes out as one instanced draw.
+struct SceneBatch {
+    uint32_t modelId;
+    uint32_t materialId;
+    uint32_t firstInstance; // Offset into the instance buffer (baseInstance of the draw)
+    uint32_t instanceCount;
+};
+
+// World-space bounds of one instance, for culling.
+struct InstanceBounds {
+    BoundingBox box;
+    BoundingSphere sphere;
+};
+
+// Flattened scene: built once at load time, sorted by model then material, with all transforms and
+// material ids in a single instance SSBO (InstanceBuffer, binding 0), read with gl_BaseInstance + gl_InstanceID.
+// Per-model data (models[], binding 4) is indexed by the model id stored in every instance.
+// The static part never changes after build(); the dynamic part (e.g. the crazy mode torches)
+// lives after it in the same buffer and is rewritten every frame.
+class Scene
+{
+public:
+    Scene();
+    ~Scene();
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    // Object-space bounds of a model; every instance of it gets them transformed. Ids without bounds are never culled.
+    // The box is also what the model's vertex positions were quantized against, it goes to the model buffer.
+    void setModelBounds(uint32_t modelId, const BoundingBox& box, const BoundingSphere& sphere);
+    // Bindless handle of the model's diffuse texture in the model buffer, 0 for none. Uploads only on a change.
+    void setModelTexture(uint32_t modelId, uint64_t handle);
+    // Instance and model buffers.
+    size_t getBufferMemoryBytes() const { return static_cast<size_t>(instanceBuffer->getSize() + modelBuffer->getSize()); }
+    // Re-transforms every instance's bounds after setModelBounds() on an already built scene (streamed-in models).
+    void refreshInstanceBounds();
+
+    // Static content
+    void clear();
+    void addInstance(uint32_t modelId, uint32_t materialId, const glm::mat4& transform);
+    void build(); // Sort, batch and upload. Call after the last addInstance().
+
+    // Dynamic content, replaced as a whole (cheap, only a handful of objects).
+    void setDynamicInstances(const std::vector<SceneInstance>& instances);
+
+    // Batches split by material, for the geometry pass.
+    const std::vector<SceneBatch>& getBatches() const { return batches; }
+    const std::vector<SceneBatch>& getDynamicBatches() const { return dynamicBatches; }
+
+    // Batches merged across materials, for depth-only passes that don't care about materials.
+    const std::vector<SceneBatch>& getDepthBatches() const { return depthBatches; }
+    const std::vector<SceneBatch>& getDynamicDepthBatches() const { return dynamicDepthBatches; }
+
+    // Indexed like the instance buffer (SceneBatch::firstInstance + i).
+    const InstanceBounds& getInstanceBounds(uint32_t instanceIndex) const { return instanceBounds[instanceIndex]; }
+
+    GLuint getInstanceBuffer() const { return instanceBuffer->getID(); }
+    size_t getStaticInstanceCount() const { return staticInstances.size(); }
+    size_t getDynamicInstanceCount() const { return dynamicInstances.size(); }
+
+    // Bumped whenever instances are added, removed or moved. Cached shadow maps compare against it.
+    uint64_t getRevision() const { return revision; }
+
+private:
+    std::vector<SceneInstance> staticInstances;
+    std::vector<SceneInstance> dynamicInstances;
+    std::vector<SceneBatch> batches;
+    std::vector<SceneBatch> depthBatches;
+    std::vector<SceneBatch> dynamicBatches;
+    std::vector<SceneBatch> dynamicDepthBatches;
+    std::vector<InstanceBounds> modelBounds;
+    std::vector<InstanceBounds> instanceBounds; // Static block then dynamic block
+
+    std::unique_ptr<ShaderStorageBuffer> instanceBuffer;
+    std::unique_ptr<ShaderStorageBuffer> modelBuffer;
+    std::vector<GPUModel> modelData;
+    size_t dynamicCapacity; // Instances reserved after the static block
+    uint64_t revision;
+
+    // Sorts instances and fills both batch lists. firstInstance values start at baseOffset.
+    static void buildBatches(std::vector<SceneInstance>& instances, uint32_t baseOffset,
+                             std::vector<SceneBatch>& materialBatches, std::vector<SceneBatch>& modelBatches);
+    static bool sameInstances(const std::vector<SceneInstance>& a, const std::vector<SceneInstance>& b);
+    void uploadAll();
+    void uploadModels();
+    void updateInstanceBounds(const std::vector<SceneInstance>& instances, size_t offset);
+    static GPUInstance toGPUInstance(const SceneInstance& instance);
+};
@@ -1,90 +1,214 @@
 #include "Shader.h"
+#include "ProgramCache.h"
+#include <algorithm>
+
+namespace {
+    const char* stageName(GLenum type)
+    {
+        switch (type) {
+        case GL_VERTEX_SHADER: return "VERTEX";
+        case GL_FRAGMENT_SHADER: return "FRAGMENT";
+        case GL_GEOMETRY_SHADER: return "GEOMETRY";
+        case GL_COMPUTE_SHADER: return "COMPUTE";
+        default: return "UNKNOWN";
+        }
+    }
+
+    // With KHR/ARB_parallel_shader_compile the driver compiles on its own threads and GL_COMPLETION_STATUS
+    // can be polled; without it a reload compiles inside the frame that notices the edit.
+    bool parallelCompileSupported()
+    {
+        static const bool supported = [] {
+            if (GLAD_GL_KHR_parallel_shader_compile) {
+                glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu); // Implementation maximum
+                return true;
+            }
+            if (GLAD_GL_ARB_parallel_shader_compile) {
+                glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+                return true;
+            }
+            return false;
+        }();
+        return supported;
+    }
+
+    std::filesystem::file_time_type writeTime(const std::string& path)
+    {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(path, error);
+        return error ? std::filesystem::file_time_type::min() : time;
+    }
+}
 
 // Constructor for Vertex + Fragment pipeline
-Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath)
+Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, const ShaderDefines& defines)
+    : Shader(std::vector<Stage>{ { GL_VERTEX_SHADER, vertexPath }, { GL_FRAGMENT_SHADER, fragmentPath } }, defines)
 {
-    // Retrieve the .vert/.frag
-    std::string vertexCode = loadShaderSource(vertexPath);
-    std::string fragmentCode = loadShaderSource(fragmentPath);
+}
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+// Constructor for pipeline with Geometry Shader
+Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath)
+    : Shader(std::vector<Stage>{ { GL_VERTEX_SHADER, vertexPath }, { GL_FRAGMENT_SHADER, fragmentPath },
+                                 { GL_GEOMETRY_SHADER, geometryPath } }, {})
+{
+}
 
-    unsigned int vertex, fragment;
+// Constructor for a compute program
+Shader::Shader(const std::string& computePath, const ShaderDefines& defines)
+    : Shader(std::vector<Stage>{ { GL_COMPUTE_SHADER, computePath } }, defines)
+{
+}
 
-    // Compile the shaders
-    
-    // Vertex
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+Shader::Shader(std::vector<Stage> programStages, ShaderDefines programDefines)
+    : ID(0), stages(std::move(programStages)), defines(std::move(programDefines)),
+      lastReloadCheck(std::chrono::steady_clock::now())
+{
+    // Every permutation gets its own cache file.
+    std::string key;
+    for (const auto& stage : stages) key += stage.path + ";";
+    for (const auto& define : defines) key += define.name + "=" + define.value + ";";
+    cachePath = ProgramCache::getCachePath(key);
 
-    // Fragment
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+    Sources sources = readSources();
+    watchedFiles = sources.files;
 
-    // Merge them into a single program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    ID = ProgramCache::load(cachePath, sources.hash);
+    if (ID) {
+        linked = true;
+    } else {
+        std::vector<GLuint> shaders;
+        ID = startBuild(sources, shaders);
+        linked = finishBuild(ID, shaders);
+        if (linked) ProgramCache::store(cachePath, sources.hash, ID);
+    }
+    cacheUniformLocations();
+}
 
-    // Cleanup
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+Shader::Sources Shader::readSources() const
+{
+    Sources sources;
+    for (const auto& stage : stages) {
+        sources.code.push_back(injectDefines(loadShaderSource(stage.path, sources.files)));
+    }
+    sources.hash = ProgramCache::hashSources(sources.code);
+    return sources;
 }
 
-// Constructor for pipeline with Geometry Shader
-Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath)
+GLuint Shader::startBuild(const Sources& sources, std::vector<GLuint>& shaders) const
 {
-    // Same as previous constructor, but also with geometry shader.
-    std::string vertexCode = loadShaderSource(vertexPath);
-    std::string fragmentCode = loadShaderSource(fragmentPath);
-    std::string geometryCode = loadShaderSource(geometryPath);
+    GLuint program = glCreateProgram();
+    for (size_t i = 0; i < stages.size(); ++i) {
+        const char* code = sources.code[i].c_str();
+        GLuint shader = glCreateShader(stages[i].type);
+        glShaderSource(shader, 1, &code, NULL);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        shaders.push_back(shader);
+    }
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-    const char* gShaderCode = geometryCode.c_str();
+    // Lets glGetProgramBinary return something for the cache.
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    return program;
+}
 
-    unsigned int vertex, fragment, geometry;
+bool Shader::finishBuild(GLuint program, std::vector<GLuint>& shaders)
+{
+    for (size_t i = 0; i < shaders.size(); ++i) {
+        checkCompileErrors(shaders[i], stageName(stages[i].type));
+    }
+    bool success = checkCompileErrors(program, "PROGRAM");
+
+    for (GLuint shader : shaders) {
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    shaders.clear();
+    return success;
+}
+
+// GLSL wants #version first, so the defines go on the line right after it.
+std::string Shader::injectDefines(const std::string& code) const
+{
+    if (defines.empty()) return code;
+
+    std::string block;
+    for (const auto& define : defines) {
+        block += "#define " + define.name + " " + define.value + "\n";
+    }
+
+    size_t version = code.find("#version");
+    if (version == std::string::npos) return block + code;
+    size_t lineEnd = code.find('\n', version);
+    if (lineEnd == std::string::npos) return code + "\n" + block;
+    return code.substr(0, lineEnd + 1) + block + code.substr(lineEnd + 1);
+}
+
+bool Shader::changedOnDisk() const
+{
+    for (const auto& file : watchedFiles) {
+        if (writeTime(file.path) != file.writeTime) return true;
+    }
+    return false;
+}
+
+std::string Shader::describe() const
+{
+    std::string text;
+    for (const auto& stage : stages) {
+        if (!text.empty()) text += " + ";
+        text += stage.path;
+    }
+    for (const auto& define : defines) {
+        text += " " + define.name + "=" + define.value;
+    }
+    return text;
+}
 
-    // Vertex
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+bool Shader::pollReload()
+{
+    if (pending) {
+        if (parallelCompileSupported()) {
+            GLint complete = GL_FALSE;
+            glGetProgramiv(pending->program, GL_COMPLETION_STATUS_KHR, &complete);
+            if (!complete) return false;
+        }
 
-    // Fragment
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+        std::unique_ptr<PendingBuild> build = std::move(pending);
+        // Either way these are the files to compare against now; a broken edit is only retried once saved again.
+        watchedFiles = build->sources.files;
+        if (!finishBuild(build->program, build->shaders)) {
+            glDeleteProgram(build->program);
+            std::cout << "Shader reload failed, keeping the previous program: " << describe() << std::endl;
+            return false;
+        }
 
-    // Geometry
-    geometry = glCreateShader(GL_GEOMETRY_SHADER);
-    glShaderSource(geometry, 1, &gShaderCode, NULL);
-    glCompileShader(geometry);
-    checkCompileErrors(geometry, "GEOMETRY");
+        glDeleteProgram(ID);
+        ID = build->program;
+        linked = true;
+        cacheUniformLocations();
+        ProgramCache::store(cachePath, build->sources.hash, ID);
+        std::cout << "Shader reloaded: " << describe() << std::endl;
+        return true;
+    }
 
-    // Merge them into a single program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glAttachShader(ID, geometry);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastReloadCheck < RELOAD_CHECK_INTERVAL) return false;
+    lastReloadCheck = now;
+    if (!changedOnDisk()) return false;
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    glDeleteShader(geometry);
+    pending = std::make_unique<PendingBuild>();
+    pending->sources = readSources();
+    pending->program = startBuild(pending->sources, pending->shaders);
+    return false;
 }
 
 Shader::~Shader()
 {
+    if (pending) {
+        for (GLuint shader : pending->shaders) glDeleteShader(shader);
+        glDeleteProgram(pending->program);
+    }
     glDeleteProgram(ID);
 }
 
@@ -93,40 +217,118 @@ void Shader::use()
     glUseProgram(ID);
 }
 
-// Boilerplate wrapper so I don't have to write glGetUniformLocation ever again
-// TODO: glGetUniformLocation is slow, cache results
+// Boilerplate wrapper so I don't have to write glGetUniformLocation ever again.
+// Locations come from the table built at link time, the driver is never queried here.
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(getUniformLocation(name), (int)value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(getUniformLocation(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(getUniformLocation(name), value);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform2fv(getUniformLocation(name), 1, &value[0]);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(getUniformLocation(name), 1, &value[0]);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+GLint Shader::getUniformLocation(const std::string& name) const
+{
+    auto it = uniformLocations.find(name);
+    return it != uniformLocations.end() ? it->second : -1;
+}
+
+// Reflect every active uniform once after linking.
+// Arrays are reported only once by the driver ("shadowMaps[0]" with size 8), so each element gets its own entry,
+// plus the bare name as an alias for element 0 like glGetUniformLocation accepts.
+void Shader::cacheUniformLocations()
+{
+    uniformLocations.clear();
+
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::string nameBuffer(std::max(maxNameLength, 1), '\0');
+    for (GLint i = 0; i < uniformCount; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), maxNameLength, &length, &size, &type, &nameBuffer[0]);
+        std::string name(nameBuffer.c_str(), length);
+
+        // Members of uniform blocks have no location.
+        GLint location = glGetUniformLocation(ID, name.c_str());
+        if (location < 0) continue;
+
+        uniformLocations[name] = location;
+
+        const std::string arraySuffix = "[0]";
+        if (name.size() > arraySuffix.size() && name.compare(name.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0) {
+            std::string baseName = name.substr(0, name.size() - arraySuffix.size());
+            uniformLocations[baseName] = location;
+
+            for (GLint element = 1; element < size; ++element) {
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                GLint elementLocation = glGetUniformLocation(ID, elementName.c_str());
+                if (elementLocation >= 0) {
+                    uniformLocations[elementName] = elementLocation;
+                }
+            }
+        }
+    }
+}
+
+template<> void Uniform<bool>::set(const bool& value) const
+{
+    glUniform1i(location, (int)value);
+}
+
+template<> void Uniform<int>::set(const int& value) const
+{
+    glUniform1i(location, value);
+}
+
+template<> void Uniform<float>::set(const float& value) const
+{
+    glUniform1f(location, value);
+}
+
+template<> void Uniform<glm::vec2>::set(const glm::vec2& value) const
+{
+    glUniform2fv(location, 1, &value[0]);
+}
+
+template<> void Uniform<glm::vec3>::set(const glm::vec3& value) const
+{
+    glUniform3fv(location, 1, &value[0]);
+}
+
+template<> void Uniform<glm::mat4>::set(const glm::mat4& value) const
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
 }
 
 // Utility function for checking shader compilation/linking errors.
-void Shader::checkCompileErrors(unsigned int shader, std::string type)
+bool Shader::checkCompileErrors(unsigned int shader, std::string type)
 {
     int success;
     char infoLog[1024];
@@ -143,23 +345,71 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
             std::cout << "---------------------------------------------------" << "\nError linking program: " << type << "\n" << infoLog << "\n---------------------------------------------------" << std::endl;
         }
     }
+    return success != 0;
+}
+
+// Reads the file into a string. Every file read (includes too) is added to files, for hot reload.
+std::string Shader::loadShaderSource(const std::string& path, std::vector<WatchedFile>& files) const
+{
+    return loadShaderSource(path, 0, files);
 }
 
-// Reads the file into a string.
-std::string Shader::loadShaderSource(const std::string& path)
+// Reads a shader file and splices in any #include "relative/path.glsl" lines.
+// Paths are relative to the including file, so shaders in lighting/ use "../common/...".
+std::string Shader::loadShaderSource(const std::string& path, int includeDepth, std::vector<WatchedFile>& files) const
 {
-    std::string code;
-    std::ifstream file;
-    
-    try {
-        file.open(path);
-        std::stringstream stream;
-        stream << file.rdbuf();
-        file.close();
-        code = stream.str();
-    } catch (std::ifstream::failure& e) {
-        std::cout << "Error reading shader file: " << e.what() << std::endl;
+    files.push_back({ path, writeTime(path) });
+
+    // An unreadable file comes back empty, which fails the compile, so the program ends up !isLinked().
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error reading shader file: " << path << std::endl;
+        return "";
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    std::string code = stream.str();
+
+    if (code.find("#include") == std::string::npos) {
+        return code;
+    }
+
+    // Catch include cycles instead of recursing forever.
+    const int maxIncludeDepth = 16;
+    if (includeDepth > maxIncludeDepth) {
+        std::cout << "Shader include depth exceeded in: " << path << std::endl;
+        return "";
+    }
+
+    std::string directory;
+    size_t slash = path.find_last_of("/\\");
+    if (slash != std::string::npos) {
+        directory = path.substr(0, slash + 1);
+    }
+
+    std::stringstream input(code);
+    std::stringstream output;
+    std::string line;
+    while (std::getline(input, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+            size_t open = line.find('"', start);
+            size_t close = (open != std::string::npos) ? line.find('"', open + 1) : std::string::npos;
+            if (close == std::string::npos) {
+                std::cout << "Malformed #include in " << path << ": " << line << std::endl;
+                continue;
+            }
+
+            std::string includePath = directory + line.substr(open + 1, close - open - 1);
+            std::string includeCode = loadShaderSource(includePath, includeDepth + 1, files);
+            if (includeCode.empty()) {
+                std::cout << "Shader include not found or empty: " << includePath << " (from " << path << ")" << std::endl;
+            }
+            output << includeCode << "\n";
+            continue;
+        }
+        output << line << "\n";
     }
-    
-    return code;
+
+    return output.str();
 }
\ No newline at end of file
@@ -3,24 +3,83 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <memory>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <filesystem>
+#include <chrono>
 
+// Pre-resolved uniform location.
+// Cheap to copy, so the Renderer keeps these as members and sets them every frame without any string work.
+// A location of -1 (uniform optimized out or misspelled) is silently ignored, same as glUniform* does.
+template<typename T>
+class Uniform
+{
+public:
+    Uniform() = default;
+    explicit Uniform(GLint location) : location(location) {}
+
+    // Uploads to the currently bound program, exactly like the Shader::setX helpers.
+    void set(const T& value) const;
+
+    bool isValid() const { return location >= 0; }
+    GLint getLocation() const { return location; }
+
+private:
+    GLint location = -1;
+};
+
+template<> void Uniform<bool>::set(const bool& value) const;
+template<> void Uniform<int>::set(const int& value) const;
+template<> void Uniform<float>::set(const float& value) const;
+template<> void Uniform<glm::vec2>::set(const glm::vec2& value) const;
+template<> void Uniform<glm::vec3>::set(const glm::vec3& value) const;
+template<> void Uniform<glm::mat4>::set(const glm::mat4& value) const;
+
+// "#define name value", injected after the #version line of every stage.
+struct ShaderDefine {
+    std::string name;
+    std::string value;
+};
+using ShaderDefines = std::vector<ShaderDefine>;
+
+// A linked program built from source files.
+// Programs come from the ProgramCache when the preprocessed sources and the driver match, and are compiled
+// otherwise. pollReload() watches the source files (includes too) and rebuilds the program in the background
+// when one changes; the new program only replaces the current one once it links, so a typo never leaves the
+// renderer without a working shader.
+// Defines make compile-time permutations of the same files (see ShaderVariants); each one is its own program.
 class Shader
 {
 public:
     unsigned int ID;
 
     // Build the shader from source files.
-    Shader(const std::string& vertexPath, const std::string& fragmentPath);
+    Shader(const std::string& vertexPath, const std::string& fragmentPath, const ShaderDefines& defines = {});
     Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath);
+    // Compute-only program.
+    explicit Shader(const std::string& computePath, const ShaderDefines& defines = {});
     ~Shader();
 
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
     // Activate this shader for the next draw calls.
     void use();
-    
+
+    // False if the last build from source failed to read, compile or link (ID is then an unusable program).
+    // The constructors never throw: this is the only failure signal, callers with a fallback check it.
+    bool isLinked() const { return linked; }
+
+    // Hot reload, GL thread, once per frame. Source files are checked at most every RELOAD_CHECK_INTERVAL.
+    // Returns true on the call that swapped a new program in: ID changed, and so did every uniform location
+    // (handles from getUniform() must be resolved again, and uniforms set once at init set again).
+    bool pollReload();
+
     // Uniforms setters
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
@@ -29,7 +88,64 @@ public:
     void setVec3(const std::string& name, const glm::vec3& value) const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
 
+    // Location from the table built at link time, -1 if the program has no such active uniform.
+    GLint getUniformLocation(const std::string& name) const;
+
+    // Resolve a handle once (e.g. at init) and reuse it in the per-frame code.
+    template<typename T>
+    Uniform<T> getUniform(const std::string& name) const { return Uniform<T>(getUniformLocation(name)); }
+
+    static constexpr std::chrono::milliseconds RELOAD_CHECK_INTERVAL{ 500 };
+
 private:
-    void checkCompileErrors(unsigned int shader, std::string type);
-    std::string loadShaderSource(const std::string& path);
+    struct Stage {
+        GLenum type;
+        std::string path;
+    };
+
+    struct WatchedFile {
+        std::string path;
+        std::filesystem::file_time_type writeTime;
+    };
+
+    // Sources of one build attempt, with everything they pulled in.
+    struct Sources {
+        std::vector<std::string> code;  // Parallel to stages
+        std::vector<WatchedFile> files;
+        uint64_t hash = 0;
+    };
+
+    // A build started by pollReload(), compiling while frames keep using ID.
+    struct PendingBuild {
+        GLuint program = 0;
+        std::vector<GLuint> shaders;
+        Sources sources;
+    };
+
+    std::vector<Stage> stages;
+    ShaderDefines defines;
+    std::string cachePath;
+    bool linked = false;
+    std::vector<WatchedFile> watchedFiles;
+    std::chrono::steady_clock::time_point lastReloadCheck;
+    std::unique_ptr<PendingBuild> pending;
+
+    // Every active uniform of the linked program, including each element of arrays ("lights[3].color", "shadowMaps[2]").
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    Shader(std::vector<Stage> programStages, ShaderDefines programDefines);
+
+    Sources readSources() const;
+    // Creates, compiles, attaches and links without waiting on the driver. The caller checks the result.
+    GLuint startBuild(const Sources& sources, std::vector<GLuint>& shaders) const;
+    // Logs compile/link errors, deletes the shader objects. True if the program linked.
+    bool finishBuild(GLuint program, std::vector<GLuint>& shaders);
+    std::string injectDefines(const std::string& code) const;
+    bool changedOnDisk() const;
+    std::string describe() const;
+
+    bool checkCompileErrors(unsigned int shader, std::string type);
+    std::string loadShaderSource(const std::string& path, std::vector<WatchedFile>& files) const;
+    std::string loadShaderSource(const std::string& path, int includeDepth, std::vector<WatchedFile>& files) const;
+    void cacheUniformLocations();
 };
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "ShaderStorageBuffer.h"
+#include <iostream>
+
+ShaderStorageBuffer::ShaderStorageBuffer(GLuint binding)
+    : ssbo(0), binding(binding), size(0)
+{
+    glGenBuffers(1, &ssbo);
+}
+
+ShaderStorageBuffer::~ShaderStorageBuffer()
+{
+    if (ssbo) {
+        glDeleteBuffers(1, &ssbo);
+    }
+}
+
+void ShaderStorageBuffer::allocate(GLsizeiptr newSize, const void* data)
+{
+    size = newSize;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    bind();
+}
+
+void ShaderStorageBuffer::update(const void* data, GLsizeiptr dataSize, GLintptr offset)
+{
+    if (offset + dataSize > size) {
+        std::cerr << "ShaderStorageBuffer::update out of range (binding " << binding << ")" << std::endl;
+        return;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, dataSize, data);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ShaderStorageBuffer::bind() const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, ssbo);
+}
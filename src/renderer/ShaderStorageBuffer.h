@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Owner of a GL shader storage buffer bound to a fixed binding point (layout (std430, binding = N)).
+// Unlike UniformBuffer the size isn't fixed: allocate() can be called again when the content grows.
+class ShaderStorageBuffer
+{
+public:
+    explicit ShaderStorageBuffer(GLuint binding);
+    ~ShaderStorageBuffer();
+
+    ShaderStorageBuffer(const ShaderStorageBuffer&) = delete;
+    ShaderStorageBuffer& operator=(const ShaderStorageBuffer&) = delete;
+
+    // (Re)create the data store. data may be null to only reserve the space.
+    void allocate(GLsizeiptr newSize, const void* data = nullptr);
+
+    // Single glBufferSubData inside the current allocation.
+    void update(const void* data, GLsizeiptr dataSize, GLintptr offset = 0);
+
+    void bind() const;
+
+    GLuint getID() const { return ssbo; }
+    GLuint getBinding() const { return binding; }
+    GLsizeiptr getSize() const { return size; }
+
+private:
+    GLuint ssbo;
+    GLuint binding;
+    GLsizeiptr size;
+};
@@ -0,0 +1,34 @@
+#include "ShaderVariants.h"
+#include <iostream>
+
+ShaderVariants::ShaderVariants(std::string name, Factory factory)
+    : name(std::move(name)), factory(std::move(factory))
+{
+}
+
+Shader* ShaderVariants::get(uint32_t key, const ShaderDefines& defines)
+{
+    auto it = variants.find(key);
+    if (it == variants.end()) {
+        std::unique_ptr<Shader> shader = factory(defines);
+        if (shader && shader->isLinked()) {
+            std::cout << name << " shader variant " << key << " compiled successfully" << std::endl;
+        } else {
+            std::cerr << name << " shader variant " << key << " failed to build" << std::endl;
+        }
+        it = variants.emplace(key, std::move(shader)).first;
+    }
+
+    // An unlinked variant stays in the map, so pollReload() can still fix it once its sources are.
+    Shader* shader = it->second.get();
+    return shader && shader->isLinked() ? shader : nullptr;
+}
+
+bool ShaderVariants::pollReload()
+{
+    bool reloaded = false;
+    for (auto& variant : variants) {
+        if (variant.second && variant.second->pollReload()) reloaded = true;
+    }
+    return reloaded;
+}
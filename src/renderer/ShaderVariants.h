@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include "Shader.h"
+
+// Compile-time permutations of one program. The caller folds the features it wants into a key (a bitmask) and
+// passes the matching defines; the variant is built the first time its key is asked for and kept afterwards,
+// so switching back and forth between settings never recompiles (and the ProgramCache covers later runs).
+class ShaderVariants
+{
+public:
+    // Builds the program for one set of defines; a build failure shows as !isLinked().
+    using Factory = std::function<std::unique_ptr<Shader>(const ShaderDefines& defines)>;
+
+    ShaderVariants(std::string name, Factory factory);
+
+    // nullptr while this variant doesn't link; it isn't rebuilt here, only by pollReload() when its sources change.
+    Shader* get(uint32_t key, const ShaderDefines& defines);
+
+    // Hot reload of every variant built so far. True if any was swapped (see Shader::pollReload()).
+    bool pollReload();
+
+    size_t getVariantCount() const { return variants.size(); }
+
+private:
+    std::string name;
+    Factory factory;
+    std::unordered_map<uint32_t, std::unique_ptr<Shader>> variants;
+};
@@ -0,0 +1,387 @@
+#include "ShadowAtlas.h"
+#include <iostream>
+
+namespace {
+    // Far plane depth, used to clear a single tile/cube without touching the neighbours.
+    const float CLEAR_DEPTH = 1.0f;
+
+    const int ATLAS_SLOTS_PER_TIER[] = { 2, 4, 16 };
+    const int CUBE_SLOTS_PER_TIER[] = { 2, 4, 8 };
+
+    // Unsized GL_DEPTH_COMPONENT: 24 bits padded to 32, or 32F.
+    const size_t DEPTH_TEXEL_BYTES = 4;
+
+    // The lighting shader reads the maps through sampler*Shadow: the texture unit does the depth test, and with
+    // linear filtering each lookup is a bilinear 2x2 PCF in hardware. Nearest keeps single-tap shadows hard.
+    void setShadowSampling(GLenum target, bool linearFiltering)
+    {
+        GLint filter = linearFiltering ? GL_LINEAR : GL_NEAREST;
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+}
+
+void ShadowSlotAllocator::configure(const std::vector<int>& slotsPerTier)
+{
+    tiers.clear();
+    for (int count : slotsPerTier) {
+        tiers.emplace_back(count);
+    }
+}
+
+ShadowSlot ShadowSlotAllocator::acquire(uint32_t owner, int preferredTier, uint64_t frame)
+{
+    ShadowSlot result;
+    if (tiers.empty()) return result;
+
+    if (preferredTier < 0) preferredTier = 0;
+    for (int tier = preferredTier; tier < getTierCount(); ++tier) {
+        auto& slots = tiers[tier];
+
+        // Already there: keep it, the cached depth is still good.
+        int chosen = -1;
+        for (int i = 0; i < static_cast<int>(slots.size()); ++i) {
+            if (slots[i].owner == owner) {
+                chosen = i;
+                break;
+            }
+        }
+
+        // Otherwise a free slot, or failing that the least recently used one nobody claimed this frame.
+        if (chosen < 0) {
+            int lruSlot = -1;
+            for (int i = 0; i < static_cast<int>(slots.size()); ++i) {
+                if (slots[i].owner == NO_OWNER) {
+                    chosen = i;
+                    break;
+                }
+                if (slots[i].lastUsedFrame < frame && (lruSlot < 0 || slots[i].lastUsedFrame < slots[lruSlot].lastUsedFrame)) {
+                    lruSlot = i;
+                }
+            }
+            if (chosen < 0) chosen = lruSlot;
+            if (chosen < 0) continue; // Tier full for this frame, try a lower resolution
+
+            // Moving tiers: give back the old slot.
+            release(owner);
+            slots[chosen].owner = owner;
+            slots[chosen].generation = nextGeneration++;
+        }
+
+        slots[chosen].lastUsedFrame = frame;
+        result.tier = tier;
+        result.index = chosen;
+        result.generation = slots[chosen].generation;
+        return result;
+    }
+
+    return result;
+}
+
+void ShadowSlotAllocator::release(uint32_t owner)
+{
+    for (auto& slots : tiers) {
+        for (auto& slot : slots) {
+            if (slot.owner == owner) {
+                slot = Slot();
+            }
+        }
+    }
+}
+
+void ShadowSlotAllocator::releaseAll()
+{
+    for (auto& slots : tiers) {
+        for (auto& slot : slots) {
+            slot = Slot();
+        }
+    }
+}
+
+// Shadow Atlas
+
+ShadowAtlas::ShadowAtlas()
+    : FBO(0), texture(0), size(0), baseTileSize(0), linearFiltering(true)
+{
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+    release();
+}
+
+void ShadowAtlas::release()
+{
+    if (FBO) glDeleteFramebuffers(1, &FBO);
+    if (texture) glDeleteTextures(1, &texture);
+    FBO = 0;
+    texture = 0;
+}
+
+bool ShadowAtlas::configure(int newBaseTileSize)
+{
+    if (newBaseTileSize == baseTileSize && texture) return false;
+
+    release();
+    baseTileSize = newBaseTileSize;
+    size = baseTileSize * 2;
+
+    // Rows of tiles, top to bottom, following the layout in the header.
+    tileRects.clear();
+    int y = 0;
+    for (int tier = 0; tier < 3; ++tier) {
+        int tileSize = baseTileSize >> tier;
+        int perRow = size / tileSize;
+        std::vector<glm::ivec4> rects;
+        for (int i = 0; i < ATLAS_SLOTS_PER_TIER[tier]; ++i) {
+            int row = i / perRow;
+            int column = i % perRow;
+            rects.push_back(glm::ivec4(column * tileSize, y + row * tileSize, tileSize, tileSize));
+        }
+        y += ((ATLAS_SLOTS_PER_TIER[tier] + perRow - 1) / perRow) * tileSize;
+        tileRects.push_back(rects);
+    }
+    allocator.configure(std::vector<int>(std::begin(ATLAS_SLOTS_PER_TIER), std::end(ATLAS_SLOTS_PER_TIER)));
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    setShadowSampling(GL_TEXTURE_2D, linearFiltering);
+    // The lighting shader clamps lookups to the tile, outside it there's no shadow anyway.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glClearTexImage(texture, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &CLEAR_DEPTH);
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+    glDrawBuffer(GL_NONE); // Depth only
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Shadow atlas framebuffer not complete!" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::cout << "Shadow atlas: " << size << "x" << size << " (tiles " << baseTileSize << "/"
+              << (baseTileSize >> 1) << "/" << (baseTileSize >> 2) << ")" << std::endl;
+    return true;
+}
+
+void ShadowAtlas::setLinearFiltering(bool linear)
+{
+    if (linear == linearFiltering) return;
+    linearFiltering = linear;
+    if (!texture) return;
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    setShadowSampling(GL_TEXTURE_2D, linearFiltering);
+}
+
+glm::ivec4 ShadowAtlas::getTileRect(const ShadowSlot& slot) const
+{
+    if (!slot.isValid()) return glm::ivec4(0);
+    return tileRects[slot.tier][slot.index];
+}
+
+glm::vec4 ShadowAtlas::getTileUV(const ShadowSlot& slot) const
+{
+    if (!slot.isValid() || size == 0) return glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    glm::vec4 rect = glm::vec4(getTileRect(slot)) / static_cast<float>(size);
+    return rect;
+}
+
+void ShadowAtlas::bindTile(const ShadowSlot& slot) const
+{
+    glm::ivec4 rect = getTileRect(slot);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glViewport(rect.x, rect.y, rect.z, rect.w);
+    glClearTexSubImage(texture, 0, rect.x, rect.y, 0, rect.z, rect.w, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &CLEAR_DEPTH);
+}
+
+size_t ShadowAtlas::getMemoryBytes() const
+{
+    return texture ? static_cast<size_t>(size) * size * DEPTH_TEXEL_BYTES : 0;
+}
+
+// Shadow Cube Array
+
+ShadowCubeArray::ShadowCubeArray()
+    : FBOs{}, textures{}, baseFaceSize(0), linearFiltering(true)
+{
+}
+
+ShadowCubeArray::~ShadowCubeArray()
+{
+    release();
+}
+
+void ShadowCubeArray::release()
+{
+    for (int tier = 0; tier < TIER_COUNT; ++tier) {
+        if (FBOs[tier]) glDeleteFramebuffers(1, &FBOs[tier]);
+        if (textures[tier]) glDeleteTextures(1, &textures[tier]);
+        FBOs[tier] = 0;
+        textures[tier] = 0;
+    }
+}
+
+bool ShadowCubeArray::configure(int newBaseFaceSize)
+{
+    if (newBaseFaceSize == baseFaceSize && textures[0]) return false;
+
+    release();
+    baseFaceSize = newBaseFaceSize;
+    allocator.configure(std::vector<int>(std::begin(CUBE_SLOTS_PER_TIER), std::end(CUBE_SLOTS_PER_TIER)));
+
+    glGenTextures(TIER_COUNT, textures);
+    glGenFramebuffers(TIER_COUNT, FBOs);
+    for (int tier = 0; tier < TIER_COUNT; ++tier) {
+        int faceSize = getFaceSize(tier);
+
+        // Depth is 6 * cube count layer-faces.
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, textures[tier]);
+        glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT, faceSize, faceSize, 6 * CUBE_SLOTS_PER_TIER[tier],
+                     0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        setShadowSampling(GL_TEXTURE_CUBE_MAP_ARRAY, linearFiltering);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glClearTexImage(textures[tier], 0, GL_DEPTH_COMPONENT, GL_FLOAT, &CLEAR_DEPTH);
+
+        // Layered attachment: the point shadow shaders pick the layer-face through gl_Layer.
+        glBindFramebuffer(GL_FRAMEBUFFER, FBOs[tier]);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[tier], 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Shadow cube array framebuffer (tier " << tier << ") not complete!" << std::endl;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::cout << "Shadow cube arrays: " << CUBE_SLOTS_PER_TIER[0] << "x" << getFaceSize(0) << ", "
+              << CUBE_SLOTS_PER_TIER[1] << "x" << getFaceSize(1) << ", "
+              << CUBE_SLOTS_PER_TIER[2] << "x" << getFaceSize(2) << std::endl;
+    return true;
+}
+
+void ShadowCubeArray::setLinearFiltering(bool linear)
+{
+    if (linear == linearFiltering) return;
+    linearFiltering = linear;
+    if (!textures[0]) return;
+
+    for (int tier = 0; tier < TIER_COUNT; ++tier) {
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, textures[tier]);
+        setShadowSampling(GL_TEXTURE_CUBE_MAP_ARRAY, linearFiltering);
+    }
+}
+
+void ShadowCubeArray::bindCube(const ShadowSlot& slot) const
+{
+    int faceSize = getFaceSize(slot.tier);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBOs[slot.tier]);
+    glViewport(0, 0, faceSize, faceSize);
+    glClearTexSubImage(textures[slot.tier], 0, 0, 0, slot.index * 6, faceSize, faceSize, 6, GL_DEPTH_COMPONENT, GL_FLOAT, &CLEAR_DEPTH);
+}
+
+size_t ShadowCubeArray::getMemoryBytes() const
+{
+    size_t bytes = 0;
+    for (int tier = 0; tier < TIER_COUNT; ++tier) {
+        if (!textures[tier]) continue;
+        size_t faceSize = static_cast<size_t>(getFaceSize(tier));
+        bytes += faceSize * faceSize * 6 * CUBE_SLOTS_PER_TIER[tier] * DEPTH_TEXEL_BYTES;
+    }
+    return bytes;
+}
+
+ShadowCascadeArray::ShadowCascadeArray()
+    : layeredFBO(0), layerFBO(0), texture(0), size(0), linearFiltering(true)
+{
+}
+
+ShadowCascadeArray::~ShadowCascadeArray()
+{
+    release();
+}
+
+void ShadowCascadeArray::release()
+{
+    if (layeredFBO) glDeleteFramebuffers(1, &layeredFBO);
+    if (layerFBO) glDeleteFramebuffers(1, &layerFBO);
+    if (texture) glDeleteTextures(1, &texture);
+    layeredFBO = 0;
+    layerFBO = 0;
+    texture = 0;
+}
+
+bool ShadowCascadeArray::configure(int newSize)
+{
+    if (newSize == size && texture) return false;
+
+    release();
+    size = newSize;
+    allocator.configure({ static_cast<int>(SHADOW_CASCADED_LIGHTS) });
+
+    int layerCount = static_cast<int>(SHADOW_CASCADED_LIGHTS * SHADOW_CASCADE_COUNT);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT, size, size, layerCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    setShadowSampling(GL_TEXTURE_2D_ARRAY, linearFiltering);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glClearTexImage(texture, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &CLEAR_DEPTH);
+
+    glGenFramebuffers(1, &layeredFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, layeredFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Shadow cascade framebuffer not complete!" << std::endl;
+    }
+
+    // Attachment is set per layer in bindLayer().
+    glGenFramebuffers(1, &layerFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, layerFBO);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::cout << "Shadow cascades: " << SHADOW_CASCADED_LIGHTS << " lights x " << SHADOW_CASCADE_COUNT
+              << " cascades of " << size << "x" << size << std::endl;
+    return true;
+}
+
+void ShadowCascadeArray::setLinearFiltering(bool linear)
+{
+    if (linear == linearFiltering) return;
+    linearFiltering = linear;
+    if (!texture) return;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    setShadowSampling(GL_TEXTURE_2D_ARRAY, linearFiltering);
+}
+
+void ShadowCascadeArray::bindCascades(const ShadowSlot& slot, int cascadeCount) const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, layeredFBO);
+    glViewport(0, 0, size, size);
+    glClearTexSubImage(texture, 0, 0, 0, slot.index * static_cast<int>(SHADOW_CASCADE_COUNT), size, size, cascadeCount,
+                       GL_DEPTH_COMPONENT, GL_FLOAT, &CLEAR_DEPTH);
+}
+
+void ShadowCascadeArray::bindLayer(const ShadowSlot& slot, int cascade) const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, layerFBO);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, slot.index * static_cast<int>(SHADOW_CASCADE_COUNT) + cascade);
+    glViewport(0, 0, size, size);
+}
+
+size_t ShadowCascadeArray::getMemoryBytes() const
+{
+    return texture ? static_cast<size_t>(size) * size * SHADOW_CASCADED_LIGHTS * SHADOW_CASCADE_COUNT * DEPTH_TEXEL_BYTES : 0;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "UniformBlocks.h"
+
+// A slot in one of the shadow pools. The generation changes every time the slot changes owner,
+// so a light can tell its cached depth was overwritten even if it gets the very same slot back.
+struct ShadowSlot {
+    int tier = -1;
+    int index = -1;
+    uint64_t generation = 0;
+
+    bool isValid() const { return tier >= 0; }
+    bool operator==(const ShadowSlot& other) const { return tier == other.tier && index == other.index && generation == other.generation; }
+    bool operator!=(const ShadowSlot& other) const { return !(*this == other); }
+};
+
+// Fixed number of slots per resolution tier (tier 0 = highest resolution).
+// Slots stay with their owner until somebody else needs them: a light that stops casting (sun at night)
+// keeps its depth until the slot is reclaimed, least recently used first.
+class ShadowSlotAllocator
+{
+public:
+    static const uint32_t NO_OWNER = UINT32_MAX;
+
+    void configure(const std::vector<int>& slotsPerTier);
+
+    // Slot for this frame, in preferredTier or the first lower tier with room. Invalid if every candidate
+    // slot was already requested this frame by higher priority owners.
+    ShadowSlot acquire(uint32_t owner, int preferredTier, uint64_t frame);
+
+    void release(uint32_t owner);
+    void releaseAll();
+
+    int getTierCount() const { return static_cast<int>(tiers.size()); }
+    int getSlotCount(int tier) const { return static_cast<int>(tiers[tier].size()); }
+
+private:
+    struct Slot {
+        uint32_t owner = NO_OWNER;
+        uint64_t lastUsedFrame = 0;
+        uint64_t generation = 0;
+    };
+    std::vector<std::vector<Slot>> tiers;
+    uint64_t nextGeneration = 1; // Never reset, see ShadowSlot
+};
+
+// One big depth texture for every spot shadow, split into square tiles.
+// Tier t tiles are baseTileSize >> t wide. Layout for an atlas of 2 * baseTileSize:
+//   top half:      2 tiles of tier 0
+//   next row:      4 tiles of tier 1
+//   bottom 2 rows: 16 tiles of tier 2
+class ShadowAtlas
+{
+public:
+    ShadowAtlas();
+    ~ShadowAtlas();
+
+    ShadowAtlas(const ShadowAtlas&) = delete;
+    ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+    // (Re)allocate for a new base tile size. Does nothing if it didn't change; otherwise every slot is dropped.
+    // Returns true when the storage was recreated.
+    bool configure(int baseTileSize);
+    // Depth compare lookups are bilinear (hardware 2x2 PCF) or nearest (hard single taps). Kept across configure().
+    void setLinearFiltering(bool linear);
+
+    ShadowSlotAllocator& getAllocator() { return allocator; }
+
+    // Pixel rect (x, y, width, height) of a tile, for glViewport.
+    glm::ivec4 getTileRect(const ShadowSlot& slot) const;
+    // Same rect in texture space: xy = offset, zw = scale.
+    glm::vec4 getTileUV(const ShadowSlot& slot) const;
+
+    void bindTile(const ShadowSlot& slot) const; // Bind the FBO, set viewport and clear the tile to far depth
+
+    GLuint getTexture() const { return texture; }
+    int getSize() const { return size; }
+    int getBaseTileSize() const { return baseTileSize; }
+    size_t getMemoryBytes() const;
+
+private:
+    GLuint FBO;
+    GLuint texture;
+    int size;
+    int baseTileSize;
+    bool linearFiltering;
+    std::vector<std::vector<glm::ivec4>> tileRects; // Per tier, per slot
+    ShadowSlotAllocator allocator;
+
+    void release();
+};
+
+// Cascaded shadow maps of the directional lights: one GL_TEXTURE_2D_ARRAY, SHADOW_CASCADE_COUNT layers per slot.
+// Layers to render to are slot.index * SHADOW_CASCADE_COUNT + cascade.
+class ShadowCascadeArray
+{
+public:
+    ShadowCascadeArray();
+    ~ShadowCascadeArray();
+
+    ShadowCascadeArray(const ShadowCascadeArray&) = delete;
+    ShadowCascadeArray& operator=(const ShadowCascadeArray&) = delete;
+
+    bool configure(int size);
+    void setLinearFiltering(bool linear);
+
+    ShadowSlotAllocator& getAllocator() { return allocator; }
+
+    // Layered FBO for single-pass rendering (cascade through gl_Layer). Clears the slot's first cascadeCount layers.
+    void bindCascades(const ShadowSlot& slot, int cascadeCount) const;
+    // Fallback without vertex shader layer output: a plain FBO on one layer. Doesn't clear, call after bindCascades().
+    void bindLayer(const ShadowSlot& slot, int cascade) const;
+
+    GLuint getTexture() const { return texture; }
+    int getSize() const { return size; }
+    size_t getMemoryBytes() const;
+
+private:
+    GLuint layeredFBO;
+    GLuint layerFBO;
+    GLuint texture;
+    int size;
+    bool linearFiltering;
+    ShadowSlotAllocator allocator;
+
+    void release();
+};
+
+// Point light cube maps, one GL_TEXTURE_CUBE_MAP_ARRAY per resolution tier (a cube array has a single face size).
+// Tier t faces are baseFaceSize >> t, with 2 / 4 / 8 cubes in tiers 0 / 1 / 2.
+class ShadowCubeArray
+{
+public:
+    static const int TIER_COUNT = 3;
+
+    ShadowCubeArray();
+    ~ShadowCubeArray();
+
+    ShadowCubeArray(const ShadowCubeArray&) = delete;
+    ShadowCubeArray& operator=(const ShadowCubeArray&) = delete;
+
+    bool configure(int baseFaceSize);
+    void setLinearFiltering(bool linear);
+
+    ShadowSlotAllocator& getAllocator() { return allocator; }
+
+    // Bind the layered FBO of the slot's tier, set the viewport and clear the slot's 6 faces.
+    // Layers to render to are slot.index * 6 + face.
+    void bindCube(const ShadowSlot& slot) const;
+
+    GLuint getTexture(int tier) const { return textures[tier]; }
+    int getFaceSize(int tier) const { return baseFaceSize >> tier; }
+    int getBaseFaceSize() const { return baseFaceSize; }
+    size_t getMemoryBytes() const; // Every tier
+
+private:
+    GLuint FBOs[TIER_COUNT];
+    GLuint textures[TIER_COUNT];
+    int baseFaceSize;
+    bool linearFiltering;
+    ShadowSlotAllocator allocator;
+
+    void release();
+};
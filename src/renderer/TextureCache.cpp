@@ -0,0 +1,413 @@
+#include "TextureCache.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#define STB_IMAGE_IMPLEMENTATION
+#include "../utils/stb_image.h"
+
+// The S3TC enums only exist in a glad loader generated with EXT_texture_compression_s3tc;
+// the guards keep this file building against one generated without it.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+
+namespace {
+    bool readFile(const std::string& path, std::vector<unsigned char>& data)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) return false;
+        std::streamsize size = file.tellg();
+        if (size <= 0) return false;
+        data.resize(static_cast<size_t>(size));
+        file.seekg(0);
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+    }
+
+    bool fileExists(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return file.is_open();
+    }
+
+    bool hasExtension(const std::string& path, const char* extension)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos) return false;
+        std::string ext = path.substr(dot);
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return ext == extension;
+    }
+
+    // Path without its extension, so the .ktx2/.dds and the original sit under the same stem.
+    std::string stemOf(const std::string& path)
+    {
+        size_t dot = path.find_last_of('.');
+        size_t slash = path.find_last_of("/\\");
+        return (dot != std::string::npos && (slash == std::string::npos || dot > slash)) ? path.substr(0, dot) : path;
+    }
+
+    uint32_t read32(const std::vector<unsigned char>& data, size_t offset)
+    {
+        uint32_t value;
+        std::memcpy(&value, data.data() + offset, sizeof(value));
+        return value;
+    }
+
+    uint64_t read64(const std::vector<unsigned char>& data, size_t offset)
+    {
+        uint64_t value;
+        std::memcpy(&value, data.data() + offset, sizeof(value));
+        return value;
+    }
+
+    // base is 0 when the data sits in the bound pixel buffer, so offsets become buffer offsets.
+    const void* levelPointer(const void* base, size_t offset)
+    {
+        return reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(base) + offset);
+    }
+
+    // Both formats use 4x4 blocks, 8 bytes (BC1) or 16 bytes (BC7) each.
+    size_t compressedLevelSize(GLenum format, int width, int height)
+    {
+        size_t blockBytes = format == GL_COMPRESSED_RGBA_BPTC_UNORM ? 16 : 8;
+        return static_cast<size_t>(std::max(1, (width + 3) / 4)) * static_cast<size_t>(std::max(1, (height + 3) / 4)) * blockBytes;
+    }
+
+    // Rejects header sizes and mip counts that don't describe a real mip chain (glTexStorage2D
+    // takes the count as is, and a bogus one would only fail there).
+    bool validDimensions(int width, int height, int levelCount)
+    {
+        if (width <= 0 || height <= 0) return false;
+        int maxLevels = 1;
+        for (int size = std::max(width, height); size > 1; size /= 2) ++maxLevels;
+        return levelCount <= maxLevels;
+    }
+
+    // Fills the levels from a tightly packed mip chain starting at offset, checking it fits in the file.
+    bool packedLevels(TextureImage& image, size_t offset, int levelCount)
+    {
+        int width = image.width, height = image.height;
+        for (int level = 0; level < levelCount; ++level) {
+            TextureImage::Level entry;
+            entry.offset = offset;
+            entry.size = compressedLevelSize(image.compressedFormat, width, height);
+            entry.width = width;
+            entry.height = height;
+            if (entry.offset + entry.size > image.data.size()) return false;
+            image.levels.push_back(entry);
+
+            offset += entry.size;
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        return true;
+    }
+
+    // The PNG path uploads as linear RGBA8, so sRGB-tagged files map to the UNORM formats to look the same.
+    bool decodeDDS(TextureImage& image)
+    {
+        const std::vector<unsigned char>& data = image.data;
+        if (data.size() < 128 || std::memcmp(data.data(), "DDS ", 4) != 0 || read32(data, 4) != 124) return false;
+
+        image.height = static_cast<int>(read32(data, 12));
+        image.width = static_cast<int>(read32(data, 16));
+        int levelCount = std::max(1, static_cast<int>(read32(data, 28)));
+        uint32_t pixelFormatFlags = read32(data, 80);
+        const unsigned char* fourCC = data.data() + 84;
+        size_t offset = 128;
+        if (!validDimensions(image.width, image.height, levelCount)) return false;
+
+        const uint32_t DDPF_ALPHAPIXELS = 0x1;
+        if (std::memcmp(fourCC, "DXT1", 4) == 0) {
+            image.compressedFormat = (pixelFormatFlags & DDPF_ALPHAPIXELS) ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        } else if (std::memcmp(fourCC, "DX10", 4) == 0) {
+            if (data.size() < 148) return false;
+            uint32_t dxgiFormat = read32(data, 128);
+            offset = 148;
+            if (dxgiFormat >= 70 && dxgiFormat <= 72) {         // BC1 typeless/unorm/srgb
+                image.compressedFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            } else if (dxgiFormat >= 97 && dxgiFormat <= 99) {  // BC7 typeless/unorm/srgb
+                image.compressedFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+            } else {
+                std::cerr << "Unsupported DDS format (DXGI " << dxgiFormat << "): " << image.file << std::endl;
+                return false;
+            }
+        } else {
+            std::cerr << "Unsupported DDS format (only BC1 and BC7): " << image.file << std::endl;
+            return false;
+        }
+
+        return packedLevels(image, offset, levelCount);
+    }
+
+    bool decodeKTX2(TextureImage& image)
+    {
+        static const unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+        const std::vector<unsigned char>& data = image.data;
+        if (data.size() < 80 || std::memcmp(data.data(), IDENTIFIER, sizeof(IDENTIFIER)) != 0) return false;
+
+        uint32_t vkFormat = read32(data, 12);
+        image.width = static_cast<int>(read32(data, 20));
+        image.height = static_cast<int>(read32(data, 24));
+        uint32_t depth = read32(data, 28);
+        uint32_t layers = read32(data, 32);
+        uint32_t faces = read32(data, 36);
+        int levelCount = std::max(1, static_cast<int>(read32(data, 40)));
+        uint32_t supercompression = read32(data, 44);
+
+        if (depth > 1 || layers > 1 || faces != 1 || supercompression != 0) {
+            std::cerr << "Unsupported KTX2 texture (only plain 2D, no supercompression): " << image.file << std::endl;
+            return false;
+        }
+        if (!validDimensions(image.width, image.height, levelCount)) return false;
+
+        switch (vkFormat) {
+            case 131: case 132: image.compressedFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;  // BC1_RGB unorm/srgb
+            case 133: case 134: image.compressedFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break; // BC1_RGBA unorm/srgb
+            case 145: case 146: image.compressedFormat = GL_COMPRESSED_RGBA_BPTC_UNORM; break;    // BC7 unorm/srgb
+            default:
+                std::cerr << "Unsupported KTX2 format (VkFormat " << vkFormat << "): " << image.file << std::endl;
+                return false;
+        }
+
+        // Level index right after the header, level 0 (the largest) first.
+        if (data.size() < 80 + static_cast<size_t>(levelCount) * 24) return false;
+        int width = image.width, height = image.height;
+        for (int level = 0; level < levelCount; ++level) {
+            TextureImage::Level entry;
+            entry.offset = static_cast<size_t>(read64(data, 80 + level * 24));
+            entry.size = static_cast<size_t>(read64(data, 80 + level * 24 + 8));
+            entry.width = width;
+            entry.height = height;
+            if (entry.size < compressedLevelSize(image.compressedFormat, width, height) ||
+                entry.offset > data.size() || entry.size > data.size() - entry.offset) {
+                return false;
+            }
+            image.levels.push_back(entry);
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        return true;
+    }
+}
+
+TextureResource::~TextureResource()
+{
+    // A handle still resident would keep the texture alive.
+    if (handle) glMakeTextureHandleNonResidentARB(handle);
+    if (id) glDeleteTextures(1, &id);
+}
+
+TextureCache::TextureCache(bool bindless)
+    : pixelBuffer(0), bindless(bindless)
+{
+    glGenBuffers(1, &pixelBuffer);
+}
+
+TextureCache::~TextureCache()
+{
+    if (pixelBuffer) glDeleteBuffers(1, &pixelBuffer);
+}
+
+std::string TextureCache::resolve(const std::string& directory, const std::string& name)
+{
+    std::string filename = directory + '/' + name;
+
+    // Try multiple possible paths since the executable might be in build/Release/
+    const std::string possiblePaths[] = {
+        filename,
+        "../../" + filename,  // From build/Release/ back to project root
+        "../" + filename      // From build/ back to project root
+    };
+
+    for (const auto& path : possiblePaths) {
+        std::string stem = stemOf(path);
+        for (const char* extension : { ".ktx2", ".dds" }) {
+            if (fileExists(stem + extension)) return stem + extension;
+        }
+        if (fileExists(path)) return path;
+    }
+    return std::string();
+}
+
+bool TextureCache::decode(const std::string& file, TextureImage& image)
+{
+    image = TextureImage();
+    image.file = file;
+
+    std::string source = file;
+    if (hasExtension(file, ".dds") || hasExtension(file, ".ktx2")) {
+        if (readFile(file, image.data) && (hasExtension(file, ".dds") ? decodeDDS(image) : decodeKTX2(image))) return true;
+
+        // A broken compressed file falls back to the original it was made from, still keyed by file.
+        image = TextureImage();
+        image.file = file;
+        source.clear();
+        std::string stem = stemOf(file);
+        for (const char* extension : { ".png", ".jpg", ".jpeg", ".tga", ".bmp" }) {
+            if (fileExists(stem + extension)) {
+                source = stem + extension;
+                break;
+            }
+        }
+        std::cerr << "Invalid compressed texture: " << file;
+        if (!source.empty()) std::cerr << ", using " << source;
+        std::cerr << std::endl;
+        if (source.empty()) return false;
+    }
+
+    int width, height, nrComponents;
+    unsigned char* pixels = stbi_load(source.c_str(), &width, &height, &nrComponents, 0);
+    if (!pixels) {
+        std::cout << "Texture failed to load at path: " << source << std::endl;
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.channels = nrComponents;
+    image.data.assign(pixels, pixels + static_cast<size_t>(width) * height * nrComponents);
+    stbi_image_free(pixels);
+
+    TextureImage::Level level;
+    level.size = image.data.size();
+    level.width = width;
+    level.height = height;
+    image.levels.push_back(level);
+    return true;
+}
+
+std::shared_ptr<TextureResource> TextureCache::find(const std::string& file) const
+{
+    auto it = entries.find(file);
+    return it != entries.end() ? it->second.lock() : nullptr;
+}
+
+std::shared_ptr<TextureResource> TextureCache::upload(const TextureImage& image)
+{
+    size_t bytes = 0;
+    GLuint id = image.isCompressed() ? createCompressed(image, bytes) : createUncompressed(image, bytes);
+    if (!id) return nullptr;
+
+    auto resource = std::make_shared<TextureResource>();
+    resource->id = id;
+    resource->file = image.file;
+    resource->bytes = bytes;
+    // The handle freezes the texture's state, which is final by now.
+    if (bindless) {
+        resource->handle = glGetTextureHandleARB(id);
+        if (resource->handle) glMakeTextureHandleResidentARB(resource->handle);
+    }
+    entries[image.file] = resource;
+    return resource;
+}
+
+size_t TextureCache::getTextureCount() const
+{
+    size_t count = 0;
+    for (const auto& entry : entries) {
+        if (!entry.second.expired()) ++count;
+    }
+    return count;
+}
+
+size_t TextureCache::getMemoryBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& entry : entries) {
+        if (auto resource = entry.second.lock()) bytes += resource->bytes;
+    }
+    return bytes;
+}
+
+// Returns the base address for the level offsets: 0 inside the bound pixel buffer, or the client copy if mapping failed.
+const void* TextureCache::stage(const TextureImage& image)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, image.data.size(), nullptr, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, image.data.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        std::memcpy(mapped, image.data.data(), image.data.size());
+        if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) return nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return image.data.data();
+}
+
+// Immutable storage with the full mip chain, level 0 uploaded and the rest generated.
+GLuint TextureCache::createUncompressed(const TextureImage& image, size_t& bytes)
+{
+    GLenum internalFormat, format;
+    switch (image.channels) {
+        case 1: internalFormat = GL_R8; format = GL_RED; break;
+        case 2: internalFormat = GL_RG8; format = GL_RG; break;
+        case 3: internalFormat = GL_RGB8; format = GL_RGB; break;
+        case 4: internalFormat = GL_RGBA8; format = GL_RGBA; break;
+        default:
+            std::cerr << "Unsupported texture format (" << image.channels << " channels): " << image.file << std::endl;
+            return 0;
+    }
+
+    int levels = 1 + static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(image.width, image.height)))));
+    bytes = 0;
+    for (int level = 0, w = image.width, h = image.height; level < levels; ++level, w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        bytes += static_cast<size_t>(w) * h * image.channels;
+    }
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, image.width, image.height);
+
+    // Rows of RGB images aren't 4-byte aligned.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const void* base = stage(image);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE, levelPointer(base, 0));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+// Block-compressed levels go up as stored; no mip generation, the file's chain is used as is.
+GLuint TextureCache::createCompressed(const TextureImage& image, size_t& bytes)
+{
+    GLsizei levels = static_cast<GLsizei>(image.levels.size());
+    bytes = 0;
+    for (const auto& level : image.levels) bytes += level.size;
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, levels, image.compressedFormat, image.width, image.height);
+
+    const void* base = stage(image);
+    for (GLsizei i = 0; i < levels; ++i) {
+        const auto& level = image.levels[i];
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.width, level.height, image.compressedFormat,
+                                  static_cast<GLsizei>(compressedLevelSize(image.compressedFormat, level.width, level.height)),
+                                  levelPointer(base, level.offset));
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One GL texture shared by every model that uses the same file. Deleted with the last reference.
+struct TextureResource {
+    GLuint id = 0;
+    std::string file;
+    size_t bytes = 0;   // All mip levels as stored on the GPU (before driver padding)
+    GLuint64 handle = 0; // Resident bindless handle, 0 unless the cache was created with bindless on
+
+    TextureResource() = default;
+    ~TextureResource();
+    TextureResource(const TextureResource&) = delete;
+    TextureResource& operator=(const TextureResource&) = delete;
+};
+
+// CPU side of a texture, produced by TextureCache::decode() on any thread.
+struct TextureImage {
+    struct Level {
+        size_t offset = 0;
+        size_t size = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    std::string file;
+    int width = 0;
+    int height = 0;
+    int channels = 0;               // Uncompressed images: 1-4, mips are generated on upload
+    GLenum compressedFormat = 0;    // BC1/BC7 from a DDS/KTX2 file, with its own mip chain in levels
+    std::vector<Level> levels;
+    std::vector<unsigned char> data;
+
+    bool isCompressed() const { return compressedFormat != 0; }
+};
+
+// Renderer-wide texture cache, keyed by the resolved file path.
+// Entries are weak: the models hold the references, and a texture nobody uses any more is freed and
+// simply loaded again if it's needed later. GL thread only, except for the static resolve()/decode().
+class TextureCache
+{
+public:
+    // bindless: every uploaded texture also gets a resident GL_ARB_bindless_texture handle.
+    explicit TextureCache(bool bindless = false);
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // Finds name (relative to directory) on disk, preferring a pre-compressed .ktx2 or .dds next to it.
+    // Empty if there's no such file.
+    static std::string resolve(const std::string& directory, const std::string& name);
+
+    // Reads a PNG/JPG/... (stb_image), DDS or KTX2 file. A malformed DDS/KTX2 falls back to an
+    // uncompressed image with the same stem, if there is one. No GL calls.
+    static bool decode(const std::string& file, TextureImage& image);
+
+    // Live texture for the file, or nullptr.
+    std::shared_ptr<TextureResource> find(const std::string& file) const;
+
+    // Uploads the image and registers it. nullptr if the format isn't supported.
+    std::shared_ptr<TextureResource> upload(const TextureImage& image);
+
+    size_t getTextureCount() const;
+    size_t getMemoryBytes() const;
+
+private:
+    std::unordered_map<std::string, std::weak_ptr<TextureResource>> entries;
+    GLuint pixelBuffer;
+    bool bindless;
+
+    // Level data goes through this pixel buffer, orphaned on every upload so a transfer still in
+    // flight never stalls the next memcpy.
+    const void* stage(const TextureImage& image);
+    GLuint createUncompressed(const TextureImage& image, size_t& bytes);
+    GLuint createCompressed(const TextureImage& image, size_t& bytes);
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// CPU mirrors of the std140 uniform blocks and std430 storage blocks declared in assets/shaders/common/*.glsl.
+// Member order is chosen so every vec3 is followed by a scalar: that way the C++ layout
+// matches std140/std430 without hidden padding. Keep both sides in sync when adding fields.
+
+// Binding points (layout (std140, binding = N) in GLSL).
+enum UniformBlockBinding : unsigned int {
+    FRAME_BLOCK_BINDING = 0,
+    LIGHT_BLOCK_BINDING = 1
+};
+
+// Binding points (layout (std430, binding = N) in GLSL).
+enum ShaderStorageBinding : unsigned int {
+    INSTANCE_BUFFER_BINDING = 0,
+    MATERIAL_BUFFER_BINDING = 1,
+    VISIBLE_INSTANCE_BINDING = 2, // uint indices into the instance buffer, rewritten per pass after culling
+    LIGHT_TILE_BINDING = 3,       // One light bitmask per screen tile, written by the light culling compute pass
+    MODEL_BUFFER_BINDING = 4,     // Per-model position dequantization, indexed by the instance's model id
+    LIGHT_BUFFER_BINDING = 5,     // lights[], patched per changed light
+    // Occlusion culling of the geometry pass (assets/shaders/culling/occlusion_cull.comp)
+    OCCLUSION_CANDIDATE_BINDING = 6,  // Frustum-culled ids with the first id of their run
+    OCCLUSION_COUNT_BINDING = 7,      // Survivors per run and phase
+    INSTANCE_VISIBILITY_BINDING = 8,  // Per scene instance: passed the last occlusion test
+    INDIRECT_COMMAND_BINDING = 9      // The indirect buffer, to write the instance counts
+};
+
+// Entry layout of the visible instance list: instance index in the low bits, target layer of layered passes on top.
+static const uint32_t VISIBLE_INSTANCE_LAYER_SHIFT = 29;
+static const uint32_t VISIBLE_INSTANCE_INDEX_MASK = (1u << VISIBLE_INSTANCE_LAYER_SHIFT) - 1u;
+
+// Same as MAX_LIGHTS in light_block.glsl, and LightManager's own limit.
+static const size_t LIGHT_BUFFER_MAX_LIGHTS = 512;
+
+// Same as LIGHT_TILE_SIZE / LIGHT_TILE_WORDS in light_tiles.glsl (and the compute work group size of light_culling.comp).
+// Every tile has a bitmask of LIGHT_TILE_WORDS uints, bit i of word w is lights[w * 32 + i].
+static const int LIGHT_TILE_SIZE = 16;
+static const size_t LIGHT_TILE_WORDS = LIGHT_BUFFER_MAX_LIGHTS / 32;
+static_assert(LIGHT_BUFFER_MAX_LIGHTS % 32 == 0, "Light tile masks are whole uints");
+
+// Same as MAX_CASCADES / MAX_CASCADED_LIGHTS in light_block.glsl.
+// Directional lights with cascades at the same time (sun and moon overlap at dusk), and cascades per light.
+static const size_t SHADOW_CASCADED_LIGHTS = 2;
+static const size_t SHADOW_CASCADE_COUNT = 4;
+
+// assets/shaders/common/frame_block.glsl
+// Camera and shadow settings, written once per frame and read by every program.
+struct FrameBlockData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 inverseViewProjection;
+
+    glm::vec3 viewPos;
+    float shadowBias;
+
+    float shadowNormalBias;
+    int32_t shadowPCFSamples;
+    float shadowIntensity;
+    int32_t enablePCF;       // bool in GLSL (4 bytes in std140)
+
+    float shadowFarPlane;
+    int32_t renderWidth;     // Internal resolution, <= the render target size with dynamic resolution
+    int32_t renderHeight;
+    float padding;
+};
+static_assert(sizeof(FrameBlockData) == 240, "FrameBlockData must match the std140 layout of FrameBlock");
+
+// One element of lights[] in assets/shaders/common/light_block.glsl (std430, LightBuffer)
+struct GPULight {
+    glm::vec3 position;
+    int32_t type;
+
+    glm::vec3 direction;
+    float intensity;
+
+    glm::vec3 color;
+    float constant;
+
+    float linear;
+    float quadratic;
+    float cutOff;
+    float outerCutOff;
+
+    int32_t castShadows;     // bool in GLSL, only set when the light got a shadow slot this frame
+    int32_t shadowTier;      // Resolution tier of the slot (picks the cube array for point lights)
+    int32_t shadowLayer;     // Cube index inside that tier's cube array, or cascade slot of directional lights
+    float range;             // Distance where the attenuation falls under the shading cutoff, for light culling
+
+    glm::vec4 shadowRect;    // Atlas tile of spot lights: xy = offset, zw = scale (texture space)
+
+    glm::mat4 lightSpaceMatrix; // World to shadow map of spot lights
+};
+static_assert(sizeof(GPULight) == 160, "GPULight must match the std430 array stride of Light");
+
+// assets/shaders/common/light_block.glsl
+// What isn't per light. Only re-uploaded when the light count or the cascades change.
+struct LightBlockData {
+    glm::mat4 cascadeMatrices[SHADOW_CASCADED_LIGHTS * SHADOW_CASCADE_COUNT]; // Cascade slot * SHADOW_CASCADE_COUNT + cascade
+    int32_t numLights;
+    int32_t cascadeCount;    // Cascades in use, <= SHADOW_CASCADE_COUNT
+    int32_t padding[2];
+};
+static_assert(sizeof(LightBlockData) == 528, "LightBlockData must match the std140 layout of LightBlock");
+
+// One element of instances[] in assets/shaders/common/scene_data.glsl
+// Read in the vertex shaders as instances[gl_BaseInstance + gl_InstanceID].
+struct GPUInstance {
+    glm::mat4 model;
+    uint32_t materialId;     // Index into materials[]
+    uint32_t modelId;        // Index into models[]
+    uint32_t padding[2];     // std430 rounds the struct up to its 16 byte alignment
+};
+static_assert(sizeof(GPUInstance) == 80, "GPUInstance must match the std430 array stride of InstanceData");
+
+// One element of models[] in assets/shaders/common/scene_data.glsl
+// Vertex positions are unorm16 inside the model's bounding box: position = positionMin + quantized * positionExtent.
+struct GPUModel {
+    glm::vec4 positionMin;   // w unused
+    glm::vec4 positionExtent;
+    uint32_t diffuseTexture[2]; // Bindless handle (low, high word), 0 when untextured or without bindless textures
+    uint32_t padding[2];
+};
+static_assert(sizeof(GPUModel) == 48, "GPUModel must match the std430 array stride of ModelData");
+
+// One element of materials[] in assets/shaders/common/scene_data.glsl
+struct GPUMaterial {
+    glm::vec3 albedo;
+    float roughness;
+
+    float specularShininess;
+    int32_t materialType;    // IlluminationModel
+    float minnaertK;
+    float orenNayarRoughness;
+
+    float ashikhminShirleyNu;
+    float ashikhminShirleyNv;
+    float cookTorranceRoughness;
+    float cookTorranceF0;
+
+    float intensityCorrection;
+    float ambientOcclusion;
+    float padding[2];
+};
+static_assert(sizeof(GPUMaterial) == 64, "GPUMaterial must match the std430 array stride of MaterialData");
@@ -0,0 +1,37 @@
+#include "UniformBuffer.h"
+#include <iostream>
+
+UniformBuffer::UniformBuffer(GLsizeiptr size, GLuint binding)
+    : ubo(0), binding(binding), size(size)
+{
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    bind();
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    if (ubo) {
+        glDeleteBuffers(1, &ubo);
+    }
+}
+
+void UniformBuffer::update(const void* data, GLsizeiptr dataSize, GLintptr offset)
+{
+    if (offset + dataSize > size) {
+        std::cerr << "UniformBuffer::update out of range (binding " << binding << ")" << std::endl;
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, dataSize, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::bind() const
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Thin owner of a GL uniform buffer that stays bound to a fixed binding point.
+// Shaders pick it up with layout (std140, binding = N), so no glUniformBlockBinding calls are needed per program.
+class UniformBuffer
+{
+public:
+    UniformBuffer(GLsizeiptr size, GLuint binding);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // Single glBufferSubData, data must follow the std140 layout of the block.
+    void update(const void* data, GLsizeiptr dataSize, GLintptr offset = 0);
+
+    // Re-attach to the binding point (only needed if someone else bound a buffer there).
+    void bind() const;
+
+    GLuint getID() const { return ubo; }
+    GLuint getBinding() const { return binding; }
+    GLsizeiptr getSize() const { return size; }
+
+private:
+    GLuint ubo;
+    GLuint binding;
+    GLsizeiptr size;
+};
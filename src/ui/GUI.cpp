@@ -4,6 +4,8 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include <iostream>
+#include <algorithm>
+#include <functional>
 
 GUI::GUI(GLFWwindow* window) : window(window), renderer(nullptr)
 {
@@ -37,6 +39,7 @@ void GUI::render()
         if (showGlobalParams) renderGlobalParamsWindow();
         if (showShadows) renderShadowsWindow();
         if (showPresets) renderPresetsWindow();
+        if (showProfiler) renderProfilerWindow();
     }
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -52,6 +55,7 @@ void GUI::renderMainMenu()
             ImGui::MenuItem("Global Parameters", nullptr, &showGlobalParams);
             ImGui::MenuItem("Shadows", nullptr, &showShadows);
             ImGui::MenuItem("Presets", nullptr, &showPresets);
+            ImGui::MenuItem("Profiler", nullptr, &showProfiler);
             ImGui::EndMenu();
         }
         ImGui::EndMainMenuBar();
@@ -62,7 +66,7 @@ void GUI::renderMainMenu()
 void GUI::renderPerformanceWindow()
 {
     ImGui::SetNextWindowPos(ImVec2(10, 30), ImGuiCond_FirstUseEver);
-    ImGui::SetNextWindowSize(ImVec2(280, 150), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(300, 250), ImGuiCond_FirstUseEver);
     ImGui::Begin("Performance", &showPerformance);
     
     // Frametime and FPS
@@ -72,7 +76,97 @@ void GUI::renderPerformanceWindow()
     // Renderer stats
     const auto& stats = renderer->getStats();
     ImGui::Text("Vertices: %u", stats.vertexCount);
+    ImGui::Text("Triangles: %u", stats.triangleCount);
     ImGui::Text("Draw calls: %u", stats.drawCalls);
+    ImGui::Text("Instances: %u visible, %u culled", stats.visibleInstances, stats.culledInstances);
+    ImGui::Text("Shadow instances: %u visible, %u culled", stats.shadowVisibleInstances, stats.shadowCulledInstances);
+    ImGui::Text("Shadow map updates: %u (%u deferred)", stats.shadowMapUpdates, stats.shadowMapsDeferred);
+    ImGui::Text("G-Buffer: %s", renderer->getGBuffer()->isCompact() ? "compact (12 B/px)" : "standard (32 B/px)");
+    if (const FrameGraph* graph = renderer->getFrameGraph()) {
+        ImGui::Text("Frame graph: %zu/%zu passes, %zu targets on %zu textures (%.1f MB)",
+                    graph->getPassCount() - graph->getCulledPassCount(), graph->getPassCount(),
+                    graph->getTransientCount(), graph->getPooledTextureCount(),
+                    graph->getPoolMemoryBytes() / (1024.0 * 1024.0));
+    }
+    if (const AssetLoader* assets = renderer->getAssetLoader()) {
+        if (!assets->isIdle()) {
+            ImGui::Text("Streaming assets: %zu/%zu models, %zu textures queued",
+                        assets->getFinishedCount(), assets->getRequestedCount(), assets->getPendingTextureCount());
+        }
+    }
+    if (const TextureCache* textures = renderer->getTextureCache()) {
+        ImGui::Text("Textures: %zu (%.1f MB)", textures->getTextureCount(),
+                    textures->getMemoryBytes() / (1024.0 * 1024.0));
+    }
+    ImGui::Checkbox("Multi-draw indirect", &renderer->useIndirectDraws);
+    ImGui::TextDisabled("Bindless textures: %s", renderer->usesBindlessTextures() ? "on" : "unsupported, one draw per texture");
+    ImGui::Checkbox("Frustum culling", &renderer->enableFrustumCulling);
+    ImGui::Checkbox("Occlusion culling (Hi-Z)", &renderer->enableOcclusionCulling);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Needs multi-draw indirect. Instance stats still count the frustum survivors.");
+    ImGui::Checkbox("Mesh LODs", &renderer->lodParams.enabled);
+    if (renderer->lodParams.enabled) {
+        ImGui::SliderFloat("LOD 1 below screen size", &renderer->lodParams.screenSize, 0.02f, 1.0f, "%.2f");
+        ImGui::SliderFloat("LOD hysteresis", &renderer->lodParams.hysteresis, 0.0f, 0.5f, "%.2f");
+        ImGui::SliderInt("Shadow LOD bias", &renderer->lodParams.shadowBias, 0, MeshBuilder::MAX_LODS - 1);
+    }
+    ImGui::Checkbox("Tiled light culling", &renderer->enableLightCulling);
+    ImGui::Checkbox("Fused lighting + outlines (compute)", &renderer->useFusedLighting);
+    ImGui::Checkbox("Shader hot reload", &renderer->enableShaderHotReload);
+    
+    // Internal resolution
+    ImGui::Separator();
+    auto& dynamicResolution = renderer->dynamicResolution;
+    ImGui::Text("Render %ux%u (%.0f%%), GPU %.2f ms", renderer->getRenderWidth(), renderer->getRenderHeight(),
+                renderer->getRenderScale() * 100.0f, renderer->getGpuFrameTime());
+    ImGui::Checkbox("Dynamic resolution", &dynamicResolution.enabled);
+    if (dynamicResolution.enabled) {
+        const int targetRates[] = { 30, 60, 120, 144 };
+        const char* targetLabels[] = { "30 Hz", "60 Hz", "120 Hz", "144 Hz" };
+        int targetIndex = 1;
+        for (int i = 0; i < 4; ++i) {
+            if (static_cast<int>(dynamicResolution.targetFrameRate) == targetRates[i]) targetIndex = i;
+        }
+        if (ImGui::Combo("Target", &targetIndex, targetLabels, 4)) {
+            dynamicResolution.targetFrameRate = static_cast<float>(targetRates[targetIndex]);
+        }
+        ImGui::SliderFloat("Min scale", &dynamicResolution.minScale, 0.25f, 1.0f);
+        ImGui::SliderFloat("Max scale", &dynamicResolution.maxScale, dynamicResolution.minScale, 1.0f);
+    } else {
+        ImGui::SliderFloat("Render scale", &dynamicResolution.fixedScale, 0.25f, 1.0f);
+    }
+    ImGui::Checkbox("Sharp outline upsampling", &dynamicResolution.sharpenEdges);
+    
+    ImGui::Separator();
+    // What the renderer allocated, per category, and the driver's view of the whole device.
+    if (ImGui::CollapsingHeader("Video memory")) {
+        const GpuMemoryReport& memory = renderer->getMemoryReport();
+        for (size_t i = 0; i < GpuMemoryReport::CATEGORY_COUNT; ++i) {
+            auto category = static_cast<GpuMemoryCategory>(i);
+            ImGui::Text("%s: %.1f MB", GpuMemoryReport::getCategoryName(category), memory[category] / (1024.0 * 1024.0));
+        }
+        ImGui::Text("Total: %.1f MB", memory.getTotalBytes() / (1024.0 * 1024.0));
+        if (memory.stagedBytes > 0) {
+            ImGui::Text("Waiting for upload (CPU): %.1f MB", memory.stagedBytes / (1024.0 * 1024.0));
+        }
+        if (memory.driverDedicatedBytes > 0) {
+            ImGui::Text("Driver (%s): %.0f of %.0f MB free", memory.driverSource,
+                        memory.driverAvailableBytes / (1024.0 * 1024.0), memory.driverDedicatedBytes / (1024.0 * 1024.0));
+        } else if (memory.hasDriverInfo()) {
+            ImGui::Text("Driver (%s): %.0f MB free", memory.driverSource, memory.driverAvailableBytes / (1024.0 * 1024.0));
+        } else {
+            ImGui::TextDisabled("Driver memory info: unsupported");
+        }
+
+        auto& budget = renderer->memoryBudget;
+        ImGui::Checkbox("Memory budget", &budget.enabled);
+        if (budget.enabled) {
+            ImGui::SliderInt("Budget (MB)", &budget.budgetMB, 128, 8192);
+            ImGui::Checkbox("Lower shadow sizes to fit", &budget.autoDowngradeShadows);
+            if (renderer->isOverMemoryBudget()) {
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.3f, 1.0f), "Over budget");
+            }
+        }
+    }
     
     if (camera) {
         ImGui::Separator();
@@ -86,6 +180,83 @@ void GUI::renderPerformanceWindow()
     ImGui::End();
 }
 
+// Per-pass CPU/GPU times: a timeline of the frame (one row per nesting level) and the averages as a table.
+void GUI::renderProfilerWindow()
+{
+    ImGui::SetNextWindowPos(ImVec2(10, 290), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(460, 380), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Profiler", &showProfiler);
+    
+    Profiler& profiler = renderer->getProfiler();
+    ImGui::Checkbox("Enabled", &profiler.enabled);
+    ImGui::SameLine();
+    ImGui::TextDisabled("(%u frames dropped)", profiler.getDroppedFrames());
+    
+    const auto& scopes = profiler.getScopes();
+    if (scopes.empty()) {
+        ImGui::Text("Waiting for GPU results...");
+        ImGui::End();
+        return;
+    }
+    
+    ImGui::RadioButton("GPU timeline", &profilerTimeline, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton("CPU timeline", &profilerTimeline, 1);
+    
+    // Timeline, scaled so the frame scope spans the whole width
+    bool gpu = profilerTimeline == 0;
+    float frameMs = std::max(gpu ? scopes.front().gpuMs : scopes.front().cpuMs, 0.001f);
+    int maxDepth = 0;
+    for (const auto& scope : scopes) maxDepth = std::max(maxDepth, scope.depth);
+    
+    const ImU32 palette[] = {
+        IM_COL32(86, 156, 214, 255), IM_COL32(78, 201, 176, 255), IM_COL32(220, 170, 90, 255),
+        IM_COL32(197, 134, 192, 255), IM_COL32(214, 110, 100, 255), IM_COL32(150, 190, 90, 255)
+    };
+    const size_t paletteSize = sizeof(palette) / sizeof(palette[0]);
+    
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float graphWidth = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+    float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    
+    for (const auto& scope : scopes) {
+        float start = gpu ? scope.gpuStartMs : scope.cpuStartMs;
+        float duration = gpu ? scope.gpuMs : scope.cpuMs;
+        ImVec2 rectMin(origin.x + start / frameMs * graphWidth, origin.y + scope.depth * rowHeight);
+        ImVec2 rectMax(rectMin.x + std::max(duration / frameMs * graphWidth, 1.0f), rectMin.y + rowHeight - 1.0f);
+        
+        drawList->AddRectFilled(rectMin, rectMax, palette[std::hash<std::string>{}(scope.name) % paletteSize]);
+        if (ImGui::CalcTextSize(scope.name.c_str()).x < rectMax.x - rectMin.x - 4.0f) {
+            drawList->AddText(ImVec2(rectMin.x + 2.0f, rectMin.y), IM_COL32(20, 20, 20, 255), scope.name.c_str());
+        }
+        if (ImGui::IsMouseHoveringRect(rectMin, rectMax)) {
+            ImGui::SetTooltip("%s\nGPU %.3f ms\nCPU %.3f ms", scope.name.c_str(), scope.gpuMs, scope.cpuMs);
+        }
+    }
+    ImGui::Dummy(ImVec2(graphWidth, rowHeight * (maxDepth + 1)));
+    
+    // Rolling averages
+    if (ImGui::BeginTable("ProfilerScopes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("GPU ms", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+        ImGui::TableSetupColumn("CPU ms", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+        ImGui::TableHeadersRow();
+        for (const auto& scope : scopes) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%*s%s", scope.depth * 2, "", scope.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.gpuMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.cpuMs);
+        }
+        ImGui::EndTable();
+    }
+    
+    ImGui::End();
+}
+
 // Lights
 void GUI::renderLightingWindow()
 {
@@ -101,7 +272,7 @@ void GUI::renderLightingWindow()
     for (size_t i = 0; i < lightManager.getLightCount(); ++i) {
         ImGui::PushID(static_cast<int>(i));
         
-        auto& light = lightManager.getLight(i);
+        Light light = lightManager.getLight(i);
         
         std::string headerLabel = "Light " + std::to_string(i);
         
@@ -114,42 +285,46 @@ void GUI::renderLightingWindow()
         headerLabel += typeIndicator;
         
         if (ImGui::CollapsingHeader(headerLabel.c_str())) {
-            ImGui::Checkbox("Cast Shadows", &light.castShadows);
+            // Edits go to a copy, written back with updateLight() so the renderer re-uploads just this light.
+            bool changed = false;
+
+            changed |= ImGui::Checkbox("Cast Shadows", &light.castShadows);
             ImGui::Separator();
             
             const char* lightTypes[] = { "Directional", "Point", "Spot" };
             int currentType = static_cast<int>(light.type);
             if (ImGui::Combo("Type", &currentType, lightTypes, 3)) {
                 light.type = static_cast<LightType>(currentType);
+                changed = true;
             }
             
             if (light.type != LightType::DIRECTIONAL) {
-                ImGui::SliderFloat3("Position", &light.position.x, -10.0f, 10.0f);
+                changed |= ImGui::SliderFloat3("Position", &light.position.x, -10.0f, 10.0f);
             }
             
             if (light.type != LightType::POINT) {
-                ImGui::SliderFloat3("Direction", &light.direction.x, -1.0f, 1.0f);
+                changed |= ImGui::SliderFloat3("Direction", &light.direction.x, -1.0f, 1.0f);
             }
             
-            ImGui::ColorEdit3("Color", &light.color.x);
+            changed |= ImGui::ColorEdit3("Color", &light.color.x);
             
             // Special Effects Controls
-            ImGui::Checkbox("Fire Flicker", &light.flicker);
+            changed |= ImGui::Checkbox("Fire Flicker", &light.flicker);
             if (ImGui::IsItemHovered()) ImGui::SetTooltip("Varies intensity and color to simulate fire");
             
             ImGui::SameLine();
-            ImGui::Checkbox("Static (Cache Shadows)", &light.isStatic);
+            changed |= ImGui::Checkbox("Static (Cache Shadows)", &light.isStatic);
             if (ImGui::IsItemHovered()) ImGui::SetTooltip("Assume fixed position for shadow optimization");
             
-            ImGui::SliderFloat("Intensity", &light.intensity, 0.0f, 5.0f);
+            changed |= ImGui::SliderFloat("Intensity", &light.intensity, 0.0f, 5.0f);
             
             // Attenuation for point and spot lights
             // TODO: Using standard quadratic attenuation: 1 / (c + l*d + q*d^2) but i may change this later
             if (light.type != LightType::DIRECTIONAL) {
                 if (ImGui::TreeNode("Attenuation")) {
-                    ImGui::SliderFloat("Constant", &light.constant, 0.1f, 2.0f);
-                    ImGui::SliderFloat("Linear", &light.linear, 0.01f, 1.0f);
-                    ImGui::SliderFloat("Quadratic", &light.quadratic, 0.001f, 1.0f);
+                    changed |= ImGui::SliderFloat("Constant", &light.constant, 0.1f, 2.0f);
+                    changed |= ImGui::SliderFloat("Linear", &light.linear, 0.01f, 1.0f);
+                    changed |= ImGui::SliderFloat("Quadratic", &light.quadratic, 0.001f, 1.0f);
                     ImGui::TreePop();
                 }
             }
@@ -157,12 +332,16 @@ void GUI::renderLightingWindow()
             // Cone parameters for spotlights
             if (light.type == LightType::SPOT) {
                 if (ImGui::TreeNode("Spot Parameters")) {
-                    ImGui::SliderFloat("Cut Off", &light.cutOff, 1.0f, 45.0f);
-                    ImGui::SliderFloat("Outer Cut Off", &light.outerCutOff, light.cutOff, 45.0f);
+                    changed |= ImGui::SliderFloat("Cut Off", &light.cutOff, 1.0f, 45.0f);
+                    changed |= ImGui::SliderFloat("Outer Cut Off", &light.outerCutOff, light.cutOff, 45.0f);
                     ImGui::TreePop();
                 }
             }
             
+            if (changed) {
+                lightManager.updateLight(i, light);
+            }
+            
             if (ImGui::Button("Remove Light")) {
                 lightManager.removeLight(i);
                 ImGui::PopID(); // Must pop here before break because loop terminates
@@ -192,7 +371,7 @@ void GUI::renderLightingWindow()
     ImGui::End();
 }
 
-// Per-model material tweaking. Modifies MaterialParams directly that is uploaded to shader per object.
+// Per-model material tweaking. Modifies the ModelMaterials directly and marks the edited one for upload.
 void GUI::renderMaterialParamsWindow()
 {
     if (!renderer) return;
@@ -210,14 +389,15 @@ void GUI::renderMaterialParamsWindow()
     auto renderModelMaterial = [&](Renderer::ModelMaterial& material, const char* name, bool hasTexture) {
         if (ImGui::CollapsingHeader(name, ImGuiTreeNodeFlags_DefaultOpen)) {
             ImGui::PushID(name);
+            bool changed = false;
             
             // If no texture we can choose albedo color here.
             if (!hasTexture) {
-                ImGui::ColorEdit3("Albedo Tint", &material.params.albedo.x);
+                changed |= ImGui::ColorEdit3("Albedo Tint", &material.params.albedo.x);
             }
             
             //TODO: verify if this workaround for dark illumination models is okay
-            ImGui::SliderFloat("Intensity Correction", &material.params.intensityCorrection, 0.1f, 5.0f);
+            changed |= ImGui::SliderFloat("Intensity Correction", &material.params.intensityCorrection, 0.1f, 5.0f);
             if (ImGui::IsItemHovered()) ImGui::SetTooltip("Multiplier for base color/texture brightness");
 
             // Illumination Model Selector
@@ -225,28 +405,31 @@ void GUI::renderMaterialParamsWindow()
             int currentModel = static_cast<int>(material.model);
             if (ImGui::Combo("Illumination Model", &currentModel, illuminationModels, 5)) {
                 material.model = static_cast<IlluminationModel>(currentModel);
+                changed = true;
             }
 
             // Per-model parameter display thatonly show parameters for the selected illumination model.
             if (material.model == IlluminationModel::LAMBERTIAN) {
-                ImGui::SliderFloat("Specular Shininess", &material.params.specularShininess, 1.0f, 256.0f);
+                changed |= ImGui::SliderFloat("Specular Shininess", &material.params.specularShininess, 1.0f, 256.0f);
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("Higher = smaller, sharper highlights");
             } else if (material.model == IlluminationModel::MINNAERT) {
-                 ImGui::SliderFloat("Roughness (k)", &material.params.minnaertK, 0.0f, 2.0f);
+                 changed |= ImGui::SliderFloat("Roughness (k)", &material.params.minnaertK, 0.0f, 2.0f);
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("Controls limb darkening/brightening. 1.0 = Lambertian, <1.0 = Velvet");
             } else if (material.model == IlluminationModel::OREN_NAYAR) {
-                ImGui::SliderFloat("Roughness", &material.params.orenNayarRoughness, 0.0f, 1.0f);
+                changed |= ImGui::SliderFloat("Roughness", &material.params.orenNayarRoughness, 0.0f, 1.0f);
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("Surface roughness. Higher = flatter look");
             } else if (material.model == IlluminationModel::ASHIKHMIN_SHIRLEY) {
-                ImGui::SliderFloat("Anisotropic Nu", &material.params.ashikhminShirleyNu, 1.0f, 1000.0f);
-                ImGui::SliderFloat("Anisotropic Nv", &material.params.ashikhminShirleyNv, 1.0f, 1000.0f);
+                changed |= ImGui::SliderFloat("Anisotropic Nu", &material.params.ashikhminShirleyNu, 1.0f, 1000.0f);
+                changed |= ImGui::SliderFloat("Anisotropic Nv", &material.params.ashikhminShirleyNv, 1.0f, 1000.0f);
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("Higher values = sharper, more stretched highlights");
             } else if (material.model == IlluminationModel::COOK_TORRANCE) {
-                ImGui::SliderFloat("Roughness (m)", &material.params.cookTorranceRoughness, 0.01f, 1.0f);
-                ImGui::SliderFloat("Fresnel (F0)", &material.params.cookTorranceF0, 0.0f, 1.0f);
+                changed |= ImGui::SliderFloat("Roughness (m)", &material.params.cookTorranceRoughness, 0.01f, 1.0f);
+                changed |= ImGui::SliderFloat("Fresnel (F0)", &material.params.cookTorranceF0, 0.0f, 1.0f);
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("Roughness: highlight spread\nF0: reflectivity at normal incidence");
             }
             
+            // Only this material's entry goes to the GPU.
+            if (changed) renderer->markMaterialDirty(material);
             ImGui::PopID();
             ImGui::Spacing();
         }
@@ -308,6 +491,9 @@ void GUI::renderGlobalParamsWindow()
     if (ImGui::Checkbox("Crazy Mode", &renderer->isCrazyMode)) {
         renderer->setCrazyMode(renderer->isCrazyMode);
     }
+    ImGui::SliderInt("Extra Torches", &renderer->crazyExtraTorches, 0, 400);
+    if (ImGui::IsItemDeactivatedAfterEdit() && renderer->isCrazyMode) renderer->setCrazyMode(true);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Additional orbiting point lights in crazy mode (no shadows)");
     
     ImGui::Checkbox("Enable Toon Shading", &globalParams.enableQuantization);
 
@@ -421,7 +607,7 @@ void GUI::renderShadowsWindow()
         else if (shadowParams.shadowMapSize == 2048) currentDirRes = 2;
         else if (shadowParams.shadowMapSize == 4096) currentDirRes = 3;
         
-        if (ImGui::Combo("Dir/Spot Resolution", &currentDirRes, resolutions, 4)) {
+        if (ImGui::Combo("Spot Resolution", &currentDirRes, resolutions, 4)) {
             shadowParams.shadowMapSize = 512 * (1 << currentDirRes);
         }
         
@@ -437,27 +623,75 @@ void GUI::renderShadowsWindow()
             shadowParams.cubeShadowMapSize = 256 * (1 << currentCubeRes);
         }
         
-        ImGui::Text("Current: Dir/Spot %dx%d", shadowParams.shadowMapSize, shadowParams.shadowMapSize);
+        // Directional lights split the view into cascades, each one its own layer of this size.
+        int currentCascadeRes = 0;
+        if (shadowParams.cascadeMapSize == 512) currentCascadeRes = 0;
+        else if (shadowParams.cascadeMapSize == 1024) currentCascadeRes = 1;
+        else if (shadowParams.cascadeMapSize == 2048) currentCascadeRes = 2;
+        else if (shadowParams.cascadeMapSize == 4096) currentCascadeRes = 3;
+        
+        if (ImGui::Combo("Cascade Resolution", &currentCascadeRes, resolutions, 4)) {
+            shadowParams.cascadeMapSize = 512 * (1 << currentCascadeRes);
+        }
+        ImGui::SliderInt("Cascades", &shadowParams.cascadeCount, 1, 4);
+        ImGui::SliderFloat("Cascade Distance", &shadowParams.cascadeDistance, 10.0f, 100.0f);
+        ImGui::SliderFloat("Cascade Split (uniform/log)", &shadowParams.cascadeSplitLambda, 0.0f, 1.0f);
+        
+        ImGui::Text("Current: Spot %dx%d", shadowParams.shadowMapSize, shadowParams.shadowMapSize);
         ImGui::Text("Current: Point %dx%d (x6 faces)", shadowParams.cubeShadowMapSize, shadowParams.cubeShadowMapSize);
+        ImGui::Text("Current: Directional %d x %dx%d", shadowParams.cascadeCount, shadowParams.cascadeMapSize, shadowParams.cascadeMapSize);
+        ImGui::Text("Allocated: %.1f MB", renderer->getMemoryReport()[GpuMemoryCategory::SHADOW_MAPS] / (1024.0 * 1024.0));
     }
     
     ImGui::Separator();
     
     // PCF shadows implementation
     if (ImGui::CollapsingHeader("Shadow Quality", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (renderer->supportsLayeredPointShadows()) {
+            ImGui::Checkbox("Single-pass point shadows", &shadowParams.layeredPointShadows);
+        } else {
+            ImGui::TextDisabled("Single-pass point shadows: unsupported");
+        }
+        
+        // Cached maps are redrawn only when out of date, at most this many per frame.
+        ImGui::SliderInt("Shadow updates per frame", &shadowParams.maxShadowUpdatesPerFrame, 0, 8);
+        ImGui::SliderFloat("Light move tolerance", &shadowParams.positionTolerance, 0.0f, 0.5f);
+        ImGui::SliderFloat("Light turn tolerance (rad)", &shadowParams.directionTolerance, 0.0f, 0.05f, "%.4f");
+        
         ImGui::Checkbox("Enable PCF (Soft Shadows)", &shadowParams.enablePCF);
         
         if (shadowParams.enablePCF) {
+            const char* filters[] = { "Grid", "Poisson Disk" };
+            int filter = static_cast<int>(shadowParams.shadowFilter);
+            if (ImGui::Combo("PCF Kernel", &filter, filters, 2)) {
+                shadowParams.shadowFilter = static_cast<ShadowFilter>(filter);
+            }
             ImGui::SliderInt("PCF Kernel Size", &shadowParams.shadowPCFSamples, 0, 4);
             int kernelSize = shadowParams.shadowPCFSamples * 2 + 1;
-            ImGui::Text("Sampling %dx%d kernel", kernelSize, kernelSize);
+            
+            // Every tap is a hardware 2x2 compare, so the tap counts stay small.
+            int taps = 1;
+            if (shadowParams.shadowPCFSamples > 0) {
+                if (shadowParams.shadowFilter == ShadowFilter::POISSON) {
+                    const int tapChoices[] = { 8, 16, 32 };
+                    const char* tapLabels[] = { "8", "16", "32" };
+                    int tapIndex = shadowParams.poissonTaps >= 32 ? 2 : (shadowParams.poissonTaps >= 16 ? 1 : 0);
+                    if (ImGui::Combo("Poisson Taps", &tapIndex, tapLabels, 3)) {
+                        shadowParams.poissonTaps = tapChoices[tapIndex];
+                    }
+                    taps = tapChoices[tapIndex];
+                } else {
+                    taps = (shadowParams.shadowPCFSamples + 1) * (shadowParams.shadowPCFSamples + 1);
+                }
+            }
+            ImGui::Text("%dx%d texel footprint, %d filtered taps", kernelSize + 1, kernelSize + 1, taps);
             
             if (shadowParams.shadowPCFSamples == 0) {
-                ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "No filtering");
-            } else if (shadowParams.shadowPCFSamples == 1) {
+                ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Hardware 2x2 filtering only");
+            } else if (taps <= 16) {
                 ImGui::TextColored(ImVec4(0.5f, 1.0f, 0.5f, 1.0f), "Balanced");
-            } else if (shadowParams.shadowPCFSamples >= 3) {
-                ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.5f, 1.0f), "High quality, low FPS");
+            } else {
+                ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.5f, 1.0f), "High quality");
             }
         } else {
             ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Low quality, high FPS");
@@ -500,29 +734,6 @@ void GUI::renderShadowsWindow()
     
     ImGui::Separator();
     
-    // Memory usage estimate
-    if (ImGui::CollapsingHeader("Memory usage for shadows")) {
-        auto& lightManager = renderer->getLightManager();
-        size_t lightCount = lightManager.getLightCount();
-        
-        size_t dirLights = 0, pointLights = 0, spotLights = 0;
-        for (size_t i = 0; i < lightCount; ++i) {
-            switch (lightManager.getLight(i).type) {
-                case LightType::DIRECTIONAL: dirLights++; break;
-                case LightType::POINT: pointLights++; break;
-                case LightType::SPOT: spotLights++; break;
-            }
-        }
-        size_t memUsage = 0;
-        memUsage += (dirLights + spotLights) * shadowParams.shadowMapSize * shadowParams.shadowMapSize * 4; // depth buffer bytes
-        memUsage += pointLights * 6 * shadowParams.cubeShadowMapSize * shadowParams.cubeShadowMapSize * 4;
-        
-        float memUsageMB = memUsage / (1024.0f * 1024.0f);
-        ImGui::Text("Estimation: %.1f MB", memUsageMB);
-    }
-    
-    ImGui::Separator();
-    
     ImGui::End();
 }
 
@@ -27,6 +27,7 @@ public:
     void renderGlobalParamsWindow();
     void renderShadowsWindow();
     void renderPresetsWindow();
+    void renderProfilerWindow();
 
 private:
     GLFWwindow* window;    // Handle to the OS window (for input forwarding)
@@ -40,4 +41,6 @@ private:
     bool showGlobalParams = false;
     bool showShadows = false;
     bool showPresets = false;
+    bool showProfiler = false;
+    int profilerTimeline = 0; // 0 = GPU, 1 = CPU
 };
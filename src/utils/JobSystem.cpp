@@ -0,0 +1,155 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+namespace {
+    // Which JobSystem (and which of its workers) the current thread belongs to.
+    thread_local const JobSystem* workerOwner = nullptr;
+    thread_local size_t workerIndex = 0;
+}
+
+JobSystem::JobSystem(unsigned int threadCount)
+    : queuedJobs(0), nextQueue(0), stopping(false)
+{
+    if (threadCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threadCount = std::max(1u, hardware > 1 ? hardware - 1 : 1u);
+    }
+
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+size_t JobSystem::currentWorker() const
+{
+    return workerOwner == this ? workerIndex : queues.size();
+}
+
+void JobSystem::run(JobGroup& group, std::function<void()> job)
+{
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+
+    // Workers keep what they spawn (it's likely still in cache), outside threads spread their jobs.
+    size_t index = currentWorker();
+    if (index == queues.size()) index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->jobs.push_back({ std::move(job), &group });
+    }
+    queuedJobs.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders this with a worker that's about to sleep, so the wake-up can't be lost.
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wakeUp.notify_one();
+}
+
+bool JobSystem::takeJob(size_t index, Job& job)
+{
+    if (queuedJobs.load(std::memory_order_acquire) == 0) return false;
+
+    if (index < queues.size()) {
+        WorkerQueue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i <= queues.size(); ++i) {
+        WorkerQueue& victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(Job& job)
+{
+    // An escaping exception would terminate the process from a thread nobody is watching.
+    try {
+        job.function();
+    } catch (const std::exception& e) {
+        std::cerr << "Job failed: " << e.what() << std::endl;
+    }
+    job.group->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::wait(JobGroup& group)
+{
+    size_t index = currentWorker();
+    while (!group.isDone()) {
+        Job job;
+        if (takeJob(index, job)) {
+            execute(job);
+        } else {
+            // The last jobs of the group are running elsewhere; they're short, don't sleep on them.
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body)
+{
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+
+    // A few chunks per thread, so stealing can even out uneven chunks.
+    size_t threads = workers.size() + 1;
+    size_t chunk = std::max(grain, (count + threads * 4 - 1) / (threads * 4));
+    if (chunk >= count) {
+        body(0, count);
+        return;
+    }
+
+    JobGroup group;
+    for (size_t begin = chunk; begin < count; begin += chunk) {
+        size_t end = std::min(count, begin + chunk);
+        run(group, [&body, begin, end]() { body(begin, end); });
+    }
+    body(0, chunk);
+    wait(group);
+}
+
+void JobSystem::workerLoop(size_t index)
+{
+    workerOwner = this;
+    workerIndex = index;
+
+    for (;;) {
+        Job job;
+        if (takeJob(index, job)) {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this] { return stopping || queuedJobs.load(std::memory_order_acquire) > 0; });
+        if (stopping) return;
+    }
+}
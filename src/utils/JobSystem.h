@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing job system for the short, CPU-only jobs of a frame (culling, draw list building).
+// Every worker has its own queue: it takes its newest job first and, when empty, steals the oldest job of
+// another worker. Threads waiting on a JobGroup run queued jobs meanwhile instead of blocking, so the main
+// thread is one more worker while it waits. ThreadPool stays for the long blocking jobs (file loading).
+// Same rule as ThreadPool: jobs must not touch GL.
+class JobSystem
+{
+public:
+    // Jobs that can be waited on together. Must outlive its jobs (wait() before it goes out of scope).
+    class JobGroup
+    {
+    public:
+        JobGroup() : pending(0) {}
+        bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<int> pending;
+    };
+
+    // 0 picks one thread less than the hardware has (the main thread joins in while waiting), at least one.
+    explicit JobSystem(unsigned int threadCount = 0);
+    // Runs the queued jobs, then joins the workers.
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void run(JobGroup& group, std::function<void()> job);
+    // Returns once every job of group has finished, running queued jobs (of any group) in the meantime.
+    void wait(JobGroup& group);
+
+    // Calls body(begin, end) over [0, count) in chunks of at least grain items, the caller included. Blocking.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body);
+
+    size_t getThreadCount() const { return workers.size(); }
+
+private:
+    struct Job {
+        std::function<void()> function;
+        JobGroup* group;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues; // One per worker
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queuedJobs;
+    std::atomic<size_t> nextQueue;     // Round-robin target for jobs pushed from outside the workers
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+
+    void workerLoop(size_t index);
+    // Own queue from the back, then the others from the front. index is ignored for non-workers.
+    bool takeJob(size_t index, Job& job);
+    void execute(Job& job);
+    size_t currentWorker() const;
+};
@@ -0,0 +1,61 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : stopping(false)
+{
+    if (threadCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threadCount = std::max(1u, hardware > 1 ? hardware - 1 : 1u);
+    }
+
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    wakeUp.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    wakeUp.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        // An escaping exception would terminate the process from a thread nobody is watching.
+        try {
+            job();
+        } catch (const std::exception& e) {
+            std::cerr << "Worker job failed: " << e.what() << std::endl;
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs from one FIFO queue.
+// Jobs must not touch GL: the context is only current on the main thread.
+class ThreadPool
+{
+public:
+    // 0 picks one thread less than the hardware has (the main thread keeps rendering), at least one.
+    explicit ThreadPool(unsigned int threadCount = 0);
+    // Jobs still queued are dropped, running ones are waited for.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> job);
+
+    size_t getThreadCount() const { return workers.size(); }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+
+    void workerLoop();
+};